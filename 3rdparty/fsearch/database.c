@@ -24,6 +24,8 @@
 #include <sys/time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
 #include <dirent.h>
@@ -42,6 +44,9 @@
 //#define WS_FOLLOWLINK	(1 << 1)	/* follow symlinks */
 #define WS_DOTFILES	(1 << 2)	/* per unix convention, .file is hidden */
 
+// number of per-location snapshots kept on disk
+#define DB_MAX_SNAPSHOTS 16
+
 struct _Database
 {
     GList *locations;
@@ -93,20 +98,48 @@ db_update_timestamp (Database *db)
     db->timestamp = time(NULL);
 }
 
+static bool
+db_read_from_buffer (const char **cursor, const char *end, void *dest, size_t len)
+{
+    if ((size_t)(end - *cursor) < len) {
+        return false;
+    }
+    memcpy (dest, *cursor, len);
+    *cursor += len;
+    return true;
+}
+
 DatabaseLocation *
 db_location_load_from_file (const char *fname)
 {
     assert (fname != NULL);
 
-    FILE *fp = fopen (fname, "rb");
-    if (!fp) {
+    int fd = open (fname, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
         return NULL;
     }
 
+    struct stat st;
+    if (fstat (fd, &st) == -1 || st.st_size <= 0) {
+        close (fd);
+        return NULL;
+    }
+
+    // map the whole database and parse it in place instead of issuing one read per field
+    const size_t data_size = st.st_size;
+    char *data = mmap (NULL, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    madvise (data, data_size, MADV_SEQUENTIAL);
+
+    const char *cursor = data;
+    const char *end = data + data_size;
     BTreeNode *root = NULL;
 
     char magic[4];
-    if (fread (magic, 1, 4, fp) != 4) {
+    if (!db_read_from_buffer (&cursor, end, magic, 4)) {
         printf ("failed to read magic\n");
         goto load_fail;
     }
@@ -116,7 +149,7 @@ db_location_load_from_file (const char *fname)
     }
 
     uint8_t majorver = 0;
-    if (fread (&majorver, 1, 1, fp) != 1) {
+    if (!db_read_from_buffer (&cursor, end, &majorver, 1)) {
         goto load_fail;
     }
     if (majorver != 0) {
@@ -125,7 +158,7 @@ db_location_load_from_file (const char *fname)
     }
 
     uint8_t minorver = 0;
-    if (fread (&minorver, 1, 1, fp) != 1) {
+    if (!db_read_from_buffer (&cursor, end, &minorver, 1)) {
         goto load_fail;
     }
     if (minorver != 1) {
@@ -135,7 +168,7 @@ db_location_load_from_file (const char *fname)
     printf ("database version=%d.%d\n", majorver, minorver);
 
     uint32_t num_items = 0;
-    if (fread (&num_items, 1, 4, fp) != 4) {
+    if (!db_read_from_buffer (&cursor, end, &num_items, 4)) {
         goto load_fail;
     }
 
@@ -143,7 +176,7 @@ db_location_load_from_file (const char *fname)
     BTreeNode *prev = NULL;
     while (true) {
         uint16_t name_len = 0;
-        if (fread (&name_len, 1, 2, fp) != 2) {
+        if (!db_read_from_buffer (&cursor, end, &name_len, 2)) {
             printf("failed to read name length\n");
             goto load_fail;
         }
@@ -164,7 +197,7 @@ db_location_load_from_file (const char *fname)
 
         // read name
         char name[name_len + 1];
-        if (fread (&name, 1, name_len, fp) != name_len) {
+        if (!db_read_from_buffer (&cursor, end, name, name_len)) {
             printf("failed to read name\n");
             goto load_fail;
         }
@@ -172,28 +205,28 @@ db_location_load_from_file (const char *fname)
 
         // read is_dir
         uint8_t is_dir = 0;
-        if (fread (&is_dir, 1, 1, fp) != 1) {
+        if (!db_read_from_buffer (&cursor, end, &is_dir, 1)) {
             printf("failed to read is_dir\n");
             goto load_fail;
         }
 
         // read size
         uint64_t size = 0;
-        if (fread (&size, 1, 8, fp) != 8) {
+        if (!db_read_from_buffer (&cursor, end, &size, 8)) {
             printf("failed to read size\n");
             goto load_fail;
         }
 
         // read mtime
         uint64_t mtime = 0;
-        if (fread (&mtime, 1, 8, fp) != 8) {
+        if (!db_read_from_buffer (&cursor, end, &mtime, 8)) {
             printf("failed to read mtime\n");
             goto load_fail;
         }
 
-        // read mtime
+        // read sort position
         uint32_t pos = 0;
-        if (fread (&pos, 1, 4, fp) != 4) {
+        if (!db_read_from_buffer (&cursor, end, &pos, 4)) {
             printf("failed to read sort position\n");
             goto load_fail;
         }
@@ -218,15 +251,13 @@ db_location_load_from_file (const char *fname)
     location->num_items = num_items_read;
     location->entries = root;
 
-    fclose (fp);
+    munmap (data, data_size);
 
     return location;
 
 load_fail:
     fprintf (stderr, "database load fail (%s)!\n", fname);
-    if (fp) {
-        fclose (fp);
-    }
+    munmap (data, data_size);
     if (root) {
         btree_node_free (root);
     }
@@ -244,11 +275,21 @@ db_location_write_to_file (DatabaseLocation *location, const char *path)
     }
     g_mkdir_with_parents (path, 0700);
 
+    // write to a unique temporary file first, so a reader never maps a half written database
+    // and concurrent saves of the same location never write into each other's file
     gchar tempfile[PATH_MAX] = "";
-    snprintf (tempfile, sizeof (tempfile), "%s/database.db", path);
+    snprintf (tempfile, sizeof (tempfile), "%s/database.db.XXXXXX", path);
+    gchar dbfile[PATH_MAX] = "";
+    snprintf (dbfile, sizeof (dbfile), "%s/database.db", path);
 
-    FILE *fp = fopen (tempfile, "w+b");
+    int fd = g_mkstemp (tempfile);
+    if (fd < 0) {
+        return false;
+    }
+    FILE *fp = fdopen (fd, "w+b");
     if (!fp) {
+        close (fd);
+        unlink (tempfile);
         return false;
     }
 
@@ -354,7 +395,10 @@ db_location_write_to_file (DatabaseLocation *location, const char *path)
 
     }
 
-    fclose (fp);
+    if (fclose (fp) != 0 || rename (tempfile, dbfile) != 0) {
+        unlink (tempfile);
+        return false;
+    }
     return true;
 
 save_fail:
@@ -488,6 +532,174 @@ db_location_walk_tree_recursive (DatabaseLocation *location,
     return WALK_OK;
 }
 
+static void
+db_location_refresh_recursive (DatabaseLocation *location,
+                               GList *excludes,
+                               char **exclude_files,
+                               const char *dname,
+                               GTimer *timer,
+                               BTreeNode *parent,
+                               bool *state,
+                               bool is_data_prefix)
+{
+    if (!(*state) || !db_support (dname, is_data_prefix)) {
+        return;
+    }
+
+    int len = strlen (dname);
+    if (len >= FILENAME_MAX - 1) {
+        return;
+    }
+
+    char fn[FILENAME_MAX] = "";
+    strcpy (fn, dname);
+    if (strcmp (dname, "/")) {
+        fn[len++] = '/';
+    }
+
+    struct stat st;
+    if (lstat (dname, &st) == -1) {
+        return;
+    }
+
+    if (parent->mtime == st.st_mtime) {
+        // adding, removing or renaming an entry updates the mtime of its directory,
+        // so the children of an unchanged directory are still valid
+        for (BTreeNode *child = parent->children; child && (*state); child = child->next) {
+            if (!child->is_dir) {
+                continue;
+            }
+            strncpy (fn + len, child->name, FILENAME_MAX - len);
+            db_location_refresh_recursive (location,
+                                           excludes,
+                                           exclude_files,
+                                           fn,
+                                           timer,
+                                           child,
+                                           state,
+                                           is_data_prefix);
+        }
+        return;
+    }
+
+    DIR *dir = NULL;
+    if (!(dir = opendir (dname))) {
+        return;
+    }
+
+    // whatever is left in this table after reading the directory has been removed
+    GHashTable *known_children = g_hash_table_new (g_str_hash, g_str_equal);
+    for (BTreeNode *child = parent->children; child; child = child->next) {
+        g_hash_table_insert (known_children, child->name, child);
+    }
+
+    struct dirent *dent = NULL;
+    while ((*state) && (dent = readdir (dir))) {
+        if (!strcmp (dent->d_name, ".") || !strcmp (dent->d_name, "..") || dent->d_name[0] == '.') {
+            continue;
+        }
+        if (file_is_excluded (dent->d_name, exclude_files)) {
+            continue;
+        }
+
+        struct stat child_st;
+        strncpy (fn + len, dent->d_name, FILENAME_MAX - len);
+
+        if (lstat (fn, &child_st) == -1) {
+            continue;
+        }
+
+        if (directory_is_excluded (fn, excludes)) {
+            continue;
+        }
+
+        const bool is_dir = S_ISDIR (child_st.st_mode);
+        BTreeNode *node = g_hash_table_lookup (known_children, dent->d_name);
+        if (node && node->is_dir == is_dir) {
+            g_hash_table_remove (known_children, dent->d_name);
+            node->size = child_st.st_size;
+            if (is_dir) {
+                db_location_refresh_recursive (location,
+                                               excludes,
+                                               exclude_files,
+                                               fn,
+                                               timer,
+                                               node,
+                                               state,
+                                               is_data_prefix);
+            }
+            else {
+                node->mtime = child_st.st_mtime;
+            }
+            continue;
+        }
+
+        node = btree_node_new (dent->d_name,
+                               child_st.st_mtime,
+                               child_st.st_size,
+                               0,
+                               is_dir);
+        btree_node_prepend (parent, node);
+        if (is_dir) {
+            db_location_walk_tree_recursive (location,
+                                             excludes,
+                                             exclude_files,
+                                             fn,
+                                             timer,
+                                             NULL,
+                                             node,
+                                             0,
+                                             state,
+                                             is_data_prefix);
+        }
+    }
+    closedir (dir);
+
+    if (*state) {
+        GHashTableIter iter;
+        gpointer removed = NULL;
+        g_hash_table_iter_init (&iter, known_children);
+        while (g_hash_table_iter_next (&iter, NULL, &removed)) {
+            btree_node_free (removed);
+        }
+        // only remember the new mtime once the directory has been fully synced
+        parent->mtime = st.st_mtime;
+    }
+    g_hash_table_destroy (known_children);
+}
+
+bool
+db_location_refresh (Database *db, const char *location_name, FsearchConfig *config, bool *state)
+{
+    assert (db != NULL);
+    assert (location_name != NULL);
+
+    db_lock (db);
+    DatabaseLocation *location = db_location_get_for_path (db, !strcmp (location_name, "/") ? "" : location_name);
+    if (!location) {
+        db_unlock (db);
+        return false;
+    }
+
+    GTimer *timer = g_timer_new ();
+    g_timer_start (timer);
+    bool is_data_prefix = strncmp("/data", location_name, strlen("/data")) == 0;
+    db_location_refresh_recursive (location,
+                                   config->exclude_locations,
+                                   config->exclude_files,
+                                   location_name,
+                                   timer,
+                                   location->entries,
+                                   state,
+                                   is_data_prefix);
+    g_timer_destroy (timer);
+
+    location->num_items = btree_node_n_nodes (location->entries);
+    db_update_timestamp (db);
+    db_unlock (db);
+    return *state;
+}
+
 static DatabaseLocation *
 db_location_build_tree (const char *dname, FsearchConfig *cfg, bool *state, void (*callback)(const char *))
 {
@@ -553,13 +765,13 @@ db_traverse_tree_insert (BTreeNode *node, void *data)
     btree_node_traverse (node, db_list_insert_node, data);
 }
 
-static uint32_t temp_index = 0;
-
 bool
 db_list_add_node (BTreeNode *node, void *data)
 {
     Database *db = data;
-    darray_set_item (db->entries, node, temp_index++);
+    // the entries list is cleared before adding, so num_entries is the next free index;
+    // a file-static counter would be shared by databases built in parallel
+    darray_set_item (db->entries, node, db->num_entries);
     db->num_entries++;
     return true;
 }
@@ -678,6 +890,76 @@ db_location_delete (DatabaseLocation *location, const char *location_name)
     g_remove (database_path);
 }
 
+typedef struct {
+    gchar *path;
+    time_t mtime;
+} DatabaseSnapshot;
+
+static gint
+db_snapshot_compare_newest_first (gconstpointer a, gconstpointer b)
+{
+    const DatabaseSnapshot *sa = a;
+    const DatabaseSnapshot *sb = b;
+    return (sa->mtime < sb->mtime) - (sa->mtime > sb->mtime);
+}
+
+static void
+db_snapshot_remove (const char *snapshot_path)
+{
+    GDir *dir = g_dir_open (snapshot_path, 0, NULL);
+    if (dir) {
+        const gchar *name = NULL;
+        while ((name = g_dir_read_name (dir))) {
+            gchar *file_path = g_build_filename (snapshot_path, name, NULL);
+            g_remove (file_path);
+            g_free (file_path);
+        }
+        g_dir_close (dir);
+    }
+    g_rmdir (snapshot_path);
+}
+
+// every searched location gets its own snapshot directory, only keep the most recently saved ones
+static void
+db_evict_snapshots (void)
+{
+    gchar config_dir[PATH_MAX] = "";
+    config_build_dir (config_dir, sizeof (config_dir));
+
+    gchar database_dir[PATH_MAX] = "";
+    snprintf (database_dir, sizeof (database_dir), "%s/database", config_dir);
+
+    GDir *dir = g_dir_open (database_dir, 0, NULL);
+    if (!dir) {
+        return;
+    }
+
+    GArray *snapshots = g_array_new (FALSE, FALSE, sizeof (DatabaseSnapshot));
+    const gchar *name = NULL;
+    while ((name = g_dir_read_name (dir))) {
+        DatabaseSnapshot snapshot = { g_build_filename (database_dir, name, NULL), 0 };
+        struct stat st;
+        // saving a snapshot creates and renames a file in its directory, so the directory mtime is its last use
+        if (stat (snapshot.path, &st) != 0 || !S_ISDIR (st.st_mode)) {
+            g_free (snapshot.path);
+            continue;
+        }
+        snapshot.mtime = st.st_mtime;
+        g_array_append_val (snapshots, snapshot);
+    }
+    g_dir_close (dir);
+
+    g_array_sort (snapshots, db_snapshot_compare_newest_first);
+    for (guint i = 0; i < snapshots->len; ++i) {
+        DatabaseSnapshot *snapshot = &g_array_index (snapshots, DatabaseSnapshot, i);
+        if (i >= DB_MAX_SNAPSHOTS) {
+            db_snapshot_remove (snapshot->path);
+        }
+        g_free (snapshot->path);
+    }
+    g_array_free (snapshots, TRUE);
+}
+
 bool
 db_save_location (Database *db, const char *location_name)
 {
@@ -692,8 +974,8 @@ db_save_location (Database *db, const char *location_name)
     gchar database_fname[PATH_MAX] = "";
     assert (0 <= snprintf (database_fname, sizeof (database_fname), "%s/database.db", database_path));
     DatabaseLocation *location = db_location_get_for_path (db, location_name);
-    if (location) {
-        db_location_write_to_file (location, database_path);
+    if (location && db_location_write_to_file (location, database_path)) {
+        db_evict_snapshots ();
     }
 
     return true;
@@ -827,7 +1109,6 @@ db_build_initial_entries_list (Database *db)
     db->entries = darray_new (num_entries);
 
     GList *locations = db->locations;
-    temp_index = 0;
     for (GList *l = locations; l != NULL; l = l->next) {
         db_list_add_location (db, l->data);
     }
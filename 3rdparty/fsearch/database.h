@@ -46,6 +46,12 @@ db_location_add(Database *db,
 bool
 db_location_remove(Database *db, const char *path);
 
+bool
+db_location_refresh(Database *db,
+                    const char *location_name,
+                    FsearchConfig *config,
+                    bool *state);
+
 bool
 db_location_write_to_file(DatabaseLocation *location, const char *fname);
 
@@ -68,6 +74,9 @@ db_update_sort_index(Database *db);
 bool
 db_save_locations(Database *db);
 
+bool
+db_save_location(Database *db, const char *location_name);
+
 void
 db_update_entries_list(Database *db);
 
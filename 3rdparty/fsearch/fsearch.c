@@ -149,12 +149,39 @@ load_database (FsearchApplication*app, const char *path, bool *state)
     app->db = db_new ();
     if (db_location_add (app->db, path, app->config, state, build_location_callback)) {
        db_build_initial_entries_list (app->db);
+       // only a complete walk is worth keeping for the next search
+       if (*state) {
+           db_save_location (app->db, path);
+       }
     }
     timer_stop ();
 
     return NULL;
 }
 
+bool
+load_database_from_snapshot (FsearchApplication *app, const char *path, bool *state)
+{
+    timer_start ();
+    Database *db = db_new ();
+    if (!db_location_load (db, path)) {
+        db_free (db);
+        return false;
+    }
+    // bring the snapshot up to date before it answers a search, only directories whose mtime changed are read again
+    if (!db_location_refresh (db, path, app->config, state)) {
+        db_clear (db);
+        db_free (db);
+        return false;
+    }
+    db_build_initial_entries_list (db);
+    db_save_location (db, path);
+    app->db = db;
+    timer_stop ();
+
+    return true;
+}
+
 void
 fsearch_application_startup (FsearchApplication* app)
 {
@@ -60,5 +60,8 @@ fsearch_application_startup(FsearchApplication *app);
 gpointer
 load_database(FsearchApplication *app, const char *path, bool *state);
 
+bool
+load_database_from_snapshot(FsearchApplication *app, const char *path, bool *state);
+
 void
 fsearch_application_init(FsearchApplication *app);
@@ -27,56 +27,31 @@
 // in the LICENSE file.
 
 #include "chinese2pinyin.h"
+#include "pinyin_table.h"
 
-#include <QHash>
-#include <QTextStream>
-#include <QFile>
+#include <QLatin1String>
 
 namespace Pinyin {
 
-static QHash<uint, QString> dict = {};
+// pinyin_table.h 由 generate_pinyin_table.sh 在编译时从 pinyin.dict 生成，
+// 按码位直接索引，不需要在运行时解析字典，也不需要加锁
+static inline const char *syllableOf(uint code)
+{
+    if (code < kFirstCodePoint || code > kLastCodePoint)
+        return nullptr;
 
-const char kDictFile[] = ":/misc/pinyin.dict";
-
-void InitDict() {
-    if (!dict.isEmpty()) {
-        return;
-    }
-
-    dict.reserve(25333);
-
-    QFile file(kDictFile);
-
-    if (!file.open(QIODevice::ReadOnly))
-        return;
-
-    QByteArray content = file.readAll();
-
-    file.close();
-
-    QTextStream stream(&content, QIODevice::ReadOnly);
-
-    while (!stream.atEnd()) {
-        const QString line = stream.readLine();
-        const QStringList items = line.split(QChar(':'));
-
-        if (items.size() == 2) {
-            dict.insert(static_cast<uint>(items[0].toInt(nullptr, 16)), items[1]);
-        }
-    }
+    return kSyllables[kSyllableIndexes[code - kFirstCodePoint]];
 }
 
 QString Chinese2Pinyin(const QString& words) {
-    InitDict();
-
     QString result;
+    result.reserve(words.length() * 2);
 
     for (int i = 0; i < words.length(); ++i) {
-        const uint key = words.at(i).unicode();
-        auto find_result = dict.find(key);
+        const char *syllable = syllableOf(words.at(i).unicode());
 
-        if (find_result != dict.end()) {
-            result.append(find_result.value());
+        if (syllable) {
+            result.append(QLatin1String(syllable));
         } else {
             result.append(words.at(i));
         }
@@ -0,0 +1,82 @@
+#!/bin/sh
+# this file is used to generate the codepoint-indexed pinyin table from pinyin.dict at build time.
+# usage: generate_pinyin_table.sh <pinyin.dict> <pinyin_table.h>
+
+if [ $# -ne 2 ]; then
+    echo "usage: $0 <pinyin.dict> <pinyin_table.h>" >&2
+    exit 1
+fi
+
+awk -F: '
+function hex2dec(hex,    i, c, value) {
+    value = 0
+    hex = tolower(hex)
+    sub(/^0x/, "", hex)
+
+    for (i = 1; i <= length(hex); ++i) {
+        c = index("0123456789abcdef", substr(hex, i, 1))
+        if (c == 0)
+            return -1
+        value = value * 16 + c - 1
+    }
+
+    return value
+}
+
+NF == 2 {
+    code = hex2dec($1)
+    if (code < 0 || $2 == "")
+        next
+
+    if (!($2 in syllableIndex)) {
+        syllableIndex[$2] = ++syllableCount
+        syllables[syllableCount] = $2
+    }
+
+    indexOfCode[code] = syllableIndex[$2]
+
+    if (count == 0 || code < first)
+        first = code
+    if (count == 0 || code > last)
+        last = code
+    ++count
+}
+
+END {
+    if (count == 0) {
+        print "no entry in the pinyin dict" > "/dev/stderr"
+        exit 1
+    }
+
+    print "// generated by generate_pinyin_table.sh from pinyin.dict, do not edit."
+    print ""
+    print "#ifndef PINYIN_TABLE_H"
+    print "#define PINYIN_TABLE_H"
+    print ""
+    print "namespace Pinyin {"
+    print ""
+    printf "static constexpr unsigned int kFirstCodePoint = 0x%x;\n", first
+    printf "static constexpr unsigned int kLastCodePoint = 0x%x;\n", last
+    print ""
+    print "// 0 means the codepoint has no pinyin"
+    print "static constexpr const char *const kSyllables[] = {"
+    print "    nullptr,"
+    for (i = 1; i <= syllableCount; ++i)
+        printf "    \"%s\",\n", syllables[i]
+    print "};"
+    print ""
+    print "static constexpr unsigned short kSyllableIndexes[kLastCodePoint - kFirstCodePoint + 1] = {"
+    for (code = first; code <= last; ++code) {
+        if ((code - first) % 16 == 0)
+            printf "   "
+        printf " %d,", (code in indexOfCode) ? indexOfCode[code] : 0
+        if ((code - first) % 16 == 15 || code == last)
+            printf "\n"
+    }
+    print "};"
+    print ""
+    print "}  // namespace Pinyin end"
+    print ""
+    print "#endif // PINYIN_TABLE_H"
+}
+' "$1" > "$2.tmp" && mv "$2.tmp" "$2"
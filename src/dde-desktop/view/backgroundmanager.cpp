@@ -26,6 +26,23 @@
 
 #include <qpa/qplatformwindow.h>
 #include <QImageReader>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFileInfo>
+#include <QDataStream>
+
+#include <utime.h>
+
+//壁纸缓存的最大数量和总大小，每个屏幕分辨率和每张壁纸各占一个，4K屏幕的一张缓存约32MB
+static const int kWallpaperCacheCount = 4;
+static const qint64 kWallpaperCacheBytes = 128 * 1024 * 1024;
+//壁纸缓存保存未压缩的像素数据，读取时不需要解码，文件头记录图片的尺寸和格式
+static const quint32 kWallpaperCacheMagic = 0x44575043; // "DWPC"
+static const quint32 kWallpaperCacheVersion = 1;
 
 BackgroundManager::BackgroundManager(bool preview, QObject *parent)
     : QObject(parent)
@@ -397,25 +414,12 @@ void BackgroundManager::onSkipBackgroundBuild()
 
 void BackgroundManager::onResetBackgroundImage()
 {
-    auto getPix = [](const QString & path, const QPixmap & defalutPixmap)->QPixmap{
-        if (path.isEmpty())
-            return defalutPixmap;
-
-        QString currentWallpaper = path.startsWith("file:") ? QUrl(path).toLocalFile() : path;
-        QPixmap backgroundPixmap(currentWallpaper);
-        // fix whiteboard shows when a jpeg file with filename xxx.png
-        // content formart not epual to extension
-        if (backgroundPixmap.isNull()) {
-            QImageReader reader(currentWallpaper);
-            reader.setDecideFormatFromContent(true);
-            backgroundPixmap = QPixmap::fromImage(reader.read());
-        }
-        return backgroundPixmap.isNull() ? defalutPixmap : backgroundPixmap;
-    };
-
-    QPixmap defaultImage;
+    const quint64 generation = ++m_resetGeneration;
 
     QMap<QString, QString> recorder; //记录有效的壁纸
+    //相同壁纸和分辨率的屏幕只解码一次
+    QMap<QString, QStringList> taskScreens;
+    QMap<QString, QPair<QString, QSize>> tasks;
     for (ScreenPointer sp : m_backgroundMap.keys()) {
         QString userPath;
         if (!m_backgroundImagePath.contains(sp->name())) {
@@ -424,37 +428,207 @@ void BackgroundManager::onResetBackgroundImage()
             userPath = m_backgroundImagePath.value(sp->name());
         }
 
-        if (!userPath.isEmpty())
-            recorder.insert(sp->name(), userPath);
-
-        QPixmap backgroundPixmap = getPix(userPath, defaultImage);
-        if (backgroundPixmap.isNull()) {
+        if (userPath.isEmpty()) {
             qCritical() << "screen " << sp->name() << "backfround path" << userPath
                         << "can not read!";
             continue;
         }
 
-        BackgroundWidgetPointer bw = m_backgroundMap.value(sp);
+        recorder.insert(sp->name(), userPath);
+
         QSize trueSize = sp->handleGeometry().size(); //使用屏幕缩放前的分辨率
-        auto pix = backgroundPixmap.scaled(trueSize,
-                                           Qt::KeepAspectRatioByExpanding,
-                                           Qt::SmoothTransformation);
+        const QString &key = QString("%1@%2x%3").arg(userPath).arg(trueSize.width()).arg(trueSize.height());
+        taskScreens[key] << sp->name();
+        tasks.insert(key, qMakePair(userPath, trueSize));
+    }
 
-        if (pix.width() > trueSize.width() || pix.height() > trueSize.height()) {
-            pix = pix.copy(QRect(static_cast<int>((pix.width() - trueSize.width()) / 2.0),
-                                 static_cast<int>((pix.height() - trueSize.height()) / 2.0),
-                                 trueSize.width(),
-                                 trueSize.height()));
+    //在线程中解码壁纸，避免大图阻塞桌面
+    for (auto iter = tasks.constBegin(); iter != tasks.constEnd(); ++iter) {
+        const QString path = iter.value().first;
+        const QStringList screens = taskScreens.value(iter.key());
+        QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+
+        connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, generation, path, screens]() {
+            watcher->deleteLater();
+
+            //已经重新设置过壁纸或屏幕已改变
+            if (generation != m_resetGeneration)
+                return;
+
+            const QImage &image = watcher->result();
+            for (const QString &screen : screens)
+                applyBackgroundImage(screen, path, image);
+        });
+
+        watcher->setFuture(QtConcurrent::run(&BackgroundManager::loadWallpaper, path, iter.value().second));
+    }
+
+    //更新壁纸
+    m_backgroundImagePath = recorder;
+}
+
+void BackgroundManager::applyBackgroundImage(const QString &screen, const QString &path, const QImage &image)
+{
+    for (ScreenPointer sp : m_backgroundMap.keys()) {
+        if (sp->name() != screen)
+            continue;
+
+        if (image.isNull()) {
+            qCritical() << "screen " << sp->name() << "backfround path" << path
+                        << "can not read!";
+            return;
         }
 
-        qDebug() << sp->name() << "background path" << userPath << "truesize" << trueSize << "devicePixelRatio"
+        BackgroundWidgetPointer bw = m_backgroundMap.value(sp);
+        QPixmap pix = QPixmap::fromImage(image);
+
+        qDebug() << sp->name() << "background path" << path << "truesize" << image.size() << "devicePixelRatio"
                  << bw->devicePixelRatioF() << pix << "widget" << bw.get();
         pix.setDevicePixelRatio(bw->devicePixelRatioF());
         bw->setPixmap(pix);
+        return;
     }
+}
 
-    //更新壁纸
-    m_backgroundImagePath = recorder;
+QImage BackgroundManager::loadWallpaper(const QString &path, const QSize &trueSize)
+{
+    QString currentWallpaper = path.startsWith("file:") ? QUrl(path).toLocalFile() : path;
+
+    //缓存按文件路径、修改时间和屏幕分辨率区分，登录和切换屏幕时不用重新解码原图
+    const QString &cachePath = wallpaperCachePath(currentWallpaper, trueSize);
+    QImage image;
+
+    if (!cachePath.isEmpty()) {
+        image = readWallpaperCache(cachePath, trueSize);
+        if (!image.isNull()) {
+            //更新修改时间，按时间淘汰缓存时保留最近使用的
+            utime(QFile::encodeName(cachePath).constData(), nullptr);
+            return image;
+        }
+    }
+
+    // fix whiteboard shows when a jpeg file with filename xxx.png
+    // content formart not epual to extension
+    QImageReader reader(currentWallpaper);
+    reader.setDecideFormatFromContent(true);
+
+    //只按屏幕分辨率解码，jpeg等格式不需要解码出原图
+    const QSize &sourceSize = reader.size();
+    if (sourceSize.isValid() && sourceSize.width() > trueSize.width() && sourceSize.height() > trueSize.height())
+        reader.setScaledSize(sourceSize.scaled(trueSize, Qt::KeepAspectRatioByExpanding));
+
+    image = reader.read();
+    if (image.isNull())
+        return image;
+
+    if (image.size().scaled(trueSize, Qt::KeepAspectRatioByExpanding) != image.size()) {
+        image = image.scaled(trueSize,
+                             Qt::KeepAspectRatioByExpanding,
+                             Qt::SmoothTransformation);
+    }
+
+    if (image.width() > trueSize.width() || image.height() > trueSize.height()) {
+        image = image.copy(QRect(static_cast<int>((image.width() - trueSize.width()) / 2.0),
+                                 static_cast<int>((image.height() - trueSize.height()) / 2.0),
+                                 trueSize.width(),
+                                 trueSize.height()));
+    }
+
+    //转换为QPixmap可以直接使用的格式，避免在主线程中转换
+    image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+
+    if (!cachePath.isEmpty()) {
+        QDir cacheDir = QFileInfo(cachePath).absoluteDir();
+        cacheDir.mkpath(".");
+
+        writeWallpaperCache(cachePath, image);
+
+        //只保留最近使用且总大小不超过上限的缓存，刚写入的这个始终保留，旧版本保存的png缓存直接删除
+        const QFileInfoList &caches = cacheDir.entryInfoList(QStringList() << "*.cache", QDir::Files, QDir::Time);
+        qint64 cachedBytes = 0;
+        for (int i = 0; i < caches.size(); ++i) {
+            cachedBytes += caches.at(i).size();
+            if (i > 0 && (i >= kWallpaperCacheCount || cachedBytes > kWallpaperCacheBytes))
+                QFile::remove(caches.at(i).absoluteFilePath());
+        }
+        for (const QFileInfo &legacy : cacheDir.entryInfoList(QStringList() << "*.png", QDir::Files))
+            QFile::remove(legacy.absoluteFilePath());
+    }
+
+    return image;
+}
+
+QString BackgroundManager::wallpaperCachePath(const QString &filePath, const QSize &trueSize)
+{
+    QFileInfo info(filePath);
+    if (!info.exists() || trueSize.isEmpty())
+        return QString();
+
+    const QString &cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cacheDir.isEmpty())
+        return QString();
+
+    const QString &key = QString("%1\n%2\n%3x%4").arg(info.absoluteFilePath())
+                         .arg(info.lastModified().toMSecsSinceEpoch())
+                         .arg(trueSize.width()).arg(trueSize.height());
+
+    return cacheDir + "/wallpaper/" + QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex() + ".cache";
+}
+
+QImage BackgroundManager::readWallpaperCache(const QString &cachePath, const QSize &trueSize)
+{
+    QFile file(cachePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return QImage();
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 width = 0;
+    qint32 height = 0;
+    qint32 format = 0;
+    qint32 bytesPerLine = 0;
+    stream >> magic >> version >> width >> height >> format >> bytesPerLine;
+
+    if (stream.status() != QDataStream::Ok || magic != kWallpaperCacheMagic || version != kWallpaperCacheVersion
+            || QSize(width, height) != trueSize
+            || (format != QImage::Format_RGB32 && format != QImage::Format_ARGB32_Premultiplied))
+        return QImage();
+
+    QImage image(width, height, static_cast<QImage::Format>(format));
+    if (image.isNull() || image.bytesPerLine() != bytesPerLine)
+        return QImage();
+
+    //直接读入图片的内存，不经过解码和额外的拷贝
+    const qint64 dataSize = static_cast<qint64>(bytesPerLine) * height;
+    if (file.read(reinterpret_cast<char *>(image.bits()), dataSize) != dataSize)
+        return QImage();
+
+    return image;
+}
+
+bool BackgroundManager::writeWallpaperCache(const QString &cachePath, const QImage &image)
+{
+    if (image.format() != QImage::Format_RGB32 && image.format() != QImage::Format_ARGB32_Premultiplied)
+        return false;
+
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream << kWallpaperCacheMagic << kWallpaperCacheVersion
+           << static_cast<qint32>(image.width()) << static_cast<qint32>(image.height())
+           << static_cast<qint32>(image.format()) << static_cast<qint32>(image.bytesPerLine());
+
+    const qint64 dataSize = static_cast<qint64>(image.bytesPerLine()) * image.height();
+    if (stream.status() != QDataStream::Ok
+            || file.write(reinterpret_cast<const char *>(image.constBits()), dataSize) != dataSize) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
 }
 
 void BackgroundManager::onWmDbusStarted(QString name, QString oldOwner, QString newOwner)
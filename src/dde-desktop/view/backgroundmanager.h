@@ -34,6 +34,7 @@
 
 #include <QObject>
 #include <QMap>
+#include <QImage>
 
 using WMInter = com::deepin::wm;
 
@@ -72,6 +73,11 @@ private:
     QString getBackgroundFromWmConfig(const QString &screen);
     QString getDefaultBackground() const;
     BackgroundWidgetPointer createBackgroundWidget(ScreenPointer);
+    void applyBackgroundImage(const QString &screen, const QString &path, const QImage &image);
+    static QImage loadWallpaper(const QString &path, const QSize &trueSize);   //在线程中调用
+    static QString wallpaperCachePath(const QString &filePath, const QSize &trueSize);
+    static QImage readWallpaperCache(const QString &cachePath, const QSize &trueSize);
+    static bool writeWallpaperCache(const QString &cachePath, const QImage &image);
 protected:
     DGioSettings *gsettings = nullptr;
     WMInter *wmInter = nullptr;
@@ -88,6 +94,9 @@ private:
 
     //记录设置的背景的壁纸
     QMap<QString, QString> m_backgroundImagePath;
+
+    //每次重设壁纸时递增，丢弃过期的解码结果
+    quint64 m_resetGeneration = 0;
 };
 
 #endif // BACKGROUNDMANAGER_H
@@ -76,8 +76,11 @@
 #include <QUrlQuery>
 #include <QRegularExpression>
 
+#include <QtConcurrent/QtConcurrent>
 #include <thread>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
 #include <gio/gio.h>
 
 #include <QQueue>
@@ -233,6 +236,312 @@ private:
     QFileInfo currentFileInfo;
 };
 
+// 目录迭代时默认预读列表和图标视图需要的属性，不支持statx时使用fstatat
+#if defined(SYS_statx) && defined(STATX_TYPE) && defined(AT_STATX_DONT_SYNC)
+#define DFM_ENABLE_STATX
+#define DFM_DIR_STAT_MASK (STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME | STATX_INO)
+#else
+#define DFM_DIR_STAT_MASK 0
+#endif
+
+// getdents64返回的目录项，glibc没有提供此结构体，文件名紧跟在d_type之后，使用dirent64Name读取
+struct DFMLinuxDirent64 {
+    quint64 d_ino;
+    qint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+};
+
+static inline const char *dirent64Name(const DFMLinuxDirent64 *entry)
+{
+    return reinterpret_cast<const char *>(entry) + offsetof(DFMLinuxDirent64, d_type) + sizeof(entry->d_type);
+}
+
+// 读取目录项的属性(不跟随链接)，fd为目录描述符
+static bool dirEntryStat(int fd, const char *name, unsigned int statMask, DFileInfo::Stat *stat)
+{
+#ifdef DFM_ENABLE_STATX
+    if (statMask == DFM_DIR_STAT_MASK) {
+        struct statx stx;
+        if (syscall(SYS_statx, fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, statMask, &stx) != 0
+                || (stx.stx_mask & statMask) != statMask)
+            return false;
+
+        stat->mode = stx.stx_mode;
+        stat->size = static_cast<qint64>(stx.stx_size);
+        stat->lastModified = stx.stx_mtime.tv_sec * 1000 + stx.stx_mtime.tv_nsec / 1000000;
+        stat->inode = stx.stx_ino;
+        return true;
+    }
+#else
+    Q_UNUSED(statMask)
+#endif
+
+    struct stat st;
+    if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+        return false;
+
+    stat->mode = st.st_mode;
+    stat->size = st.st_size;
+    stat->lastModified = st.st_mtim.tv_sec * 1000 + st.st_mtim.tv_nsec / 1000000;
+    stat->inode = st.st_ino;
+    return true;
+}
+
+// 后台预读的目录项属性，迭代器和预读线程共享
+struct DFMDirStatCache {
+    QMutex mutex;
+    // 文件信息创建前已经预读到的属性
+    QHash<QByteArray, QSharedPointer<DFileInfo::PrefetchedStat>> stats;
+    // 文件信息已经创建，等待预读线程填入的属性
+    QHash<QByteArray, QSharedPointer<DFileInfo::PrefetchedStat>> waiting;
+    QAtomicInteger<bool> canceled { false };
+};
+
+/*!
+ * \brief The DFMLocalDirIterator class 使用getdents64批量读取本地目录
+ * 根据目录项的d_type过滤文件，只有d_type未知的文件和需要区分目标类型的链接文件才stat，
+ * 遍历时不创建QFileInfo，每读完一批目录项后在后台线程使用statx预读文件属性，
+ * 预读结果按文件名和DFileInfo共享，创建文件信息时不等待预读，也不再重复stat
+ * 不支持名称过滤和按权限过滤，这些情况仍然使用DFMQDirIterator
+ */
+class DFMLocalDirIterator : public DDirIterator
+{
+public:
+    DFMLocalDirIterator(const QString &path, QDir::Filters filter, unsigned int statMask = DFM_DIR_STAT_MASK)
+        : dirPath(QDir(path).absolutePath())
+        , filters(filter)
+        , statMask(statMask)
+        , statCache(new DFMDirStatCache)
+    {
+        dirFd = open(QFile::encodeName(dirPath).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd < 0)
+            qWarning() << "open dir failed:" << dirPath << strerror(errno);
+    }
+
+    ~DFMLocalDirIterator() override
+    {
+        // 目录读完或者关闭后预读仍需要继续，只有迭代器销毁时才取消
+        statCache->canceled.store(true);
+        close();
+    }
+
+    static bool canIterate(QDir::Filters filter, const QStringList &nameFilters, QDirIterator::IteratorFlags flags)
+    {
+        const QDir::Filters permissionFilters = QDir::Readable | QDir::Writable | QDir::Executable | QDir::Modified;
+        return nameFilters.isEmpty() && flags == QDirIterator::NoIteratorFlags && !(filter & permissionFilters);
+    }
+
+    DUrl next() override
+    {
+        if (!hasNext())
+            return DUrl();
+
+        currentName = pendingName;
+        currentType = pendingType;
+        pendingName.clear();
+
+        return fileUrl();
+    }
+
+    bool hasNext() const override
+    {
+        if (!pendingName.isEmpty())
+            return true;
+
+        while (dirFd >= 0) {
+            if (bufferPos >= bufferSize && !readBatch())
+                return false;
+
+            const DFMLinuxDirent64 *entry = reinterpret_cast<const DFMLinuxDirent64 *>(buffer.constData() + bufferPos);
+            bufferPos += entry->d_reclen;
+
+            const char *name = dirent64Name(entry);
+            unsigned char type = entry->d_type;
+            if (accept(name, type)) {
+                pendingName = QFile::decodeName(name);
+                pendingType = type;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void close() override
+    {
+        if (dirFd >= 0) {
+            ::close(dirFd);
+            dirFd = -1;
+        }
+    }
+
+    QString fileName() const override
+    {
+        return currentName;
+    }
+
+    DUrl fileUrl() const override
+    {
+        return DUrl::fromLocalFile(filePath());
+    }
+
+    const DAbstractFileInfoPointer fileInfo() const override
+    {
+        // 目录和链接文件不会是桌面文件，其他文件与DFMQDirIterator一样按mimetype判断
+        const QFileInfo info(filePath());
+        if ((currentType == DT_REG || currentType == DT_UNKNOWN) && FileUtils::isDesktopFile(info))
+            return DAbstractFileInfoPointer(new DesktopFileInfo(info));
+
+        const QByteArray name = QFile::encodeName(currentName);
+        QSharedPointer<DFileInfo::PrefetchedStat> prefetched;
+        {
+            QMutexLocker locker(&statCache->mutex);
+            prefetched = statCache->stats.take(name);
+            if (!prefetched) {
+                // 预读还没有到达此文件时不同步读取，先使用目录项中的文件类型，其他属性由预读线程稍后填入
+                prefetched.reset(new DFileInfo::PrefetchedStat);
+                prefetched->type = currentType == DT_UNKNOWN ? 0 : DTTOIF(currentType);
+                statCache->waiting.insert(name, prefetched);
+            }
+        }
+
+        return DAbstractFileInfoPointer(new DFileInfo(info.absoluteFilePath(), prefetched));
+    }
+
+    DUrl url() const override
+    {
+        return DUrl::fromLocalFile(dirPath);
+    }
+
+private:
+    QString filePath() const
+    {
+        return dirPath.endsWith('/') ? dirPath + currentName : dirPath + '/' + currentName;
+    }
+
+    bool readBatch() const
+    {
+        buffer.resize(256 * 1024);
+        long size = syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size());
+        if (size < 0 && errno == EINTR)
+            size = syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size());
+
+        if (size <= 0) {
+            if (size < 0)
+                qWarning() << "getdents64 failed:" << dirPath << strerror(errno);
+            // 只关闭目录，已经开始的预读继续进行
+            const_cast<DFMLocalDirIterator *>(this)->close();
+            return false;
+        }
+
+        bufferPos = 0;
+        bufferSize = static_cast<int>(size);
+        prefetchStat();
+
+        return true;
+    }
+
+    // 在后台线程预读这一批目录项的属性，目录描述符复制一份，避免迭代器关闭后失效
+    void prefetchStat() const
+    {
+        QList<QByteArray> names;
+        for (int pos = 0; pos < bufferSize;) {
+            const DFMLinuxDirent64 *entry = reinterpret_cast<const DFMLinuxDirent64 *>(buffer.constData() + pos);
+            pos += entry->d_reclen;
+            const char *name = dirent64Name(entry);
+            if (strcmp(name, ".") != 0 && strcmp(name, "..") != 0)
+                names << QByteArray(name);
+        }
+
+        const int fd = names.isEmpty() ? -1 : dup(dirFd);
+        if (fd < 0)
+            return;
+
+        const unsigned int mask = statMask;
+        QSharedPointer<DFMDirStatCache> cache = statCache;
+        QtConcurrent::run([fd, names, mask, cache]() {
+            for (const QByteArray &name : names) {
+                if (cache->canceled.load())
+                    break;
+
+                DFileInfo::Stat stat;
+                const bool ok = dirEntryStat(fd, name.constData(), mask, &stat);
+
+                QMutexLocker locker(&cache->mutex);
+                QSharedPointer<DFileInfo::PrefetchedStat> prefetched = cache->waiting.take(name);
+                if (!ok)
+                    continue;
+
+                if (!prefetched) {
+                    prefetched.reset(new DFileInfo::PrefetchedStat);
+                    cache->stats.insert(name, prefetched);
+                }
+
+                // 先写入属性再设置ready，文件信息所在的线程看到ready后才读取
+                prefetched->stat = stat;
+                prefetched->ready.storeRelease(true);
+            }
+            ::close(fd);
+        });
+    }
+
+    bool accept(const char *name, unsigned char &type) const
+    {
+        const bool isDot = strcmp(name, ".") == 0;
+        const bool isDotDot = strcmp(name, "..") == 0;
+        if (isDot || isDotDot) {
+            if ((isDot && filters.testFlag(QDir::NoDot)) || (isDotDot && filters.testFlag(QDir::NoDotDot)))
+                return false;
+            return filters.testFlag(QDir::Dirs) || filters.testFlag(QDir::AllDirs);
+        }
+
+        if (name[0] == '.' && !filters.testFlag(QDir::Hidden))
+            return false;
+
+        struct stat st;
+        if (type == DT_UNKNOWN) {
+            if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                return false;
+            type = static_cast<unsigned char>(IFTODT(st.st_mode));
+        }
+
+        bool isDir = type == DT_DIR;
+        bool isFile = type == DT_REG;
+        if (type == DT_LNK) {
+            if (filters.testFlag(QDir::NoSymLinks))
+                return false;
+            // 链接文件按照指向的文件分类，指向无效的链接属于系统文件
+            if (fstatat(dirFd, name, &st, 0) == 0) {
+                isDir = S_ISDIR(st.st_mode);
+                isFile = S_ISREG(st.st_mode);
+            }
+        }
+
+        if (isDir)
+            return filters.testFlag(QDir::Dirs) || filters.testFlag(QDir::AllDirs);
+        if (isFile)
+            return filters.testFlag(QDir::Files);
+
+        return filters.testFlag(QDir::System);
+    }
+
+    QString dirPath;
+    QDir::Filters filters;
+    unsigned int statMask;
+    QSharedPointer<DFMDirStatCache> statCache;
+
+    mutable int dirFd = -1;
+    mutable QByteArray buffer;
+    mutable int bufferPos = 0;
+    mutable int bufferSize = 0;
+    mutable QString pendingName;
+    mutable unsigned char pendingType = DT_UNKNOWN;
+
+    QString currentName;
+    unsigned char currentType = DT_UNKNOWN;
+};
+
 #ifndef DISABLE_QUICK_SEARCH
 class DFMAnythingDirIterator : public DDirIterator
 {
@@ -1872,6 +2181,9 @@ FileDirIterator::FileDirIterator(const QString &path, const QStringList &nameFil
 
     if (sort_inode) {
         iterator = new DFMSortInodeDirIterator(path);
+    } else if (!gvfs && DFMLocalDirIterator::canIterate(filter, nameFilters, flags)
+               && !FileUtils::isGvfsMountFile(path, true)) {
+        iterator = new DFMLocalDirIterator(path, filter);
     } else {
         iterator = new DFMQDirIterator(path, nameFilters, filter, flags, gvfs);
     }
@@ -45,6 +45,8 @@
 #include <DRecentManager>
 #include <DDialog>
 
+#include <sys/stat.h>
+
 DCORE_USE_NAMESPACE
 DWIDGET_USE_NAMESPACE
 
@@ -309,9 +311,17 @@ DUrl RecentDirIterator::url() const
 RecentController::RecentController(QObject *parent)
     : DAbstractFileController(parent),
       m_xbelPath(QDir::homePath() + "/.local/share/recently-used.xbel"),
-      m_watcher(new DFileWatcher(m_xbelPath, this))
-{
-    asyncHandleFileChanged();
+      m_watcher(new DFileWatcher(m_xbelPath, this)),
+      m_parseTimer(new QTimer(this))
+{
+    // 写入方会连续多次改写xbel文件，一个周期内的多次变化只解析一次
+    m_parseTimer->setSingleShot(true);
+    m_parseTimer->setInterval(1000);
+    connect(m_parseTimer, &QTimer::timeout, this, [this] {
+        QtConcurrent::run(this, &RecentController::handleFileChanged);
+    });
+
+    QtConcurrent::run(this, &RecentController::handleFileChanged);
 
     connect(m_watcher, &DFileWatcher::subfileCreated, this, &RecentController::asyncHandleFileChanged);
     connect(m_watcher, &DFileWatcher::fileModified, this, &RecentController::asyncHandleFileChanged);
@@ -564,107 +574,137 @@ DUrlList RecentController::realUrlList(const DUrlList &recentUrls)
     return list;
 }
 
-void RecentController::handleFileChanged()
+QHash<DUrl, QString> RecentController::readXbelEntries(QIODevice *device)
 {
-    // read xbel file.
-    QFile file(m_xbelPath);
-    QList<DUrl> urlList;
+    QHash<DUrl, QString> entries;
+    QXmlStreamReader reader(device);
 
-    // try interrupting any other running parsers, then acquire the lock
-    m_condition.wakeAll();
-    if (!m_xbelFileLock.tryLock(100)) {
-        return;
+    while (!reader.atEnd()) {
+        if (!reader.readNextStartElement() ||
+                reader.name() != "bookmark") {
+            continue;
+        }
+
+        const QStringRef &location = reader.attributes().value("href");
+
+        if (location.isEmpty())
+            continue;
+
+        const DUrl &url = DUrl(FileUtils::bindPathTransform(location.toString()));
+
+        if (!url.isLocalFile())
+            continue;
+
+        DUrl recentUrl = url;
+        recentUrl.setScheme(RECENT_SCHEME);
+        entries.insert(recentUrl, reader.attributes().value("modified").toString());
     }
 
+    return entries;
+}
+
+void RecentController::handleFileChanged()
+{
+    QMutexLocker locker(&m_xbelFileLock);
+
     QPointer<RecentController> dp = this;
+    QFile file(m_xbelPath);
+    const QFileInfo xbelInfo(m_xbelPath);
 
-    if (m_condition.wait(&m_xbelFileLock, 1000)) {
-        // if the parser is interrupted.
-        // we need a timeout long enough so that
-        // virtually all execution time is spent here.
-        m_xbelFileLock.unlock();
+    // 文件内容没有变化(如只是被打开、关闭)时不再解析
+    if (xbelInfo.exists() && xbelInfo.size() == m_xbelSize && xbelInfo.lastModified() == m_xbelLastModified)
         return;
-    }
+
+    m_xbelSize = xbelInfo.exists() ? xbelInfo.size() : -1;
+    m_xbelLastModified = xbelInfo.lastModified();
+
+    // 文件会被其它进程原地改写，流式读取而不是映射到内存，避免文件被截断时访问映射区域出错
+    QHash<DUrl, QString> entries;
 
     if (file.open(QIODevice::ReadOnly)) {
-        QXmlStreamReader reader(&file);
+        entries = readXbelEntries(&file);
+    }
+
+    // 与上一次的解析结果比较，只处理新增、删除和访问时间变化的文件
+    QHash<DUrl, QString> snapshot;
+    QList<QPair<DUrl, QString>> addedFiles;
+    QList<QPair<DUrl, QString>> changedFiles;
+    DUrlList removedFiles;
 
-        while (!reader.atEnd()) {
+    for (auto iter = entries.constBegin(); iter != entries.constEnd(); ++iter) {
+        const DUrl &recentUrl = iter.key();
+        auto old = m_xbelSnapshot.constFind(recentUrl);
 
-            if (!reader.readNextStartElement() ||
-                    reader.name() != "bookmark") {
+        if (old != m_xbelSnapshot.constEnd()) {
+            // 已显示的文件可能已被删除，xbel中仍有记录，只stat一次检查是否还存在
+            struct stat st;
+            if (::stat(QFile::encodeName(recentUrl.path()).constData(), &st) != 0 || !S_ISREG(st.st_mode))
                 continue;
-            }
 
-            const QStringRef &location = reader.attributes().value("href");
-            const QStringRef &readTime = reader.attributes().value("modified");
-
-            if (!location.isEmpty()) {
-                QString path = location.toString();
-                path = FileUtils::bindPathTransform(path);
-                DUrl url = DUrl(path);
-                QFileInfo info(url.toLocalFile());
-                DUrl recentUrl = url;
-                recentUrl.setScheme(RECENT_SCHEME);
-
-                if (info.exists() && info.isFile()) {
-                    urlList << recentUrl;
-
-                    DThreadUtil::runInMainThread([ = ]() {
-                        if (dp.isNull())
-                            return;
-                        // 保险箱内文件不显示到最近使用页面
-                        if(!VaultController::isVaultFile(location.toString())) {
-                            if (!recentNodes.contains(recentUrl)) {
-                                recentNodes[recentUrl] = new RecentFileInfo(recentUrl);
-                                DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT),
-                                                                  &DAbstractFileWatcher::subfileCreated,
-                                                                  recentUrl);
-                            }
-                            //如果readtime变更了，需要通知filesystemmodel重新排序
-                            else if (recentNodes[recentUrl]->readDateTime().toSecsSinceEpoch() != QDateTime::fromString(readTime.toString(), Qt::ISODate).toSecsSinceEpoch()) {
-                                //先更新info数据
-                                recentNodes[recentUrl]->updateInfo();
-                                DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT),
-                                                                  &DAbstractFileWatcher::fileModified,
-                                                                  recentUrl);
-                            }
-                        }
-                    });
-                }
-            }
+            snapshot.insert(recentUrl, iter.value());
+
+            if (old.value() != iter.value())
+                changedFiles << qMakePair(recentUrl, iter.value());
+
+            continue;
+        }
+
+        QFileInfo info(recentUrl.path());
+
+        // 保险箱内文件不显示到最近使用页面
+        if (info.exists() && info.isFile() && !VaultController::isVaultFile(recentUrl.path())) {
+            snapshot.insert(recentUrl, iter.value());
+            addedFiles << qMakePair(recentUrl, iter.value());
         }
     }
 
-    if (dp.isNull())
+    for (auto iter = m_xbelSnapshot.constBegin(); iter != m_xbelSnapshot.constEnd(); ++iter) {
+        if (!snapshot.contains(iter.key()))
+            removedFiles << iter.key();
+    }
+
+    m_xbelSnapshot = snapshot;
+
+    if (addedFiles.isEmpty() && changedFiles.isEmpty() && removedFiles.isEmpty())
         return;
-    // delete does not exist url.
-    for (auto iter = recentNodes.begin(); iter != recentNodes.end();) {
+
+    DThreadUtil::runInMainThread([ = ]() {
         if (dp.isNull())
             return;
-        const DUrl &url = iter.key();
-        if (!urlList.contains(url)) {
-            DThreadUtil::runInMainThread([this, &iter, url]() {
-                iter = recentNodes.erase(iter);
-
-                DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT),
-                                                  &DAbstractFileWatcher::fileDeleted,
-                                                  url);
-            });
-        } else {
-            auto info = iter.value();
-            if (info) {
-                iter.value()->updateInfo();
-                ++iter;
-            } else {
-                iter = recentNodes.erase(iter);
-            }
+
+        for (const QPair<DUrl, QString> &file : addedFiles) {
+            if (recentNodes.contains(file.first))
+                continue;
+
+            recentNodes[file.first] = new RecentFileInfo(file.first, file.second);
+            DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT),
+                                              &DAbstractFileWatcher::subfileCreated,
+                                              file.first);
         }
-        if (dp.isNull())
-            return;
-    }
 
-    m_xbelFileLock.unlock();
+        //如果readtime变更了，需要通知filesystemmodel重新排序
+        for (const QPair<DUrl, QString> &file : changedFiles) {
+            const RecentPointer &info = recentNodes.value(file.first);
+
+            if (!info)
+                continue;
+
+            //先更新info数据
+            info->setReadDateTime(file.second);
+            DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT),
+                                              &DAbstractFileWatcher::fileModified,
+                                              file.first);
+        }
+
+        for (const DUrl &url : removedFiles) {
+            if (!recentNodes.remove(url))
+                continue;
+
+            DAbstractFileWatcher::ghostSignal(DUrl(RECENT_ROOT),
+                                              &DAbstractFileWatcher::fileDeleted,
+                                              url);
+        }
+    });
 }
 
 void RecentController::asyncHandleFileChanged()
@@ -679,6 +719,9 @@ void RecentController::asyncHandleFileChanged()
      * The issue mentioned above is specific to applications that use DTK.
      * Applications using GTK does not trigger file closed/modified events
      * at all for some obscure reasons.
+     * The timer is not restarted by the following events, so the file is
+     * parsed at most once a second even if it is rewritten continuously.
      */
-    QtConcurrent::run(this, &RecentController::handleFileChanged);
+    if (!m_parseTimer->isActive())
+        m_parseTimer->start();
 }
@@ -27,8 +27,9 @@
 #include "dabstractfilecontroller.h"
 #include "models/recentfileinfo.h"
 
-#include <QWaitCondition>
 #include <QMutex>
+#include <QHash>
+#include <QDateTime>
 
 class QFileSystemWatcher;
 class DAbstractFileInfo;
@@ -70,14 +71,19 @@ public:
 
 private:
     static DUrlList realUrlList(const DUrlList &recentUrls);
+    static QHash<DUrl, QString> readXbelEntries(QIODevice *device);
     void handleFileChanged();
     void asyncHandleFileChanged();
 
 private:
     QString m_xbelPath;
     DFileWatcher *m_watcher;
-    QWaitCondition m_condition;
+    QTimer *m_parseTimer;
     QMutex m_xbelFileLock;
+    // 上一次解析的结果，<最近使用的文件, 访问时间>，只包含已加入recentNodes的文件
+    QHash<DUrl, QString> m_xbelSnapshot;
+    qint64 m_xbelSize = -1;
+    QDateTime m_xbelLastModified;
 };
 
 #endif // RECENTCONTROLLER_H
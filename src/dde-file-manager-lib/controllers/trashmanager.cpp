@@ -35,6 +35,7 @@
 #include "interfaces/dfmstandardpaths.h"
 #include "singleton.h"
 #include "shutil/dfmfilelistfile.h"
+#include "shutil/dfmtrashinfoindex.h"
 
 #include "dfmeventdispatcher.h"
 
@@ -80,6 +81,8 @@ private:
     QDirIterator *iterator;
     bool nextIsCached = false;
     QDir::Filters filters;
+    // hasNext 中为过滤文件创建的 info，next 之后由 fileInfo 直接返回
+    DAbstractFileInfoPointer currentInfo;
 };
 
 TrashDirIterator::TrashDirIterator(const DUrl &url, const QStringList &nameFilters,
@@ -112,6 +115,8 @@ DUrl TrashDirIterator::next()
         QString path = iterator->filePath();
         return DUrl::fromTrashFile(path.remove(DFMStandardPaths::location(DFMStandardPaths::TrashFilesPath)));
     }
+    currentInfo.reset();
+
     return DUrl::fromTrashFile(DUrl::fromLocalFile(iterator->next()).path().remove(DFMStandardPaths::location(DFMStandardPaths::TrashFilesPath)));
 }
 
@@ -132,8 +137,7 @@ bool TrashDirIterator::hasNext() const
 
     do {
         const_cast<TrashDirIterator *>(this)->iterator->next();
-        QString absoluteFilePath = iterator->fileInfo().absoluteFilePath();
-        info = DAbstractFileInfoPointer(new TrashFileInfo(DUrl::fromLocalFile(absoluteFilePath)));
+        info = DAbstractFileInfoPointer(new TrashFileInfo(fileUrl()));
 
         if (!info->isPrivate() && (showHidden || (!info->isHidden() && !hiddenFiles->contains(info->fileName())))) {
             break;
@@ -145,6 +149,7 @@ bool TrashDirIterator::hasNext() const
     // file is exists
     if (info) {
         const_cast<TrashDirIterator *>(this)->nextIsCached = true;
+        const_cast<TrashDirIterator *>(this)->currentInfo = info;
 
         return true;
     }
@@ -165,6 +170,9 @@ DUrl TrashDirIterator::fileUrl() const
 
 const DAbstractFileInfoPointer TrashDirIterator::fileInfo() const
 {
+    if (currentInfo)
+        return currentInfo;
+
     return DFileService::instance()->createFileInfo(Q_NULLPTR, fileUrl());
 }
 
@@ -176,6 +184,7 @@ DUrl TrashDirIterator::url() const
 TrashManager::TrashManager(QObject *parent)
     : DAbstractFileController(parent)
     , m_trashFileWatcher(new DFileWatcher(DFMStandardPaths::location(DFMStandardPaths::TrashFilesPath), this))
+    , m_trashInfoWatcher(new DFileWatcher(DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath), this))
 {
     m_isTrashEmpty = isEmpty();
     QString trashFilePath = DFMStandardPaths::location(DFMStandardPaths::TrashFilesPath);
@@ -183,9 +192,22 @@ TrashManager::TrashManager(QObject *parent)
     if (!QFile::exists(trashFilePath))
         QDir().mkdir(trashFilePath);
 
+    QString trashInfoPath = DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath);
+    if (!QFile::exists(trashInfoPath))
+        QDir().mkpath(trashInfoPath);
+
     connect(m_trashFileWatcher, &DFileWatcher::fileDeleted, this, &TrashManager::trashFilesChanged);
     connect(m_trashFileWatcher, &DFileWatcher::subfileCreated, this, &TrashManager::trashFilesChanged);
     m_trashFileWatcher->startWatcher();
+
+    connect(m_trashInfoWatcher, &DFileWatcher::fileDeleted, this, &TrashManager::trashInfosChanged);
+    connect(m_trashInfoWatcher, &DFileWatcher::subfileCreated, this, &TrashManager::trashInfosChanged);
+    connect(m_trashInfoWatcher, &DFileWatcher::fileModified, this, &TrashManager::trashInfosChanged);
+    connect(m_trashInfoWatcher, &DFileWatcher::fileMoved, this, [this](const DUrl &fromUrl, const DUrl &toUrl) {
+        trashInfosChanged(fromUrl);
+        trashInfosChanged(toUrl);
+    });
+    m_trashInfoWatcher->startWatcher();
 }
 
 const DAbstractFileInfoPointer TrashManager::createFileInfo(const QSharedPointer<DFMCreateFileInfoEvent> &event) const
@@ -228,11 +250,19 @@ DUrlList TrashManager::moveToTrash(const QSharedPointer<DFMMoveToTrashEvent> &ev
 void TrashManager::sortByOriginPath(DUrlList &list) const
 {
     DAbstractFileInfo::CompareFunction sortFun = FileSortFunction::compareFileListByTrashFilePath;
-    qSort(list.begin(), list.end(), [sortFun, this](const DUrl url1, const DUrl url2) {
-        const auto &&event1 = dMakeEventPointer<DFMCreateFileInfoEvent>(this, url1);
-        const auto &&event2 = dMakeEventPointer<DFMCreateFileInfoEvent>(this, url2);
-        return sortFun(TrashManager::createFileInfo(event1), TrashManager::createFileInfo(event2), Qt::AscendingOrder);
+    // 每个文件只创建一次 info，不在比较函数中反复创建
+    QList<DAbstractFileInfoPointer> infos;
+    infos.reserve(list.size());
+    for (const DUrl &url : list)
+        infos << TrashManager::createFileInfo(dMakeEventPointer<DFMCreateFileInfoEvent>(this, url));
+
+    qSort(infos.begin(), infos.end(), [sortFun](const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2) {
+        return sortFun(info1, info2, Qt::AscendingOrder);
     });
+
+    list.clear();
+    for (const DAbstractFileInfoPointer &info : infos)
+        list << info->fileUrl();
 }
 
 bool TrashManager::restoreFile(const QSharedPointer<DFMRestoreFromTrashEvent> &event) const
@@ -244,8 +274,10 @@ bool TrashManager::restoreFile(const QSharedPointer<DFMRestoreFromTrashEvent> &e
     if (urlList.size() == 1 && DUrl::fromTrashFile("/") == urlList.first()) {
         urlList.clear();
         // fix bug#33763 回收站内的隐藏文件应该被找出来进行还原
-        for (const DAbstractFileInfoPointer &info : DFileService::instance()->getChildren(Q_NULLPTR, DUrl::fromTrashFile("/"), QStringList(), QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System | QDir::Hidden))
-            urlList << info->fileUrl();
+        // 只需要文件名，直接列出 files 目录，不为每个文件创建 info
+        QDir trashDir(DFMStandardPaths::location(DFMStandardPaths::TrashFilesPath));
+        for (const QString &name : trashDir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System | QDir::Hidden))
+            urlList << DUrl::fromTrashFile("/" + name);
     }
 
     //! fix bug#36608 按照原始路径排序，避免恢复时冲突
@@ -454,6 +486,12 @@ void TrashManager::cleanTrash(const QObject *sender, bool silent) const
     if (ret) {
         QString infoPaht = info_url.toLocalFile();
         QProcess::execute("rm -r \"" + infoPaht.toUtf8() + "\"");
+
+        // info 目录被删除后监视会失效，重建目录并重新监视
+        DFMTrashInfoIndex::instance()->clear();
+        QDir().mkpath(infoPaht);
+        m_trashInfoWatcher->stopWatcher();
+        m_trashInfoWatcher->startWatcher();
     }
 }
 
@@ -485,3 +523,8 @@ void TrashManager::trashFilesChanged(const DUrl &url)
     m_isTrashEmpty = isEmpty();
     emit fileSignalManager->trashStateChanged();
 }
+
+void TrashManager::trashInfosChanged(const DUrl &url)
+{
+    DFMTrashInfoIndex::instance()->update(url.toLocalFile());
+}
@@ -68,9 +68,12 @@ public:
     static bool isWorking();
 public slots:
     void trashFilesChanged(const DUrl &url);
+    void trashInfosChanged(const DUrl &url);
 private:
     bool m_isTrashEmpty;
     DFileWatcher *m_trashFileWatcher;
+    // 监视 info 目录，更新 .trashinfo 的索引
+    DFileWatcher *m_trashInfoWatcher;
 };
 
 #endif // TRASHMANAGER_H
@@ -209,6 +209,7 @@ void DMultiFilePropertyDialogPrivate::initUiParameter()noexcept
     }
 
     m_filesSizeWorker =  std::shared_ptr<DFileStatisticsJob>{ new DFileStatisticsJob(q_ptr) };
+    m_filesSizeWorker->setFileHints(DFileStatisticsJob::DeduplicateHardLinks);
 
     nameLabel = nullptr;
     lineLabel = nullptr;
@@ -960,8 +960,10 @@ void PropertyDialog::startComputerFolderSize(const DUrl &url)
     DUrlList urls;
     urls << validUrl;
 
-    if (!m_sizeWorker)
+    if (!m_sizeWorker) {
         m_sizeWorker = new DFileStatisticsJob(this);
+        m_sizeWorker->setFileHints(DFileStatisticsJob::DeduplicateHardLinks);
+    }
 
     connect(m_sizeWorker, &DFileStatisticsJob::dataNotify, this, &PropertyDialog::updateFolderSize);
     m_sizeWorker->start(urls);
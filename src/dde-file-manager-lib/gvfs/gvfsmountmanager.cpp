@@ -43,6 +43,7 @@
 #include "networkmanager.h"
 #include "dfmapplication.h"
 #include "dabstractfilewatcher.h"
+#include "dstorageinfo.h"
 #include "ddiskmanager.h"
 #include "dblockdevice.h"
 #include "ddiskdevice.h"
@@ -477,6 +478,7 @@ void GvfsMountManager::monitor_mount_removed_root(GVolumeMonitor *volume_monitor
 void GvfsMountManager::monitor_mount_added(GVolumeMonitor *volume_monitor, GMount *gmount)
 {
     Q_UNUSED(volume_monitor)
+    DStorageInfo::invalidateMountTableCache();
     qCDebug(mountManager()) << "==============================monitor_mount_added==============================";
     QMount qMount = gMountToqMount(gmount);
     GVolume *gvolume = g_mount_get_volume(gmount);
@@ -550,6 +552,7 @@ void GvfsMountManager::monitor_mount_added(GVolumeMonitor *volume_monitor, GMoun
 void GvfsMountManager::monitor_mount_removed(GVolumeMonitor *volume_monitor, GMount *mount)
 {
     Q_UNUSED(volume_monitor)
+    DStorageInfo::invalidateMountTableCache();
     qCDebug(mountManager()) << "==============================monitor_mount_removed==============================" ;
     QMount qMount = gMountToqMount(mount);
 
@@ -116,6 +116,22 @@ bool compareByString(const QString &str1, const QString &str2, Qt::SortOrder ord
     return ((order == Qt::DescendingOrder) ^ (sortCollator.compare(str1, str2) < 0)) == 0x01;
 }
 
+int sortClassOfString(const QString &str)
+{
+    //其他符号要排在最后，需要在中文前先做判断
+    if (DFMGlobal::startWithSymbol(str))
+        return 2;
+
+    return DFMGlobal::startWithHanzi(str) ? 1 : 0;
+}
+
+QCollatorSortKey sortKeyOfString(const QString &str)
+{
+    thread_local static DCollator sortCollator;
+
+    return sortCollator.sortKey(str);
+}
+
 COMPARE_FUN_DEFINE(fileDisplayName, DisplayName, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(fileSize, Size, DAbstractFileInfo)
 COMPARE_FUN_DEFINE(lastModified, Modified, DAbstractFileInfo)
@@ -336,8 +352,12 @@ QString DAbstractFileInfo::fileDisplayPinyinName() const
 
     const QString &diaplayName = this->fileDisplayName();
 
-    if (d->pinyinName.isEmpty()) {
+    // 排序和搜索会在多个线程中反复获取拼音名称，只在显示名称改变时转换一次
+    QMutexLocker locker(&d->pinyinMutex);
+
+    if (d->pinyinName.isEmpty() || d->pinyinSourceName != diaplayName) {
         d->pinyinName = DFMGlobal::toPinyin(diaplayName);
+        d->pinyinSourceName = diaplayName;
     }
 
     return d->pinyinName;
@@ -26,6 +26,7 @@
 
 #include <functional>
 
+#include <QCollator>
 #include <QFile>
 #include <QFileInfo>
 #include <QDateTime>
@@ -91,6 +92,14 @@ class DAbstractFileInfo;
 class DAbstractFileWatcher;
 typedef QExplicitlySharedDataPointer<DAbstractFileInfo> DAbstractFileInfoPointer;
 typedef std::function<const DAbstractFileInfoPointer(int)> getFileInfoFun;
+
+namespace FileSortFunction {
+bool compareFileListByDisplayName(const DAbstractFileInfoPointer &info1, const DAbstractFileInfoPointer &info2, Qt::SortOrder order);
+// 按名称排序时字符串的分类，0为字母数字开头，1为中文开头，2为其他符号开头，分类大的排在后面
+int sortClassOfString(const QString &str);
+// 按名称排序时使用的排序键，与compareByString使用相同的排序规则
+QCollatorSortKey sortKeyOfString(const QString &str);
+}
 typedef DFMGlobal::MenuAction MenuAction;
 class DAbstractFileInfoPrivate;
 
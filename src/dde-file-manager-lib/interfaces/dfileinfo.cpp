@@ -301,6 +301,28 @@ bool DFileInfoPrivate::isLowSpeedFile() const
     return lowSpeedFile;
 }
 
+const DFileInfo::Stat *DFileInfoPrivate::readyStat() const
+{
+    if (!prefetched || !prefetched->ready.loadAcquire() || S_ISLNK(prefetched->stat.mode))
+        return nullptr;
+
+    return &prefetched->stat;
+}
+
+quint32 DFileInfoPrivate::prefetchedType() const
+{
+    if (!prefetched)
+        return 0;
+
+    return prefetched->ready.loadAcquire() ? (prefetched->stat.mode & S_IFMT) : prefetched->type;
+}
+
+quint32 DFileInfoPrivate::knownType() const
+{
+    const quint32 type = prefetchedType();
+    return S_ISLNK(type) ? 0 : type;
+}
+
 DFileInfo::DFileInfo(const QString &filePath, bool hasCache)
     : DFileInfo(DUrl::fromLocalFile(filePath), hasCache)
 {
@@ -317,6 +339,14 @@ DFileInfo::DFileInfo(const QFileInfo &fileInfo, bool hasCache)
 
 }
 
+DFileInfo::DFileInfo(const QString &filePath, const QSharedPointer<PrefetchedStat> &stat, bool hasCache)
+    : DFileInfo(DUrl::fromLocalFile(filePath), hasCache)
+{
+    Q_D(DFileInfo);
+
+    d->prefetched = stat;
+}
+
 DFileInfo::~DFileInfo()
 {
 
@@ -656,6 +686,24 @@ DAbstractFileInfo::FileType DFileInfo::fileType() const
         return RegularFile;
     }
 
+    if (const quint32 mode = d->knownType()) {
+
+        if (S_ISDIR(mode))
+            return Directory;
+        if (S_ISCHR(mode))
+            return CharDevice;
+        if (S_ISBLK(mode))
+            return BlockDevice;
+        if (S_ISFIFO(mode))
+            return FIFOFile;
+        if (S_ISSOCK(mode))
+            return SocketFile;
+        if (S_ISREG(mode))
+            return RegularFile;
+
+        return Unknown;
+    }
+
     // Cannot access statBuf.st_mode from the filesystem engine, so we have to stat again.
     // In addition we want to follow symlinks.
     const QByteArray &nativeFilePath = QFile::encodeName(absoluteFilePath);
@@ -687,6 +735,9 @@ bool DFileInfo::isFile() const
 {
     Q_D(const DFileInfo);
 
+    if (const quint32 type = d->knownType())
+        return S_ISREG(type);
+
     return d->fileInfo.isFile();
 }
 
@@ -694,6 +745,9 @@ bool DFileInfo::isDir() const
 {
     Q_D(const DFileInfo);
 
+    if (const quint32 type = d->knownType())
+        return S_ISDIR(type);
+
     return d->fileInfo.isDir();
 }
 
@@ -701,6 +755,9 @@ bool DFileInfo::isSymLink() const
 {
     Q_D(const DFileInfo);
 
+    if (const quint32 type = d->prefetchedType())
+        return S_ISLNK(type);
+
     return d->fileInfo.isSymLink();
 }
 
@@ -789,6 +846,9 @@ qint64 DFileInfo::size() const
 {
     Q_D(const DFileInfo);
 
+    if (const Stat *stat = d->readyStat())
+        return stat->size;
+
     return d->fileInfo.size();
 }
 
@@ -821,6 +881,9 @@ QDateTime DFileInfo::lastModified() const
 {
     Q_D(const DFileInfo);
 
+    if (const Stat *stat = d->readyStat())
+        return QDateTime::fromMSecsSinceEpoch(stat->lastModified);
+
     if (isSymLink() && !d->fileInfo.exists()) {
         struct stat attrib;
 
@@ -923,6 +986,7 @@ void DFileInfo::refresh(const bool isForce)
     Q_UNUSED(isForce)
 
     d->fileInfo.refresh();
+    d->prefetched.reset();
     d->icon = QIcon();
     d->epInitialized = false;
     d->hasThumbnail = -1;
@@ -946,10 +1010,16 @@ void DFileInfo::makeToActive()
 {
     Q_D(DFileInfo);
 
-    if (!d->isLowSpeedFile())
+    if (!d->isLowSpeedFile()) {
         d->fileInfo.refresh();
+        d->prefetched.reset();
+    }
 
     DAbstractFileInfo::makeToActive();
+
+    // 视图滚动时可见的文件优先生成缩略图
+    if (d->requestingThumbnail)
+        DThumbnailProvider::instance()->raiseInProduceQueue(d->fileInfo, DThumbnailProvider::Large);
 }
 
 void DFileInfo::makeToInactive()
@@ -1141,6 +1211,9 @@ quint64 DFileInfo::inode() const
         return d->inode;
     }
 
+    if (const Stat *stat = d->readyStat())
+        return stat->inode;
+
     struct stat statinfo;
     QByteArray pathArry = d->fileInfo.absoluteFilePath().toUtf8();
     std::string pathStd = pathArry.toStdString();
@@ -26,11 +26,32 @@
 
 #include "dabstractfileinfo.h"
 
+#include <QAtomicInteger>
+
 class DFileInfoPrivate;
 class DFileInfo : public DAbstractFileInfo
 {
 public:
+    // 目录迭代时已经读取到的文件属性(不跟随链接)
+    struct Stat {
+        quint32 mode = 0;
+        qint64 size = 0;
+        // 毫秒
+        qint64 lastModified = 0;
+        quint64 inode = 0;
+    };
+
+    // 目录迭代时预读的属性，预读线程填入 stat 后才设置 ready，在此之前只有来自目录项的 type 可用
+    struct PrefetchedStat {
+        // 文件类型(S_IFMT)，未知时为0
+        quint32 type = 0;
+        Stat stat;
+        QAtomicInteger<bool> ready { false };
+    };
+
     explicit DFileInfo(const QString &filePath, bool hasCache = true);
+    // 使用目录迭代时读取的属性，isFile/isDir/size/lastModified 等不需要再访问文件系统，refresh 后失效
+    DFileInfo(const QString &filePath, const QSharedPointer<PrefetchedStat> &stat, bool hasCache = true);
     explicit DFileInfo(const DUrl &fileUrl, bool hasCache = true);
     explicit DFileInfo(const QFileInfo &fileInfo, bool hasCache = true);
     ~DFileInfo() override;
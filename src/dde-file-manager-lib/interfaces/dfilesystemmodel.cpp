@@ -44,9 +44,13 @@
 #include "dfilesystemmodel_p.h"
 #include "dfmsettings.h"
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 #include <QList>
 #include <QMap>
+#include <QSet>
+#include <QTimer>
 #include <QDebug>
 #include <QMimeData>
 #include <QSharedPointer>
@@ -101,6 +105,135 @@ static int FindInsertPosInOrderList(const FileSystemNodePointer &needNode,
     return row;
 }
 
+// 元素少于此数量时不再拆分给多个线程排序
+#define PARALLEL_SORT_MIN_COUNT 8192
+// 文件事件的合并间隔(ms)
+#define FILE_EVENT_MERGE_INTERVAL 50
+
+/*!
+ * \brief parallelStableSort 稳定排序，元素较多时先由多个线程分段排序，再逐层两两归并相邻的有序段
+ * \param list 需要排序的元素
+ * \param lessThan 比较函数
+ * \param isCancel 每个阶段结束后检查是否取消排序
+ * \return 排序被取消时返回false，list的顺序未定义
+ */
+template<typename T, typename LessThan>
+static bool parallelStableSort(std::vector<T> &list, const LessThan &lessThan, const bool *isCancel)
+{
+    typedef QPair<size_t, size_t> Range;
+
+    const size_t count = list.size();
+    const size_t chunkCount = qMin(static_cast<size_t>(qMax(QThread::idealThreadCount(), 1)), count / PARALLEL_SORT_MIN_COUNT);
+    if (chunkCount <= 1) {
+        std::stable_sort(list.begin(), list.end(), lessThan);
+        return !*isCancel;
+    }
+
+    QVector<Range> ranges;
+    for (size_t i = 0; i < chunkCount; ++i)
+        ranges << Range(count * i / chunkCount, count * (i + 1) / chunkCount);
+
+    QtConcurrent::blockingMap(ranges, [&](const Range &range) {
+        std::stable_sort(list.begin() + static_cast<long>(range.first), list.begin() + static_cast<long>(range.second), lessThan);
+    });
+
+    while (ranges.size() > 1) {
+        if (*isCancel)
+            return false;
+
+        // 相邻的两段合并为一段，个数为奇数时最后一段留到下一层
+        QVector<QPair<Range, size_t>> merges;
+        QVector<Range> mergedRanges;
+        for (int i = 0; i + 1 < ranges.size(); i += 2) {
+            merges << qMakePair(Range(ranges.at(i).first, ranges.at(i + 1).second), ranges.at(i).second);
+            mergedRanges << merges.last().first;
+        }
+        if (ranges.size() % 2)
+            mergedRanges << ranges.last();
+
+        QtConcurrent::blockingMap(merges, [&](const QPair<Range, size_t> &merge) {
+            std::inplace_merge(list.begin() + static_cast<long>(merge.first.first),
+                               list.begin() + static_cast<long>(merge.second),
+                               list.begin() + static_cast<long>(merge.first.second), lessThan);
+        });
+        ranges = mergedRanges;
+    }
+
+    return !*isCancel;
+}
+
+/*!
+ * \brief sortNodeList 对节点列表排序
+ * 按名称排序时预先为每个文件计算一次是否目录、名称分类和QCollatorSortKey，比较时不再访问文件信息和QCollator，
+ * 其他排序方式直接使用sortFun比较
+ * \param list 需要排序的节点
+ * \param sortFun 文件信息提供的比较函数
+ * \param order 升序还是降序
+ * \param isCancel 是否取消排序
+ * \return 排序被取消时返回false，list保持不变
+ */
+static bool sortNodeList(QList<FileSystemNodePointer> &list, const DAbstractFileInfo::CompareFunction &sortFun,
+                         const Qt::SortOrder &order, const bool *isCancel)
+{
+    typedef bool (*CompareFunctionPointer)(const DAbstractFileInfoPointer &, const DAbstractFileInfoPointer &, Qt::SortOrder);
+
+    const CompareFunctionPointer *compare = sortFun.target<CompareFunctionPointer>();
+    if (compare && *compare == &FileSortFunction::compareFileListByDisplayName) {
+        struct NameSortItem {
+            FileSystemNodePointer node;
+            bool isDir;
+            int sortClass;
+            QCollatorSortKey sortKey;
+        };
+
+        const QCollatorSortKey emptyKey = FileSortFunction::sortKeyOfString(QString());
+        std::vector<NameSortItem> items;
+        items.reserve(static_cast<size_t>(list.size()));
+        for (const FileSystemNodePointer &node : list)
+            items.push_back({node, false, 0, emptyKey});
+
+        QtConcurrent::blockingMap(items, [](NameSortItem &item) {
+            const QString &name = item.node->fileInfo->fileDisplayName();
+            item.isDir = item.node->fileInfo->isDir();
+            item.sortClass = FileSortFunction::sortClassOfString(name);
+            item.sortKey = FileSortFunction::sortKeyOfString(name);
+        });
+        if (*isCancel)
+            return false;
+
+        // 目录始终排在文件前面，与compareFileListByDisplayName的规则一致
+        const bool ok = parallelStableSort(items, [order](const NameSortItem &item1, const NameSortItem &item2) {
+            if (item1.isDir != item2.isDir)
+                return item1.isDir;
+
+            int result = item1.sortClass - item2.sortClass;
+            if (result == 0)
+                result = item1.sortKey.compare(item2.sortKey);
+
+            return order == Qt::DescendingOrder ? result > 0 : result < 0;
+        }, isCancel);
+        if (!ok)
+            return false;
+
+        for (int i = 0; i < list.size(); ++i)
+            list[i] = items[static_cast<size_t>(i)].node;
+
+        return true;
+    }
+
+    std::vector<FileSystemNodePointer> nodes(list.begin(), list.end());
+    const bool ok = parallelStableSort(nodes, [&sortFun, order](const FileSystemNodePointer &node1, const FileSystemNodePointer &node2) {
+        return sortFun(node1->fileInfo, node2->fileInfo, order);
+    }, isCancel);
+    if (!ok)
+        return false;
+
+    for (int i = 0; i < list.size(); ++i)
+        list[i] = nodes[static_cast<size_t>(i)];
+
+    return true;
+}
+
 FileSystemNode::FileSystemNode(FileSystemNode *parent,
                    const DAbstractFileInfoPointer &info,
                    DFileSystemModel *dFileSystemModel,
@@ -202,22 +335,10 @@ void FileSystemNode::applyFileFilter(std::shared_ptr<FileFilter> filter)
 void FileSystemNode::sortAllChildren(const DAbstractFileInfo::CompareFunction &sortFun, const Qt::SortOrder &order, const bool *cancel) {
     if (!sortFun)
         return;
-    QList<FileSystemNodePointer> sortList;
-    int row = 0;
     rwLock->lockForWrite();
-    for (const auto & needNode : visibleChildren) {
-        if (*cancel) {
-            rwLock->unlock();
-            return;
-        }
-        row = FindInsertPosInOrderList(needNode, sortList, sortFun, order, cancel);
-        if (*cancel) {
-            rwLock->unlock();
-            return;
-        }
-        sortList.insert(row, needNode);
-    }
-    visibleChildren = sortList;
+    QList<FileSystemNodePointer> sortList = visibleChildren;
+    if (!*cancel && sortNodeList(sortList, sortFun, order, cancel))
+        visibleChildren = sortList;
     rwLock->unlock();
 }
 
@@ -284,6 +405,32 @@ void FileSystemNode::insertChildren(int index, const DUrl &url, const FileSystem
     rwLock->unlock();
 }
 
+void FileSystemNode::insertChildren(int index, const QList<FileSystemNodePointer> &nodes, const bool *isCache)
+{
+    rwLock->lockForWrite();
+    // 整段插入，避免逐个插入时反复移动后面的元素
+    index = qBound(0, index, visibleChildren.count());
+    const QList<FileSystemNodePointer> &tail = visibleChildren.mid(index);
+    visibleChildren.erase(visibleChildren.begin() + index, visibleChildren.end());
+    visibleChildren.reserve(visibleChildren.count() + nodes.count() + tail.count());
+
+    for (const FileSystemNodePointer &node : nodes) {
+        const DUrl &url = node->fileInfo->fileUrl();
+
+        if (children.contains(url))
+            continue;
+
+        if (*isCache && !fileInfo->fileUrl().isSearchFile())
+            insertCacheChildren.insert(url, node);
+
+        children[url] = node;
+        visibleChildren.append(node);
+    }
+
+    visibleChildren.append(tail);
+    rwLock->unlock();
+}
+
 int FileSystemNode::insertChildren(const DUrl &url, const FileSystemNodePointer &needNode, const DAbstractFileInfo::CompareFunction &sortFun, const Qt::SortOrder &order, const bool &isInsert)
 {
     rwLock->lockForWrite();
@@ -373,6 +520,26 @@ FileSystemNodePointer FileSystemNode::takeNodeByIndex(const int index, const boo
     return node;
 }
 
+void FileSystemNode::takeNodesByIndex(const int first, const int last, const bool *isCache)
+{
+    rwLock->lockForWrite();
+    if (first >= 0 && first <= last && last < visibleChildren.size()) {
+        for (int i = first; i <= last; ++i) {
+            const FileSystemNodePointer &node = visibleChildren.at(i);
+
+            if (*isCache && !fileInfo->fileUrl().isSearchFile())
+                removeCacheChildren.insert(node->fileInfo->fileUrl(), node);
+
+            children.remove(node->fileInfo->fileUrl());
+        }
+
+        visibleChildren.erase(visibleChildren.begin() + first, visibleChildren.begin() + last + 1);
+    } else {
+        qWarning() << "index range [" << first << "," << last << "] out of range [" << visibleChildren.size() << "]";
+    }
+    rwLock->unlock();
+}
+
 int FileSystemNode::indexOfChild(const FileSystemNodePointer &node)
 {
     rwLock->lockForRead();
@@ -392,6 +559,49 @@ int FileSystemNode::indexOfChild(const DUrl &url)
     return index;
 }
 
+/*!
+ * \brief FileSystemNode::indexesOfChildren 一次遍历找出多个子节点的行号，按升序返回，不存在的文件被忽略
+ */
+QList<int> FileSystemNode::indexesOfChildren(const DUrlList &urls)
+{
+    QList<int> indexes;
+
+    rwLock->lockForRead();
+    QSet<const FileSystemNode *> nodes;
+
+    for (const DUrl &url : urls) {
+        const FileSystemNodePointer &node = children.value(url);
+
+        if (node)
+            nodes.insert(node.constData());
+    }
+
+    for (int i = 0; i < visibleChildren.count() && indexes.count() < nodes.count(); ++i) {
+        if (nodes.contains(visibleChildren.at(i).constData()))
+            indexes << i;
+    }
+    rwLock->unlock();
+
+    return indexes;
+}
+
+/*!
+ * \brief FileSystemNode::newChildren 过滤掉已经是子节点的文件，返回尚未插入的节点
+ */
+QList<FileSystemNodePointer> FileSystemNode::newChildren(const QList<FileSystemNodePointer> &nodes)
+{
+    QList<FileSystemNodePointer> result;
+
+    rwLock->lockForRead();
+    for (const FileSystemNodePointer &node : nodes) {
+        if (!children.contains(node->fileInfo->fileUrl()))
+            result << node;
+    }
+    rwLock->unlock();
+
+    return result;
+}
+
 int FileSystemNode::childrenCount()
 {
     QReadLocker rl(rwLock);
@@ -1005,65 +1215,19 @@ bool DFileSystemModelPrivate::passFileFilters(const DAbstractFileInfoPointer &in
 
 void DFileSystemModelPrivate::_q_onFileCreated(const DUrl &fileUrl, bool isPickUpQueue)
 {
-    Q_Q(DFileSystemModel);
-
-    DAbstractFileInfoPointer info = DAbstractFileInfo::getFileInfo(fileUrl);
-    if (info) {
-        info->refresh(info->isGvfsMountFile());
-    } else {
-        info = DFileService::instance()->createFileInfo(q, fileUrl);
-    }
-
-    if ((!info || !passFileFilters(info)) && !isPickUpQueue) {
-        return;
-    }
-//    rootNodeManager->addFile(info);
+    // 文件信息的创建和过滤放到批量处理时在线程中进行，避免大量文件事件时逐个阻塞界面线程
     mutex.lock();
-    fileEventQueue.enqueue(qMakePair(AddFile, fileUrl));
+    fileEventQueue.enqueue(qMakePair(isPickUpQueue ? AddFileUnfiltered : AddFile, fileUrl));
     mutex.unlock();
-    q->metaObject()->invokeMethod(q, QT_STRINGIFY(_q_processFileEvent), Qt::QueuedConnection);
-
-//    if (!_q_processFileEvent_runing.load()) {
-//        queueWLock.lockForWrite();
-//        while (!laterFileEventQueue.isEmpty()) {
-//            fileEventQueue.enqueue(laterFileEventQueue.dequeue());
-//        }
-//        fileEventQueue.enqueue(qMakePair(AddFile, fileUrl));
-//        queueWLock.unlock();
-//        q->metaObject()->invokeMethod(q, QT_STRINGIFY(_q_processFileEvent), Qt::QueuedConnection);
-//    } else {
-//        queueWLock.lockForWrite();
-//        laterFileEventQueue.enqueue(qMakePair(AddFile, fileUrl));
-//        queueWLock.unlock();
-//    }
+    startFileEventTimer();
 }
 
 void DFileSystemModelPrivate::_q_onFileDeleted(const DUrl &fileUrl)
 {
-    Q_Q(DFileSystemModel);
-
-//    rootNodeManager->removeFile(DFileService::instance()->createFileInfo(q, fileUrl));
-    //当文件删除时，删除隐藏文件集中的隐藏
-    QString absort = fileUrl.path().left(fileUrl.path().length() - fileUrl.fileName().length());
-    DFMFileListFile flf(absort);
-    if (flf.contains(fileUrl.fileName())) {
-        flf.remove(fileUrl.fileName());
-        flf.save();
-    }
-
     mutex.lock();
     fileEventQueue.enqueue(qMakePair(RmFile, fileUrl));
     mutex.unlock();
-    q->metaObject()->invokeMethod(q, QT_STRINGIFY(_q_processFileEvent), Qt::QueuedConnection);
-//    if (!_q_processFileEvent_runing.load()) {
-//        while (!laterFileEventQueue.isEmpty()) {
-//            fileEventQueue.enqueue(laterFileEventQueue.dequeue());
-//        }
-//        fileEventQueue.enqueue(qMakePair(RmFile, fileUrl));
-//        q->metaObject()->invokeMethod(q, QT_STRINGIFY(_q_processFileEvent), Qt::QueuedConnection);
-//    } else {
-//        laterFileEventQueue.enqueue(qMakePair(RmFile, fileUrl));
-//    }
+    startFileEventTimer();
 }
 
 void DFileSystemModelPrivate::_q_onFileUpdated(const DUrl &fileUrl)
@@ -1168,22 +1332,165 @@ void DFileSystemModelPrivate::_q_processFileEvent()
         if (me.isNull()) { // 当前窗口被关闭以后，me 指针指向的窗口会马上被析构，后面的流程不需要再走了
             return;
         }
+
+        // 一次取出队列中积累的所有事件，合并后批量处理
+        QQueue<QPair<EventType, DUrl>> events;
         mutex.lock();
-        const QPair<EventType, DUrl> &event = fileEventQueue.dequeue();
+        events.swap(fileEventQueue);
         mutex.unlock();
+
+        removeFromHiddenFileList(events);
+
+        if (!processFileEventBatch(mergeFileEvents(events))) {
+            return;
+        }
+    }
+    _q_processFileEvent_runing.store(false);
+}
+
+void DFileSystemModelPrivate::startFileEventTimer()
+{
+    Q_Q(DFileSystemModel);
+
+    if (!fileEventTimer) {
+        fileEventTimer = new QTimer(q);
+        fileEventTimer->setSingleShot(true);
+        fileEventTimer->setInterval(FILE_EVENT_MERGE_INTERVAL);
+        QObject::connect(fileEventTimer, SIGNAL(timeout()), q, SLOT(_q_processFileEvent()));
+    }
+
+    // 计时中不重新开始计时，持续不断的事件也能按固定的间隔得到处理
+    if (!fileEventTimer->isActive())
+        fileEventTimer->start();
+}
+
+void DFileSystemModelPrivate::removeFromHiddenFileList(const QQueue<QPair<EventType, DUrl>> &events)
+{
+    //当文件删除时，删除隐藏文件集中的隐藏，同一目录的文件只读写一次隐藏文件
+    QHash<QString, QStringList> deletedNames;
+
+    for (const QPair<EventType, DUrl> &event : events) {
+        if (event.first != RmFile)
+            continue;
+
         const DUrl &fileUrl = event.second;
-        const DAbstractFileInfoPointer &info = DFileService::instance()->createFileInfo(q, fileUrl);
+        const QString &absort = fileUrl.path().left(fileUrl.path().length() - fileUrl.fileName().length());
+        deletedNames[absort] << fileUrl.fileName();
+    }
+
+    for (auto it = deletedNames.constBegin(); it != deletedNames.constEnd(); ++it) {
+        DFMFileListFile flf(it.key());
+        bool changed = false;
+
+        for (const QString &name : it.value()) {
+            if (flf.contains(name)) {
+                flf.remove(name);
+                changed = true;
+            }
+        }
+
+        if (changed)
+            flf.save();
+    }
+}
+
+/*!
+ * \brief DFileSystemModelPrivate::mergeFileEvents 合并一批文件事件，同一文件只保留最后一次事件，
+ * 批次内先创建后删除且不在模型中的文件直接丢弃
+ */
+QList<QPair<DFileSystemModelPrivate::EventType, DUrl>> DFileSystemModelPrivate::mergeFileEvents(const QQueue<QPair<EventType, DUrl>> &events) const
+{
+    QHash<DUrl, int> lastEventIndex;
+    QHash<DUrl, EventType> firstEvent;
+
+    lastEventIndex.reserve(events.count());
+    firstEvent.reserve(events.count());
+
+    for (int i = 0; i < events.count(); ++i) {
+        const DUrl &fileUrl = events.at(i).second;
+
+        if (!firstEvent.contains(fileUrl))
+            firstEvent.insert(fileUrl, events.at(i).first);
+
+        lastEventIndex[fileUrl] = i;
+    }
+
+    QList<QPair<EventType, DUrl>> mergedEvents;
+
+    for (int i = 0; i < events.count(); ++i) {
+        const QPair<EventType, DUrl> &event = events.at(i);
+
+        if (lastEventIndex.value(event.second) != i)
+            continue;
+
+        if (event.first == RmFile && firstEvent.value(event.second) != RmFile
+                && !(rootNode && rootNode->childContains(event.second))) {
+            continue;
+        }
+
+        mergedEvents << event;
+    }
+
+    return mergedEvents;
+}
+
+bool DFileSystemModelPrivate::processFileEventBatch(const QList<QPair<EventType, DUrl>> &events)
+{
+    Q_Q(DFileSystemModel);
+    QPointer<DFileSystemModel> me = q;
+
+    if (events.isEmpty())
+        return true;
+
+    // 在线程中并行创建和刷新文件信息
+    QVector<DAbstractFileInfoPointer> infos(events.count());
+    QFuture<void> result = QtConcurrent::run(QThreadPool::globalInstance(), [&] {
+        QVector<int> indexes(events.count());
+
+        for (int i = 0; i < indexes.count(); ++i)
+            indexes[i] = i;
+
+        QtConcurrent::blockingMap(indexes, [&](int i) {
+            const DAbstractFileInfoPointer &info = DFileService::instance()->createFileInfo(q, events.at(i).second);
+
+            if (!info)
+                return;
+
+            if (events.at(i).first == RmFile) {
+                info->refresh(info->isGvfsMountFile());
+            }
+            // Will refreshing the file info meta data
+            info->refresh();
+            infos[i] = info;
+        });
+    });
+
+    while (!result.isFinished()) {
+        qApp->processEvents();
+    }
+
+    if (me.isNull()) {
+        return false;
+    }
+
+    const DUrl &rootUrl = q->rootUrl();
+    QList<DAbstractFileInfoPointer> addedInfos;
+    DUrlList removedUrls;
+
+    for (int i = 0; i < events.count(); ++i) {
+        const QPair<EventType, DUrl> &event = events.at(i);
+        const DAbstractFileInfoPointer &info = infos.at(i);
 
         if (!info) {
             continue;
         }
-        if (event.first != AddFile) {
-            info->refresh(info->isGvfsMountFile());
+
+        if (event.first == AddFile && !passFileFilters(info)) {
+            continue;
         }
-        const DUrl &rootUrl = q->rootUrl();
-        const DAbstractFileInfoPointer rootinfo = fileService->createFileInfo(q, rootUrl);
+
         DUrl nparentUrl(info->parentUrl());
-        DUrl nfileUrl(fileUrl);
+        DUrl nfileUrl(event.second);
 
         if (rootUrl.scheme() == BURN_SCHEME) {
             QRegularExpression burn_rxp("^(.*?)/(" BURN_SEG_ONDISC "|" BURN_SEG_STAGING ")(.*)$");
@@ -1210,21 +1517,32 @@ void DFileSystemModelPrivate::_q_processFileEvent()
         if (nparentUrl != rootUrl) {
             continue;
         }
-        // Will refreshing the file info meta data
-        info->refresh();
-        if (event.first == AddFile) {
-            q->addFile(info);
-            q->selectAndRenameFile(fileUrl);
-        } else {// rm file event
-            // q->update();/*解决文管多窗口删除文件的时候，文官会崩溃的问题*/
-            // todo: 此处引起效率变低，暂时注释
-            q->remove(fileUrl);
+
+        if (event.first != RmFile) {
+            addedInfos << info;
+        } else {
+            removedUrls << event.second;
         }
+    }
+
+    // 合并后每个文件只剩一个事件，先删除再添加不会互相影响
+    if (!removedUrls.isEmpty()) {
+        q->removeFiles(removedUrls);
+    }
+
+    if (!addedInfos.isEmpty()) {
+        q->addFiles(addedInfos);
+
         if (me.isNull()) {
-            return;
+            return false;
+        }
+
+        for (const DAbstractFileInfoPointer &info : addedInfos) {
+            q->selectAndRenameFile(info->fileUrl());
         }
     }
-    _q_processFileEvent_runing.store(false);
+
+    return !me.isNull();
 }
 
 bool DFileSystemModelPrivate::checkFileEventQueue()
@@ -2805,6 +3123,42 @@ bool DFileSystemModel::remove(const DUrl &url)
     return false;
 }
 
+void DFileSystemModel::removeFiles(const DUrlList &urls)
+{
+    Q_D(DFileSystemModel);
+
+    if (urls.count() == 1) {
+        remove(urls.first());
+        return;
+    }
+
+    const FileSystemNodePointer &parentNode = d->rootNode;
+
+    if (!parentNode || !parentNode->populatedChildren) {
+        return;
+    }
+
+    const QList<int> &rows = parentNode->indexesOfChildren(urls);
+
+    d->currentRemove = true;
+    // 从后往前按连续的行移除，前面的行号不受影响
+    for (int last = rows.count() - 1; last >= 0;) {
+        int first = last;
+
+        while (first > 0 && rows.at(first - 1) == rows.at(first) - 1) {
+            --first;
+        }
+
+        if (beginRemoveRows(createIndex(parentNode, 0), rows.at(first), rows.at(last))) {
+            parentNode->takeNodesByIndex(rows.at(first), rows.at(last), d->rootNodeManager->isInsertCaches());
+            endRemoveRows();
+        }
+
+        last = first - 1;
+    }
+    d->currentRemove = false;
+}
+
 const FileSystemNodePointer DFileSystemModel::getNodeByIndex(const QModelIndex &index) const
 {
     Q_D(const DFileSystemModel);
@@ -3033,6 +3387,100 @@ void DFileSystemModel::addFile(const DAbstractFileInfoPointer &fileInfo)
     }
 }
 
+void DFileSystemModel::addFiles(const QList<DAbstractFileInfoPointer> &infos)
+{
+    Q_D(const DFileSystemModel);
+
+    if (infos.count() == 1) {
+        addFile(infos.first());
+        return;
+    }
+
+    const FileSystemNodePointer parentNode = d->rootNode;
+
+    if (!parentNode || !parentNode->populatedChildren) {
+        return;
+    }
+
+    QList<FileSystemNodePointer> nodes;
+
+    for (const DAbstractFileInfoPointer &fileInfo : infos) {
+        if (!parentNode->childContains(fileInfo->fileUrl()))
+            nodes << createNode(parentNode.data(), fileInfo);
+    }
+
+    if (nodes.isEmpty()) {
+        return;
+    }
+
+    QPointer<DFileSystemModel> me = this;
+    // 每个新节点在原有子节点中的插入位置，为空时追加到末尾
+    QList<int> rows;
+
+    if (enabledSort()) {
+        const DAbstractFileInfoPointer &fileInfo = nodes.first()->fileInfo;
+
+        if (fileInfo->hasOrderly()) {
+            DAbstractFileInfo::CompareFunction compareFun = fileInfo->compareFunByColumn(d->sortRole);
+            Qt::SortOrder order = d->srotOrder;
+
+            // 先将新节点排序，再逐个查找插入位置，得到的位置是递增的
+            QFuture<void> result = QtConcurrent::run(QThreadPool::globalInstance(), [&] {
+                bool isCancel = false;
+                const QList<FileSystemNodePointer> &children = parentNode->getChildrenList();
+
+                sortNodeList(nodes, compareFun, order, &isCancel);
+
+                for (const FileSystemNodePointer &node : nodes) {
+                    if (!me)
+                        return;
+
+                    rows << FindInsertPosInOrderList(node, children, compareFun, order, &isCancel);
+                }
+            });
+
+            while (!result.isFinished()) {
+                qApp->processEvents();
+            }
+
+            if (!me) {
+                return;
+            }
+        } else {
+            // tmp: 暂时不排序，与单个文件的添加保持一致插入到最前面
+            for (int i = 0; i < nodes.count(); ++i)
+                rows << 0;
+        }
+    }
+
+    // 插入位置相同的节点是连续的一段，每段只通知一次插入
+    int offset = 0;
+
+    for (int i = 0; i < nodes.count();) {
+        const int pos = rows.isEmpty() ? -1 : rows.at(i);
+        int j = i + 1;
+
+        while (j < nodes.count() && (rows.isEmpty() || rows.at(j) == pos)) {
+            ++j;
+        }
+
+        // 排序期间处理过其他事件，部分文件可能已经插入，通知前重新过滤，保证通知的行数与实际插入的一致
+        const QList<FileSystemNodePointer> &segment = parentNode->newChildren(nodes.mid(i, j - i));
+
+        if (!segment.isEmpty()) {
+            const int count = parentNode->childrenCount();
+            const int row = pos < 0 ? count : qMin(pos + offset, count);
+
+            beginInsertRows(createIndex(parentNode, 0), row, row + segment.count() - 1);
+            parentNode->insertChildren(row, segment, d->rootNodeManager->isInsertCaches());
+            endInsertRows();
+        }
+
+        offset += segment.count();
+        i = j;
+    }
+}
+
 void DFileSystemModel::emitAllDataChanged()
 {
     Q_D(const DFileSystemModel);
@@ -3166,17 +3614,9 @@ bool DFileSystemModel::beginRemoveRows(const QModelIndex &parent, int first, int
 void DFileSystemModel::sortByMySelf(QList<FileSystemNodePointer> &list, const DAbstractFileInfo::CompareFunction &sortFun)
 {
     Q_D(DFileSystemModel);
-    QList<FileSystemNodePointer> sortList;
-    int row = 0;
-    for (const auto & needNode : list) {
-        if (isNeedToBreakBusyCase)
-            return;
-        row = FindInsertPosInOrderList(needNode, sortList, sortFun, d->srotOrder, &isNeedToBreakBusyCase);
-        if (isNeedToBreakBusyCase)
-            return;
-        sortList.insert(row, needNode);
-    }
-    list = sortList;
+    QList<FileSystemNodePointer> sortList = list;
+    if (!isNeedToBreakBusyCase && sortNodeList(sortList, sortFun, d->srotOrder, &isNeedToBreakBusyCase))
+        list = sortList;
 }
 
 void DFileSystemModel::endRemoveRows()
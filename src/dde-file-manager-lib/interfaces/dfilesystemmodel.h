@@ -243,6 +243,7 @@ signals:
 
 protected:
     bool remove(const DUrl &url);
+    void removeFiles(const DUrlList &urls);
     bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
 
 private:
@@ -264,6 +265,7 @@ private:
     void onJobAddChildren(const DAbstractFileInfoPointer fileInfo, const bool isEnd);
     void onJobFinished();
     void addFile(const DAbstractFileInfoPointer &fileInfo);
+    void addFiles(const QList<DAbstractFileInfoPointer> &infos);
 
     void emitAllDataChanged();
     void selectAndRenameFile(const DUrl &fileUrl);
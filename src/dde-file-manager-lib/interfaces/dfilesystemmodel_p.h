@@ -10,6 +10,7 @@
 
 #include <QReadWriteLock>
 #include <QQueue>
+#include <QTimer>
 
 class FileSystemNode : public QSharedData
 {
@@ -27,6 +28,7 @@ public:
     bool shouldHideByFilterRule(std::shared_ptr<FileFilter> filter);
     void noLockInsertChildren(int index, const DUrl &url, const FileSystemNodePointer &node);
     void insertChildren(int index, const DUrl &url, const FileSystemNodePointer &node, const bool *isCache);
+    void insertChildren(int index, const QList<FileSystemNodePointer> &nodes, const bool *isCache);
     int insertChildren(const DUrl &url, const FileSystemNodePointer &node, const DAbstractFileInfo::CompareFunction &sortFun,
                        const Qt::SortOrder &order,const bool &isInsert = true);
     void noLockAppendChildren(const DUrl &url, const FileSystemNodePointer &node);
@@ -36,8 +38,11 @@ public:
     FileSystemNodePointer getNodeByIndex(int index);
     FileSystemNodePointer takeNodeByUrl(const DUrl &url);
     FileSystemNodePointer takeNodeByIndex(const int index, const bool *isCache);
+    void takeNodesByIndex(const int first, const int last, const bool *isCache);
     int indexOfChild(const FileSystemNodePointer &node);
     int indexOfChild(const DUrl &url);
+    QList<int> indexesOfChildren(const DUrlList &urls);
+    QList<FileSystemNodePointer> newChildren(const QList<FileSystemNodePointer> &nodes);
     int childrenCount();
     QList<FileSystemNodePointer> getChildrenList() const;
     DUrlList getChildrenUrlList();
@@ -220,6 +225,7 @@ class DFileSystemModelPrivate
 public:
     enum EventType {
         AddFile,
+        AddFileUnfiltered, // 不经过文件过滤器直接添加
         RmFile
     };
     explicit DFileSystemModelPrivate(DFileSystemModel *qq);
@@ -240,6 +246,10 @@ public:
     /// add/rm file event
     void _q_processFileEvent();
     bool checkFileEventQueue();
+    void startFileEventTimer();
+    void removeFromHiddenFileList(const QQueue<QPair<EventType, DUrl>> &events);
+    QList<QPair<EventType, DUrl>> mergeFileEvents(const QQueue<QPair<EventType, DUrl>> &events) const;
+    bool processFileEventBatch(const QList<QPair<EventType, DUrl>> &events);
 
     DFileSystemModel *q_ptr;
 
@@ -276,6 +286,8 @@ public:
     std::atomic<bool> _q_processFileEvent_runing;
     QQueue<QPair<EventType, DUrl>> fileEventQueue;
     QQueue<QPair<EventType, DUrl>> laterFileEventQueue;
+    // 短时间内到达的文件事件合并为一批处理
+    QTimer *fileEventTimer = nullptr;
 
     bool enabledSort = true;
 
@@ -430,6 +430,27 @@ void DFMStyledItemDelegatePrivate::init()
     textLineHeight = q->parent()->parent()->fontMetrics().lineSpacing();
 }
 
+QString DFMStyledItemDelegatePrivate::elideText(const QString &text, const QSizeF &size, QTextOption::WrapMode wordWrap,
+                                                const QFont &font, Qt::TextElideMode mode, qreal lineHeight) const
+{
+    const TextLayoutCacheKey key { text, font, size.width(), size.height(), wordWrap, mode, 0, lineHeight, QString() };
+
+    if (const QString *elided_text = elidedTextCache.object(key))
+        return *elided_text;
+
+    const QString &elided_text = DFMGlobal::elideText(text, size, wordWrap, font, mode, lineHeight);
+
+    elidedTextCache.insert(key, new QString(elided_text));
+
+    return elided_text;
+}
+
+void DFMStyledItemDelegatePrivate::clearTextLayoutCache()
+{
+    elidedTextCache.clear();
+    textBoundingCache.clear();
+}
+
 void DFMStyledItemDelegatePrivate::_q_onRowsInserted(const QModelIndex &parent, int first, int last)
 {
     if (editingIndex.isValid() && first <= editingIndex.row() && !editingIndex.parent().isValid()) {
@@ -454,9 +454,6 @@ public:
 
     QPointer<ExpandedItem> expandedItem;
 
-    //    mutable QHash<QString, QString> elideMap;
-    //    mutable QHash<QString, QString> wordWrapMap;
-    //    mutable QHash<QString, int> textHeightMap;
     mutable QModelIndex expandedIndex;
     mutable QModelIndex lastAndExpandedInde;
 
@@ -1326,9 +1323,7 @@ void DIconItemDelegate::updateItemSizeHint()
 {
     Q_D(DIconItemDelegate);
 
-    //    d->elideMap.clear();
-    //    d->wordWrapMap.clear();
-    //    d->textHeightMap.clear();
+    d->clearTextLayoutCache();
     d->textLineHeight = parent()->parent()->fontMetrics().lineSpacing();
 
     int width = parent()->parent()->iconSize().width() + 30;
@@ -1436,7 +1431,32 @@ QList<QRectF> DIconItemDelegate::drawText(const QModelIndex &index, QPainter *pa
 
     const_cast<DIconItemDelegatePrivate *>(d)->drawTextBackgroundOnLast = background != Qt::NoBrush;
 
-    return DFMStyledItemDelegate::drawText(index, painter, layout, boundingRect, radius, background, wordWrap, mode, flags, shadowColor);
+    if (painter)
+        return DFMStyledItemDelegate::drawText(index, painter, layout, boundingRect, radius, background, wordWrap, mode, flags, shadowColor);
+
+    // 只计算文本区域时(点击、框选、展开等判断)，从缓存中取上一次排版的结果，缓存的区域相对于boundingRect的左上角
+    const QVariantHash &ep = index.data(DFileSystemModel::ExtraProperties).toHash();
+    QStringList color_names;
+
+    for (const QColor &color : qvariant_cast<QList<QColor>>(ep.value("colored")))
+        color_names << color.name();
+
+    const TextLayoutCacheKey key { layout->text(), layout->font(), boundingRect.width(), boundingRect.height(),
+                                   wordWrap, mode, flags, static_cast<qreal>(d->textLineHeight), color_names.join(',') };
+    QList<QRectF> lines;
+
+    if (const QList<QRectF> *cached_lines = d->textBoundingCache.object(key)) {
+        lines = *cached_lines;
+    } else {
+        lines = DFMStyledItemDelegate::drawText(index, nullptr, layout, QRectF(QPointF(0, 0), boundingRect.size()),
+                                                radius, background, wordWrap, mode, flags, shadowColor);
+        d->textBoundingCache.insert(key, new QList<QRectF>(lines));
+    }
+
+    for (QRectF &line : lines)
+        line.translate(boundingRect.topLeft());
+
+    return lines;
 }
 
 void DIconItemDelegate::onEditWidgetFocusOut()
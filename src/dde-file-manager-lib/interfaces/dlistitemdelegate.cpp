@@ -311,7 +311,7 @@ void DListItemDelegate::paint(QPainter *painter,
                     if(VaultController::isVaultFile(strInfo))
                         strInfo = VaultController::localPathToVirtualPath(index.data(rol).toString());
                 }
-                const QString &text = DFMGlobal::elideText(strInfo, rec.size(),
+                const QString &text = d->elideText(strInfo, rec.size(),
                                                            QTextOption::NoWrap, opt.font,
                                                            Qt::ElideRight, d->textLineHeight);
 
@@ -344,6 +344,8 @@ void DListItemDelegate::paint(QPainter *painter,
 void DListItemDelegate::drawNotStringData(const QStyleOptionViewItem &opt, int lineHeight, const QRect &rect, const QVariant &data,
                                           bool drawBackground, QPainter *painter, const int &column) const
 {
+    Q_D(const DListItemDelegate);
+
     const DFileSystemModel *model = parent()->model();
     const DAbstractFileInfoPointer &fileInfo = model->fileInfo(model->rootUrl());
 
@@ -356,14 +358,14 @@ void DListItemDelegate::drawNotStringData(const QStyleOptionViewItem &opt, int l
     if (data.canConvert<QPair<QString, QString>>()) {
         QPair<QString, QString> name_path = qvariant_cast<QPair<QString, QString>>(data);
 
-        const QString &file_name = DFMGlobal::elideText(name_path.first.remove('\n'),
+        const QString &file_name = d->elideText(name_path.first.remove('\n'),
                                                         QSize(rect.width(), rect.height() / 2), QTextOption::NoWrap,
                                                         opt.font, Qt::ElideRight,
                                                         lineHeight);
         painter->setPen(sortRoleIndexByColumnChildren == 0 ? active_color : normal_color);
         painter->drawText(rect.adjusted(0, 0, 0, -rect.height() / 2), Qt::AlignBottom, file_name);
 
-        const QString &file_path = DFMGlobal::elideText(name_path.second.remove('\n'),
+        const QString &file_path = d->elideText(name_path.second.remove('\n'),
                                                         QSize(rect.width(), rect.height() / 2), QTextOption::NoWrap,
                                                         opt.font, Qt::ElideRight,
                                                         lineHeight);
@@ -375,7 +377,7 @@ void DListItemDelegate::drawNotStringData(const QStyleOptionViewItem &opt, int l
 
         const QPair<QString, QPair<QString, QString>> &dst = qvariant_cast<QPair<QString, QPair<QString, QString>>>(data);
 
-        const QString &date = DFMGlobal::elideText(dst.first, QSize(rect.width(), rect.height() / 2),
+        const QString &date = d->elideText(dst.first, QSize(rect.width(), rect.height() / 2),
                                                    QTextOption::NoWrap, opt.font,
                                                    Qt::ElideRight, lineHeight);
 
@@ -384,14 +386,14 @@ void DListItemDelegate::drawNotStringData(const QStyleOptionViewItem &opt, int l
 
         new_rect = QRect(rect.left(), rect.top(), new_rect.width(), rect.height());
 
-        const QString &size = DFMGlobal::elideText(dst.second.first, QSize(new_rect.width() / 2, new_rect.height() / 2),
+        const QString &size = d->elideText(dst.second.first, QSize(new_rect.width() / 2, new_rect.height() / 2),
                                                    QTextOption::NoWrap, opt.font,
                                                    Qt::ElideRight, lineHeight);
 
         painter->setPen(sortRoleIndexByColumnChildren == 1 ? active_color : normal_color);
         painter->drawText(new_rect.adjusted(0, new_rect.height() / 2, 0, 0), Qt::AlignTop | Qt::AlignLeft, size);
 
-        const QString &type = DFMGlobal::elideText(dst.second.second, QSize(new_rect.width() / 2, new_rect.height() / 2),
+        const QString &type = d->elideText(dst.second.second, QSize(new_rect.width() / 2, new_rect.height() / 2),
                                                    QTextOption::NoWrap, opt.font,
                                                    Qt::ElideLeft, lineHeight);
         painter->setPen(sortRoleIndexByColumnChildren == 2 ? active_color : normal_color);
@@ -649,6 +651,7 @@ void DListItemDelegate::updateItemSizeHint()
 {
     Q_D(DListItemDelegate);
 
+    d->clearTextLayoutCache();
     d->textLineHeight = parent()->parent()->fontMetrics().lineSpacing();
     d->itemSizeHint = QSize(-1, qMax(int(parent()->parent()->iconSize().height() * 1.5), d->textLineHeight));
 }
@@ -769,6 +772,8 @@ bool DListItemDelegate::helpEvent(QHelpEvent *event, QAbstractItemView *view, co
 
 void DListItemDelegate::paintFileName(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index, const int &role, const QRect &rect, const int &textLineHeight) const
 {
+    Q_D(const DListItemDelegate);
+
     bool drawBackground =((option.state & QStyle::State_Selected) || parent()->isDropTarget(index)) && option.showDecorationSelected;
     const QVariant &data = index.data(role);
     painter->setPen(option.palette.color(drawBackground ? QPalette::BrightText : QPalette::Text));
@@ -791,7 +796,7 @@ void DListItemDelegate::paintFileName(QPainter *painter, const QStyleOptionViewI
             if (suffix == ".")
                 break;
 
-            file_name = DFMGlobal::elideText(index.data(DFileSystemModel::FileBaseNameRole).toString().remove('\n'),
+            file_name = d->elideText(index.data(DFileSystemModel::FileBaseNameRole).toString().remove('\n'),
                                              QSize(rect.width() - option.fontMetrics.width(suffix), rect.height()), QTextOption::WrapAtWordBoundaryOrAnywhere,
                                              option.font, Qt::ElideRight,
                                              textLineHeight);
@@ -801,7 +806,7 @@ void DListItemDelegate::paintFileName(QPainter *painter, const QStyleOptionViewI
         } while (false);
 
         if (file_name.isEmpty()) {
-            file_name = DFMGlobal::elideText(index.data(role).toString().remove('\n'),
+            file_name = d->elideText(index.data(role).toString().remove('\n'),
                                              rect.size(), QTextOption::WrapAtWordBoundaryOrAnywhere,
                                              option.font, Qt::ElideRight,
                                              textLineHeight);
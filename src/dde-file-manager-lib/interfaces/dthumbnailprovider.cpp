@@ -35,10 +35,13 @@
 #include <QDir>
 #include <QDateTime>
 #include <QImageReader>
-#include <QQueue>
+#include <QMap>
 #include <QMimeType>
 #include <QReadWriteLock>
-#include <QWaitCondition>
+#include <QMutex>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QElapsedTimer>
 #include <QPainter>
 #include <QDirIterator>
 #include <QJsonDocument>
@@ -54,12 +57,28 @@
 #include <poppler-page.h>
 #include <poppler-page-renderer.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <functional>
 
 #include <DThumbnailProvider>
 
 DFM_BEGIN_NAMESPACE
 
 #define FORMAT ".png"
+// 同时生成缩略图的工作线程上限
+#define THUMBNAIL_WORKER_MAX 4
+// 等待缩略图子进程时检查任务是否被取消的间隔(ms)
+#define THUMBNAIL_PROCESS_WAIT_INTERVAL 100
+// 缩略图子进程的超时时间(ms)
+#define THUMBNAIL_PROCESS_TIMEOUT 30000
 //#define CREATE_VEDIO_THUMB "CreateVedioThumbnail"
 
 inline QByteArray dataToMd5Hex(const QByteArray &data)
@@ -67,6 +86,231 @@ inline QByteArray dataToMd5Hex(const QByteArray &data)
     return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
 }
 
+/*!
+ * \brief 以常驻模式(--batch)运行的缩略图工具进程，通过管道依次发送请求，避免每个文件都启动一次进程
+ * 请求: quint32 缩略图大小, quint32 路径长度, 路径
+ * 回复: qint32 状态(0 为成功), quint32 数据长度, 数据(成功时为 png 图片, 失败时为错误信息)
+ * 整数均为本机字节序。一个进程同一时间只由一个工作线程使用
+ */
+class ThumbnailToolWorker
+{
+public:
+    enum Reply {
+        ReplyImage,     // data 为缩略图
+        ReplyError,     // data 为工具返回的错误信息
+        ReplyDead,      // 发送请求前进程已经退出(已被回收或者写管道EPIPE)，可以换一个进程重试
+        ReplyBroken     // 请求发出后超时、崩溃(包括没有任何回复就关闭)或者任务被取消，此进程不能再使用，也不应再重试
+    };
+
+    explicit ThumbnailToolWorker(const QString &tool)
+        : tool(tool)
+    {
+
+    }
+
+    ~ThumbnailToolWorker()
+    {
+        stop();
+    }
+
+    bool start()
+    {
+        int input[2] = { -1, -1 };
+        int output[2] = { -1, -1 };
+
+        if (pipe2(input, O_CLOEXEC) != 0)
+            return false;
+
+        if (pipe2(output, O_CLOEXEC) != 0) {
+            ::close(input[0]);
+            ::close(input[1]);
+            return false;
+        }
+
+        // 子进程的标准输入输出连接到管道，标准错误中的ffmpeg日志直接丢弃
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, input[0], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, output[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+        const QByteArray &program = QFile::encodeName(tool);
+        char *const argv[] = { const_cast<char *>(program.constData()), const_cast<char *>("--batch"), nullptr };
+        int ret = posix_spawn(&pid, program.constData(), &actions, nullptr, argv, environ);
+
+        posix_spawn_file_actions_destroy(&actions);
+        ::close(input[0]);
+        ::close(output[1]);
+
+        if (ret != 0) {
+            pid = -1;
+            ::close(input[1]);
+            ::close(output[0]);
+            errno = ret;
+            return false;
+        }
+
+        writeFd = input[1];
+        readFd = output[0];
+
+        return true;
+    }
+
+    void stop()
+    {
+        if (writeFd >= 0)
+            ::close(writeFd);
+
+        if (readFd >= 0)
+            ::close(readFd);
+
+        writeFd = -1;
+        readFd = -1;
+
+        if (pid > 0) {
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+            pid = -1;
+        }
+    }
+
+    // 进程是否已经退出，已退出的进程在此回收
+    bool hasExited()
+    {
+        if (pid <= 0)
+            return true;
+
+        pid_t ret = ::waitpid(pid, nullptr, WNOHANG);
+
+        if (ret == pid || (ret < 0 && errno == ECHILD)) {
+            pid = -1;
+            return true;
+        }
+
+        return false;
+    }
+
+    Reply request(quint32 size, const QString &filePath, QByteArray *data, const std::function<bool()> &isCanceled)
+    {
+        const QByteArray &path = QFile::encodeName(filePath);
+        const quint32 header[2] = { size, static_cast<quint32>(path.size()) };
+        QElapsedTimer timer;
+
+        timer.start();
+
+        // 空闲期间退出的进程还没有收到本次请求
+        if (hasExited())
+            return ReplyDead;
+
+        if (!writeFull(header, sizeof(header)) || !writeFull(path.constData(), path.size()))
+            return errno == EPIPE ? ReplyDead : ReplyBroken;
+
+        // 请求写入成功后进程可能正在处理此文件，之后的任何错误(包括没有回复就关闭管道)都可能是此文件导致的
+        qint32 replyHeader[2];
+
+        if (!readFull(replyHeader, sizeof(replyHeader), timer, isCanceled) || replyHeader[1] < 0)
+            return ReplyBroken;
+
+        data->resize(replyHeader[1]);
+
+        if (!readFull(data->data(), data->size(), timer, isCanceled))
+            return ReplyBroken;
+
+        return replyHeader[0] == 0 ? ReplyImage : ReplyError;
+    }
+
+    const QString tool;
+
+private:
+    bool writeFull(const void *data, qint64 size)
+    {
+        // 工具进程退出后写管道会产生SIGPIPE，写入时在当前线程屏蔽此信号
+        sigset_t pipeSet;
+        sigset_t oldSet;
+
+        sigemptyset(&pipeSet);
+        sigaddset(&pipeSet, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+
+        const char *buffer = static_cast<const char *>(data);
+        bool ok = true;
+        int error = 0;
+
+        while (size > 0) {
+            ssize_t ret = ::write(writeFd, buffer, static_cast<size_t>(size));
+
+            if (ret < 0 && errno == EINTR)
+                continue;
+
+            if (ret <= 0) {
+                ok = false;
+                error = ret < 0 ? errno : EIO;
+                break;
+            }
+
+            buffer += ret;
+            size -= ret;
+        }
+
+        if (!ok && error == EPIPE && !sigismember(&oldSet, SIGPIPE)) {
+            const struct timespec zero = { 0, 0 };
+            sigtimedwait(&pipeSet, nullptr, &zero);
+        }
+
+        pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+
+        // 调用者根据EPIPE判断进程是否在发送请求前已经退出
+        errno = error;
+
+        return ok;
+    }
+
+    bool readFull(void *data, qint64 size, const QElapsedTimer &timer, const std::function<bool()> &isCanceled)
+    {
+        char *buffer = static_cast<char *>(data);
+
+        while (size > 0) {
+            struct pollfd pfd;
+            pfd.fd = readFd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+
+            // 分段等待回复，任务被移出可见区域或者超时时放弃此进程，释放工作线程
+            int ret = ::poll(&pfd, 1, THUMBNAIL_PROCESS_WAIT_INTERVAL);
+
+            if (ret < 0 && errno == EINTR)
+                continue;
+
+            if (ret < 0)
+                return false;
+
+            if (ret == 0) {
+                if ((isCanceled && isCanceled()) || timer.elapsed() >= THUMBNAIL_PROCESS_TIMEOUT)
+                    return false;
+
+                continue;
+            }
+
+            ssize_t readSize = ::read(readFd, buffer, static_cast<size_t>(size));
+
+            if (readSize < 0 && errno == EINTR)
+                continue;
+
+            if (readSize <= 0)
+                return false;
+
+            buffer += readSize;
+            size -= readSize;
+        }
+
+        return true;
+    }
+
+    pid_t pid = -1;
+    int writeFd = -1;
+    int readFd = -1;
+};
+
 class DThumbnailProviderPrivate
 {
 public:
@@ -76,14 +320,28 @@ public:
 
     QString sizeToFilePath(DThumbnailProvider::Size size) const;
 
+    typedef QPair<QString, DThumbnailProvider::Size> ProduceKey;
+
+    bool raiseInProduceQueue(const ProduceKey &key);
+    void startWorker();
+    void processProduceQueue();
+
+    bool isCurrentTaskCanceled() const;
+    bool waitForProcessFinished(QProcess &process);
+    // 使用常驻的工具进程生成缩略图，成功时data为png图片
+    bool requestToolWorker(const QString &tool, int size, const QString &filePath, QByteArray *data, QString *errorString);
+    void clearToolWorkers();
+
     DThumbnailProvider *q_ptr;
-    QString errorString;
+    // 多个工作线程同时生成缩略图，错误信息按线程保存
+    QThreadStorage<QString> errorString;
     // 5MB
     qint64 defaultSizeLimit = 1024 * 1024 * 20;
     QHash<QMimeType, qint64> sizeLimitHash;
     DMimeDatabase mimeDatabase;
 
     static QSet<QString> hasThumbnailMimeHash;
+    static QMutex hasThumbnailMimeMutex;
 
     struct ProduceInfo {
         QFileInfo fileInfo;
@@ -91,21 +349,37 @@ public:
         DThumbnailProvider::CallBack callback;
     };
 
-    QQueue<ProduceInfo> produceQueue;
-    QQueue<QString> m_produceAbsoluteFilePathQueue;
-    QSet<QPair<QString, DThumbnailProvider::Size>> discardedProduceInfos;
+    // 等待生成的任务，key为优先级，值越大越先生成
+    QMap<quint64, ProduceInfo> produceQueue;
+    QHash<ProduceKey, quint64> producePriority;
+    quint64 priorityCounter = 0;
+    // 正在生成的任务及其取消标记
+    QHash<ProduceKey, QSharedPointer<QAtomicInt>> runningTasks;
+    QThreadStorage<QSharedPointer<QAtomicInt>> currentTaskCanceled;
 
     bool running = true;
+    int workerCount = 0;
 
-    QWaitCondition waitCondition;
     QReadWriteLock dataReadWriteLock;
 
+    QMutex thumbnailToolMutex;
     QHash<QString, QString> keyToThumbnailTool;
+    // 支持常驻模式的缩略图工具
+    QSet<QString> batchThumbnailTools;
+    // 空闲的常驻工具进程，key为工具路径，数量不超过工作线程的数量
+    QMutex toolWorkerMutex;
+    QMultiHash<QString, QSharedPointer<ThumbnailToolWorker>> idleToolWorkers;
+    // dtk的缩略图接口的错误信息是共享的，调用时需要串行
+    mutable QMutex dtkProviderMutex;
+
+    // 放在最后，保证析构时先等待工作线程退出
+    QThreadPool workerPool;
 
     Q_DECLARE_PUBLIC(DThumbnailProvider)
 };
 
 QSet<QString> DThumbnailProviderPrivate::hasThumbnailMimeHash;
+QMutex DThumbnailProviderPrivate::hasThumbnailMimeMutex;
 
 DThumbnailProviderPrivate::DThumbnailProviderPrivate(DThumbnailProvider *qq)
     : q_ptr(qq)
@@ -115,6 +389,8 @@ DThumbnailProviderPrivate::DThumbnailProviderPrivate(DThumbnailProvider *qq)
 
 void DThumbnailProviderPrivate::init()
 {
+    workerPool.setMaxThreadCount(qBound(2, QThread::idealThreadCount() / 2, THUMBNAIL_WORKER_MAX));
+
     sizeLimitHash.reserve(28);
     sizeLimitHash.insert(mimeDatabase.mimeTypeForName("text/plain"), 1024 * 1024);
     sizeLimitHash.insert(mimeDatabase.mimeTypeForName("application/pdf"), INT64_MAX);
@@ -147,6 +423,173 @@ QString DThumbnailProviderPrivate::sizeToFilePath(DThumbnailProvider::Size size)
     return ""; //默认返回空字符 warning项
 }
 
+bool DThumbnailProviderPrivate::raiseInProduceQueue(const ProduceKey &key)
+{
+    auto it = producePriority.find(key);
+
+    if (it == producePriority.end())
+        return false;
+
+    const ProduceInfo &info = produceQueue.take(it.value());
+
+    it.value() = ++priorityCounter;
+    produceQueue.insert(it.value(), info);
+
+    return true;
+}
+
+void DThumbnailProviderPrivate::startWorker()
+{
+    // 调用方需持有dataReadWriteLock的写锁
+    if (!running || workerCount >= workerPool.maxThreadCount() || workerCount >= produceQueue.size())
+        return;
+
+    ++workerCount;
+    QtConcurrent::run(&workerPool, [this] {
+        processProduceQueue();
+    });
+}
+
+void DThumbnailProviderPrivate::processProduceQueue()
+{
+    Q_Q(DThumbnailProvider);
+
+    forever {
+        QWriteLocker locker(&dataReadWriteLock);
+
+        if (!running || produceQueue.isEmpty()) {
+            const bool isLastWorker = (--workerCount == 0);
+            locker.unlock();
+
+            // 队列中的任务都完成后结束空闲的工具进程
+            if (isLastWorker)
+                clearToolWorkers();
+
+            return;
+        }
+
+        // 优先生成最后请求或最近被视图提升的任务，即当前可见区域的文件
+        auto last = std::prev(produceQueue.end());
+        const ProduceInfo task = last.value();
+        const ProduceKey key(task.fileInfo.absoluteFilePath(), task.size);
+        const QSharedPointer<QAtomicInt> canceled(new QAtomicInt(0));
+
+        produceQueue.erase(last);
+        producePriority.remove(key);
+        runningTasks.insert(key, canceled);
+        locker.unlock();
+
+        currentTaskCanceled.setLocalData(canceled);
+        const QString &thumbnail = q->createThumbnail(task.fileInfo, task.size);
+        currentTaskCanceled.setLocalData(QSharedPointer<QAtomicInt>());
+
+        locker.relock();
+        runningTasks.remove(key);
+        locker.unlock();
+
+        // 被取消的任务没有生成结果，不通知调用方，以免其误认为此文件没有缩略图
+        if (task.callback && !(thumbnail.isEmpty() && canceled->load()))
+            task.callback(thumbnail);
+    }
+}
+
+bool DThumbnailProviderPrivate::isCurrentTaskCanceled() const
+{
+    const QSharedPointer<QAtomicInt> &canceled = currentTaskCanceled.localData();
+
+    return canceled && canceled->load();
+}
+
+bool DThumbnailProviderPrivate::waitForProcessFinished(QProcess &process)
+{
+    QElapsedTimer timer;
+
+    timer.start();
+
+    // 分段等待子进程结束，任务被移出可见区域时直接结束子进程，释放工作线程
+    while (!process.waitForFinished(THUMBNAIL_PROCESS_WAIT_INTERVAL)) {
+        if (process.state() == QProcess::NotRunning)
+            return false;
+
+        if (isCurrentTaskCanceled() || timer.elapsed() >= THUMBNAIL_PROCESS_TIMEOUT) {
+            process.kill();
+            process.waitForFinished();
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool DThumbnailProviderPrivate::requestToolWorker(const QString &tool, int size, const QString &filePath, QByteArray *data, QString *errorString)
+{
+    for (int i = 0; i < 2; ++i) {
+        QSharedPointer<ThumbnailToolWorker> worker;
+
+        {
+            QMutexLocker locker(&toolWorkerMutex);
+            auto iter = idleToolWorkers.find(tool);
+
+            if (iter != idleToolWorkers.end()) {
+                worker = iter.value();
+                idleToolWorkers.erase(iter);
+            }
+        }
+
+        const bool isNewWorker = !worker;
+
+        if (isNewWorker) {
+            worker.reset(new ThumbnailToolWorker(tool));
+
+            if (!worker->start()) {
+                *errorString = QString("start the \"%1\" application failed: %2").arg(tool).arg(strerror(errno));
+                return false;
+            }
+        }
+
+        const ThumbnailToolWorker::Reply reply = worker->request(static_cast<quint32>(size), filePath, data, [this] {
+            return isCurrentTaskCanceled();
+        });
+
+        if (reply == ThumbnailToolWorker::ReplyImage || reply == ThumbnailToolWorker::ReplyError) {
+            QMutexLocker locker(&toolWorkerMutex);
+            idleToolWorkers.insert(tool, worker);
+            locker.unlock();
+
+            if (reply == ThumbnailToolWorker::ReplyError) {
+                *errorString = data->isEmpty() ? QString("get thumbnail failed from the \"%1\" application").arg(tool)
+                                               : QString::fromUtf8(*data);
+                return false;
+            }
+
+            return true;
+        }
+
+        // 只有空闲期间已经退出的进程才重新启动一个再试一次；超时、处理中崩溃和新启动的进程出错时不再重试，
+        // 避免导致工具崩溃或者卡住的文件(如损坏的视频)反复占用工作线程
+        if (reply != ThumbnailToolWorker::ReplyDead || isNewWorker || isCurrentTaskCanceled())
+            break;
+    }
+
+    *errorString = QString("get thumbnail failed from the \"%1\" application").arg(tool);
+
+    return false;
+}
+
+void DThumbnailProviderPrivate::clearToolWorkers()
+{
+    QMultiHash<QString, QSharedPointer<ThumbnailToolWorker>> workers;
+
+    {
+        QMutexLocker locker(&toolWorkerMutex);
+        workers.swap(idleToolWorkers);
+    }
+
+    // 在锁外析构，等待进程退出时不阻塞其它工作线程
+    workers.clear();
+}
+
 class DFileThumbnailProviderPrivate : public DThumbnailProvider {};
 Q_GLOBAL_STATIC(DFileThumbnailProviderPrivate, ftpGlobal)
 
@@ -183,6 +626,8 @@ bool DThumbnailProvider::hasThumbnail(const QFileInfo &info) const
 
 bool DThumbnailProvider::hasThumbnail(const QMimeType &mimeType) const
 {
+    Q_D(const DThumbnailProvider);
+
     const QString &mime = mimeType.name();
     QStringList mimeTypeList = {mime};
     mimeTypeList.append(mimeType.parentMimeTypes());
@@ -204,6 +649,8 @@ bool DThumbnailProvider::hasThumbnail(const QMimeType &mimeType) const
         return false;
     }
 
+    QMutexLocker locker(&DThumbnailProviderPrivate::hasThumbnailMimeMutex);
+
     if (DThumbnailProviderPrivate::hasThumbnailMimeHash.contains(mime))
         return true;
 
@@ -223,6 +670,10 @@ bool DThumbnailProvider::hasThumbnail(const QMimeType &mimeType) const
         return true;
     }
 
+    locker.unlock();
+
+    QMutexLocker dtkLocker(&d->dtkProviderMutex);
+
     if (DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->hasThumbnail(mimeType))
         return true;
 
@@ -292,7 +743,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 {
     Q_D(DThumbnailProvider);
 
-    d->errorString.clear();
+    QString &errorString = d->errorString.localData();
+
+    errorString.clear();
 
     const QString &absolutePath = info.absolutePath();
     const QString &absoluteFilePath = info.absoluteFilePath();
@@ -305,7 +758,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
     }
 
     if (!hasThumbnail(info)) {
-        d->errorString = QStringLiteral("This file has not support thumbnail: ") + absoluteFilePath;
+        errorString = QStringLiteral("This file has not support thumbnail: ") + absoluteFilePath;
 
         //!Warnning: Do not store thumbnails to the fail path
         return QString();
@@ -341,10 +794,12 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 
     //! 新增djvu格式文件缩略图预览
     if (mime.name().contains("image/vnd.djvu")) {
+        QMutexLocker dtkLocker(&d->dtkProviderMutex);
         thumbnail = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->createThumbnail(info, (DTK_GUI_NAMESPACE::DThumbnailProvider::Size)size);
-        d->errorString = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        errorString = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        dtkLocker.unlock();
 
-        if (d->errorString.isEmpty()) {
+        if (errorString.isEmpty()) {
             emit createThumbnailFinished(absoluteFilePath, thumbnail);
             emit thumbnailChanged(absoluteFilePath, thumbnail);
 
@@ -361,8 +816,13 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
             arguments << "--thumbnail" << "-f" << absoluteFilePath << "-t" << saveImage;
             process.start(readerBinary, arguments);
 
-            if (!process.waitForFinished()) {
-                d->errorString = process.errorString();
+            if (!d->waitForProcessFinished(process)) {
+                if (d->isCurrentTaskCanceled()) {
+                    errorString = QStringLiteral("The thumbnail task has been canceled: ") + absoluteFilePath;
+                    return QString();
+                }
+
+                errorString = process.errorString();
 
                 goto _return;
             }
@@ -371,9 +831,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 const QString &error = process.readAllStandardError();
 
                 if (error.isEmpty()) {
-                    d->errorString = QString("get thumbnail failed from the \"%1\" application").arg(readerBinary);
+                    errorString = QString("get thumbnail failed from the \"%1\" application").arg(readerBinary);
                 } else {
-                    d->errorString = error;
+                    errorString = error;
                 }
 
                 goto _return;
@@ -386,7 +846,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 Q_ASSERT(!output.isEmpty());
 
                 if (image->loadFromData(output, "png")) {
-                    d->errorString.clear();
+                    errorString.clear();
                 }
                 file.close();
             }
@@ -404,7 +864,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 
         QImageReader reader(absoluteFilePath, suffix.toLatin1());
         if (!reader.canRead()) {
-            d->errorString = reader.errorString();
+            errorString = reader.errorString();
             goto _return;
         }
 
@@ -413,7 +873,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         //fix 读取损坏icns文件（可能任意损坏的image类文件也有此情况）在arm平台上会导致递归循环的问题
         //这里先对损坏文件（imagesize无效）做处理，不再尝试读取其image数据
         if (!imageSize.isValid()) {
-            d->errorString = "Fail to read image file attribute data:" + info.absoluteFilePath();
+            errorString = "Fail to read image file attribute data:" + info.absoluteFilePath();
             goto _return;
         }
 
@@ -424,7 +884,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         reader.setAutoTransform(true);
 
         if (!reader.read(image.data())) {
-            d->errorString = reader.errorString();
+            errorString = reader.errorString();
             goto _return;
         }
 
@@ -436,7 +896,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QFile file(absoluteFilePath);
 
         if (!file.open(QIODevice::ReadOnly)) {
-            d->errorString = file.errorString();
+            errorString = file.errorString();
             goto _return;
         }
 
@@ -465,19 +925,19 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         QScopedPointer<poppler::document> doc(poppler::document::load_from_file(absoluteFilePath.toStdString()));
 
         if (!doc || doc->is_locked()) {
-            d->errorString = QStringLiteral("Cannot read this pdf file: ") + absoluteFilePath;
+            errorString = QStringLiteral("Cannot read this pdf file: ") + absoluteFilePath;
             goto _return;
         }
 
         if (doc->pages() < 1) {
-            d->errorString = QStringLiteral("This stream is invalid");
+            errorString = QStringLiteral("This stream is invalid");
             goto _return;
         }
 
         QScopedPointer<const poppler::page> page(doc->create_page(0));
 
         if (!page) {
-            d->errorString = QStringLiteral("Cannot get this page at index 0");
+            errorString = QStringLiteral("Cannot get this page at index 0");
             goto _return;
         }
 
@@ -488,7 +948,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         poppler::image imageData = pr.render_page(page.data(), 72, 72, -1, -1, -1, size);
 
         if (!imageData.is_valid()) {
-            d->errorString = QStringLiteral("Render error");
+            errorString = QStringLiteral("Render error");
             goto _return;
         }
 
@@ -497,7 +957,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 
         switch (format) {
         case poppler::image::format_invalid:
-            d->errorString = QStringLiteral("Image format is invalid");
+            errorString = QStringLiteral("Image format is invalid");
             goto _return;
         case poppler::image::format_mono:
             img = QImage((uchar *)imageData.data(), imageData.width(), imageData.height(), QImage::Format_Mono);
@@ -513,21 +973,25 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
         }
 
         if (img.isNull()) {
-            d->errorString = QStringLiteral("Render error");
+            errorString = QStringLiteral("Render error");
             goto _return;
         }
 
         *image = img.scaled(QSize(size, size), Qt::KeepAspectRatio, Qt::SmoothTransformation);
     } else {
+        QMutexLocker dtkLocker(&d->dtkProviderMutex);
         thumbnail = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->createThumbnail(info, (DTK_GUI_NAMESPACE::DThumbnailProvider::Size)size);
-        d->errorString = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        errorString = DTK_GUI_NAMESPACE::DThumbnailProvider::instance()->errorString();
+        dtkLocker.unlock();
 
-        if (d->errorString.isEmpty()) {
+        if (errorString.isEmpty()) {
             emit createThumbnailFinished(absoluteFilePath, thumbnail);
             emit thumbnailChanged(absoluteFilePath, thumbnail);
 
             return thumbnail;
         } else { // fallback to thumbnail tool
+            QMutexLocker toolLocker(&d->thumbnailToolMutex);
+
             if (d->keyToThumbnailTool.isEmpty()) {
                 d->keyToThumbnailTool["Initialized"] = QString();
 
@@ -555,6 +1019,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                             continue;
                         }
 
+                        if (document.object().value("Batch").toBool())
+                            d->batchThumbnailTools.insert(tool_file_path);
+
                         for (const QString &key : keys) {
                             if (d->keyToThumbnailTool.contains(key))
                                 continue;
@@ -573,15 +1040,46 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 tool = d->keyToThumbnailTool.value(mime_name);
             }
 
+            const bool isBatchTool = d->batchThumbnailTools.contains(tool);
+
+            toolLocker.unlock();
+
             if (tool.isEmpty()) {
                 return thumbnail;
             }
 
+            // 支持常驻模式的工具由已启动的进程生成，直接返回png数据，不再每个文件启动一次进程
+            if (isBatchTool) {
+                QByteArray png_data;
+
+                if (!d->requestToolWorker(tool, size, absoluteFilePath, &png_data, &errorString)) {
+                    if (d->isCurrentTaskCanceled()) {
+                        errorString = QStringLiteral("The thumbnail task has been canceled: ") + absoluteFilePath;
+                        return QString();
+                    }
+
+                    goto _return;
+                }
+
+                if (image->loadFromData(png_data, "png")) {
+                    errorString.clear();
+                } else {
+                    errorString = QString("load png image failed from the \"%1\" application").arg(tool);
+                }
+
+                goto _return;
+            }
+
             QProcess process;
             process.start(tool, {QString::number(size), absoluteFilePath}, QIODevice::ReadOnly);
 
-            if (!process.waitForFinished()) {
-                d->errorString = process.errorString();
+            if (!d->waitForProcessFinished(process)) {
+                if (d->isCurrentTaskCanceled()) {
+                    errorString = QStringLiteral("The thumbnail task has been canceled: ") + absoluteFilePath;
+                    return QString();
+                }
+
+                errorString = process.errorString();
 
                 goto _return;
             }
@@ -590,9 +1088,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 const QString &error = process.readAllStandardError();
 
                 if (error.isEmpty()) {
-                    d->errorString = QString("get thumbnail failed from the \"%1\" application").arg(tool);
+                    errorString = QString("get thumbnail failed from the \"%1\" application").arg(tool);
                 } else {
-                    d->errorString = error;
+                    errorString = error;
                 }
 
                 goto _return;
@@ -603,7 +1101,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
             Q_ASSERT(!png_data.isEmpty());
 
             if (image->loadFromData(png_data, "png")) {
-                d->errorString.clear();
+                errorString.clear();
             } else {
                 //过滤video tool的其他输出信息
                 QString processResult(output);
@@ -611,9 +1109,9 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
                 const QByteArray pngData = QByteArray::fromBase64(processResult.toUtf8());
                 Q_ASSERT(!pngData.isEmpty());
                 if (image->loadFromData(pngData, "png")) {
-                    d->errorString.clear();
+                    errorString.clear();
                 } else {
-                    d->errorString = QString("load png image failed from the \"%1\" application").arg(tool);
+                    errorString = QString("load png image failed from the \"%1\" application").arg(tool);
                 }
             }
         }
@@ -621,7 +1119,7 @@ QString DThumbnailProvider::createThumbnail(const QFileInfo &info, DThumbnailPro
 
 _return:
     // successful
-    if (d->errorString.isEmpty()) {
+    if (errorString.isEmpty()) {
         thumbnail = d->sizeToFilePath(size) + QDir::separator() + thumbnailName;
     } else {
         //fail
@@ -635,10 +1133,10 @@ _return:
     QFileInfo(thumbnail).absoluteDir().mkpath(".");
 
     if (!image->save(thumbnail, Q_NULLPTR, 80)) {
-        d->errorString = QStringLiteral("Can not save image to ") + thumbnail;
+        errorString = QStringLiteral("Can not save image to ") + thumbnail;
     }
 
-    if (d->errorString.isEmpty()) {
+    if (errorString.isEmpty()) {
         emit createThumbnailFinished(absoluteFilePath, thumbnail);
         emit thumbnailChanged(absoluteFilePath, thumbnail);
 
@@ -653,52 +1151,61 @@ _return:
 
 void DThumbnailProvider::appendToProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size, DThumbnailProvider::CallBack callback)
 {
+    Q_D(DThumbnailProvider);
+
+    const DThumbnailProviderPrivate::ProduceKey key(info.absoluteFilePath(), size);
+    QWriteLocker locker(&d->dataReadWriteLock);
+
+    // fix bug 62540 这里在没生成缩略图的情况下，（触发刷新，文件大小改变）同一个文件会多次生成缩略图的情况,
+    // 正在生成的文件不再加入队列，已在队列中的文件只提升其优先级
+    if (d->runningTasks.contains(key) || d->raiseInProduceQueue(key))
+        return;
+
     DThumbnailProviderPrivate::ProduceInfo produceInfo;
 
     produceInfo.fileInfo = info;
     produceInfo.size = size;
     produceInfo.callback = callback;
 
+    d->producePriority.insert(key, ++d->priorityCounter);
+    d->produceQueue.insert(d->priorityCounter, std::move(produceInfo));
+    d->startWorker();
+}
+
+void DThumbnailProvider::removeInProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size)
+{
     Q_D(DThumbnailProvider);
 
-    if (isRunning()) {
-        QWriteLocker locker(&d->dataReadWriteLock);
-        // fix bug 62540 这里在没生成缩略图的情况下，（触发刷新，文件大小改变）同一个文件会多次生成缩略图的情况,
-        // 缓存当前队列中生成的缩略图文件的路劲没有就加入队里生成
-        if (!d->m_produceAbsoluteFilePathQueue.contains(info.absoluteFilePath())) {
-            d->produceQueue.append(std::move(produceInfo));
-            d->m_produceAbsoluteFilePathQueue << info.absoluteFilePath();
-        }
-        locker.unlock();
-        d->waitCondition.wakeAll();
-    } else {
-        // fix bug 62540 这里在没生成缩略图的情况下，（触发刷新，文件大小改变）同一个文件会多次生成缩略图的情况,
-        // 缓存当前队列中生成的缩略图文件的路劲没有就加入队里生成
-        if (!d->m_produceAbsoluteFilePathQueue.contains(info.absoluteFilePath())) {
-            d->produceQueue.append(std::move(produceInfo));
-            d->m_produceAbsoluteFilePathQueue << info.absoluteFilePath();
-        }
-        start();
+    const DThumbnailProviderPrivate::ProduceKey key(info.absoluteFilePath(), size);
+    QWriteLocker locker(&d->dataReadWriteLock);
+    const quint64 priority = d->producePriority.take(key);
+
+    if (priority > 0) {
+        d->produceQueue.remove(priority);
+    } else if (const QSharedPointer<QAtomicInt> &canceled = d->runningTasks.value(key)) {
+        // 已在生成中的任务只能通知其尽早结束
+        canceled->store(1);
     }
 }
 
-void DThumbnailProvider::removeInProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size)
+/*!
+ * \brief DThumbnailProvider::raiseInProduceQueue 将队列中等待生成的任务提升为最先生成，
+ * 视图滚动时对可见区域的文件调用，使其缩略图先于已滚出视图的文件生成
+ */
+void DThumbnailProvider::raiseInProduceQueue(const QFileInfo &info, DThumbnailProvider::Size size)
 {
     Q_D(DThumbnailProvider);
 
-    if (isRunning()) {
-        QWriteLocker locker(&d->dataReadWriteLock);
-        Q_UNUSED(locker)
-    }
+    QWriteLocker locker(&d->dataReadWriteLock);
 
-    d->discardedProduceInfos.insert(qMakePair(info.absoluteFilePath(), size));
+    d->raiseInProduceQueue(qMakePair(info.absoluteFilePath(), size));
 }
 
 QString DThumbnailProvider::errorString() const
 {
     Q_D(const DThumbnailProvider);
 
-    return d->errorString;
+    return d->errorString.localData();
 }
 
 qint64 DThumbnailProvider::defaultSizeLimit() const
@@ -730,7 +1237,7 @@ void DThumbnailProvider::setSizeLimit(const QMimeType &mimeType, qint64 size)
 }
 
 DThumbnailProvider::DThumbnailProvider(QObject *parent)
-    : QThread(parent)
+    : QObject(parent)
     , d_ptr(new DThumbnailProviderPrivate(this))
 {
     d_func()->init();
@@ -740,48 +1247,17 @@ DThumbnailProvider::~DThumbnailProvider()
 {
     Q_D(DThumbnailProvider);
 
-    d->running = false;
-    d->waitCondition.wakeAll();
-    wait();
-}
-
-void DThumbnailProvider::run()
-{
-    Q_D(DThumbnailProvider);
-
-    forever {
-        QWriteLocker locker(&d->dataReadWriteLock);
-
-        if (d->produceQueue.isEmpty()) {
-            d->waitCondition.wait(&d->dataReadWriteLock);
-        }
+    QWriteLocker locker(&d->dataReadWriteLock);
 
-        if (!d->running)
-            return;
-
-        const DThumbnailProviderPrivate::ProduceInfo &task = d->produceQueue.dequeue();
-        const QPair<QString, DThumbnailProvider::Size> &tmpKey = qMakePair(task.fileInfo.absoluteFilePath(), task.size);
-
-        if (d->discardedProduceInfos.contains(tmpKey)) {
-            d->discardedProduceInfos.remove(tmpKey);
-            //fix 62540 去除缓存
-            d->m_produceAbsoluteFilePathQueue.removeOne(task.fileInfo.absoluteFilePath());
-            locker.unlock();
-            continue;
-        }
-
-        locker.unlock();
-
-        const QString &thumbnail = createThumbnail(task.fileInfo, task.size);
+    d->running = false;
+    d->produceQueue.clear();
+    d->producePriority.clear();
 
-        locker.relock();
-        //fix 62540 生成结束了去除缓存
-        d->m_produceAbsoluteFilePathQueue.removeOne(task.fileInfo.absoluteFilePath());
-        locker.unlock();
+    for (const QSharedPointer<QAtomicInt> &canceled : d->runningTasks)
+        canceled->store(1);
 
-        if (task.callback)
-            task.callback(thumbnail);
-    }
+    locker.unlock();
+    d->workerPool.waitForDone();
 }
 
 DFM_END_NAMESPACE
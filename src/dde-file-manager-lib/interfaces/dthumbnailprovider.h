@@ -24,7 +24,7 @@
 #ifndef DFM_DFILETHUMBNAILPROVIDER_H
 #define DFM_DFILETHUMBNAILPROVIDER_H
 
-#include <QThread>
+#include <QObject>
 #include <QFileInfo>
 
 #include "dfmglobal.h"
@@ -38,7 +38,7 @@ QT_END_NAMESPACE
 DFM_BEGIN_NAMESPACE
 
 class DThumbnailProviderPrivate;
-class DThumbnailProvider : public QThread
+class DThumbnailProvider : public QObject
 {
     Q_OBJECT
 
@@ -60,6 +60,7 @@ public:
     QString createThumbnail(const QFileInfo &info, Size size);
     void appendToProduceQueue(const QFileInfo &info, Size size, CallBack callback = 0);
     void removeInProduceQueue(const QFileInfo &info, Size size);
+    void raiseInProduceQueue(const QFileInfo &info, Size size);
 
     QString errorString() const;
 
@@ -78,8 +79,6 @@ protected:
     explicit DThumbnailProvider(QObject *parent = 0);
     ~DThumbnailProvider() override;
 
-    void run() override;
-
 private:
     QScopedPointer<DThumbnailProviderPrivate> d_ptr;
     Q_DECLARE_PRIVATE(DThumbnailProvider)
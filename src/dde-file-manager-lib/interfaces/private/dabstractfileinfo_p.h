@@ -28,6 +28,7 @@
 #include "dmimedatabase.h"
 
 #include <QPointer>
+#include <QMutex>
 
 QT_BEGIN_NAMESPACE
 class QReadWriteLock;
@@ -46,7 +47,10 @@ public:
 
     DAbstractFileInfo *q_ptr = Q_NULLPTR;
 
+    // 拼音名称的缓存，pinyinSourceName为生成缓存时的显示名称，显示名称改变后重新生成
     mutable QString pinyinName;
+    mutable QString pinyinSourceName;
+    mutable QMutex pinyinMutex;
     bool active = false;
     qint8 gvfsMountFile = -1;
 
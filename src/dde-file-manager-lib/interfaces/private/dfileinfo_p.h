@@ -41,6 +41,12 @@ public:
     ~DFileInfoPrivate();
 
     bool isLowSpeedFile() const;
+    // 链接文件的属性需要跟随到目标文件，仍然使用 QFileInfo，预读未完成或者不是链接文件时返回nullptr
+    const DFileInfo::Stat *readyStat() const;
+    // 目录项或预读得到的文件类型(S_IFMT)，未知时返回0
+    quint32 prefetchedType() const;
+    // 不是链接文件时返回已知的文件类型，未知时返回0
+    quint32 knownType() const;
 
     QFileInfo fileInfo;
     mutable QMimeType mimeType;
@@ -54,6 +60,8 @@ public:
     mutable qint8 hasThumbnail = -1;
     mutable qint8 lowSpeedFile = -1;
     mutable quint64 inode = 0;
+    // 目录迭代时预读的属性，与预读线程共享
+    QSharedPointer<DFileInfo::PrefetchedStat> prefetched;
 
     mutable QVariantHash extraProperties;
     mutable bool epInitialized = false;
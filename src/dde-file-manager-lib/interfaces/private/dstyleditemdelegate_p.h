@@ -25,6 +25,41 @@
 
 #include "dfmstyleditemdelegate.h"
 
+#include <QCache>
+#include <QFont>
+#include <QRectF>
+#include <QTextOption>
+
+// 文本排版缓存的键，文本、字体、区域大小、换行和省略方式都相同时，排版的结果也相同
+struct TextLayoutCacheKey
+{
+    QString text;
+    QFont font;
+    qreal width;
+    qreal height;
+    int wrapMode;
+    int elideMode;
+    int flags;
+    qreal lineHeight;
+    // 其他影响排版的属性，如文件标记的颜色
+    QString extra;
+
+    bool operator==(const TextLayoutCacheKey &other) const
+    {
+        return text == other.text && font == other.font
+               && width == other.width && height == other.height
+               && wrapMode == other.wrapMode && elideMode == other.elideMode && flags == other.flags
+               && lineHeight == other.lineHeight && extra == other.extra;
+    }
+};
+
+inline uint qHash(const TextLayoutCacheKey &key, uint seed = 0)
+{
+    return qHash(key.text, seed) ^ qHash(key.font, seed) ^ qHash(key.extra, seed)
+           ^ qHash(qRound(key.width) ^ (qRound(key.height) << 16), seed)
+           ^ qHash((key.wrapMode << 24) ^ (key.elideMode << 16) ^ key.flags, seed);
+}
+
 class DFMStyledItemDelegatePrivate
 {
 public:
@@ -35,11 +70,20 @@ public:
     void _q_onRowsInserted(const QModelIndex &parent, int first, int last);
     void _q_onRowsRemoved(const QModelIndex &parent, int first, int last);
 
+    QString elideText(const QString &text, const QSizeF &size, QTextOption::WrapMode wordWrap,
+                      const QFont &font, Qt::TextElideMode mode, qreal lineHeight) const;
+    void clearTextLayoutCache();
+
     DFMStyledItemDelegate *q_ptr;
     mutable QModelIndex editingIndex;
     QSize itemSizeHint;
     int textLineHeight = -1;
 
+    // 省略后的文本和文本区域的LRU缓存，滚动时不再对每个可见的文件名重新排版
+    // 文件重命名后文本不同，不会命中旧的缓存；缩放和字体改变时在updateItemSizeHint中清空
+    mutable QCache<TextLayoutCacheKey, QString> elidedTextCache{ 2000 };
+    mutable QCache<TextLayoutCacheKey, QList<QRectF>> textBoundingCache{ 2000 };
+
     Q_DECLARE_PUBLIC(DFMStyledItemDelegate)
 };
 
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "dfilecopybufferpool.h"
+
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include <unistd.h>
+#include <stdlib.h>
+
+#define DEFAULT_MAX_CACHED_SIZE (64 * 1024 * 1024)
+
+DFM_BEGIN_NAMESPACE
+
+class DFileCopyBufferPoolPrivate
+{
+public:
+    DFileCopyBufferPoolPrivate();
+
+    void freeBuffer(char *buffer);
+
+    mutable QMutex mutex;
+    qint64 pageSize;
+    qint64 maxCachedSize;
+    qint64 cachedSize = 0;
+    // 所有由池申请且尚未释放的缓冲区及其实际大小
+    QHash<char *, qint64> capacities;
+    // 按大小分级的空闲缓冲区，每级的大小是2的幂
+    QHash<qint64, QVector<char *>> freeBuffers;
+};
+
+DFileCopyBufferPoolPrivate::DFileCopyBufferPoolPrivate()
+    : pageSize(getpagesize())
+    , maxCachedSize(DEFAULT_MAX_CACHED_SIZE)
+{
+    bool ok = false;
+    const qint64 size = qgetenv("DFM_COPY_BUFFER_POOL_SIZE").toLongLong(&ok);
+    if (ok && size >= 0)
+        maxCachedSize = size * 1024 * 1024;
+}
+
+void DFileCopyBufferPoolPrivate::freeBuffer(char *buffer)
+{
+    capacities.remove(buffer);
+    free(buffer);
+}
+
+DFileCopyBufferPool *DFileCopyBufferPool::instance()
+{
+    static DFileCopyBufferPool pool;
+
+    return &pool;
+}
+
+char *DFileCopyBufferPool::acquire(qint64 size)
+{
+    Q_D(DFileCopyBufferPool);
+
+    // 按2的幂分级，大小相近的请求共用同一级的空闲缓冲区，页大小本身是2的幂，得到的缓冲区仍按页对齐
+    qint64 capacity = d->pageSize;
+    while (capacity < size)
+        capacity <<= 1;
+
+    {
+        QMutexLocker lk(&d->mutex);
+        auto it = d->freeBuffers.find(capacity);
+        if (it != d->freeBuffers.end() && !it->isEmpty()) {
+            d->cachedSize -= capacity;
+            return it->takeLast();
+        }
+    }
+
+    void *buffer = nullptr;
+    if (posix_memalign(&buffer, static_cast<size_t>(d->pageSize), static_cast<size_t>(capacity)) != 0)
+        qBadAlloc();
+
+    QMutexLocker lk(&d->mutex);
+    d->capacities.insert(static_cast<char *>(buffer), capacity);
+
+    return static_cast<char *>(buffer);
+}
+
+void DFileCopyBufferPool::release(char *buffer)
+{
+    if (!buffer)
+        return;
+
+    Q_D(DFileCopyBufferPool);
+    QMutexLocker lk(&d->mutex);
+
+    const qint64 capacity = d->capacities.value(buffer, -1);
+    if (Q_UNLIKELY(capacity < 0)) {
+        qWarning() << "release a buffer not acquired from the pool";
+        return;
+    }
+
+    if (d->cachedSize + capacity > d->maxCachedSize) {
+        d->freeBuffer(buffer);
+        return;
+    }
+
+    d->freeBuffers[capacity].append(buffer);
+    d->cachedSize += capacity;
+}
+
+qint64 DFileCopyBufferPool::maxCachedSize() const
+{
+    Q_D(const DFileCopyBufferPool);
+    QMutexLocker lk(&d->mutex);
+
+    return d->maxCachedSize;
+}
+
+void DFileCopyBufferPool::setMaxCachedSize(qint64 size)
+{
+    Q_D(DFileCopyBufferPool);
+    QMutexLocker lk(&d->mutex);
+
+    d->maxCachedSize = qMax(size, qint64(0));
+
+    // 超出新上限的空闲缓冲区直接释放
+    for (auto it = d->freeBuffers.begin(); it != d->freeBuffers.end() && d->cachedSize > d->maxCachedSize; ++it) {
+        while (!it->isEmpty() && d->cachedSize > d->maxCachedSize) {
+            d->freeBuffer(it->takeLast());
+            d->cachedSize -= it.key();
+        }
+    }
+}
+
+qint64 DFileCopyBufferPool::cachedSize() const
+{
+    Q_D(const DFileCopyBufferPool);
+    QMutexLocker lk(&d->mutex);
+
+    return d->cachedSize;
+}
+
+void DFileCopyBufferPool::clear()
+{
+    Q_D(DFileCopyBufferPool);
+    QMutexLocker lk(&d->mutex);
+
+    for (const QVector<char *> &buffers : d->freeBuffers) {
+        for (char *buffer : buffers)
+            d->freeBuffer(buffer);
+    }
+    d->freeBuffers.clear();
+    d->cachedSize = 0;
+}
+
+DFileCopyBufferPool::DFileCopyBufferPool()
+    : d_ptr(new DFileCopyBufferPoolPrivate())
+{
+
+}
+
+DFileCopyBufferPool::~DFileCopyBufferPool()
+{
+    clear();
+}
+
+DFM_END_NAMESPACE
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DFILECOPYBUFFERPOOL_H
+#define DFILECOPYBUFFERPOOL_H
+
+#include <dfmglobal.h>
+
+#include <QScopedPointer>
+
+DFM_BEGIN_NAMESPACE
+
+/*!
+ * \brief The DFileCopyBufferPool class 进程内共享的拷贝缓冲区池
+ * 缓冲区按页对齐，大小向上取整到页大小的整数倍。归还的缓冲区在不超过缓存上限时留在池中复用，
+ * 超过上限时直接释放，避免大量小文件拷贝时频繁的申请和释放内存
+ */
+class DFileCopyBufferPoolPrivate;
+class DFileCopyBufferPool
+{
+    Q_DECLARE_PRIVATE(DFileCopyBufferPool)
+
+public:
+    static DFileCopyBufferPool *instance();
+
+    // 获取至少size大小的缓冲区，实际大小取整到2的幂，必须使用release归还
+    char *acquire(qint64 size);
+    // 归还acquire获取的缓冲区，buffer为空时不做处理
+    void release(char *buffer);
+
+    // 池中空闲缓冲区占用内存的上限，默认64M，可以使用环境变量DFM_COPY_BUFFER_POOL_SIZE（单位为M）修改
+    qint64 maxCachedSize() const;
+    void setMaxCachedSize(qint64 size);
+    // 池中空闲缓冲区占用的内存大小
+    qint64 cachedSize() const;
+    // 释放池中所有空闲的缓冲区
+    void clear();
+
+private:
+    DFileCopyBufferPool();
+    ~DFileCopyBufferPool();
+
+    QScopedPointer<DFileCopyBufferPoolPrivate> d_ptr;
+
+    Q_DISABLE_COPY(DFileCopyBufferPool)
+};
+
+DFM_END_NAMESPACE
+
+#endif // DFILECOPYBUFFERPOOL_H
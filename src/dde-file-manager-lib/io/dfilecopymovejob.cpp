@@ -30,6 +30,9 @@
 #include "ddiriterator.h"
 #include "dfilestatisticsjob.h"
 #include "dlocalfiledevice.h"
+#include "dstorageinfo.h"
+#include "dfilecopybufferpool.h"
+#include "dfilecopypipeline.h"
 #include "models/trashfileinfo.h"
 #include "controllers/vaultcontroller.h"
 #include "controllers/masteredmediacontroller.h"
@@ -54,6 +57,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <linux/fs.h>
 #include <inttypes.h>
 #include <string.h>
 #include <stdlib.h>
@@ -76,47 +82,22 @@ Q_LOGGING_CATEGORY(fileJob, "file.job", QtInfoMsg)
 //<syscall.h> == <sys/syscall.h>
 #if defined(Q_OS_LINUX) && (defined(__GLIBC__) || QT_HAS_INCLUDE(<syscall.h>))
 #  include <syscall.h>
-
-# if defined(Q_OS_ANDROID) && !defined(SYS_gettid)
-#  define SYS_gettid __NR_gettid
-# endif
-
+#endif
 
 #define MAX_BUFFER_LEN 1024 * 1024 * 1
+// 内核拷贝时每次拷贝的数据量，用于及时更新进度和响应停止
+#define KERNEL_COPY_BLOCK_LEN 1024 * 1024 * 8
+// 超过此大小的文件在不能使用copy_file_range时使用读写流水线拷贝
+#define PIPELINE_COPY_FILE_SIZE 1024 * 1024 * 64
+// 等待拷贝的小文件数量最多为线程数量的倍数
+#define SMALL_FILE_QUEUE_FACTOR 4
+// 每个目录最多同时预读的子目录数量为遍历线程数量的倍数
+#define DIR_PREFETCH_FACTOR 2
 #define BIG_FILE_SIZE 500 * 1024 * 1024
 #define THREAD_SLEEP_TIME 200
 QQueue<DFileCopyMoveJob*> DFileCopyMoveJobPrivate::CopyLargeFileOnDiskQueue;
 QMutex DFileCopyMoveJobPrivate::CopyLargeFileOnDiskMutex;
 
-static long qt_gettid()
-{
-    // no error handling
-    // this syscall has existed since Linux 2.4.11 and cannot fail
-    return syscall(SYS_gettid);
-}
-#elif defined(Q_OS_DARWIN)
-#  include <pthread.h>
-static int qt_gettid()
-{
-    // no error handling: this call cannot fail
-    __uint64_t tid;
-    pthread_threadid_np(NULL, &tid);
-    return tid;
-}
-#elif defined(Q_OS_FREEBSD_KERNEL) && defined(__FreeBSD_version) && __FreeBSD_version >= 900031
-#  include <pthread_np.h>
-static int qt_gettid()
-{
-    return pthread_getthreadid_np();
-}
-#else
-static QT_PREPEND_NAMESPACE(qint64) qt_gettid()
-{
-    QT_USE_NAMESPACE
-    return qintptr(QThread::currentThreadId());
-}
-#endif
-
 static QByteArray fileReadAll(const QString &file_path)
 {
     QFile file(file_path);
@@ -128,6 +109,22 @@ static QByteArray fileReadAll(const QString &file_path)
     return QByteArray();
 }
 
+// glibc 2.27以前没有提供copy_file_range的封装
+static ssize_t kernelCopyFileRange(int fromFd, loff_t *fromOffset, int toFd, loff_t *toOffset, size_t len)
+{
+#ifdef SYS_copy_file_range
+    return syscall(SYS_copy_file_range, fromFd, fromOffset, toFd, toOffset, len, 0u);
+#else
+    Q_UNUSED(fromFd)
+    Q_UNUSED(fromOffset)
+    Q_UNUSED(toFd)
+    Q_UNUSED(toOffset)
+    Q_UNUSED(len)
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 class ElapsedTimer
 {
 public:
@@ -184,6 +181,7 @@ DFileCopyMoveJobPrivate::DFileCopyMoveJobPrivate(DFileCopyMoveJob *qq)
     , updateSpeedElapsedTimer(new ElapsedTimer())
 {
     m_pool.setMaxThreadCount(FileUtils::getCpuProcessCount());
+    m_traversalPool.setMaxThreadCount(FileUtils::getCpuProcessCount());
 }
 
 DFileCopyMoveJobPrivate::~DFileCopyMoveJobPrivate()
@@ -253,52 +251,6 @@ QString DFileCopyMoveJobPrivate::errorToString(DFileCopyMoveJob::Error error)
     return QString();
 }
 
-qint64 DFileCopyMoveJobPrivate::getWriteBytes(long tid)
-{
-    QFile file(QStringLiteral("/proc/self/task/%1/io").arg(tid));
-
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Failed on open the" << file.fileName() << ", will be not update the job speed and progress";
-
-        return 0;
-    }
-
-    const QByteArray &line_head = QByteArrayLiteral("write_bytes: ");
-    const QByteArray &all_data = file.readAll();
-
-    file.close();
-
-    QTextStream text_stream(all_data);
-
-    while (!text_stream.atEnd()) {
-        const QByteArray &line = text_stream.readLine().toLatin1();
-
-        if (line.startsWith(line_head)) {
-            bool ok = false;
-            qint64 size = line.mid(line_head.size()).toLongLong(&ok);
-
-            if (!ok) {
-                qWarning() << "Failed to convert to qint64, line string=" << line;
-
-                return 0;
-            }
-
-//            qCDebug(fileJob(), "Did Write size on block device: %lld", size);
-
-            return size;
-        }
-    }
-
-    qWarning() << "Failed to find \"" << line_head << "\" from the" << file.fileName();
-
-    return 0;
-}
-
-qint64 DFileCopyMoveJobPrivate::getWriteBytes() const
-{
-    return getWriteBytes(tid);
-}
-
 qint64 DFileCopyMoveJobPrivate::getSectorsWritten() const
 {
     const QByteArray data = fileReadAll(targetSysDevPath + "/stat");
@@ -312,21 +264,57 @@ qint64 DFileCopyMoveJobPrivate::getSectorsWritten() const
 
 qint64 DFileCopyMoveJobPrivate::getCompletedDataSize() const
 {
-    if (canUseWriteBytes) {
-        return getWriteBytes();
-    }
-
-    if (targetDeviceStartSectorsWritten >= 0) {
-        if ((getSectorsWritten() == 0) && (targetDeviceStartSectorsWritten > 0)) {
+    // 只在最后同步数据时读取设备已写入的扇区，拷贝过程中直接使用读写线程累加的大小
+    if (m_isSyncingTargetDevice && targetDeviceStartSectorsWritten >= 0) {
+        const qint64 sectorsWritten = getSectorsWritten();
+        if (sectorsWritten == 0 && targetDeviceStartSectorsWritten > 0) {
             return 0;
-        } else {
-            return (getSectorsWritten() - targetDeviceStartSectorsWritten) * targetLogSecionSize;
         }
+
+        // 空洞等没有写入设备的数据不会增加扇区计数，直接算作已同步
+        return qMin((sectorsWritten - targetDeviceStartSectorsWritten) * targetLogSecionSize + completedDataSizeWithoutWrite.load(),
+                    completedDataSize.load());
     }
 
     return completedDataSize;
 }
 
+void DFileCopyMoveJobPrivate::waitForTargetDeviceSync()
+{
+    if (targetDeviceStartSectorsWritten < 0) {
+        return;
+    }
+
+    m_isSyncingTargetDevice = true;
+    Q_EMIT q_ptr->sendDataSyncing(qApp->translate("DFileCopyMoveJob", "Syncing data"), qApp->translate("DFileCopyMoveJob", "Please wait"));
+
+    // 设备上已写入的数据达到拷贝的数据大小时，认为数据已同步到设备；
+    // 文件系统的元数据、压缩等会让扇区计数与数据大小对不上，长时间没有新的扇区写入时也结束等待
+    QElapsedTimer stallTimer;
+    qint64 lastCompletedSize = -1;
+
+    stallTimer.start();
+
+    while (state != DFileCopyMoveJob::StoppedState) {
+        const qint64 currentCompletedSize = getCompletedDataSize();
+
+        if (currentCompletedSize >= completedDataSize)
+            break;
+
+        if (currentCompletedSize != lastCompletedSize) {
+            lastCompletedSize = currentCompletedSize;
+            stallTimer.restart();
+        } else if (stallTimer.elapsed() > syncStallTimeout) {
+            qCWarning(fileJob(), "target device sync stalled at %lld of %lld", currentCompletedSize, completedDataSize.load());
+            break;
+        }
+
+        QThread::msleep(100);
+    }
+
+    m_isSyncingTargetDevice = false;
+}
+
 void DFileCopyMoveJobPrivate::setState(DFileCopyMoveJob::State s)
 {
     if (state == s) {
@@ -523,6 +511,32 @@ DFileCopyMoveJob::Action DFileCopyMoveJobPrivate::setAndhandleError(DFileCopyMov
     return action;
 }
 
+DFileCopyMoveJob::Action DFileCopyMoveJobPrivate::handleWritebackError(DFileWriteback *writeback,
+                                                                       const DAbstractFileInfoPointer &fromInfo,
+                                                                       const DAbstractFileInfoPointer &toInfo)
+{
+    //错误队列处理
+    errorQueueHandling();
+
+    DFileCopyMoveJob::Action action = DFileCopyMoveJob::NoAction;
+    bool synced = false;
+
+    do {
+        const QString &errorstr = qApp->translate("DFileCopyMoveJob", "Failed to write the file, cause: %1").arg(strerror(writeback->error()));
+        action = setAndhandleError(DFileCopyMoveJob::WriteError, fromInfo, toInfo, errorstr);
+        // 重试时再次同步未同步的数据
+        synced = (action == DFileCopyMoveJob::RetryAction && writeback->finish());
+    } while (action == DFileCopyMoveJob::RetryAction && !synced);
+
+    //当前错误处理完成
+    errorQueueHandled(action == DFileCopyMoveJob::RetryAction || action == DFileCopyMoveJob::SkipAction);
+
+    if (synced)
+        return DFileCopyMoveJob::NoAction;
+
+    return action == DFileCopyMoveJob::SkipAction ? DFileCopyMoveJob::SkipAction : DFileCopyMoveJob::CancelAction;
+}
+
 #define TASK_RUNNING_MAX_COUNT 5
 
 bool DFileCopyMoveJobPrivate::isRunning()
@@ -1278,16 +1292,44 @@ bool DFileCopyMoveJobPrivate::mergeDirectory(const QSharedPointer<DFileHandler>
     }
 
     bool sortInode = toInfo && !fileHints.testFlag(DFileCopyMoveJob::DontSortInode);
-    const DDirIteratorPointer &iterator = DFileService::instance()->createDirIterator(nullptr, fromInfo->fileUrl(), QStringList(),
-                                                                                      QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System | QDir::Hidden,
-                                                                                      sortInode ? static_cast<QDirIterator::IteratorFlag>(DDirIterator::SortINode)
-                                                                                      : QDirIterator::NoIteratorFlags, true);
+    // 优化拷贝时一次读完目录，并在线程池中预读后面的子目录，遍历线程只负责按顺序创建目录和分发文件
+    const bool parallelTraversal = m_refineStat != DFileCopyMoveJob::NoRefine;
+    QList<DAbstractFileInfoPointer> entries;
+    DDirIteratorPointer iterator;
+    if (!parallelTraversal || !takeDirEntries(fromInfo->fileUrl(), entries)) {
+        iterator = DFileService::instance()->createDirIterator(nullptr, fromInfo->fileUrl(), QStringList(),
+                                                               QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System | QDir::Hidden,
+                                                               sortInode ? static_cast<QDirIterator::IteratorFlag>(DDirIterator::SortINode)
+                                                               : QDirIterator::NoIteratorFlags, true);
+
+        if (!iterator) {
+            setError(DFileCopyMoveJob::UnknowUrlError, "Failed on create dir iterator");
+            return false;
+        }
 
-    if (!iterator) {
-        setError(DFileCopyMoveJob::UnknowUrlError, "Failed on create dir iterator");
-        return false;
+        if (parallelTraversal) {
+            while (iterator->hasNext()) {
+                iterator->next();
+                entries << iterator->fileInfo();
+            }
+        }
     }
 
+    QList<DUrl> subDirs;
+    for (const DAbstractFileInfoPointer &info : entries) {
+        if (info && info->isDir() && !info->isSymLink())
+            subDirs << info->fileUrl();
+    }
+
+    int prefetchedCount = 0;
+    int enteredCount = 0;
+    const int prefetchWindow = m_traversalPool.maxThreadCount() * DIR_PREFETCH_FACTOR;
+    auto prefetchSubDirs = [&] {
+        while (prefetchedCount < subDirs.count() && prefetchedCount < enteredCount + prefetchWindow)
+            prefetchDirEntries(subDirs.at(prefetchedCount++), sortInode);
+    };
+    prefetchSubDirs();
+
     bool existsSkipFile = false;
     bool enter_dir = toInfo;
 
@@ -1297,7 +1339,7 @@ bool DFileCopyMoveJobPrivate::mergeDirectory(const QSharedPointer<DFileHandler>
 
     //目录没有执行权限时不能正确的遍历到子文件的信息，后续删除或剪切复制逻辑无法成立
     //弹出错误弹窗，提示无权限
-    if (!fromInfo->isExecutable() && iterator->hasNext()) {
+    if (!fromInfo->isExecutable() && (parallelTraversal ? !entries.isEmpty() : iterator->hasNext())) {
         //错误队列处理
         errorQueueHandling();
         bool ok = setAndhandleError(DFileCopyMoveJob::PermissionDeniedError, fromInfo, DAbstractFileInfoPointer(nullptr)) == DFileCopyMoveJob::SkipAction;
@@ -1306,15 +1348,24 @@ bool DFileCopyMoveJobPrivate::mergeDirectory(const QSharedPointer<DFileHandler>
         return ok;
     }
 
-    while (iterator->hasNext()) {
+    for (int i = 0; parallelTraversal ? i < entries.count() : iterator->hasNext(); ++i) {
         if (!stateCheck()) {
             return false;
         }
 
-        const DUrl &url = iterator->next();
-        const DAbstractFileInfoPointer &info = iterator->fileInfo();
+        const DUrl &url = parallelTraversal ? entries.at(i)->fileUrl() : iterator->next();
+        const DAbstractFileInfoPointer &info = parallelTraversal ? entries.at(i) : iterator->fileInfo();
+        const bool isSubDir = parallelTraversal && enteredCount < subDirs.count() && subDirs.at(enteredCount) == url;
+        if (isSubDir) {
+            ++enteredCount;
+            prefetchSubDirs();
+        }
 
-        if (!process(url, info, toInfo, isNew)) {
+        const bool ok = process(url, info, toInfo, isNew);
+        // 子目录被跳过时没有取出预读的列表
+        if (isSubDir)
+            m_dirEntriesFutures.remove(url);
+        if (!ok) {
             return false;
         }
 
@@ -1558,9 +1609,29 @@ open_file: {
         saveCurrentDevice(toInfo->fileUrl(),toDevice);
     }
 
+    // 慢速设备上按区间回写并定期同步，不再每次写入后都同步
+    DFileWriteback writeback(&m_writeback, togio ? -1 : toDevice->handle(), [&]() {
+        return toDevice->syncToDisk(m_isVfat);
+    });
+
+    // 本地文件之间的拷贝优先交给内核完成，数据不经过用户态缓冲区
+    // 需要在用户态计算源文件的校验值时不能使用
+    if (!fromgio && !togio && fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)) {
+        qint64 copiedSize = 0;
+        if (doCopyFileByKernel(fromDevice->handle(), toDevice->handle(), fromInfo->size(), copiedSize, &writeback) == KernelCopyCanceled) {
+            cleanDoCopyFileSource(nullptr, fromInfo, toInfo, fromDevice, toDevice);
+            return false;
+        }
+        // 拷贝完成时下面的读取会直接读到文件末尾，否则从已拷贝的位置继续读写
+        if (copiedSize > 0 && (!fromDevice->seek(copiedSize) || !toDevice->seek(copiedSize))) {
+            cleanDoCopyFileSource(nullptr, fromInfo, toInfo, fromDevice, toDevice);
+            return handleUnknowError(fromInfo, toInfo, fromDevice->errorString());
+        }
+    }
+
     qint64 block_Size = fromInfo->size() > MAX_BUFFER_LEN ? MAX_BUFFER_LEN : fromInfo->size();
 
-    char *data = new char[block_Size + 1];
+    char *data = DFileCopyBufferPool::instance()->acquire(block_Size);
 
     Q_FOREVER {
         qint64 current_pos = fromDevice->pos();
@@ -1678,11 +1749,6 @@ open_file: {
             }
         }
 
-        //fix 修复vfat格式u盘卡死问题，写入数据后立刻同步
-        if (m_isEveryReadAndWritesSnc && size_write > 0) {
-            toDevice->inherits("");
-            toDevice->syncToDisk(m_isVfat);
-        }
         countrefinesize(size_write);
 
         if (Q_UNLIKELY(size_write != size_read)) {
@@ -1759,13 +1825,29 @@ open_file: {
         completedDataSize += size_write;
         completedDataSizeOnBlockDevice += size_write;
 
+        //fix 修复vfat格式u盘卡死问题，写入的数据到达一定大小后回写并同步
+        if (Q_UNLIKELY(!writeback.written(current_pos, size_read))) {
+            DFileCopyMoveJob::Action action = handleWritebackError(&writeback, fromInfo, toInfo);
+            if (action != DFileCopyMoveJob::NoAction) {
+                cleanDoCopyFileSource(data, fromInfo, toInfo, fromDevice, toDevice);
+                return action == DFileCopyMoveJob::SkipAction;
+            }
+        }
+
         if (Q_LIKELY(!fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking))) {
             source_checksum = adler32(source_checksum, reinterpret_cast<Bytef *>(data), static_cast<uInt>(size_read));
         }
 
     }
-    delete[] data;
+    DFileCopyBufferPool::instance()->release(data);
     data = nullptr;
+    if (Q_UNLIKELY(!writeback.finish())) {
+        DFileCopyMoveJob::Action action = handleWritebackError(&writeback, fromInfo, toInfo);
+        if (action != DFileCopyMoveJob::NoAction) {
+            cleanDoCopyFileSource(nullptr, fromInfo, toInfo, fromDevice, toDevice);
+            return action == DFileCopyMoveJob::SkipAction;
+        }
+    }
     fromDevice->close();
     toDevice->close();
     countrefinesize(fromInfo->size() <= 0 ? FileUtils::getMemoryPageSize() : 0);
@@ -1826,7 +1908,7 @@ open_file: {
     }
     //校验数据完整性
 
-    char *data1 = new char[blockSize + 1];
+    char *data1 = DFileCopyBufferPool::instance()->acquire(blockSize);
     ulong target_checksum = adler32(0L, nullptr, 0);
 
     qint64 elapsed_time_checksum = 0;
@@ -1857,7 +1939,7 @@ open_file: {
                     errorQueueHandled();
                     isErrorOccur = false;
                 }
-                delete [] data1;
+                DFileCopyBufferPool::instance()->release(data1);
                 return true;
             default:
                 //当前错误处理完成
@@ -1865,7 +1947,7 @@ open_file: {
                     errorQueueHandled(false);
                     isErrorOccur = false;
                 }
-                delete [] data1;
+                DFileCopyBufferPool::instance()->release(data1);
                 return false;
             }
         }
@@ -1873,11 +1955,11 @@ open_file: {
         target_checksum = adler32(target_checksum, reinterpret_cast<Bytef *>(data1), static_cast<uInt>(size));
 
         if (Q_UNLIKELY(!stateCheck())) {
-            delete [] data1;
+            DFileCopyBufferPool::instance()->release(data1);
             return false;
         }
     }
-    delete [] data1;
+    DFileCopyBufferPool::instance()->release(data1);
 
     qCDebug(fileJob(), "Time spent of integrity check of the file: %lld", updateSpeedElapsedTimer->elapsed() - elapsed_time_checksum);
 
@@ -2067,9 +2149,30 @@ open_file:{
         saveCurrentDevice(toInfo->fileUrl(),toDevice);
     }
 
+    // 本地文件之间的拷贝优先交给内核完成，数据不经过用户态缓冲区
+    if (!fromgio && !togio && fileHints.testFlag(DFileCopyMoveJob::DontIntegrityChecking)) {
+        qint64 copiedSize = 0;
+        DFileWriteback writeback(&m_writeback, toDevice->handle());
+        if (doCopyFileByKernel(fromDevice->handle(), toDevice->handle(), fromInfo->size(), copiedSize, &writeback) == KernelCopyCanceled) {
+            cleanCopySources(nullptr, fromDevice, toDevice, isErrorOccur);
+            return false;
+        }
+        if (Q_UNLIKELY(!writeback.finish())) {
+            DFileCopyMoveJob::Action action = handleWritebackError(&writeback, fromInfo, toInfo);
+            if (action != DFileCopyMoveJob::NoAction) {
+                cleanCopySources(nullptr, fromDevice, toDevice, isErrorOccur);
+                return action == DFileCopyMoveJob::SkipAction;
+            }
+        }
+        if (copiedSize > 0 && (!fromDevice->seek(copiedSize) || !toDevice->seek(copiedSize))) {
+            cleanCopySources(nullptr, fromDevice, toDevice, isErrorOccur);
+            return handleUnknowError(fromInfo, toInfo, fromDevice->errorString());
+        }
+    }
+
     qint64 block_Size = fromInfo->size() > MAX_BUFFER_LEN ? MAX_BUFFER_LEN : fromInfo->size();
     uLong source_checksum = adler32(0L, nullptr, 0);
-    char *data = new char[block_Size + 1];
+    char *data = DFileCopyBufferPool::instance()->acquire(block_Size);
 
     Q_FOREVER {
         qint64 current_pos = fromDevice->pos();
@@ -2220,7 +2323,7 @@ open_file:{
             source_checksum = adler32(source_checksum, reinterpret_cast<Bytef *>(data), static_cast<uInt>(size_read));
         }
     }
-    delete[] data;
+    DFileCopyBufferPool::instance()->release(data);
     fromDevice->close();
     toDevice->close();
     countrefinesize(fromInfo->size() <= 0 ? FileUtils::getMemoryPageSize() : 0);
@@ -2277,7 +2380,7 @@ open_file:{
     }
     //校验数据完整性
 
-    char *data1 = new char[block_Size + 1];
+    char *data1 = DFileCopyBufferPool::instance()->acquire(block_Size);
     ulong target_checksum = adler32(0L, nullptr, 0);
 
     qint64 elapsed_time_checksum = 0;
@@ -2308,7 +2411,7 @@ open_file:{
                     errorQueueHandled();
                     isErrorOccur = false;
                 }
-                delete [] data1;
+                DFileCopyBufferPool::instance()->release(data1);
                 return true;
             default:
                 //当前错误处理完成
@@ -2316,7 +2419,7 @@ open_file:{
                     errorQueueHandled(false);
                     isErrorOccur = false;
                 }
-                delete [] data1;
+                DFileCopyBufferPool::instance()->release(data1);
                 return false;
             }
         }
@@ -2324,11 +2427,11 @@ open_file:{
         target_checksum = adler32(target_checksum, reinterpret_cast<Bytef *>(data1), static_cast<uInt>(size));
 
         if (Q_UNLIKELY(!stateCheck())) {
-            delete [] data1;
+            DFileCopyBufferPool::instance()->release(data1);
             return false;
         }
     }
-    delete [] data1;
+    DFileCopyBufferPool::instance()->release(data1);
 
     qCDebug(fileJob(), "Time spent of integrity check of the file: %lld", updateSpeedElapsedTimer->elapsed() - elapsed_time_checksum);
 
@@ -2382,6 +2485,7 @@ bool DFileCopyMoveJobPrivate::doThreadPoolCopyFile()
             return false;
         }
         threadInfo = m_threadInfos.dequeue();
+        m_threadInfoCondition.wakeAll();
     }
 
     if (!threadInfo)
@@ -2451,6 +2555,46 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
     }
 
 #endif
+    // 优先由内核直接把数据写入目标文件，完成后此文件不再进入写队列
+    if (fromInfo->size() > 0) {
+        std::string toPath = toInfo->fileUrl().path().toStdString();
+        int toFd = open(toPath.c_str(), m_openFlag, 0777);
+        if (toFd > -1) {
+            qint64 copiedSize = 0;
+            DFileWriteback writeback(&m_writeback, toFd);
+            KernelCopyResult result = doCopyFileByKernel(fromfd, toFd, fromInfo->size(), copiedSize, &writeback);
+            if (result == KernelCopyFinished && !writeback.finish()) {
+                action = handleWritebackError(&writeback, fromInfo, toInfo);
+                if (action != DFileCopyMoveJob::NoAction) {
+                    close(toFd);
+                    close(fromfd);
+                    return action == DFileCopyMoveJob::SkipAction;
+                }
+            }
+            if (result == KernelCopyFinished) {
+                syncfs(toFd);
+                close(toFd);
+                close(fromfd);
+                setTargetFileAttributes(handler, fromInfo, toInfo);
+                return true;
+            }
+            close(toFd);
+            if (result == KernelCopyCanceled) {
+                close(fromfd);
+                return false;
+            }
+            // 写线程会截断目标文件后重新写入，撤销已经计入进度的数据
+            if (copiedSize > 0) {
+                currentJobDataSizeInfo.second -= copiedSize;
+                completedDataSize -= copiedSize;
+                completedDataSizeOnBlockDevice -= copiedSize;
+                completedDataSizeWithoutWrite -= writeback.skippedSize();
+                countrefinesize(-copiedSize);
+                writeback.discard();
+            }
+        }
+    }
+
     qint64 size_block = fromInfo->size() > MAX_BUFFER_LEN ? MAX_BUFFER_LEN : fromInfo->size();
     size_block = blockSize;
     FileCopyInfoPointer copyinfo(new FileCopyInfo());
@@ -2464,10 +2608,10 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
             QThread::msleep(1);
         }
         copyinfo->currentpos = current_pos;
-        char *buffer = new char[size_block + 1];
+        char *buffer = DFileCopyBufferPool::instance()->acquire(size_block);
 
         if (Q_UNLIKELY(!stateCheck())) {
-            delete[]  buffer;
+            DFileCopyBufferPool::instance()->release(buffer);
             close(fromfd);
             return false;
         }
@@ -2478,7 +2622,7 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
                     ? FileUtils::getMemoryPageSize() : fromInfo->size() - current_pos;
             countrefinesize(fromInfo->size() <= 0
                             ? FileUtils::getMemoryPageSize() : fromInfo->size() - current_pos);
-            delete[]  buffer;
+            DFileCopyBufferPool::instance()->release(buffer);
             close(fromfd);
             return true;
         }
@@ -2486,7 +2630,7 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
         qint64 size_read = read(fromfd, buffer, static_cast<size_t>(size_block));
 
         if (Q_UNLIKELY(!stateCheck())) {
-            delete[]  buffer;
+            DFileCopyBufferPool::instance()->release(buffer);
             close(fromfd);
             return false;
         }
@@ -2509,11 +2653,13 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
             case DFileCopyMoveJob::RetryAction: {
                 if (!lseek(fromfd, current_pos, SEEK_SET)) {
                     setError(DFileCopyMoveJob::UnknowError, "");
-                    delete[]  buffer;
+                    DFileCopyBufferPool::instance()->release(buffer);
                     close(fromfd);
                     q_ptr->stop();
                     return false;
                 }
+                // 重试时重新获取缓冲区，先归还这一次的
+                DFileCopyBufferPool::instance()->release(buffer);
                 break;
             }
             case DFileCopyMoveJob::SkipAction:
@@ -2524,12 +2670,12 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
                         ? FileUtils::getMemoryPageSize() : fromInfo->size() - current_pos;
                 countrefinesize(fromInfo->size() <= 0
                                 ? FileUtils::getMemoryPageSize() : fromInfo->size() - current_pos);
-                delete[]  buffer;
+                DFileCopyBufferPool::instance()->release(buffer);
                 return true;
             default:
                 close(fromfd);
                 q_ptr->stop();
-                delete[]  buffer;
+                DFileCopyBufferPool::instance()->release(buffer);
                 return false;
             }
         } else {
@@ -2570,6 +2716,258 @@ bool DFileCopyMoveJobPrivate::doCopyFileOnBlock(const DAbstractFileInfoPointer f
     return true;
 }
 
+/*!
+ * \brief DFileCopyMoveJobPrivate::doCopyFileByKernel 由内核完成文件数据的拷贝，依次尝试reflink、copy_file_range和sendfile
+ * 不能使用copy_file_range的大文件改用DFileCopyPipeline拷贝
+ * \param fromFd 源文件的文件描述符
+ * \param toFd 目标文件的文件描述符
+ * \param fileSize 源文件的大小
+ * \param copiedSize 已拷贝的数据大小，回退到用户态读写时从此位置继续
+ * \param writeback 目标文件的回写状态，为空时只在此函数内控制回写。中途同步失败的数据保留在其中，
+ * 拷贝完成后由调用者调用finish()同步剩余的数据并处理同步错误
+ * \return 拷贝结果
+ */
+DFileCopyMoveJobPrivate::KernelCopyResult DFileCopyMoveJobPrivate::doCopyFileByKernel(int fromFd, int toFd, qint64 fileSize, qint64 &copiedSize, DFileWriteback *writeback)
+{
+    copiedSize = 0;
+#ifdef Q_OS_LINUX
+    if (fromFd < 0 || toFd < 0 || fileSize <= 0)
+        return KernelCopyFallback;
+
+    DFileWriteback localWriteback(&m_writeback, toFd);
+    if (!writeback)
+        writeback = &localWriteback;
+
+#ifdef FICLONE
+    // btrfs、xfs等支持写时复制的文件系统上直接共享数据块
+    if (ioctl(toFd, FICLONE, fromFd) == 0) {
+        copiedSize = fileSize;
+        countKernelCopiedSize(fileSize, false);
+        writeback->written(0, fileSize);
+        return KernelCopyFinished;
+    }
+#endif
+
+    // 实际占用的磁盘空间小于文件大小时源文件中有空洞
+    struct stat fromStat;
+    if (fstat(fromFd, &fromStat) == 0 && fromStat.st_blocks * 512 < fileSize) {
+        KernelCopyResult result = doCopySparseFile(fromFd, toFd, fileSize, copiedSize, writeback);
+        if (result == KernelCopyFinished)
+            return KernelCopyFinished;
+        if (result != KernelCopyFallback || copiedSize > 0)
+            return result;
+    }
+
+    bool useCopyFileRange = true;
+    while (copiedSize < fileSize) {
+        if (Q_UNLIKELY(!stateCheck()))
+            return KernelCopyCanceled;
+
+        const size_t len = static_cast<size_t>(qMin<qint64>(fileSize - copiedSize, KERNEL_COPY_BLOCK_LEN));
+        ssize_t size_write = -1;
+        if (useCopyFileRange) {
+            loff_t fromOffset = copiedSize;
+            loff_t toOffset = copiedSize;
+            size_write = kernelCopyFileRange(fromFd, &fromOffset, toFd, &toOffset, len);
+            // 跨文件系统或者文件系统不支持时改用sendfile
+            if (size_write < 0 && copiedSize == 0
+                    && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL)) {
+                useCopyFileRange = false;
+                // 大文件使用同时保持多个读写请求的流水线，小文件直接使用sendfile
+                if (fileSize >= PIPELINE_COPY_FILE_SIZE) {
+                    DFileCopyPipeline pipeline;
+                    qint64 pipelineWritten = 0;
+                    copiedSize = pipeline.copy(fromFd, toFd, 0, fileSize, [&](qint64 size) {
+                        //fix 修复vfat格式u盘卡死问题，写入的数据到达一定大小后回写并同步
+                        writeback->written(pipelineWritten, size);
+                        pipelineWritten += size;
+                        countKernelCopiedSize(size);
+                        return stateCheck();
+                    });
+                    if (copiedSize == fileSize)
+                        return KernelCopyFinished;
+                    if (Q_UNLIKELY(!stateCheck()))
+                        return KernelCopyCanceled;
+
+                    qCDebug(fileJob(), "copy pipeline stopped at %lld, cause: %s", copiedSize, strerror(pipeline.error()));
+                    return KernelCopyFallback;
+                }
+                if (lseek(toFd, 0, SEEK_SET) < 0)
+                    return KernelCopyFallback;
+                continue;
+            }
+        } else {
+            // sendfile从目标文件的当前偏移处开始写入
+            off_t fromOffset = copiedSize;
+            size_write = sendfile(toFd, fromFd, &fromOffset, len);
+        }
+
+        if (size_write < 0 && errno == EINTR)
+            continue;
+
+        // 出错或者源文件被截断，交给用户态读写处理
+        if (size_write <= 0) {
+            qCDebug(fileJob(), "kernel copy stopped at %lld, cause: %s", copiedSize, strerror(errno));
+            break;
+        }
+
+        //fix 修复vfat格式u盘卡死问题，写入的数据到达一定大小后回写并同步
+        writeback->written(copiedSize, size_write);
+
+        copiedSize += size_write;
+        countKernelCopiedSize(size_write);
+    }
+
+    return copiedSize == fileSize ? KernelCopyFinished : KernelCopyFallback;
+#else
+    Q_UNUSED(fromFd)
+    Q_UNUSED(toFd)
+    Q_UNUSED(fileSize)
+    Q_UNUSED(writeback)
+    return KernelCopyFallback;
+#endif
+}
+
+/*!
+ * \brief DFileCopyMoveJobPrivate::doCopySparseFile 拷贝稀疏文件
+ * 使用SEEK_DATA/SEEK_HOLE找到源文件中的数据段，只拷贝数据段，空洞直接跳过并计入进度，
+ * 最后把目标文件截断到源文件的大小，目标文件中没有写入的部分保持为空洞
+ * \param fromFd 源文件的描述符
+ * \param toFd 新建的空目标文件的描述符
+ * \param fileSize 源文件的大小
+ * \param copiedSize 返回从文件开头已连续完成的大小，回退时两个描述符的偏移都在此位置
+ * \param writeback 目标文件的回写状态，为空时只在此函数内控制回写
+ * \return 拷贝的结果
+ */
+DFileCopyMoveJobPrivate::KernelCopyResult DFileCopyMoveJobPrivate::doCopySparseFile(int fromFd, int toFd, qint64 fileSize, qint64 &copiedSize, DFileWriteback *writeback)
+{
+    copiedSize = 0;
+#if defined(Q_OS_LINUX) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+    DFileWriteback localWriteback(&m_writeback, toFd);
+    if (!writeback)
+        writeback = &localWriteback;
+
+    auto fallback = [&]() {
+        lseek(fromFd, copiedSize, SEEK_SET);
+        lseek(toFd, copiedSize, SEEK_SET);
+        return KernelCopyFallback;
+    };
+
+    bool useCopyFileRange = true;
+    char *buffer = nullptr;
+    KernelCopyResult result = KernelCopyFinished;
+
+    while (copiedSize < fileSize) {
+        if (Q_UNLIKELY(!stateCheck())) {
+            result = KernelCopyCanceled;
+            break;
+        }
+
+        // 后面没有数据时lseek返回ENXIO，剩下的都是空洞
+        off_t dataStart = lseek(fromFd, copiedSize, SEEK_DATA);
+        if (dataStart < 0 && errno != ENXIO) {
+            result = KernelCopyFallback;
+            break;
+        }
+        dataStart = dataStart < 0 ? fileSize : qMin<qint64>(dataStart, fileSize);
+        if (dataStart > copiedSize) {
+            // 空洞只计入进度，目标设备上没有对应的写入
+            countKernelCopiedSize(dataStart - copiedSize, false);
+            writeback->skipped(dataStart - copiedSize);
+            copiedSize = dataStart;
+            continue;
+        }
+
+        off_t dataEnd = lseek(fromFd, copiedSize, SEEK_HOLE);
+        if (dataEnd < 0) {
+            result = KernelCopyFallback;
+            break;
+        }
+        dataEnd = qMin<qint64>(dataEnd, fileSize);
+
+        while (copiedSize < dataEnd) {
+            if (Q_UNLIKELY(!stateCheck())) {
+                result = KernelCopyCanceled;
+                break;
+            }
+
+            const size_t len = static_cast<size_t>(qMin<qint64>(dataEnd - copiedSize, KERNEL_COPY_BLOCK_LEN));
+            ssize_t size_write = -1;
+            if (useCopyFileRange) {
+                loff_t fromOffset = copiedSize;
+                loff_t toOffset = copiedSize;
+                size_write = kernelCopyFileRange(fromFd, &fromOffset, toFd, &toOffset, len);
+                // 跨文件系统或者文件系统不支持时改用pread/pwrite
+                if (size_write < 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL)) {
+                    useCopyFileRange = false;
+                    continue;
+                }
+            } else {
+                if (!buffer)
+                    buffer = DFileCopyBufferPool::instance()->acquire(KERNEL_COPY_BLOCK_LEN);
+                size_write = pread(fromFd, buffer, len, copiedSize);
+                if (size_write > 0)
+                    size_write = pwrite(toFd, buffer, static_cast<size_t>(size_write), copiedSize);
+            }
+
+            if (size_write < 0 && errno == EINTR)
+                continue;
+
+            if (size_write <= 0) {
+                qCDebug(fileJob(), "sparse copy stopped at %lld, cause: %s", copiedSize, strerror(errno));
+                result = KernelCopyFallback;
+                break;
+            }
+
+            //fix 修复vfat格式u盘卡死问题，写入的数据到达一定大小后回写并同步
+            writeback->written(copiedSize, size_write);
+
+            copiedSize += size_write;
+            countKernelCopiedSize(size_write);
+        }
+
+        if (result != KernelCopyFinished)
+            break;
+    }
+
+    DFileCopyBufferPool::instance()->release(buffer);
+
+    if (result == KernelCopyCanceled)
+        return result;
+
+    if (result == KernelCopyFinished) {
+        // 文件末尾的空洞需要截断目标文件才能保留，不支持截断时在末尾写入一个字节
+        if (ftruncate(toFd, fileSize) == 0 || pwrite(toFd, "", 1, fileSize - 1) == 1)
+            return KernelCopyFinished;
+
+        // 末尾的空洞无法恢复，撤销已计入的进度后从头开始拷贝
+        qCDebug(fileJob(), "failed on truncate the sparse file, cause: %s", strerror(errno));
+        countKernelCopiedSize(-(copiedSize - writeback->skippedSize()));
+        countKernelCopiedSize(-writeback->skippedSize(), false);
+        writeback->discard();
+        copiedSize = 0;
+    }
+
+    return fallback();
+#else
+    Q_UNUSED(fromFd)
+    Q_UNUSED(toFd)
+    Q_UNUSED(fileSize)
+    Q_UNUSED(writeback)
+    return KernelCopyFallback;
+#endif
+}
+
+void DFileCopyMoveJobPrivate::countKernelCopiedSize(qint64 size, bool written)
+{
+    currentJobDataSizeInfo.second += size;
+    completedDataSize += size;
+    completedDataSizeOnBlockDevice += size;
+    if (!written)
+        completedDataSizeWithoutWrite += size;
+    countrefinesize(size);
+}
+
 bool DFileCopyMoveJobPrivate::doRemoveFile(const QSharedPointer<DFileHandler> &handler, const DAbstractFileInfoPointer fileInfo, const DAbstractFileInfoPointer &toInfo)
 {
     if (!fileInfo->exists()) {
@@ -2783,6 +3181,7 @@ bool DFileCopyMoveJobPrivate::copyFile(const DAbstractFileInfoPointer fromInfo,
         //1.判断源文件是本地，目标文件也是本地执行读写线程分离处理
         //2.判断源文件是本地，目标文件是（除光盘外的）块设备，
         else {
+            waitForThreadInfoQueue();
             if (!stateCheck())
                 return false;
             QSharedPointer<ThreadCopyInfo> threadInfo(new ThreadCopyInfo);
@@ -2954,12 +3353,11 @@ void DFileCopyMoveJobPrivate::updateCopyProgress()
     // 网络文件使用统计线程的值获取总大小. 非网络文件使用 fts_* 系统 API 统计函数同步统计总大小
     bool fromLocal = (m_isFileOnDiskUrls && targetUrl.isValid());
     const qint64 totalSize = fromLocal ? totalsize : fileStatistics->totalProgressSize();
-    //通过getCompletedDataSize取出的已传输的数据大小后期会远超实际数据大小，这种情况下直接使用completedDataSize
     qint64 dataSize(getCompletedDataSize());
-    // completedDataSize 可能一直为 0
-    if (dataSize > completedDataSize && completedDataSize > 0) {
-        dataSize = completedDataSize;
-    }
+
+    // 控制回写的慢速设备上只计算已经同步到设备上的数据，进度与实际落盘的数据一致
+    if (m_writeback.isEnabled())
+        dataSize = qMin(dataSize, m_writeback.durableSize());
 
     dataSize += completedProgressDataSize;
     dataSize -= m_gvfsFileInnvliadProgress;
@@ -3064,8 +3462,7 @@ void DFileCopyMoveJobPrivate::_q_updateProgress()
 
 void DFileCopyMoveJobPrivate::countrefinesize(const qint64 &size)
 {
-    QMutexLocker lock(&m_refineMutex);
-    m_refineCopySize += size;
+    m_refineCopySize.fetchAndAddRelaxed(size);
 }
 
 void DFileCopyMoveJobPrivate::checkTagetNeedSync()
@@ -3073,13 +3470,18 @@ void DFileCopyMoveJobPrivate::checkTagetNeedSync()
     if (!targetUrl.isValid()) {
         return;
     }
-    m_isEveryReadAndWritesSnc = m_isTagGvfsFile;
-    DStorageInfo targetStorageInfo(targetUrl.toLocalFile());
-    if (!m_isEveryReadAndWritesSnc && targetStorageInfo.isValid()) {
-        const QString &fs_type = targetStorageInfo.fileSystemType();
-        m_isVfat = fs_type.contains("vfat");
-        m_isEveryReadAndWritesSnc = (fs_type == "cifs" || fs_type == "vfat");
+    const bool isGvfs = m_isTagGvfsFile;
+    QString fs_type;
+    if (!isGvfs) {
+        DStorageInfo targetStorageInfo(targetUrl.toLocalFile());
+        if (targetStorageInfo.isValid()) {
+            fs_type = targetStorageInfo.fileSystemType();
+            m_isVfat = fs_type.contains("vfat");
+        }
     }
+    // 不再每次写入后同步，按目标文件系统的特点定期回写和同步
+    m_writeback.setEnabled(DFileWritebackController::needWriteback(fs_type, isGvfs));
+    m_writeback.setPolicy(DFileWritebackController::policyOfFileSystem(fs_type, isGvfs));
 }
 
 void DFileCopyMoveJobPrivate::checkTagetIsFromBlockDevice()
@@ -3089,6 +3491,144 @@ void DFileCopyMoveJobPrivate::checkTagetIsFromBlockDevice()
     }
     m_isTagFromBlockDevice.store(!deviceListener->isFileFromDisc(targetUrl.toLocalFile()) &&
                                  deviceListener->isBlockFile(targetUrl.toLocalFile()));
+    m_targetDeviceType = copyDeviceType(targetUrl.toLocalFile());
+}
+
+/*!
+ * \brief DFileCopyMoveJobPrivate::copyDeviceType 获取文件所在设备的类型
+ * 块设备通过/sys/class/block下的queue/rotational区分机械硬盘和固态硬盘，
+ * U盘、网络文件系统和gvfs挂载不能并行寻道，都作为HddDevice
+ * \param path 本地文件路径
+ * \return 设备的类型
+ */
+DFileCopyMoveJobPrivate::CopyDeviceType DFileCopyMoveJobPrivate::copyDeviceType(const QString &path)
+{
+    if (path.isEmpty() || FileUtils::isGvfsMountFile(path))
+        return HddDevice;
+
+    DStorageInfo info(path);
+    if (!info.isValid())
+        return SsdDevice;
+
+    const QByteArray &fsType = info.fileSystemType();
+    if (fsType == "cifs" || fsType == "nfs" || fsType == "nfs4" || fsType.startsWith("fuse.")) {
+        return HddDevice;
+    }
+
+    const QString device = QString::fromLocal8Bit(info.device());
+    // tmpfs、overlay等不是块设备的文件系统不受磁盘寻道的限制
+    if (!device.startsWith("/dev/"))
+        return SsdDevice;
+
+    const QString devName = QFileInfo(device).canonicalFilePath().section('/', -1);
+    QString sysPath = QFileInfo("/sys/class/block/" + devName).canonicalFilePath();
+    if (devName.isEmpty() || sysPath.isEmpty())
+        return SsdDevice;
+
+    // 分区的属性在所属磁盘的目录下
+    if (QFile::exists(sysPath + "/partition"))
+        sysPath = sysPath.section('/', 0, -2);
+
+    if (sysPath.contains("/usb") || fileReadAll(sysPath + "/removable").trimmed() == "1"
+            || fileReadAll(sysPath + "/queue/rotational").trimmed() == "1")
+        return HddDevice;
+
+    return SsdDevice;
+}
+
+/*!
+ * \brief DFileCopyMoveJobPrivate::copyThreadCountOfDevice 获取设备上并行读取目录和拷贝小文件的线程数量
+ * 小文件的拷贝主要耗时在读取目录、打开和创建文件等元数据操作上，固态硬盘可以使用比cpu核数更多的线程，
+ * 机械硬盘线程过多会导致磁头来回寻道
+ * \param type 设备的类型
+ * \return 线程数量
+ */
+int DFileCopyMoveJobPrivate::copyThreadCountOfDevice(DFileCopyMoveJobPrivate::CopyDeviceType type)
+{
+    switch (type) {
+    case SsdDevice:
+        return FileUtils::getCpuProcessCount() * 2;
+    case HddDevice:
+        return 2;
+    }
+
+    return 2;
+}
+
+/*!
+ * \brief DFileCopyMoveJobPrivate::initSmallFileCopyThreadCount 设置优化拷贝时的线程数量
+ * 读取目录只访问源设备，按源设备计算；小文件拷贝(只在RefineLocal时使用)同时读写两个设备，取较小的值
+ */
+void DFileCopyMoveJobPrivate::initSmallFileCopyThreadCount()
+{
+    // 源文件可能来自多个设备，按第一个源文件所在的设备计算
+    const CopyDeviceType sourceDeviceType = (!sourceUrlList.isEmpty() && sourceUrlList.first().isLocalFile())
+                                            ? copyDeviceType(sourceUrlList.first().toLocalFile()) : SsdDevice;
+    const int traversalThreadCount = copyThreadCountOfDevice(sourceDeviceType);
+    const int threadCount = qMin(traversalThreadCount, copyThreadCountOfDevice(m_targetDeviceType));
+
+    m_traversalPool.setMaxThreadCount(traversalThreadCount);
+    m_pool.setMaxThreadCount(threadCount);
+    qCDebug(fileJob(), "dir traversal thread count: %d, small file copy thread count: %d, source device type: %d, target device type: %d",
+            traversalThreadCount, threadCount, sourceDeviceType, m_targetDeviceType);
+}
+
+void DFileCopyMoveJobPrivate::waitForThreadInfoQueue()
+{
+    const int maxCount = m_pool.maxThreadCount() * SMALL_FILE_QUEUE_FACTOR;
+
+    forever {
+        {
+            QMutexLocker lk(&m_threadMutex);
+            if (m_threadInfos.count() < maxCount)
+                return;
+            // 拷贝线程取走文件后唤醒，暂停和停止时不会唤醒，超时后检查任务状态
+            m_threadInfoCondition.wait(&m_threadMutex, THREAD_SLEEP_TIME);
+            if (m_threadInfos.count() < maxCount)
+                return;
+        }
+
+        if (!stateCheck())
+            return;
+    }
+}
+
+void DFileCopyMoveJobPrivate::prefetchDirEntries(const DUrl &url, bool sortInode)
+{
+    if (m_dirEntriesFutures.contains(url))
+        return;
+
+    // 任务中不访问this，任务结束前拷贝任务可以被销毁，线程池析构时会等待任务结束
+    m_dirEntriesFutures.insert(url, QtConcurrent::run(&m_traversalPool, [url, sortInode]() {
+        QList<DAbstractFileInfoPointer> entries;
+        const DDirIteratorPointer &iterator = DFileService::instance()->createDirIterator(nullptr, url, QStringList(),
+                                                                                          QDir::AllEntries | QDir::NoDotAndDotDot | QDir::System | QDir::Hidden,
+                                                                                          sortInode ? static_cast<QDirIterator::IteratorFlag>(DDirIterator::SortINode)
+                                                                                          : QDirIterator::NoIteratorFlags, true);
+        if (!iterator)
+            return entries;
+
+        while (iterator->hasNext()) {
+            iterator->next();
+            entries << iterator->fileInfo();
+        }
+
+        return entries;
+    }));
+}
+
+bool DFileCopyMoveJobPrivate::takeDirEntries(const DUrl &url, QList<DAbstractFileInfoPointer> &entries)
+{
+    auto it = m_dirEntriesFutures.find(url);
+    if (it == m_dirEntriesFutures.end())
+        return false;
+
+    QFuture<QList<DAbstractFileInfoPointer>> future = it.value();
+    m_dirEntriesFutures.erase(it);
+    entries = future.result();
+
+    // 创建迭代器失败时读到空列表，重新创建迭代器以便报告错误
+    return !entries.isEmpty();
 }
 
 bool DFileCopyMoveJobPrivate::checkWritQueueEmpty()
@@ -3158,13 +3698,33 @@ void DFileCopyMoveJobPrivate::errorQueueHandled(const bool &isNotCancel)
 void DFileCopyMoveJobPrivate::releaseCopyInfo(const DFileCopyMoveJobPrivate::FileCopyInfoPointer &info)
 {
     if (info->buffer) {
-        delete [] info->buffer;
+        DFileCopyBufferPool::instance()->release(info->buffer);
         info->buffer = nullptr;
     }
     for (auto fd : m_writeOpenFd) {
         close(fd);
     }
     m_writeOpenFd.clear();
+    m_writeWritebacks.clear();
+}
+
+void DFileCopyMoveJobPrivate::setTargetFileAttributes(const QSharedPointer<DFileHandler> &handler, const DAbstractFileInfoPointer &fromInfo,
+                                                      const DAbstractFileInfoPointer &toInfo)
+{
+    QSharedPointer<DFileHandler> fileHandler = handler ? handler :
+                                               QSharedPointer<DFileHandler>(DFileService::instance()->createFileHandler(nullptr, fromInfo->fileUrl()));
+    fileHandler->setFileTime(toInfo->fileUrl(), fromInfo->lastRead(), fromInfo->lastModified());
+
+    QFileDevice::Permissions permissions = fromInfo->permissions();
+    //! use stat function to read vault file permission.
+    QString path = fromInfo->fileUrl().path();
+    if (VaultController::isVaultFile(path)) {
+        permissions = VaultController::getPermissions(path);
+    } else if (deviceListener->isFileFromDisc(fromInfo->path())) { // fix bug 52610: 从光盘中复制出来的文件权限为只读，与 ubuntu 策略保持一致，拷贝出来权限为 rw-rw-r--
+        permissions |= MasteredMediaController::getPermissionsCopyToLocal();
+    }
+    if (permissions != 0000)
+        fileHandler->setPermissions(toInfo->fileUrl(), permissions);
 }
 
 bool DFileCopyMoveJobPrivate::writeRefineThread()
@@ -3228,6 +3788,7 @@ bool DFileCopyMoveJobPrivate::writeToFileByQueue()
                 toFd = open(path.c_str(), m_openFlag, 0777);
                 if (toFd > -1) {
                     m_writeOpenFd.insert(info->toinfo->fileUrl(), toFd);
+                    m_writeWritebacks.insert(info->toinfo->fileUrl(), QSharedPointer<DFileWriteback>(new DFileWriteback(&m_writeback, toFd)));
                     action = DFileCopyMoveJob::NoAction;
                 } else {
                     qCDebug(fileJob()) << "open error:" << info->toinfo->fileUrl() << QThread::currentThreadId();
@@ -3429,31 +3990,45 @@ write_data: {
 
             countrefinesize(size_write);
             if (info->buffer) {
-                delete [] info->buffer;
+                DFileCopyBufferPool::instance()->release(info->buffer);
                 info->buffer = nullptr;
             }
+
+            const QSharedPointer<DFileWriteback> &writeback = m_writeWritebacks.value(info->toinfo->fileUrl());
+            if (writeback && Q_UNLIKELY(!writeback->written(info->currentpos, info->size))) {
+                DFileCopyMoveJob::Action action = handleWritebackError(writeback.data(), info->frominfo, info->toinfo);
+                if (action == DFileCopyMoveJob::SkipAction) {
+                    releaseCopyInfo(info);
+                    QMutexLocker lk(&m_skipFileQueueMutex);
+                    m_skipFileQueue.push_back(info->frominfo->fileUrl());
+                    continue;
+                } else if (action != DFileCopyMoveJob::NoAction) {
+                    releaseCopyInfo(info);
+                    return false;
+                }
+            }
         }
         //关闭文件并加权
         if (info->closeflag) {
+            const QSharedPointer<DFileWriteback> &writeback = m_writeWritebacks.take(info->toinfo->fileUrl());
+            if (writeback && Q_UNLIKELY(!writeback->finish())) {
+                DFileCopyMoveJob::Action action = handleWritebackError(writeback.data(), info->frominfo, info->toinfo);
+                if (action == DFileCopyMoveJob::SkipAction) {
+                    releaseCopyInfo(info);
+                    QMutexLocker lk(&m_skipFileQueueMutex);
+                    m_skipFileQueue.push_back(info->frominfo->fileUrl());
+                    continue;
+                } else if (action != DFileCopyMoveJob::NoAction) {
+                    releaseCopyInfo(info);
+                    return false;
+                }
+            }
             //异步执行同步
             syncfs(toFd);
 
             close(toFd);
             m_writeOpenFd.remove(info->toinfo->fileUrl());
-            QSharedPointer<DFileHandler> handler = info->handler ? info->handler :
-                                                   QSharedPointer<DFileHandler>(DFileService::instance()->createFileHandler(nullptr, info->frominfo->fileUrl()));
-            handler->setFileTime(info->toinfo->fileUrl(), info->frominfo->lastRead(), info->frominfo->lastModified());
-
-            QFileDevice::Permissions permissions = info->frominfo->permissions();
-            //! use stat function to read vault file permission.
-            QString path = info->frominfo->fileUrl().path();
-            if (VaultController::isVaultFile(path)) {
-                permissions = VaultController::getPermissions(path);
-            } else if (deviceListener->isFileFromDisc(info->frominfo->path())) { // fix bug 52610: 从光盘中复制出来的文件权限为只读，与 ubuntu 策略保持一致，拷贝出来权限为 rw-rw-r--
-                permissions |= MasteredMediaController::getPermissionsCopyToLocal();
-            }
-            if (permissions != 0000)
-                handler->setPermissions(info->toinfo->fileUrl(), permissions);
+            setTargetFileAttributes(info->handler, info->frominfo, info->toinfo);
         }
     }
     qDebug() << "write queue over!";
@@ -3475,10 +4050,11 @@ void DFileCopyMoveJobPrivate::cancelReadFileDealWriteThread()
         close(fd);
     }
     m_writeOpenFd.clear();
+    m_writeWritebacks.clear();
     while (!m_writeFileQueue.isEmpty()) {
         auto info = m_writeFileQueue.dequeue();
         if (info->buffer)
-            delete[] info->buffer;
+            DFileCopyBufferPool::instance()->release(info->buffer);
     }
 }
 
@@ -3524,6 +4100,7 @@ void DFileCopyMoveJobPrivate::clearThreadPool()
 {
     QMutexLocker lk(&m_threadMutex);
     m_threadInfos.clear();
+    m_threadInfoCondition.wakeAll();
 }
 
 DFileCopyMoveJob::DFileCopyMoveJob(QObject *parent)
@@ -3651,6 +4228,17 @@ qint64 DFileCopyMoveJob::totalDataSize() const
     return d->fileStatistics->totalSize();
 }
 
+qint64 DFileCopyMoveJob::durableDataSize() const
+{
+    Q_D(const DFileCopyMoveJob);
+
+    // 没有控制回写时不记录，返回已写入的大小
+    if (!d->m_writeback.isEnabled())
+        return d->getCompletedDataSize();
+
+    return qMin(d->m_writeback.durableSize(), d->getCompletedDataSize());
+}
+
 int DFileCopyMoveJob::totalFilesCount() const
 {
     Q_D(const DFileCopyMoveJob);
@@ -3870,7 +4458,7 @@ DFileCopyMoveJob::Action DFileCopyMoveJobPrivate::openGvfsFile(const DAbstractFi
 void DFileCopyMoveJobPrivate::cleanCopySources(char *data, const QSharedPointer<DFileDevice> &fromDevice,
                                                const QSharedPointer<DFileDevice> &toDevice, bool &isError)
 {
-    delete[] data;
+    DFileCopyBufferPool::instance()->release(data);
     data = nullptr;
     fromDevice->close();
     toDevice->close();
@@ -4009,7 +4597,7 @@ void DFileCopyMoveJobPrivate::cleanDoCopyFileSource(char *data,const DAbstractFi
     } else {
         fromDevice->close();
     }
-    delete[] data;
+    DFileCopyBufferPool::instance()->release(data);
     data = nullptr;
 }
 
@@ -4268,8 +4856,9 @@ void DFileCopyMoveJob::run()
     d->targetUrlList.clear();
     d->completedDataSize = 0;
     d->completedDataSizeOnBlockDevice = 0;
+    d->completedDataSizeWithoutWrite = 0;
+    d->m_writeback.reset();
     d->completedFilesCount = 0;
-    d->tid = qt_gettid();
 
     DAbstractFileInfoPointer target_info;
     bool mayExecSync = false;
@@ -4297,7 +4886,6 @@ void DFileCopyMoveJob::run()
         }
 
         // reset
-        d->canUseWriteBytes = 0;
         d->targetIsRemovable = 0;
         d->targetLogSecionSize = 512;
         d->targetDeviceStartSectorsWritten = -1;
@@ -4322,17 +4910,17 @@ void DFileCopyMoveJob::run()
                     targetStorageInfo->device().constData(), qPrintable(d->targetRootPath));
 
             if (targetStorageInfo->isLocalDevice()) {
-                d->canUseWriteBytes = targetStorageInfo->fileSystemType().startsWith("ext");
+                const bool isExtFileSystem = targetStorageInfo->fileSystemType().startsWith("ext");
                 if (targetStorageInfo->fileSystemType().startsWith("vfat")
                         || targetStorageInfo->fileSystemType().startsWith("ntfs")
                         || targetStorageInfo->fileSystemType().startsWith("btrfs")
                         || targetStorageInfo->fileSystemType().startsWith("fuseblk"))
                     d->m_openFlag = d->m_openFlag | O_DIRECT;
 
-                if (d->canUseWriteBytes && !d->m_bDestLocal)
+                if (isExtFileSystem && !d->m_bDestLocal)
                     d->m_refineStat = NoRefine;
 
-                if (!d->canUseWriteBytes) {
+                if (!isExtFileSystem) {
                     const QByteArray dev_path = targetStorageInfo->device();
 
                     QProcess process;
@@ -4374,7 +4962,7 @@ void DFileCopyMoveJob::run()
                     }
                 }
 
-                qCDebug(fileJob(), "canUseWriteBytes = %d, targetIsRemovable = %d", bool(d->canUseWriteBytes), bool(d->targetIsRemovable));
+                qCDebug(fileJob(), "isExtFileSystem = %d, targetIsRemovable = %d", isExtFileSystem, bool(d->targetIsRemovable));
             }
         }
     } else if (d->mode == CopyMode || d->mode == CutMode) {
@@ -4386,6 +4974,8 @@ void DFileCopyMoveJob::run()
     }
     //初始化优化状态
     d->initRefineState();
+    if (d->m_refineStat != NoRefine)
+        d->initSmallFileCopyThreadCount();
 
     for (DUrl &source : d->sourceUrlList) {
         if (!d->stateCheck()) {
@@ -4458,6 +5048,8 @@ void DFileCopyMoveJob::run()
 end:
     //设置优化拷贝线程结束
     d->setRefineCopyProccessSate(ReadFileProccessOver);
+    //停止或出错时可能还有未取出的预读目录列表
+    d->m_dirEntriesFutures.clear();
     //等待线程池结束,等待异步写线程结束
     d->waitRefineThreadFinish();
 
@@ -4497,9 +5089,7 @@ end:
             }
         }
         else if (d->mode == CopyMode){
-            while (d->state != DFileCopyMoveJob::StoppedState && d->lastProgress < 1) {
-                QThread::msleep(100);
-            }
+            d->waitForTargetDeviceSync();
         }
     }
 
@@ -186,6 +186,8 @@ public:
 
     bool fileStatisticsIsFinished() const;
     qint64 totalDataSize() const;
+    // 已经同步到目标设备上的数据大小
+    qint64 durableDataSize() const;
     int totalFilesCount() const;
     QList<QPair<DUrl, DUrl> > completedFiles() const;
     QList<QPair<DUrl, DUrl> > completedDirectorys() const;
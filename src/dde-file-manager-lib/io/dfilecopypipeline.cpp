@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "dfilecopypipeline.h"
+#include "dfilecopybufferpool.h"
+
+#include <QMutex>
+#include <QQueue>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include <QtConcurrent/QtConcurrent>
+
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef DFM_ENABLE_IO_URING
+#include <liburing.h>
+#endif
+
+DFM_BEGIN_NAMESPACE
+
+class DFileCopyPipelinePrivate
+{
+public:
+    DFileCopyPipelinePrivate(int depth, qint64 blockSize);
+    ~DFileCopyPipelinePrivate();
+
+    qint64 copyByThread(int fromFd, int toFd, qint64 offset, qint64 size, const DFileCopyPipeline::ProgressFunction &progress);
+#ifdef DFM_ENABLE_IO_URING
+    qint64 copyByIoUring(int fromFd, int toFd, qint64 offset, qint64 size, const DFileCopyPipeline::ProgressFunction &progress);
+
+    bool drainIoUring(QVector<bool> &inflight, int &inflightCount);
+
+    struct io_uring ring;
+    bool ringInited = false;
+    bool buffersRegistered = false;
+    // 取消后仍等不到完成事件，内核可能还在访问缓冲区，这些缓冲区不能再使用
+    bool buffersInUse = false;
+#endif
+
+    int depth;
+    qint64 blockSize;
+    int error = 0;
+    // 从缓冲区池获取的按页对齐的读写缓冲区，每个同时进行的请求使用一个
+    QVector<char *> buffers;
+};
+
+DFileCopyPipelinePrivate::DFileCopyPipelinePrivate(int depth, qint64 blockSize)
+    : depth(qMax(depth, 1))
+    , blockSize(qMax(blockSize, qint64(getpagesize())))
+{
+    for (int i = 0; i < this->depth; ++i)
+        buffers << DFileCopyBufferPool::instance()->acquire(this->blockSize);
+
+#ifdef DFM_ENABLE_IO_URING
+    if (this->depth > 0 && io_uring_queue_init(static_cast<unsigned>(this->depth), &ring, 0) == 0) {
+        ringInited = true;
+
+        QVector<struct iovec> iovecs;
+        for (char *buffer : buffers)
+            iovecs << iovec {buffer, static_cast<size_t>(this->blockSize)};
+        // 注册缓冲区失败时仍可使用普通的读写请求
+        buffersRegistered = io_uring_register_buffers(&ring, iovecs.constData(), static_cast<unsigned>(iovecs.size())) == 0;
+    }
+#endif
+}
+
+DFileCopyPipelinePrivate::~DFileCopyPipelinePrivate()
+{
+#ifdef DFM_ENABLE_IO_URING
+    if (ringInited) {
+        if (buffersRegistered && !buffersInUse)
+            io_uring_unregister_buffers(&ring);
+        io_uring_queue_exit(&ring);
+    }
+
+    // 宁可泄漏也不能把内核可能还在写入的缓冲区还给缓冲区池
+    if (buffersInUse)
+        return;
+#endif
+
+    for (char *buffer : buffers)
+        DFileCopyBufferPool::instance()->release(buffer);
+}
+
+qint64 DFileCopyPipelinePrivate::copyByThread(int fromFd, int toFd, qint64 offset, qint64 size, const DFileCopyPipeline::ProgressFunction &progress)
+{
+    // 读线程按顺序把数据读入空闲的缓冲区，调用线程按相同的顺序写入目标文件
+    QSemaphore freeBuffers(depth);
+    QMutex mutex;
+    QWaitCondition readyCondition;
+    // 缓冲区的索引和读取到的数据大小，索引小于0表示读取失败
+    QQueue<QPair<int, qint64>> readyBlocks;
+    QAtomicInteger<bool> stopped = false;
+    int readError = 0;
+
+    QThreadPool readPool;
+    readPool.setMaxThreadCount(1);
+    QFuture<void> readResult = QtConcurrent::run(&readPool, [&]() {
+        const qint64 end = offset + size;
+        qint64 pos = offset;
+        int index = 0;
+
+        while (pos < end) {
+            freeBuffers.acquire();
+            if (stopped.load())
+                return;
+
+            const size_t len = static_cast<size_t>(qMin(blockSize, end - pos));
+            ssize_t sizeRead = -1;
+            do {
+                sizeRead = pread(fromFd, buffers[index], len, pos);
+            } while (sizeRead < 0 && errno == EINTR);
+
+            QMutexLocker lk(&mutex);
+            if (sizeRead <= 0) {
+                // 源文件被截断时没有errno，交给调用者处理
+                readError = sizeRead < 0 ? errno : 0;
+                readyBlocks.enqueue(qMakePair(-1, qint64(0)));
+                readyCondition.wakeAll();
+                return;
+            }
+
+            readyBlocks.enqueue(qMakePair(index, qint64(sizeRead)));
+            readyCondition.wakeAll();
+            pos += sizeRead;
+            index = (index + 1) % depth;
+        }
+    });
+
+    qint64 copied = 0;
+    while (copied < size) {
+        QPair<int, qint64> block;
+        {
+            QMutexLocker lk(&mutex);
+            while (readyBlocks.isEmpty())
+                readyCondition.wait(&mutex);
+            block = readyBlocks.dequeue();
+        }
+
+        if (block.first < 0) {
+            error = readError;
+            break;
+        }
+
+        const char *data = buffers[block.first];
+        qint64 written = 0;
+        while (written < block.second) {
+            ssize_t sizeWrite = pwrite(toFd, data + written, static_cast<size_t>(block.second - written), offset + copied + written);
+            if (sizeWrite < 0 && errno == EINTR)
+                continue;
+            if (sizeWrite <= 0) {
+                error = sizeWrite < 0 ? errno : ENOSPC;
+                break;
+            }
+            written += sizeWrite;
+        }
+
+        copied += written;
+        if (written > 0 && progress && !progress(written))
+            break;
+        if (error != 0)
+            break;
+
+        freeBuffers.release();
+    }
+
+    stopped.store(true);
+    freeBuffers.release(depth);
+    readResult.waitForFinished();
+
+    return copied;
+}
+
+#ifdef DFM_ENABLE_IO_URING
+/*!
+ * \brief DFileCopyPipelinePrivate::drainIoUring 取消所有已提交的请求，并等待它们的完成事件
+ * \param inflight 每个缓冲区是否有已提交还没有完成的请求
+ * \param inflightCount 已提交还没有完成的请求个数
+ * \return 所有请求都已完成时返回true，此后内核不会再访问缓冲区
+ */
+bool DFileCopyPipelinePrivate::drainIoUring(QVector<bool> &inflight, int &inflightCount)
+{
+    // 取消请求本身也会产生完成事件，用-1区分
+    int cancelCount = 0;
+    for (int i = 0; i < inflight.size(); ++i) {
+        if (!inflight.at(i))
+            continue;
+
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        if (!sqe)
+            break;
+
+        io_uring_prep_cancel(sqe, reinterpret_cast<void *>(static_cast<intptr_t>(i)), 0);
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(static_cast<intptr_t>(-1)));
+        ++cancelCount;
+    }
+
+    while (inflightCount > 0 || cancelCount > 0) {
+        io_uring_submit(&ring);
+
+        struct io_uring_cqe *cqe = nullptr;
+        int ret = io_uring_wait_cqe(&ring, &cqe);
+        if (ret == -EINTR)
+            continue;
+        if (ret < 0)
+            return false;
+
+        const int index = static_cast<int>(reinterpret_cast<intptr_t>(io_uring_cqe_get_data(cqe)));
+        io_uring_cqe_seen(&ring, cqe);
+
+        if (index < 0) {
+            --cancelCount;
+        } else {
+            inflight[index] = false;
+            --inflightCount;
+        }
+    }
+
+    return true;
+}
+
+qint64 DFileCopyPipelinePrivate::copyByIoUring(int fromFd, int toFd, qint64 offset, qint64 size, const DFileCopyPipeline::ProgressFunction &progress)
+{
+    // 每个缓冲区对应文件中一段连续的数据，先读满再写完，然后继续处理后面还没有读取的数据
+    struct Block {
+        qint64 pos = 0;
+        qint64 len = 0;
+        qint64 filled = 0;
+        qint64 written = 0;
+        bool busy = false; // 这段数据还没有全部写入
+        bool inflight = false; // 已提交请求，还没有完成
+    };
+
+    QVector<Block> blocks(depth);
+    const qint64 end = offset + size;
+    qint64 nextPos = offset;
+    qint64 reported = offset;
+    int inflightCount = 0;
+    bool stopped = false;
+
+    auto submit = [&](int index) -> bool {
+        Block &block = blocks[index];
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        if (!sqe)
+            return false;
+
+        const bool isRead = block.filled < block.len;
+        char *data = buffers[index] + (isRead ? block.filled : block.written);
+        const unsigned len = static_cast<unsigned>(isRead ? block.len - block.filled : block.filled - block.written);
+        const qint64 pos = block.pos + (isRead ? block.filled : block.written);
+
+        if (isRead) {
+            if (buffersRegistered)
+                io_uring_prep_read_fixed(sqe, fromFd, data, len, static_cast<__u64>(pos), index);
+            else
+                io_uring_prep_read(sqe, fromFd, data, len, static_cast<__u64>(pos));
+        } else {
+            if (buffersRegistered)
+                io_uring_prep_write_fixed(sqe, toFd, data, len, static_cast<__u64>(pos), index);
+            else
+                io_uring_prep_write(sqe, toFd, data, len, static_cast<__u64>(pos));
+        }
+
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(static_cast<intptr_t>(index)));
+        block.inflight = true;
+        ++inflightCount;
+        return true;
+    };
+
+    auto startBlock = [&](int index) -> bool {
+        Block &block = blocks[index];
+        block.pos = nextPos;
+        block.len = qMin(blockSize, end - nextPos);
+        block.filled = 0;
+        block.written = 0;
+        block.busy = true;
+        nextPos += block.len;
+        return submit(index);
+    };
+
+    for (int i = 0; i < depth && nextPos < end; ++i)
+        startBlock(i);
+
+    while (inflightCount > 0) {
+        io_uring_submit(&ring);
+
+        struct io_uring_cqe *cqe = nullptr;
+        int ret = io_uring_wait_cqe(&ring, &cqe);
+        if (ret == -EINTR)
+            continue;
+        if (ret < 0) {
+            // 已提交的请求还在使用缓冲区，取消并等待它们全部完成后才能返回
+            error = -ret;
+            QVector<bool> inflight(depth);
+            for (int i = 0; i < depth; ++i)
+                inflight[i] = blocks.at(i).inflight;
+
+            if (!drainIoUring(inflight, inflightCount)) {
+                // 仍然取不到完成事件，只能放弃这个流水线和它的缓冲区
+                buffersInUse = true;
+            }
+            return reported - offset;
+        }
+
+        const int index = static_cast<int>(reinterpret_cast<intptr_t>(io_uring_cqe_get_data(cqe)));
+        const int res = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+
+        Block &block = blocks[index];
+        block.inflight = false;
+        --inflightCount;
+
+        const bool isRead = block.filled < block.len;
+        if (res == -EINTR || res == -EAGAIN) {
+            if (!stopped)
+                submit(index);
+            continue;
+        }
+
+        if (res <= 0) {
+            // 读到0表示源文件被截断，交给调用者处理
+            if (res < 0 || !isRead)
+                error = res < 0 ? -res : ENOSPC;
+            stopped = true;
+            continue;
+        }
+
+        if (isRead)
+            block.filled += res;
+        else
+            block.written += res;
+
+        if (block.written < block.len) {
+            if (!stopped)
+                submit(index);
+            continue;
+        }
+
+        block.busy = false;
+
+        // 只报告从offset开始连续写入的数据
+        qint64 prefix = nextPos;
+        for (const Block &b : blocks) {
+            if (b.busy)
+                prefix = qMin(prefix, b.pos + b.written);
+        }
+        if (prefix > reported) {
+            const qint64 newSize = prefix - reported;
+            reported = prefix;
+            if (progress && !progress(newSize))
+                stopped = true;
+        }
+
+        if (!stopped && nextPos < end)
+            startBlock(index);
+    }
+
+    // 中途停止时，已写入但不连续的部分交给调用者重新处理
+    return reported - offset;
+}
+#endif
+
+DFileCopyPipeline::DFileCopyPipeline(int depth, qint64 blockSize)
+    : d_ptr(new DFileCopyPipelinePrivate(depth, blockSize))
+{
+
+}
+
+DFileCopyPipeline::~DFileCopyPipeline()
+{
+
+}
+
+bool DFileCopyPipeline::isIoUringEnabled() const
+{
+#ifdef DFM_ENABLE_IO_URING
+    Q_D(const DFileCopyPipeline);
+
+    return d->ringInited;
+#else
+    return false;
+#endif
+}
+
+int DFileCopyPipeline::error() const
+{
+    Q_D(const DFileCopyPipeline);
+
+    return d->error;
+}
+
+qint64 DFileCopyPipeline::copy(int fromFd, int toFd, qint64 offset, qint64 size, const ProgressFunction &progress)
+{
+    Q_D(DFileCopyPipeline);
+
+    d->error = 0;
+    if (fromFd < 0 || toFd < 0 || offset < 0 || size <= 0)
+        return 0;
+
+    if (d->depth <= 0) {
+        d->error = ENOMEM;
+        return 0;
+    }
+
+#ifdef DFM_ENABLE_IO_URING
+    if (d->buffersInUse) {
+        d->error = EIO;
+        return 0;
+    }
+
+    if (d->ringInited)
+        return d->copyByIoUring(fromFd, toFd, offset, size, progress);
+#endif
+
+    return d->copyByThread(fromFd, toFd, offset, size, progress);
+}
+
+DFM_END_NAMESPACE
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DFILECOPYPIPELINE_H
+#define DFILECOPYPIPELINE_H
+
+#include <dfmglobal.h>
+
+#include <QScopedPointer>
+
+#include <functional>
+
+DFM_BEGIN_NAMESPACE
+
+/*!
+ * \brief The DFileCopyPipeline class 在两个本地文件描述符之间拷贝数据，同时保持多个读写请求
+ * 支持io_uring时由内核异步执行读写，否则由一个读线程和调用线程并行读写
+ */
+class DFileCopyPipelinePrivate;
+class DFileCopyPipeline
+{
+    Q_DECLARE_PRIVATE(DFileCopyPipeline)
+
+public:
+    // 每写入一段连续的数据后调用，参数为新写入的数据大小，返回false时停止拷贝
+    typedef std::function<bool(qint64 size)> ProgressFunction;
+
+    explicit DFileCopyPipeline(int depth = 4, qint64 blockSize = 1024 * 1024);
+    ~DFileCopyPipeline();
+
+    bool isIoUringEnabled() const;
+    // 拷贝失败时的errno，拷贝完成或者被停止时为0
+    int error() const;
+
+    // 从offset开始拷贝size大小的数据，返回从offset开始已连续写入目标文件的数据大小
+    qint64 copy(int fromFd, int toFd, qint64 offset, qint64 size, const ProgressFunction &progress = nullptr);
+
+private:
+    QScopedPointer<DFileCopyPipelinePrivate> d_ptr;
+
+    Q_DISABLE_COPY(DFileCopyPipeline)
+};
+
+DFM_END_NAMESPACE
+
+#endif // DFILECOPYPIPELINE_H
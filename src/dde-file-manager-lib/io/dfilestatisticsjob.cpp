@@ -31,6 +31,25 @@
 #include <QQueue>
 #include <QTimer>
 #include <QWaitCondition>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <QCache>
+#include <QSet>
+#include <QDateTime>
+#include <QMetaMethod>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
 
 
 DFM_BEGIN_NAMESPACE
@@ -62,6 +81,9 @@ public:
     QAtomicInteger<qint64> totalProgressSize = 0;
     QAtomicInt filesCount = 0;
     QAtomicInt directoryCount = 0;
+
+    // 是否有对象关心 fileFound/directoryFound 信号，没有时本地遍历不再为每个文件构造 DUrl
+    bool notifyFoundFiles = true;
 };
 
 DFileStatisticsJobPrivate::DFileStatisticsJobPrivate(DFileStatisticsJob *qq)
@@ -242,6 +264,558 @@ void DFileStatisticsJobPrivate::processFile(const DUrl &url, QQueue<DUrl> &direc
 
 }
 
+namespace {
+// 缓存结果的有效期。文件内容被原地修改时目录的修改时间不会变化，所以缓存只能短时间内使用
+const qint64 kSizeCacheTimeout = 30 * 1000;
+// 缓存的目录总数上限
+const int kSizeCacheMaxDirectoryCount = 200000;
+// 大目录中每处理这么多文件汇总一次进度
+const int kFlushEntryCount = 1000;
+
+struct LocalFileStat
+{
+    dev_t dev = 0;
+    ino_t ino = 0;
+    mode_t mode = 0;
+    nlink_t nlink = 0;
+    qint64 size = 0;
+    qint64 mtime = 0; // 纳秒
+};
+
+bool localFileStat(int dirFd, const char *name, bool followSymlink, LocalFileStat *st)
+{
+#ifdef STATX_BASIC_STATS
+    struct statx stx;
+    int flags = AT_STATX_DONT_SYNC | (followSymlink ? 0 : AT_SYMLINK_NOFOLLOW);
+
+    if (statx(dirFd, name, flags, STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_INO | STATX_SIZE | STATX_MTIME, &stx) == 0) {
+        st->dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+        st->ino = stx.stx_ino;
+        st->mode = stx.stx_mode;
+        st->nlink = stx.stx_nlink;
+        st->size = static_cast<qint64>(stx.stx_size);
+        st->mtime = stx.stx_mtime.tv_sec * 1000000000LL + stx.stx_mtime.tv_nsec;
+
+        return true;
+    }
+
+    // 内核不支持 statx 时使用 fstatat
+    if (errno != ENOSYS)
+        return false;
+#endif
+
+    struct stat buf;
+
+    if (fstatat(dirFd, name, &buf, followSymlink ? 0 : AT_SYMLINK_NOFOLLOW) != 0)
+        return false;
+
+    st->dev = buf.st_dev;
+    st->ino = buf.st_ino;
+    st->mode = buf.st_mode;
+    st->nlink = buf.st_nlink;
+    st->size = buf.st_size;
+    st->mtime = buf.st_mtim.tv_sec * 1000000000LL + buf.st_mtim.tv_nsec;
+
+    return true;
+}
+
+/*!
+ * \brief The DirectorySizeCache class 本地目录统计结果的缓存
+ * 以目录的 (dev, ino, mtime) 为键，属性窗口、复制前的统计、删除前的统计等短时间内重复统计同一个目录时直接使用。
+ * 子目录的变化不会修改上层目录的修改时间，因此同时记录子树中所有目录的状态，使用前逐个校验。
+ */
+class DirectorySizeCache
+{
+public:
+    struct Stamp {
+        QByteArray path;
+        dev_t dev;
+        ino_t ino;
+        qint64 mtime;
+        bool followSymlink;
+    };
+
+    struct Result {
+        qint64 totalSize = 0;
+        qint64 totalProgressSize = 0;
+        int filesCount = 0;
+        int directoryCount = 0;
+        QVector<Stamp> directories;
+        qint64 time = 0;
+    };
+
+    static QByteArray key(const LocalFileStat &st, int fileHints)
+    {
+        return QByteArray::number(static_cast<quint64>(st.dev)) + ':' + QByteArray::number(static_cast<quint64>(st.ino))
+               + ':' + QByteArray::number(st.mtime) + ':' + QByteArray::number(fileHints);
+    }
+
+    static bool find(const QByteArray &key, Result *result)
+    {
+        {
+            QMutexLocker locker(&mutex);
+            Result *cached = cache.object(key);
+
+            if (!cached)
+                return false;
+
+            if (QDateTime::currentMSecsSinceEpoch() - cached->time > kSizeCacheTimeout) {
+                cache.remove(key);
+                return false;
+            }
+
+            *result = *cached;
+        }
+
+        for (const Stamp &stamp : result->directories) {
+            LocalFileStat st;
+
+            if (!localFileStat(AT_FDCWD, stamp.path.constData(), stamp.followSymlink, &st)
+                    || st.dev != stamp.dev || st.ino != stamp.ino || st.mtime != stamp.mtime) {
+                QMutexLocker locker(&mutex);
+                cache.remove(key);
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static void insert(const QByteArray &key, const Result &result)
+    {
+        QMutexLocker locker(&mutex);
+
+        cache.insert(key, new Result(result), result.directories.size() + 1);
+    }
+
+private:
+    static QMutex mutex;
+    static QCache<QByteArray, Result> cache;
+};
+
+QMutex DirectorySizeCache::mutex;
+QCache<QByteArray, DirectorySizeCache::Result> DirectorySizeCache::cache(kSizeCacheMaxDirectoryCount);
+}
+
+/*!
+ * \brief The DFileStatisticsLocalWalker class 本地目录的多线程统计
+ * 每个线程有自己的任务队列，从队尾取目录(深度优先)，自己的队列为空时从其它线程的队头窃取目录(靠近根的大子树)。
+ * 目录用 openat/fstatat(statx) 遍历，不再为每个文件创建 DAbstractFileInfo。
+ */
+class DFileStatisticsLocalWalker
+{
+public:
+    explicit DFileStatisticsLocalWalker(DFileStatisticsJobPrivate *dd);
+    ~DFileStatisticsLocalWalker();
+
+    bool addRoot(const QString &path);
+    bool run();
+
+private:
+    struct Root {
+        QByteArray cacheKey;
+        QMutex lock;
+        DirectorySizeCache::Result result;
+        QSet<QPair<dev_t, ino_t>> hardLinks;
+        QSet<QPair<dev_t, ino_t>> visitedDirectories;
+    };
+
+    struct Task {
+        QByteArray path;
+        dev_t dev;
+        ino_t ino;
+        qint64 mtime;
+        bool followSymlink;
+        Root *root;
+    };
+
+    struct Queue {
+        QMutex lock;
+        std::deque<Task> tasks;
+    };
+
+    struct Counters {
+        qint64 totalSize = 0;
+        qint64 totalProgressSize = 0;
+        int filesCount = 0;
+        int directoryCount = 0;
+    };
+
+    void work(int index);
+    bool takeTask(int index, Task *task);
+    void pushTask(int index, const Task &task);
+    void processDirectory(int index, const Task &task);
+    void processSubdirectory(int index, const Task &task, const QByteArray &path, const LocalFileStat &st, bool followSymlink, Counters *counters);
+    void processFile(const Task &task, int dirFd, const char *name, const QByteArray &path, const LocalFileStat &st, bool isSymLink, Counters *counters);
+    void flush(Root *root, Counters *counters);
+
+    DFileStatisticsJobPrivate *d;
+    int threadCount;
+    int cacheFileHints;
+    std::vector<std::unique_ptr<Queue>> queues;
+    QList<Root *> roots;
+    QAtomicInt pendingTasks = 0;
+    QMutex idleLock;
+    QWaitCondition idleCondition;
+};
+
+DFileStatisticsLocalWalker::DFileStatisticsLocalWalker(DFileStatisticsJobPrivate *dd)
+    : d(dd)
+    , threadCount(qBound(1, QThread::idealThreadCount(), 8))
+    , cacheFileHints(static_cast<int>(dd->fileHints & ~(DFileStatisticsJob::ExcludeSourceFile | DFileStatisticsJob::SingleDepth)))
+{
+    for (int i = 0; i < threadCount; ++i)
+        queues.emplace_back(new Queue);
+}
+
+DFileStatisticsLocalWalker::~DFileStatisticsLocalWalker()
+{
+    qDeleteAll(roots);
+}
+
+bool DFileStatisticsLocalWalker::addRoot(const QString &path)
+{
+    const QByteArray &nativePath = QFile::encodeName(path);
+    LocalFileStat st;
+
+    if (!localFileStat(AT_FDCWD, nativePath.constData(), true, &st) || !S_ISDIR(st.mode))
+        return false;
+
+    const QByteArray &cacheKey = DirectorySizeCache::key(st, cacheFileHints);
+    DirectorySizeCache::Result cached;
+
+    // 需要逐个通知文件时不能使用缓存
+    if (!d->notifyFoundFiles && DirectorySizeCache::find(cacheKey, &cached)) {
+        d->totalSize += cached.totalSize;
+        d->totalProgressSize += cached.totalProgressSize;
+        d->filesCount += cached.filesCount;
+        d->directoryCount += cached.directoryCount;
+
+        if (cached.totalSize > 0)
+            Q_EMIT d->q_ptr->sizeChanged(d->totalSize);
+
+        return true;
+    }
+
+    Root *root = new Root;
+    root->cacheKey = cacheKey;
+    root->visitedDirectories.insert(qMakePair(st.dev, st.ino));
+    roots << root;
+
+    pushTask(roots.size() % threadCount, Task{nativePath, st.dev, st.ino, st.mtime, true, root});
+
+    return true;
+}
+
+bool DFileStatisticsLocalWalker::run()
+{
+    if (pendingTasks.load() > 0) {
+        QThreadPool pool;
+        QList<QFuture<void>> futures;
+
+        pool.setMaxThreadCount(threadCount);
+
+        for (int i = 0; i < threadCount; ++i)
+            futures << QtConcurrent::run(&pool, [this, i] { work(i); });
+
+        for (QFuture<void> &future : futures)
+            future.waitForFinished();
+    }
+
+    if (d->state == DFileStatisticsJob::StoppedState)
+        return false;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    for (Root *root : roots) {
+        root->result.time = now;
+        DirectorySizeCache::insert(root->cacheKey, root->result);
+    }
+
+    return true;
+}
+
+void DFileStatisticsLocalWalker::work(int index)
+{
+    Task task;
+
+    forever {
+        if (!d->stateCheck())
+            return;
+
+        if (takeTask(index, &task)) {
+            processDirectory(index, task);
+
+            if (pendingTasks.fetchAndAddOrdered(-1) == 1) {
+                QMutexLocker locker(&idleLock);
+                idleCondition.wakeAll();
+            }
+
+            continue;
+        }
+
+        QMutexLocker locker(&idleLock);
+
+        if (pendingTasks.load() == 0)
+            return;
+
+        // 其它线程正在处理的目录中可能还会产生新的子目录
+        idleCondition.wait(&idleLock, 20);
+    }
+}
+
+bool DFileStatisticsLocalWalker::takeTask(int index, Task *task)
+{
+    {
+        Queue *queue = queues.at(static_cast<size_t>(index)).get();
+        QMutexLocker locker(&queue->lock);
+
+        if (!queue->tasks.empty()) {
+            *task = queue->tasks.back();
+            queue->tasks.pop_back();
+
+            return true;
+        }
+    }
+
+    for (int i = 1; i < threadCount; ++i) {
+        Queue *queue = queues.at(static_cast<size_t>((index + i) % threadCount)).get();
+        QMutexLocker locker(&queue->lock);
+
+        if (!queue->tasks.empty()) {
+            *task = queue->tasks.front();
+            queue->tasks.pop_front();
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DFileStatisticsLocalWalker::pushTask(int index, const Task &task)
+{
+    pendingTasks.ref();
+
+    {
+        Queue *queue = queues.at(static_cast<size_t>(index)).get();
+        QMutexLocker locker(&queue->lock);
+
+        queue->tasks.push_back(task);
+    }
+
+    idleCondition.wakeOne();
+}
+
+void DFileStatisticsLocalWalker::processDirectory(int index, const Task &task)
+{
+    {
+        QMutexLocker locker(&task.root->lock);
+        task.root->result.directories << DirectorySizeCache::Stamp{task.path, task.dev, task.ino, task.mtime, task.followSymlink};
+    }
+
+    int fd = ::open(task.path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0) {
+        qWarning() << "Failed on open directory:" << task.path << strerror(errno);
+        return;
+    }
+
+    DIR *dir = fdopendir(fd);
+
+    if (!dir) {
+        ::close(fd);
+        return;
+    }
+
+    Counters counters;
+    int processedCount = 0;
+
+    while (struct dirent *entry = readdir(dir)) {
+        const char *name = entry->d_name;
+
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+            continue;
+
+        if (!d->stateCheck())
+            break;
+
+        LocalFileStat st;
+
+        if (!localFileStat(fd, name, false, &st))
+            continue;
+
+        const QByteArray &path = task.path.endsWith('/') ? task.path + name : task.path + '/' + name;
+
+        if (S_ISLNK(st.mode)) {
+            LocalFileStat target;
+            bool ok = localFileStat(fd, name, true, &target);
+
+            if (ok && !S_ISDIR(target.mode)) {
+                processFile(task, fd, name, path, target, true, &counters);
+            } else {
+                // fix bug 30548 ,以为有些文件大小为0,文件夹为空，size也为零，重新计算显示大小
+                counters.totalProgressSize += FileUtils::getMemoryPageSize();
+
+                if (!ok || !d->fileHints.testFlag(DFileStatisticsJob::FollowSymlink)) {
+                    ++counters.filesCount;
+
+                    if (d->notifyFoundFiles)
+                        Q_EMIT d->q_ptr->fileFound(DUrl::fromLocalFile(QFile::decodeName(path)));
+                } else {
+                    processSubdirectory(index, task, path, target, true, &counters);
+                }
+            }
+        } else if (S_ISDIR(st.mode)) {
+            counters.totalProgressSize += FileUtils::getMemoryPageSize();
+            processSubdirectory(index, task, path, st, false, &counters);
+        } else {
+            processFile(task, fd, name, path, st, false, &counters);
+        }
+
+        if (++processedCount % kFlushEntryCount == 0)
+            flush(task.root, &counters);
+    }
+
+    closedir(dir);
+    flush(task.root, &counters);
+}
+
+void DFileStatisticsLocalWalker::processSubdirectory(int index, const Task &task, const QByteArray &path, const LocalFileStat &st, bool followSymlink, Counters *counters)
+{
+    ++counters->directoryCount;
+
+    bool skip = false;
+
+    // 跟随链接时同一个目录可能被多次访问，甚至形成循环
+    if (d->fileHints.testFlag(DFileStatisticsJob::FollowSymlink)) {
+        QMutexLocker locker(&task.root->lock);
+        const QPair<dev_t, ino_t> &id = qMakePair(st.dev, st.ino);
+
+        skip = task.root->visitedDirectories.contains(id);
+        task.root->visitedDirectories.insert(id);
+    }
+
+    // 设备号不同时才可能是挂载点，只有这时才需要查询挂载信息
+    if (!skip && st.dev != task.dev
+            && !(d->fileHints & (DFileStatisticsJob::DontSkipAVFSDStorage | DFileStatisticsJob::DontSkipPROCStorage))) {
+        const QString &localPath = QFile::decodeName(path);
+        DStorageInfo si(localPath);
+
+        if (si.rootPath() == localPath) {
+            if (!d->fileHints.testFlag(DFileStatisticsJob::DontSkipPROCStorage)
+                    && si.device() == "proc") {
+                skip = true;
+            }
+
+            if (!d->fileHints.testFlag(DFileStatisticsJob::DontSkipAVFSDStorage)
+                    && si.device() == "avfsd") {
+                skip = true;
+            }
+        }
+    }
+
+    if (!skip)
+        pushTask(index, Task{path, st.dev, st.ino, st.mtime, followSymlink, task.root});
+
+    if (d->notifyFoundFiles)
+        Q_EMIT d->q_ptr->directoryFound(DUrl::fromLocalFile(QFile::decodeName(path)));
+}
+
+void DFileStatisticsLocalWalker::processFile(const Task &task, int dirFd, const char *name, const QByteArray &path, const LocalFileStat &st, bool isSymLink, Counters *counters)
+{
+    do {
+        // ###(zccrs): skip the file,os file
+        if (path == "/proc/kcore" || path == "/dev/core") {
+            break;
+        }
+        //skip os file Shortcut
+        if (isSymLink) {
+            char target[PATH_MAX];
+            ssize_t length = readlinkat(dirFd, name, target, sizeof(target) - 1);
+
+            if (length > 0) {
+                const QByteArray targetPath(target, static_cast<int>(length));
+
+                if (targetPath == "/proc/kcore" || targetPath == "/dev/core")
+                    break;
+            }
+        }
+
+        if (S_ISCHR(st.mode) && !d->fileHints.testFlag(DFileStatisticsJob::DontSkipCharDeviceFile)) {
+            break;
+        }
+
+        if (S_ISBLK(st.mode) && !d->fileHints.testFlag(DFileStatisticsJob::DontSkipBlockDeviceFile)) {
+            break;
+        }
+
+        if (S_ISFIFO(st.mode) && !d->fileHints.testFlag(DFileStatisticsJob::DontSkipFIFOFile)) {
+            break;
+        }
+
+        if (S_ISSOCK(st.mode) && !d->fileHints.testFlag(DFileStatisticsJob::DontSkipSocketFile)) {
+            break;
+        }
+
+        if (!S_ISREG(st.mode) && !S_ISCHR(st.mode) && !S_ISBLK(st.mode) && !S_ISFIFO(st.mode) && !S_ISSOCK(st.mode)) {
+            break;
+        }
+
+        qint64 size = st.size;
+
+        if (size > 0 && st.nlink > 1 && d->fileHints.testFlag(DFileStatisticsJob::DeduplicateHardLinks)) {
+            QMutexLocker locker(&task.root->lock);
+            const QPair<dev_t, ino_t> &id = qMakePair(st.dev, st.ino);
+
+            if (task.root->hardLinks.contains(id)) {
+                size = 0;
+            } else {
+                task.root->hardLinks.insert(id);
+            }
+        }
+
+        if (size > 0) {
+            counters->totalSize += size;
+        }
+        // fix bug 30548 ,以为有些文件大小为0,文件夹为空，size也为零，重新计算显示大小
+        // fix bug 202007010033【文件管理器】【5.1.2.10-1】【sp2】复制软连接的文件，进度条显示1%
+        // 判断文件是否是链接文件
+        counters->totalProgressSize += (size <= 0 || isSymLink) ? FileUtils::getMemoryPageSize() : size;
+    } while (false);
+
+    ++counters->filesCount;
+
+    if (d->notifyFoundFiles)
+        Q_EMIT d->q_ptr->fileFound(DUrl::fromLocalFile(QFile::decodeName(path)));
+}
+
+void DFileStatisticsLocalWalker::flush(Root *root, Counters *counters)
+{
+    if (counters->filesCount == 0 && counters->directoryCount == 0 && counters->totalProgressSize == 0)
+        return;
+
+    d->totalSize += counters->totalSize;
+    d->totalProgressSize += counters->totalProgressSize;
+    d->filesCount += counters->filesCount;
+    d->directoryCount += counters->directoryCount;
+
+    {
+        QMutexLocker locker(&root->lock);
+
+        root->result.totalSize += counters->totalSize;
+        root->result.totalProgressSize += counters->totalProgressSize;
+        root->result.filesCount += counters->filesCount;
+        root->result.directoryCount += counters->directoryCount;
+    }
+
+    if (counters->totalSize > 0)
+        Q_EMIT d->q_ptr->sizeChanged(d->totalSize);
+
+    *counters = Counters();
+}
+
 DFileStatisticsJob::DFileStatisticsJob(QObject *parent)
     : QThread(parent)
     , d_ptr(new DFileStatisticsJobPrivate(this))
@@ -386,6 +960,9 @@ void DFileStatisticsJob::run()
 
     Q_EMIT dataNotify(0, 0, 0);
 
+    d->notifyFoundFiles = isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::fileFound))
+                          || isSignalConnected(QMetaMethod::fromSignal(&DFileStatisticsJob::directoryFound));
+
     QQueue<DUrl> directory_queue;
     int fileCount = 0;
     if (d->fileHints.testFlag(ExcludeSourceFile)) {
@@ -447,6 +1024,24 @@ void DFileStatisticsJob::run()
         return;
     }
 
+    // 本地目录(不包括gvfs挂载的目录)多线程遍历，其它目录仍然通过 DFileService 遍历
+    DFileStatisticsLocalWalker localWalker(d);
+
+    for (int i = directory_queue.size() - 1; i >= 0; --i) {
+        const DUrl &directory_url = directory_queue.at(i);
+
+        if (directory_url.isLocalFile() && !FileUtils::isGvfsMountFile(directory_url.toLocalFile())
+                && localWalker.addRoot(directory_url.toLocalFile())) {
+            directory_queue.removeAt(i);
+        }
+    }
+
+    if (!localWalker.run()) {
+        d->setState(StoppedState);
+
+        return;
+    }
+
     while (!directory_queue.isEmpty()) {
         const DUrl &directory_url = directory_queue.dequeue();
         const DDirIteratorPointer &iterator = DFileService::instance()->createDirIterator(nullptr, directory_url, QStringList(),
@@ -59,7 +59,8 @@ public:
         DontSkipFIFOFile = 0x20,
         DontSkipSocketFile = 0x40,
         ExcludeSourceFile = 0x80, // 不计算传入的文件列表
-        SingleDepth = 0x100 // 深度为1
+        SingleDepth = 0x100, // 深度为1
+        DeduplicateHardLinks = 0x200 // 同一文件的多个硬链接只统计一次大小
     };
 
     Q_ENUM(FileHint)
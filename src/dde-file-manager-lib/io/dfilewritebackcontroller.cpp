@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "dfilewritebackcontroller.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+DFM_BEGIN_NAMESPACE
+
+DFileWritebackController::Policy DFileWritebackController::policyOfFileSystem(const QString &fsType, bool isGvfs)
+{
+    Policy policy;
+
+    if (isGvfs) {
+        // gvfs的文件设备只能整体同步(flush或者关闭后重新打开)，不使用sync_file_range
+        policy.rangeSize = 0;
+        policy.syncSize = 16 * 1024 * 1024;
+        policy.syncInterval = 1000;
+    } else if (fsType.contains("vfat")) {
+        // U盘的写入速度慢，积累太多脏页时关闭文件或者卸载会卡住很久
+        policy.rangeSize = 4 * 1024 * 1024;
+        policy.syncSize = 32 * 1024 * 1024;
+        policy.syncInterval = 1000;
+    } else if (fsType == "cifs") {
+        // 每次同步都要等待服务器的确认，同步的间隔长一些
+        policy.rangeSize = 8 * 1024 * 1024;
+        policy.syncSize = 64 * 1024 * 1024;
+        policy.syncInterval = 2000;
+    } else {
+        policy.rangeSize = 16 * 1024 * 1024;
+        policy.syncSize = 128 * 1024 * 1024;
+        policy.syncInterval = 5000;
+    }
+
+    return policy;
+}
+
+bool DFileWritebackController::needWriteback(const QString &fsType, bool isGvfs)
+{
+    return isGvfs || fsType == "cifs" || fsType.contains("vfat");
+}
+
+bool DFileWritebackController::isEnabled() const
+{
+    return m_enabled;
+}
+
+void DFileWritebackController::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+DFileWritebackController::Policy DFileWritebackController::policy() const
+{
+    return m_policy;
+}
+
+void DFileWritebackController::setPolicy(const Policy &policy)
+{
+    m_policy = policy;
+}
+
+qint64 DFileWritebackController::durableSize() const
+{
+    return m_durableSize.load();
+}
+
+void DFileWritebackController::reset()
+{
+    m_durableSize.store(0);
+}
+
+DFileWriteback::DFileWriteback(DFileWritebackController *controller, int fd, const SyncFunction &sync)
+    : m_controller(controller)
+    , m_fd(fd)
+    , m_sync(sync)
+{
+
+}
+
+DFileWriteback::~DFileWriteback()
+{
+    // 没有同步完就放弃的文件(跳过、出错或者任务取消)，未同步的数据已经计入拷贝的进度，
+    // 也要计入已落盘的大小，否则之后的进度会一直被限制在较低的位置
+    if (isEnabled() && m_pendingSize > 0)
+        m_controller->m_durableSize.fetchAndAddOrdered(m_pendingSize);
+}
+
+bool DFileWriteback::isEnabled() const
+{
+    return m_controller && m_controller->isEnabled();
+}
+
+bool DFileWriteback::written(qint64 offset, qint64 size)
+{
+    if (!isEnabled() || size <= 0)
+        return true;
+
+    if (!m_syncTimer.isValid())
+        m_syncTimer.start();
+
+    // 写入的位置不连续时(如稀疏文件的空洞、重试时重新定位)从新的位置开始计算回写的区间
+    if (m_started < 0 || offset < m_started || offset > m_end) {
+        m_started = offset;
+        m_waited = offset;
+    }
+
+    m_end = offset + size;
+    m_pendingSize += size;
+
+    const DFileWritebackController::Policy &policy = m_controller->m_policy;
+
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0 && m_rangeSupported && policy.rangeSize > 0 && m_end - m_started >= policy.rangeSize) {
+        // 等待上一个区间回写完成，再开始回写新写入的区间，设备上始终只有一个区间在回写
+        int ret = 0;
+
+        if (m_started > m_waited) {
+            ret = sync_file_range(m_fd, m_waited, m_started - m_waited,
+                                  SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        }
+
+        if (ret == 0)
+            ret = sync_file_range(m_fd, m_started, m_end - m_started, SYNC_FILE_RANGE_WRITE);
+
+        // 不支持时只按大小和时间同步，其它错误由之后的fdatasync报告
+        if (ret != 0 && (errno == EINVAL || errno == ESPIPE || errno == ENOSYS))
+            m_rangeSupported = false;
+
+        m_waited = m_started;
+        m_started = m_end;
+    }
+#endif
+
+    if (m_pendingSize >= policy.syncSize || m_syncTimer.elapsed() >= policy.syncInterval)
+        return sync();
+
+    return true;
+}
+
+void DFileWriteback::skipped(qint64 size)
+{
+    if (size <= 0)
+        return;
+
+    m_skippedSize += size;
+
+    if (!isEnabled())
+        return;
+
+    m_controller->m_durableSize.fetchAndAddOrdered(size);
+    m_durableSize += size;
+}
+
+qint64 DFileWriteback::skippedSize() const
+{
+    return m_skippedSize;
+}
+
+bool DFileWriteback::finish()
+{
+    if (!isEnabled() || m_pendingSize <= 0)
+        return true;
+
+    return sync();
+}
+
+int DFileWriteback::error() const
+{
+    return m_error;
+}
+
+void DFileWriteback::discard()
+{
+    if (m_controller && m_durableSize > 0)
+        m_controller->m_durableSize.fetchAndAddOrdered(-m_durableSize);
+
+    m_durableSize = 0;
+    m_pendingSize = 0;
+    m_skippedSize = 0;
+}
+
+bool DFileWriteback::sync()
+{
+    bool ok = true;
+
+    if (m_sync) {
+        ok = m_sync();
+        m_error = ok ? 0 : EIO;
+    } else if (m_fd >= 0) {
+        int ret = -1;
+
+        do {
+            ret = fdatasync(m_fd);
+        } while (ret != 0 && errno == EINTR);
+
+        ok = (ret == 0);
+        m_error = ok ? 0 : errno;
+    }
+
+    m_syncTimer.restart();
+
+    // 同步失败时保留未同步的数据，由finish()再次同步
+    if (!ok)
+        return false;
+
+    m_controller->m_durableSize.fetchAndAddOrdered(m_pendingSize);
+    m_durableSize += m_pendingSize;
+    m_pendingSize = 0;
+
+    return true;
+}
+
+DFM_END_NAMESPACE
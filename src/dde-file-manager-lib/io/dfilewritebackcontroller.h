@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DFILEWRITEBACKCONTROLLER_H
+#define DFILEWRITEBACKCONTROLLER_H
+
+#include <dfmglobal.h>
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+
+#include <functional>
+
+DFM_BEGIN_NAMESPACE
+
+/*!
+ * \brief The DFileWritebackController class 控制拷贝任务向慢速设备(vfat、cifs、gvfs)写入数据时的回写
+ * 每写入一段数据用sync_file_range让内核开始回写并等待上一段回写完成，限制脏页的数量；
+ * 每写入一定大小或者经过一定时间后用fdatasync同步一次，同步过的数据计入已落盘的大小，
+ * 用于显示真实的拷贝进度，同时避免每次写入后都同步造成的性能下降
+ */
+class DFileWritebackController
+{
+public:
+    struct Policy
+    {
+        // 开始回写的区间大小
+        qint64 rangeSize = 0;
+        // 两次同步之间最多写入的大小
+        qint64 syncSize = 0;
+        // 两次同步之间最长的时间(毫秒)
+        qint64 syncInterval = 0;
+    };
+
+    DFileWritebackController() = default;
+
+    // fsType为目标目录所在的文件系统类型，gvfs挂载的目录fsType为空
+    static Policy policyOfFileSystem(const QString &fsType, bool isGvfs = false);
+    static bool needWriteback(const QString &fsType, bool isGvfs = false);
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+    Policy policy() const;
+    void setPolicy(const Policy &policy);
+
+    // 已经同步到设备上的数据大小
+    qint64 durableSize() const;
+    void reset();
+
+private:
+    friend class DFileWriteback;
+
+    bool m_enabled = false;
+    Policy m_policy;
+    QAtomicInteger<qint64> m_durableSize = 0;
+
+    Q_DISABLE_COPY(DFileWritebackController)
+};
+
+/*!
+ * \brief The DFileWriteback class 一个目标文件的回写状态，在写入这个文件的线程中使用
+ * fd有效时用sync_file_range控制回写；同步时优先调用sync函数(如gio的文件设备)，否则使用fdatasync
+ */
+class DFileWriteback
+{
+public:
+    typedef std::function<bool()> SyncFunction;
+
+    DFileWriteback(DFileWritebackController *controller, int fd, const SyncFunction &sync = nullptr);
+    ~DFileWriteback();
+
+    bool isEnabled() const;
+
+    // 在offset处写入了size大小的数据后调用，到达阈值时回写或者同步，同步失败时返回false
+    bool written(qint64 offset, qint64 size);
+    // 跳过的数据(如稀疏文件的空洞)不需要同步，直接计入已落盘的大小
+    void skipped(qint64 size);
+    // 本文件中跳过的数据大小
+    qint64 skippedSize() const;
+    // 文件写完后同步剩余的数据，上次同步失败时再次同步
+    bool finish();
+    // 上次同步失败的错误码
+    int error() const;
+    // 已同步的数据会被重新写入时(如回退到用户态读写)，从已落盘的大小中扣除
+    void discard();
+
+private:
+    bool sync();
+
+    DFileWritebackController *m_controller = nullptr;
+    int m_fd = -1;
+    SyncFunction m_sync;
+    bool m_rangeSupported = true;
+    // 已写入区间的末尾、已开始回写的位置、已等待回写完成的位置
+    qint64 m_end = 0;
+    qint64 m_started = -1;
+    qint64 m_waited = -1;
+    // 未同步的数据大小和本文件已同步的数据大小
+    qint64 m_pendingSize = 0;
+    qint64 m_durableSize = 0;
+    qint64 m_skippedSize = 0;
+    int m_error = 0;
+    QElapsedTimer m_syncTimer;
+
+    Q_DISABLE_COPY(DFileWriteback)
+};
+
+DFM_END_NAMESPACE
+
+#endif // DFILEWRITEBACKCONTROLLER_H
@@ -22,6 +22,11 @@
  */
 #include <gio/gio.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
 
 #include "dstorageinfo.h"
 #include "controllers/vaultcontroller.h"
@@ -29,6 +34,12 @@
 
 #include <QRegularExpression>
 #include <QMutex>
+#include <QReadWriteLock>
+#include <QMultiHash>
+#include <QAtomicInt>
+#include <QSet>
+
+#include <thread>
 
 DFM_BEGIN_NAMESPACE
 
@@ -44,6 +55,302 @@ static QString preprocessPath(const QString &path, DStorageInfo::PathHints hints
     return path;
 }
 
+/*!
+ * \brief 进程级挂载表缓存
+
+ * 解析 /proc/self/mountinfo 并按设备号(st_dev)索引挂载项，供 isLocalDevice 等静态接口
+ * 查询，避免每次构造 DStorageInfo 重新解析挂载表。内核在挂载表变化时会在 mountinfo 的
+ * 文件描述符上报告 POLLPRI|POLLERR，由一个监视线程阻塞 poll 等待，变化时标记缓存失效，
+ * 查询本身不再 poll；udisks/gvfs 的挂载信号也会通过 invalidate() 使缓存失效。
+ *
+ * 查询时只持有读锁在当前挂载表中查找，多个目录加载线程和拷贝线程可以同时查询；
+ * 缓存失效后由下一次查询在锁外重新解析，解析完成后才短暂持有写锁替换挂载表。
+ */
+class MountTableCache
+{
+public:
+    struct MountEntry
+    {
+        QString mountPoint;
+        QByteArray source;
+        QByteArray fsType;
+    };
+
+    // 挂载表, 解析完成后在写锁内整体替换
+    struct Snapshot
+    {
+        QMultiHash<dev_t, MountEntry> entries;
+        // 只有一个挂载源的设备(绝大多数情况)直接由设备号得到挂载源, 无需再比较路径
+        QHash<dev_t, QByteArray> uniqueSources;
+    };
+
+    MountTableCache()
+    {
+        fd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0)
+            return;
+
+        // 监视线程通过此管道得知缓存即将析构
+        if (::pipe2(wakeFds, O_CLOEXEC) != 0) {
+            ::close(fd);
+            fd = -1;
+            return;
+        }
+
+        watcher = std::thread([this] {
+            watch();
+        });
+    }
+
+    ~MountTableCache()
+    {
+        if (watcher.joinable()) {
+            ssize_t ret = -1;
+
+            do {
+                ret = ::write(wakeFds[1], "", 1);
+            } while (ret < 0 && errno == EINTR);
+
+            watcher.join();
+        }
+
+        for (int wakeFd : wakeFds) {
+            if (wakeFd >= 0)
+                ::close(wakeFd);
+        }
+
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    void invalidate()
+    {
+        dirty.storeRelease(1);
+    }
+
+    // 查找设备号对应的挂载源, 同一设备有多个挂载点(bind mount)且挂载源不同时取与路径前缀最长匹配的一项
+    bool findSource(dev_t dev, const QString &path, QByteArray *source)
+    {
+        if (fd < 0)
+            return false;
+
+        if (dirty.loadAcquire())
+            reload();
+
+        QReadLocker lk(&lock);
+
+        auto iter = current.uniqueSources.constFind(dev);
+
+        if (iter != current.uniqueSources.constEnd()) {
+            *source = iter.value();
+            return true;
+        }
+
+        const QList<MountEntry> &list = current.entries.values(dev);
+
+        if (list.isEmpty())
+            return false;
+
+        const QString &absolutePath = QFileInfo(path).absoluteFilePath();
+        int matchLength = -1;
+
+        *source = list.first().source;
+
+        for (const MountEntry &e : list) {
+            if (e.mountPoint.length() > matchLength && isPrefixOf(e.mountPoint, absolutePath)) {
+                matchLength = e.mountPoint.length();
+                *source = e.source;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    static bool isPrefixOf(const QString &mountPoint, const QString &path)
+    {
+        if (mountPoint == QStringLiteral("/"))
+            return path.startsWith('/');
+
+        return path.startsWith(mountPoint)
+               && (path.length() == mountPoint.length() || path.at(mountPoint.length()) == '/');
+    }
+
+    // 挂载点中的空格等字符在 mountinfo 中以 \040 形式转义
+    static QByteArray unescape(const QByteArray &field)
+    {
+        if (!field.contains('\\'))
+            return field;
+
+        QByteArray result;
+        result.reserve(field.size());
+
+        for (int i = 0; i < field.size(); ++i) {
+            if (field.at(i) == '\\' && i + 3 < field.size()) {
+                bool ok = false;
+                char c = static_cast<char>(field.mid(i + 1, 3).toInt(&ok, 8));
+
+                if (ok) {
+                    result.append(c);
+                    i += 3;
+                    continue;
+                }
+            }
+
+            result.append(field.at(i));
+        }
+
+        return result;
+    }
+
+    // 在监视线程中运行, 每次 poll 返回都会消费掉一次挂载表变化的事件
+    void watch()
+    {
+        struct pollfd pfds[2];
+        pfds[0].fd = fd;
+        pfds[0].events = POLLPRI;
+        pfds[1].fd = wakeFds[0];
+        pfds[1].events = POLLIN;
+
+        for (;;) {
+            pfds[0].revents = 0;
+            pfds[1].revents = 0;
+
+            int ret = ::poll(pfds, 2, -1);
+
+            if (ret < 0 && errno == EINTR)
+                continue;
+
+            if (ret < 0 || pfds[1].revents)
+                break;
+
+            if (pfds[0].revents & (POLLPRI | POLLERR))
+                invalidate();
+        }
+    }
+
+    void reload()
+    {
+        QMutexLocker lk(&reloadMutex);
+
+        // 可能已经被其它线程重新解析过了; 解析期间发生的变化会再次标记失效, 由之后的查询重新解析
+        if (!dirty.fetchAndStoreOrdered(0))
+            return;
+
+        QByteArray content;
+        char buffer[4096];
+
+        if (::lseek(fd, 0, SEEK_SET) < 0) {
+            dirty.storeRelease(1);
+            return;
+        }
+
+        for (;;) {
+            ssize_t size = ::read(fd, buffer, sizeof(buffer));
+
+            if (size < 0 && errno == EINTR)
+                continue;
+
+            if (size <= 0)
+                break;
+
+            content.append(buffer, static_cast<int>(size));
+        }
+
+        Snapshot snapshot;
+        QSet<dev_t> ambiguousDevices;
+
+        // 格式: id parent major:minor root mountpoint options [optional...] - fstype source superoptions
+        for (const QByteArray &line : content.split('\n')) {
+            const QList<QByteArray> &fields = line.split(' ');
+            int separator = fields.indexOf("-", 6);
+
+            if (fields.size() < 6 || separator < 0 || separator + 2 >= fields.size())
+                continue;
+
+            const QList<QByteArray> &devNumber = fields.at(2).split(':');
+
+            if (devNumber.size() != 2)
+                continue;
+
+            MountEntry entry;
+            entry.mountPoint = QFile::decodeName(unescape(fields.at(4)));
+            entry.fsType = fields.at(separator + 1);
+            entry.source = unescape(fields.at(separator + 2));
+
+            dev_t dev = makedev(devNumber.first().toUInt(), devNumber.last().toUInt());
+            auto iter = snapshot.uniqueSources.find(dev);
+
+            if (iter != snapshot.uniqueSources.end()) {
+                if (iter.value() != entry.source) {
+                    snapshot.uniqueSources.erase(iter);
+                    ambiguousDevices.insert(dev);
+                }
+            } else if (!ambiguousDevices.contains(dev)) {
+                snapshot.uniqueSources.insert(dev, entry.source);
+            }
+
+            snapshot.entries.insert(dev, entry);
+        }
+
+        // 只在替换时持有写锁, 旧的挂载表在锁外释放
+        QWriteLocker writeLocker(&lock);
+        std::swap(current, snapshot);
+        writeLocker.unlock();
+    }
+
+    int fd = -1;
+    int wakeFds[2] = { -1, -1 };
+    QAtomicInt dirty { 1 };
+    // current 只在持有 lock 时访问
+    QReadWriteLock lock;
+    Snapshot current;
+    // 保证同一时间只有一个线程重新解析
+    QMutex reloadMutex;
+    std::thread watcher;
+};
+
+Q_GLOBAL_STATIC(MountTableCache, mountTableCache)
+
+/*!
+ * \brief 通过挂载表缓存获取路径所在的设备, 与 DStorageInfo(path).device() 结果一致
+ * \param path 文件路径, 符号链接取其所在目录的设备(同 PathHint::NoHint)
+ * \param device 输出设备名, 路径不存在时为空
+ * \return 缓存无法确定时(如 gvfs 挂载需要通过 gio 查询)返回 false
+ */
+static bool deviceFromMountTable(const QString &path, QByteArray *device)
+{
+    struct stat st;
+
+    if (::lstat(QFile::encodeName(path).constData(), &st) != 0) {
+        device->clear();
+        return true;
+    }
+
+    QByteArray source;
+
+    if (!mountTableCache->findSource(st.st_dev, path, &source))
+        return false;
+
+    if (source == QByteArrayLiteral("gvfsd-fuse"))
+        return false;
+
+    *device = source;
+
+    return true;
+}
+
+static QByteArray deviceOfPath(const QString &path)
+{
+    QByteArray device;
+
+    if (!deviceFromMountTable(path, &device))
+        device = DStorageInfo(path).device();
+
+    return device;
+}
+
 class DStorageInfoPrivate : public QSharedData
 {
 public:
@@ -331,7 +638,7 @@ bool DStorageInfo::isLocalDevice(const QString &path, const bool &isEx)
         return true;
     }
 
-    QString device = DStorageInfo(path).device();
+    QString device = deviceOfPath(path);
     if (isEx && device.isEmpty()) {
         return true;
     }
@@ -363,12 +670,23 @@ bool DStorageInfo::isLowSpeedDevice(const QString &path)
                                     QString(FTP_SCHEME));
     }
 
-    return DStorageInfo(path).isLowSpeedDevice();
+    const QString &device = deviceOfPath(path);
+
+    return device.startsWith("mtp://")
+            || device.startsWith("gphoto://")
+            || device.startsWith("gphoto2://")
+            || device.startsWith("smb-share://")
+            || device.startsWith("smb://");
 }
 
 bool DStorageInfo::isCdRomDevice(const QString &path)
 {
-    return DStorageInfo(path).device().startsWith("/dev/sr");
+    return deviceOfPath(path).startsWith("/dev/sr");
+}
+
+void DStorageInfo::invalidateMountTableCache()
+{
+    mountTableCache->invalidate();
 }
 
 bool DStorageInfo::isSameFile(const QString &filePath1, const QString &filePath2)
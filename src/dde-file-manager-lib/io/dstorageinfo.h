@@ -78,6 +78,7 @@ public:
     static bool isLocalDevice(const QString &path,const bool &isEx = false);
     static bool isLowSpeedDevice(const QString &path);
     static bool isCdRomDevice(const QString &path);
+    static void invalidateMountTableCache();     //udisks/gvfs 挂载变化时使挂载表缓存失效
     static bool isSameFile(const QString &filePath1, const QString &filePath2);     //通过文件(文件夹)的inode，判断是否是同一个文件(文件夹)
 
 private:
@@ -4,6 +4,9 @@ HEADERS += \
     $$PWD/dlocalfiledevice.h \
     $$PWD/dfileiodeviceproxy.h \
     $$PWD/dfilecopymovejob.h \
+    $$PWD/dfilecopybufferpool.h \
+    $$PWD/dfilecopypipeline.h \
+    $$PWD/dfilewritebackcontroller.h \
     $$PWD/dfilehandler.h \
     $$PWD/dfiledevice.h \
     $$PWD/dlocalfilehandler.h \
@@ -15,6 +18,9 @@ SOURCES += \
     $$PWD/dlocalfiledevice.cpp \
     $$PWD/dfileiodeviceproxy.cpp \
     $$PWD/dfilecopymovejob.cpp \
+    $$PWD/dfilecopybufferpool.cpp \
+    $$PWD/dfilecopypipeline.cpp \
+    $$PWD/dfilewritebackcontroller.cpp \
     $$PWD/dfilehandler.cpp \
     $$PWD/dfiledevice.cpp \
     $$PWD/dlocalfilehandler.cpp \
@@ -22,4 +28,10 @@ SOURCES += \
     $$PWD/dstorageinfo.cpp \
     $$PWD/dgiofiledevice.cpp
 
+# 有liburing时大文件拷贝使用io_uring，否则使用读写线程
+packagesExist(liburing) {
+    PKGCONFIG += liburing
+    DEFINES += DFM_ENABLE_IO_URING
+}
+
 include(private/private.pri)
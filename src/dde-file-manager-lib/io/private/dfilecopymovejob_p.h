@@ -40,6 +40,7 @@
 #include <fcntl.h>
 
 #include "dfiledevice.h"
+#include "dfilewritebackcontroller.h"
 
 typedef QExplicitlySharedDataPointer<DAbstractFileInfo> DAbstractFileInfoPointer;
 
@@ -122,19 +123,32 @@ public:
 
     typedef QSharedPointer<FileCopyInfo> FileCopyInfoPointer;
 
+    // 拷贝时源和目标所在设备的类型，用于决定并行遍历目录和并行拷贝小文件的线程数量
+    // 只有源文件在本机磁盘上时才会优化拷贝，U盘、网络文件等不能并行寻道的设备都按机械硬盘处理
+    enum CopyDeviceType {
+        SsdDevice,
+        HddDevice
+    };
+
+    // 内核直接拷贝文件数据（reflink、copy_file_range、sendfile）的结果
+    enum KernelCopyResult {
+        KernelCopyFinished, // 全部数据已拷贝完成
+        KernelCopyFallback, // 内核不支持或者中途出错，需要从已拷贝的位置回退到用户态读写
+        KernelCopyCanceled // 任务已停止
+    };
+
     explicit DFileCopyMoveJobPrivate(DFileCopyMoveJob *qq);
     ~DFileCopyMoveJobPrivate();
 
     static QString errorToString(DFileCopyMoveJob::Error error);
-    // 返回当前线程已经往block设备写入的数据，返回的是本次和上次间隔时间内写入的大小
-    static qint64 getWriteBytes(long tid);
-    qint64 getWriteBytes() const;
     // 返回当前目标设备已写入扇区总数
     // /sys/dev/block/[x:x]/stat 的第7个字段
     // https://www.kernel.org/doc/Documentation/iostats.txt
     qint64 getSectorsWritten() const;
-    // 返回已写入数据大小，根据多种情况，用不同的方式获取此数据
+    // 返回已写入数据大小，拷贝时由读写线程累加，最后同步数据阶段取设备实际写入的大小
     qint64 getCompletedDataSize() const;
+    // 等待可移除设备把已写入的数据同步到磁盘
+    void waitForTargetDeviceSync();
 
     void setState(DFileCopyMoveJob::State s);
     void setError(DFileCopyMoveJob::Error e, const QString &es = QString());
@@ -142,6 +156,9 @@ public:
     DFileCopyMoveJob::Action handleError(const DAbstractFileInfoPointer sourceInfo, const DAbstractFileInfoPointer targetInfo);
     DFileCopyMoveJob::Action setAndhandleError(DFileCopyMoveJob::Error e, const DAbstractFileInfoPointer sourceInfo,
                                                const DAbstractFileInfoPointer targetInfo, const QString &es = QString());
+    // 慢速设备上同步数据失败时报告错误，重试成功时返回NoAction，否则返回SkipAction或者CancelAction
+    DFileCopyMoveJob::Action handleWritebackError(DFileWriteback *writeback, const DAbstractFileInfoPointer &fromInfo,
+                                                  const DAbstractFileInfoPointer &toInfo);
 
     bool isRunning(); // bug 26333, add state function to check the job status
     bool jobWait();
@@ -162,6 +179,12 @@ public:
     bool doThreadPoolCopyFile();
     //拷贝文件到块设备（除光驱和系统所在的磁盘）
     bool doCopyFileOnBlock(const DAbstractFileInfoPointer fromInfo, const DAbstractFileInfoPointer toInfo, const QSharedPointer<DFileHandler> &handler, int blockSize = 1048576);
+    //由内核完成两个本地文件之间的数据拷贝，copiedSize返回已拷贝的数据大小
+    KernelCopyResult doCopyFileByKernel(int fromFd, int toFd, qint64 fileSize, qint64 &copiedSize, DFileWriteback *writeback = nullptr);
+    //只拷贝稀疏文件中的数据段，目标文件保留源文件的空洞，copiedSize返回已拷贝（包括跳过的空洞）的数据大小
+    KernelCopyResult doCopySparseFile(int fromFd, int toFd, qint64 fileSize, qint64 &copiedSize, DFileWriteback *writeback = nullptr);
+    //在目标文件中拷贝完一段数据后计入进度
+    void countKernelCopiedSize(qint64 size, bool written = true);
     bool doRemoveFile(const QSharedPointer<DFileHandler> &handler, const DAbstractFileInfoPointer fileInfo,
                       const DAbstractFileInfoPointer &toInfo = DAbstractFileInfoPointer(nullptr));
     bool doRenameFile(const QSharedPointer<DFileHandler> &handler, const DAbstractFileInfoPointer oldInfo, const DAbstractFileInfoPointer newInfo);
@@ -200,8 +223,14 @@ public:
     void cancelReadFileDealWriteThread();
     void setRefineCopyProccessSate(const DFileCopyMoveJob::RefineCopyProccessSate &stat);
     bool checkRefineCopyProccessSate(const DFileCopyMoveJob::RefineCopyProccessSate &stat);
-    void checkTagetNeedSync();//检测目标目录是网络文件就每次拷贝去同步，否则网络很卡时会因为同步卡死
-    void checkTagetIsFromBlockDevice();//检查目标文件是否是块设备
+    void checkTagetNeedSync();//检测目标目录是网络文件或者U盘就控制写入数据的回写，否则网络很卡时会因为同步卡死
+    void checkTagetIsFromBlockDevice();//检查目标文件是否是块设备，并记录目标设备的类型
+    static CopyDeviceType copyDeviceType(const QString &path);
+    static int copyThreadCountOfDevice(CopyDeviceType type);
+    void initSmallFileCopyThreadCount();//按源和目标设备的类型设置并行遍历目录和并行拷贝小文件的线程数量
+    void waitForThreadInfoQueue();//等待小文件拷贝队列有空位，避免遍历目录远远超前于拷贝
+    void prefetchDirEntries(const DUrl &url, bool sortInode);//在线程池中预读子目录的文件列表
+    bool takeDirEntries(const DUrl &url, QList<DAbstractFileInfoPointer> &entries);//取出预读的文件列表
     bool checkWritQueueEmpty();
     bool checkWritQueueCount();
     QSharedPointer<FileCopyInfo> writeQueueDequeue();
@@ -212,6 +241,9 @@ public:
     void errorQueueHandled(const bool &isNotCancel = true);
     //清理当前拷贝信息
     void releaseCopyInfo(const FileCopyInfoPointer &info);
+    //拷贝完成后设置目标文件的时间和权限
+    void setTargetFileAttributes(const QSharedPointer<DFileHandler> &handler, const DAbstractFileInfoPointer &fromInfo,
+                                 const DAbstractFileInfoPointer &toInfo);
     /**
      * @brief setCutTrashData    保存剪切回收站文件路径
      * @param fileNameList       文件路径
@@ -285,14 +317,14 @@ public:
     QFuture<void> m_writeResult, m_syncResult;
 
 
-    // 是否可以使用 /pric/[pid]/task/[tid]/io 文件中的的 writeBytes 字段的值作为判断已写入数据的依据
-    qint8 canUseWriteBytes : 1;
     // 目标磁盘设备是不是可移除或者热插拔设备
     qint8 targetIsRemovable : 1;
     // 逻辑扇区大小
     qint16 targetLogSecionSize = 512;
     // 记录任务开始时目标磁盘设备已写入扇区数
     qint64 targetDeviceStartSectorsWritten;
+    // 等待目标设备同步数据时，扇区计数停止增长多久后不再等待(毫秒)
+    qint64 syncStallTimeout = 10000;
     // /sys/dev/block/x:x
     QString targetSysDevPath;
     // 目标设备所挂载的根目录
@@ -308,21 +340,24 @@ public:
     QList<QPair<DUrl, DUrl>> completedDirectoryList;
     int completedFilesCount = 0;
     int totalMoveFilesCount = 1;
-    qint64 completedDataSize = 0;
+    // 已写入的数据大小，由各个读写线程无锁累加
+    QAtomicInteger<qint64> completedDataSize = 0;
     qint64 completedProgressDataSize = 0;
     //跳过文件大小统计
     qint64 skipFileSize = 0;
     // 已经写入到block设备的总大小
-    qint64 completedDataSizeOnBlockDevice = 0;
+    QAtomicInteger<qint64> completedDataSizeOnBlockDevice = 0;
+    // 计入进度但不会在目标设备上产生扇区写入的大小(跳过的空洞、reflink共享的数据块)
+    QAtomicInteger<qint64> completedDataSizeWithoutWrite = 0;
     QPair<qint64 /*total*/, qint64 /*writed*/> currentJobDataSizeInfo;
     int currentJobFileHandle = -1;
+    // 拷贝完成后正在等待目标设备同步数据，此时已写入数据大小从 sysfs 中读取
+    QAtomicInteger<bool> m_isSyncingTargetDevice = false;
     ElapsedTimer *updateSpeedElapsedTimer = nullptr;
     QTimer *updateSpeedTimer = nullptr;
     int timeOutCount = 0;
     QAtomicInteger<bool> needUpdateProgress = false;
     QAtomicInteger<bool> countStatisticsFinished = false;
-    // 线程id
-    long tid = -1;
 
     qreal lastProgress = 0.01; // 上次刷新的进度
 
@@ -334,12 +369,11 @@ public:
     //优化盘内拷贝，启用的线程池
     QThreadPool m_pool;
     QAtomicInteger<bool> m_bDestLocal = false;
-    qint64 m_refineCopySize = 0;
-    QMutex m_refineMutex;
+    QAtomicInteger<qint64> m_refineCopySize = 0;
     //是否需要显示进度条
     QAtomicInteger<bool> m_isNeedShowProgress = false;
-    //是否需要每读写一次同步
-    bool m_isEveryReadAndWritesSnc = false;
+    //目标是慢速设备(vfat、cifs、gvfs)时按区间回写并定期同步，记录已落盘的数据大小
+    DFileWritebackController m_writeback;
     QAtomicInteger<bool> m_isVfat = false;
     QAtomicInt m_openFlag = O_CREAT | O_WRONLY | O_TRUNC;
     //分断拷贝的线程数量
@@ -347,6 +381,8 @@ public:
     QAtomicInteger<bool> m_isWriteThreadStart = false;
     //目标目录是否是来自块设备
     QAtomicInteger<bool> m_isTagFromBlockDevice = false;
+    //目标目录所在设备的类型
+    CopyDeviceType m_targetDeviceType = SsdDevice;
     //读线程跳过的文件
     QQueue<DUrl> m_skipFileQueue;
     //目标文件是否是gvfs目录
@@ -377,11 +413,19 @@ public:
     QMutex m_clearThreadPoolMutex;
     QQueue<QSharedPointer<ThreadCopyInfo>> m_threadInfos;
     QMutex m_threadMutex;
+    //小文件拷贝队列有空位时唤醒遍历线程
+    QWaitCondition m_threadInfoCondition;
+    //并行读取子目录文件列表的线程池，目录的创建仍在遍历线程中按顺序进行
+    QThreadPool m_traversalPool;
+    //预读的子目录文件列表，只在遍历线程中访问
+    QHash<DUrl, QFuture<QList<DAbstractFileInfoPointer>>> m_dirEntriesFutures;
     QList<QPair<DUrl,DUrl>> m_emitUrl;
     QMutex m_emitUrlMutex;
 
     //打开写入文件的fd
     QMap<DUrl,int> m_writeOpenFd;
+    //写入文件的回写状态
+    QMap<DUrl,QSharedPointer<DFileWriteback>> m_writeWritebacks;
     QList<QSharedPointer<DirSetPermissonInfo>> m_dirPermissonList;
 
     qint64 m_gvfsFileInnvliadProgress = 0;
@@ -51,6 +51,17 @@ RecentFileInfo::RecentFileInfo(const DUrl &url)
     checkMountFile();
 }
 
+RecentFileInfo::RecentFileInfo(const DUrl &url, const QString &readDateTime)
+    : DAbstractFileInfo(url)
+{
+    QMutexLocker lk(&m_mutex);
+    if (url.path() != "/") {
+        setProxy(DFileService::instance()->createFileInfo(nullptr, DUrl::fromLocalFile(url.path())));
+    }
+    setReadDateTime(readDateTime);
+    checkMountFile();
+}
+
 RecentFileInfo::~RecentFileInfo()
 {
     QMutexLocker lk(&m_mutex);
@@ -34,6 +34,8 @@ class RecentFileInfo : public DAbstractFileInfo
 {
 public:
     explicit RecentFileInfo(const DUrl &url);
+    // 访问时间已知时(如解析recently-used.xbel时)使用，不再重新读取xbel文件
+    RecentFileInfo(const DUrl &url, const QString &readDateTime);
     ~RecentFileInfo() override;
 
     bool makeAbsolute() override;
@@ -36,9 +36,9 @@
 #include "fileoperations/filejob.h"
 #include "dialogs/dialogmanager.h"
 #include "desktopfileinfo.h"
+#include "shutil/dfmtrashinfoindex.h"
 
 #include <QMimeType>
-#include <QSettings>
 #include <QIcon>
 
 namespace FileSortFunction {
@@ -53,29 +53,21 @@ void TrashFileInfoPrivate::updateInfo()
     const QString &basePath = DFMStandardPaths::location(DFMStandardPaths::TrashFilesPath);
     const QString &fileBaseName = filePath.mid(basePath.size());
 
-    QString location(DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath) + fileBaseName + ".trashinfo");
-    if (QFile::exists(location)) {
-        QSettings setting(location, QSettings::NativeFormat);
-
-        setting.beginGroup("Trash Info");
-        setting.setIniCodec("utf-8");
-
-        originalFilePath = QByteArray::fromPercentEncoding(setting.value("Path").toByteArray()) + filePath.mid(basePath.size() + fileBaseName.size());
+    DFMTrashInfoIndex::Entry entry;
+    // 只有回收站第一层的文件才有对应的 .trashinfo 文件
+    if (fileBaseName.lastIndexOf('/') == 0 && DFMTrashInfoIndex::instance()->entry(fileBaseName.mid(1), &entry)) {
+        originalFilePath = entry.originalFilePath;
 
         displayName = originalFilePath.mid(originalFilePath.lastIndexOf('/') + 1);
 
-        deletionDate = QDateTime::fromString(setting.value("DeletionDate").toString(), Qt::ISODate);
+        deletionDate = entry.deletionDate;
         displayDeletionDate = deletionDate.toString(DAbstractFileInfo::dateTimeFormat());
 
         if (displayDeletionDate.isEmpty()) {
-            displayDeletionDate = setting.value("DeletionDate").toString();
+            displayDeletionDate = entry.deletionDateString;
         }
 
-        const QString &tag_name_list = setting.value("TagNameList").toString();
-
-        if (!tag_name_list.isEmpty()) {
-            tagNameList = tag_name_list.split(",");
-        }
+        tagNameList = entry.tagNameList;
     } else {
         //inherits from parent trash info
         inheritParentTrashInfo();
@@ -107,19 +99,15 @@ void TrashFileInfoPrivate::inheritParentTrashInfo()
         restPath += "/" + str;
     }
 
-    if (QFile::exists(DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath) + QDir::separator() + name + ".trashinfo")) {
-        QSettings setting(DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath) + QDir::separator() + name + ".trashinfo", QSettings::NativeFormat);
-
-        setting.beginGroup("Trash Info");
-        setting.setIniCodec("utf-8");
-
-        originalFilePath = QByteArray::fromPercentEncoding(setting.value("Path").toByteArray()) + restPath;
+    DFMTrashInfoIndex::Entry entry;
+    if (DFMTrashInfoIndex::instance()->entry(name, &entry)) {
+        originalFilePath = entry.originalFilePath + restPath;
 
-        deletionDate = QDateTime::fromString(setting.value("DeletionDate").toString(), Qt::ISODate);
+        deletionDate = entry.deletionDate;
         displayDeletionDate = deletionDate.toString(DAbstractFileInfo::dateTimeFormat());
 
         if (displayDeletionDate.isEmpty()) {
-            displayDeletionDate = setting.value("DeletionDate").toString();
+            displayDeletionDate = entry.deletionDateString;
         }
     }
 }
@@ -76,7 +76,10 @@ void DFSearch::searchByKeyWord(const QString &key, void (*callback)(void *, void
     if (app->search == nullptr) return;
 
     QByteArray pathBytes(pathForSearching.toLocal8Bit());
-    load_database(app, pathBytes.data(), &state);//加载数据库
+    // 优先加载上次保存的索引快照，并在搜索前按目录修改时间增量刷新，不再每次搜索都遍历整个目录
+    if (!load_database_from_snapshot(app, pathBytes.data(), &state) && state) {
+        load_database(app, pathBytes.data(), &state);//加载数据库
+    }
     if (!state)
         return;
 
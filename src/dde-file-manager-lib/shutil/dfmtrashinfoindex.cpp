@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dfmtrashinfoindex.h"
+#include "interfaces/dfmstandardpaths.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+static const QString kTrashInfoSuffix = QStringLiteral(".trashinfo");
+
+DFMTrashInfoIndex *DFMTrashInfoIndex::instance()
+{
+    static DFMTrashInfoIndex index;
+
+    return &index;
+}
+
+bool DFMTrashInfoIndex::entry(const QString &name, Entry *entry)
+{
+    if (name.isEmpty())
+        return false;
+
+    ensureBuilt();
+
+    {
+        QReadLocker locker(&m_lock);
+        auto iter = m_entries.constFind(name);
+
+        if (iter != m_entries.constEnd()) {
+            *entry = iter.value();
+            return true;
+        }
+    }
+
+    // 文件监视的事件还没有到达(如刚移入回收站)，直接读取并补充到索引中
+    Entry newEntry;
+
+    if (!readTrashInfo(DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath) + "/" + name + kTrashInfoSuffix, &newEntry))
+        return false;
+
+    QWriteLocker locker(&m_lock);
+    m_entries.insert(name, newEntry);
+    *entry = newEntry;
+
+    return true;
+}
+
+QStringList DFMTrashInfoIndex::names()
+{
+    ensureBuilt();
+
+    QReadLocker locker(&m_lock);
+
+    return m_entries.keys();
+}
+
+void DFMTrashInfoIndex::update(const QString &infoFilePath)
+{
+    const QString &infosPath = DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath);
+
+    // info 目录本身被删除(如清空回收站)
+    if (QDir::cleanPath(infoFilePath) == QDir::cleanPath(infosPath)) {
+        clear();
+        return;
+    }
+
+    if (!infoFilePath.endsWith(kTrashInfoSuffix))
+        return;
+
+    const QString &fileName = infoFilePath.mid(infoFilePath.lastIndexOf('/') + 1);
+    const QString &name = fileName.left(fileName.length() - kTrashInfoSuffix.length());
+    Entry newEntry;
+    bool ok = readTrashInfo(infoFilePath, &newEntry);
+
+    QWriteLocker locker(&m_lock);
+
+    if (ok) {
+        m_entries.insert(name, newEntry);
+    } else {
+        m_entries.remove(name);
+    }
+}
+
+void DFMTrashInfoIndex::clear()
+{
+    QWriteLocker locker(&m_lock);
+
+    m_entries.clear();
+    m_built = false;
+}
+
+bool DFMTrashInfoIndex::parseTrashInfo(const QByteArray &data, Entry *entry)
+{
+    bool inTrashInfoGroup = false;
+    bool found = false;
+
+    for (const QByteArray &rawLine : data.split('\n')) {
+        const QByteArray &line = rawLine.trimmed();
+
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        if (line.startsWith('[')) {
+            inTrashInfoGroup = (line == "[Trash Info]");
+            found = found || inTrashInfoGroup;
+            continue;
+        }
+
+        if (!inTrashInfoGroup)
+            continue;
+
+        int index = line.indexOf('=');
+
+        if (index <= 0)
+            continue;
+
+        const QByteArray &key = line.left(index).trimmed();
+        const QByteArray &value = line.mid(index + 1).trimmed();
+
+        if (key == "Path") {
+            entry->originalFilePath = QString::fromUtf8(QByteArray::fromPercentEncoding(value));
+        } else if (key == "DeletionDate") {
+            entry->deletionDateString = QString::fromUtf8(value);
+            entry->deletionDate = QDateTime::fromString(entry->deletionDateString, Qt::ISODate);
+        } else if (key == "TagNameList" && !value.isEmpty()) {
+            entry->tagNameList = QString::fromUtf8(value).split(",");
+        }
+    }
+
+    return found;
+}
+
+bool DFMTrashInfoIndex::readTrashInfo(const QString &infoFilePath, Entry *entry)
+{
+    QFile file(infoFilePath);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    return parseTrashInfo(file.readAll(), entry);
+}
+
+void DFMTrashInfoIndex::ensureBuilt()
+{
+    {
+        QReadLocker locker(&m_lock);
+
+        if (m_built)
+            return;
+    }
+
+    // 在锁外扫描 info 目录，同时进入的线程各自扫描一遍，结果相同
+    QHash<QString, Entry> entries;
+    QDirIterator iterator(DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath),
+                          QStringList() << "*" + kTrashInfoSuffix,
+                          QDir::Files | QDir::Hidden | QDir::System);
+
+    while (iterator.hasNext()) {
+        const QString &infoFilePath = iterator.next();
+        const QString &fileName = iterator.fileName();
+        Entry newEntry;
+
+        if (readTrashInfo(infoFilePath, &newEntry))
+            entries.insert(fileName.left(fileName.length() - kTrashInfoSuffix.length()), newEntry);
+    }
+
+    QWriteLocker locker(&m_lock);
+
+    if (m_built)
+        return;
+
+    // 扫描期间由文件监视写入的条目较新，以它们为准
+    for (auto iter = m_entries.constBegin(); iter != m_entries.constEnd(); ++iter)
+        entries.insert(iter.key(), iter.value());
+
+    m_entries = entries;
+    m_built = true;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QStringList>
+
+/**
+ * @brief DFMTrashInfoIndex 回收站 info 目录下所有 .trashinfo 文件的内存索引
+ * 第一次访问时扫描一遍 info 目录，之后由 TrashManager 根据 info 目录的文件监视更新，
+ * 避免每构造一个 TrashFileInfo 都要用 QSettings 打开解析一次 .trashinfo 文件
+ */
+class DFMTrashInfoIndex
+{
+public:
+    struct Entry {
+        QString originalFilePath;
+        QString deletionDateString;
+        QDateTime deletionDate;
+        QStringList tagNameList;
+    };
+
+    static DFMTrashInfoIndex *instance();
+
+    // name: 回收站 files 目录下第一层的文件名
+    bool entry(const QString &name, Entry *entry);
+    QStringList names();
+
+    // infoFilePath: 变化的 .trashinfo 文件路径，为 info 目录本身时清空索引
+    void update(const QString &infoFilePath);
+    void clear();
+
+    static bool parseTrashInfo(const QByteArray &data, Entry *entry);
+    static bool readTrashInfo(const QString &infoFilePath, Entry *entry);
+
+private:
+    DFMTrashInfoIndex() = default;
+
+    void ensureBuilt();
+
+    QReadWriteLock m_lock;
+    QHash<QString, Entry> m_entries;
+    bool m_built = false;
+};
@@ -140,6 +140,85 @@ static constexpr const char *const CONNECTIONNAME{ "deep" };
 static constexpr const char *const USERNAME{"username"};
 static constexpr const char *const PASSWORD{"password"};
 
+///###: statements for batch operations. values are bound to the placeholders of cached prepared statements,
+///###: a batch of files is staged in temp tables, then one set-based statement handles the whole batch.
+static constexpr const char *const JOURNALMODEWAL{ "PRAGMA journal_mode = WAL" };
+static constexpr const char *const SYNCHRONOUSNORMAL{ "PRAGMA synchronous = NORMAL" };
+static constexpr const char *const CREATEINDEXOFTAGWITHFILE{ "CREATE INDEX IF NOT EXISTS tag_with_file_file_name ON tag_with_file (file_name)" };
+static constexpr const char *const MAINDATABASENAME{ ".__main.db" };
+
+static constexpr const char *const CREATEBATCHFILES{ "CREATE TEMP TABLE IF NOT EXISTS batch_files (file_name TEXT NOT NULL PRIMARY KEY)" };
+static constexpr const char *const CLEARBATCHFILES{ "DELETE FROM temp.batch_files" };
+static constexpr const char *const INSERTBATCHFILES{ "INSERT OR IGNORE INTO temp.batch_files (file_name) VALUES (?)" };
+
+static constexpr const char *const CREATEBATCHPAIRS{
+    "CREATE TEMP TABLE IF NOT EXISTS batch_pairs (file_name TEXT NOT NULL, tag_name TEXT NOT NULL, "
+    "PRIMARY KEY (file_name, tag_name))"
+};
+static constexpr const char *const CLEARBATCHPAIRS{ "DELETE FROM temp.batch_pairs" };
+static constexpr const char *const INSERTBATCHPAIRS{ "INSERT OR IGNORE INTO temp.batch_pairs (file_name, tag_name) VALUES (?, ?)" };
+
+static constexpr const char *const CREATEBATCHRENAMES{
+    "CREATE TEMP TABLE IF NOT EXISTS batch_renames (old_name TEXT NOT NULL PRIMARY KEY, new_name TEXT NOT NULL)"
+};
+static constexpr const char *const CLEARBATCHRENAMES{ "DELETE FROM temp.batch_renames" };
+static constexpr const char *const INSERTBATCHRENAMES{ "INSERT OR REPLACE INTO temp.batch_renames (old_name, new_name) VALUES (?, ?)" };
+
+static constexpr const char *const TAGBATCHPAIRS{
+    "INSERT INTO tag_with_file (file_name, tag_name) SELECT p.file_name, p.tag_name FROM temp.batch_pairs AS p "
+    "WHERE NOT EXISTS (SELECT 1 FROM tag_with_file AS t WHERE t.file_name = p.file_name AND t.tag_name = p.tag_name)"
+};
+static constexpr const char *const UNTAGBATCHPAIRS{
+    "DELETE FROM tag_with_file WHERE EXISTS (SELECT 1 FROM temp.batch_pairs AS p "
+    "WHERE p.file_name = tag_with_file.file_name AND p.tag_name = tag_with_file.tag_name)"
+};
+static constexpr const char *const GETTAGSOFBATCHFILES{
+    "SELECT t.file_name, t.tag_name FROM tag_with_file AS t "
+    "INNER JOIN temp.batch_files AS b ON b.file_name = t.file_name ORDER BY t.rowid"
+};
+static constexpr const char *const GETTAGSOFFILESINRANGE{
+    "SELECT file_name, tag_name FROM tag_with_file WHERE file_name > ? AND file_name < ? ORDER BY rowid"
+};
+static constexpr const char *const GETTAGSOFALLFILES{ "SELECT file_name, tag_name FROM tag_with_file ORDER BY rowid" };
+static constexpr const char *const COUNTTAGSOFBATCHFILES{
+    "SELECT t.tag_name, COUNT(DISTINCT t.file_name) AS counter FROM tag_with_file AS t "
+    "INNER JOIN temp.batch_files AS b ON b.file_name = t.file_name GROUP BY t.tag_name"
+};
+static constexpr const char *const UPSERTFILEPROPERTY{
+    "INSERT INTO file_property (file_name, tag_1, tag_2, tag_3) VALUES (?, ?, ?, ?) "
+    "ON CONFLICT(file_name) DO UPDATE SET tag_1 = excluded.tag_1, tag_2 = excluded.tag_2, tag_3 = excluded.tag_3"
+};
+static constexpr const char *const DELETEUNTAGGEDFILEPROPERTY{
+    "DELETE FROM file_property WHERE file_name IN (SELECT file_name FROM temp.batch_files) "
+    "AND NOT EXISTS (SELECT 1 FROM tag_with_file AS t WHERE t.file_name = file_property.file_name)"
+};
+static constexpr const char *const DELETEBATCHFILESINFILEPROPERTY{
+    "DELETE FROM file_property WHERE file_name IN (SELECT file_name FROM temp.batch_files)"
+};
+static constexpr const char *const DELETEBATCHFILESINTAGWITHFILE{
+    "DELETE FROM tag_with_file WHERE file_name IN (SELECT file_name FROM temp.batch_files)"
+};
+///###: renamed rows of file_property are moved to a temporary BLOB key first. a BLOB never equals a TEXT name,
+///###: so chained or swapped renames (a->b, b->c / a->b, b->a) do not hit the UNIQUE constraint halfway.
+///###: BLOB values sort after all TEXT values, "file_name >= x''" selects only the temporary keys through the index.
+static constexpr const char *const MOVEBATCHRENAMESTOTEMPKEY{
+    "UPDATE file_property SET file_name = CAST(file_name AS BLOB) WHERE file_name IN (SELECT old_name FROM temp.batch_renames)"
+};
+///###: a rename whose new name is taken by a file outside the batch is skipped alone, not the whole batch.
+static constexpr const char *const RENAMEBATCHFILESINFILEPROPERTY{
+    "UPDATE OR IGNORE file_property SET file_name = (SELECT r.new_name FROM temp.batch_renames AS r "
+    "WHERE r.old_name = CAST(file_property.file_name AS TEXT)) WHERE file_name >= x''"
+};
+static constexpr const char *const RESTOREUNRENAMEDFILESINFILEPROPERTY{
+    "UPDATE OR IGNORE file_property SET file_name = CAST(file_name AS TEXT) WHERE file_name >= x''"
+};
+///###: the old name has been taken by another renamed file in the same batch meanwhile, only one row can keep it.
+static constexpr const char *const DELETEUNRESTOREDFILESINFILEPROPERTY{ "DELETE FROM file_property WHERE file_name >= x''" };
+static constexpr const char *const RENAMEBATCHFILESINTAGWITHFILE{
+    "UPDATE tag_with_file SET file_name = (SELECT r.new_name FROM temp.batch_renames AS r WHERE r.old_name = tag_with_file.file_name) "
+    "WHERE file_name IN (SELECT old_name FROM temp.batch_renames)"
+};
+
 
 static const std::map<QString, QString> StrTableOfEscapeChar{
     {"\\007", "\a"},
@@ -166,48 +245,6 @@ static const std::multimap<DSqliteHandle::SqlType, QString> SqlTypeWithStrs {
         "VALUES(\'%1\', \'%2\')"
     },
 
-    {
-        DSqliteHandle::SqlType::TagFiles, "SELECT COUNT (tag_with_file.file_name) AS counter "
-        "FROM tag_with_file WHERE tag_with_file.file_name = \'%1\' "
-        "AND tag_with_file.tag_name = \'%2\'"
-    },
-    {DSqliteHandle::SqlType::TagFiles, "INSERT INTO tag_with_file (file_name, tag_name) VALUES (\'%1\', \'%2\')"},
-    {
-        DSqliteHandle::SqlType::TagFiles, "DELETE FROM tag_with_file WHERE tag_with_file.tag_name = \'%1\' "
-        "AND tag_with_file.file_name = \'%2\'"
-    },
-    {DSqliteHandle::SqlType::TagFiles, "DELETE FROM file_property WHERE file_property.file_name = \'%1\'"},
-    {
-        DSqliteHandle::SqlType::TagFiles, "SELECT tag_with_file.tag_name FROM tag_with_file "
-        "WHERE tag_with_file.file_name = \'%1\'"
-    },
-    {
-        DSqliteHandle::SqlType::TagFiles, "UPDATE file_property SET tag_1 = \'%1\', tag_2 = \'%2\', tag_3 = \'%3\' "
-        "WHERE file_property.file_name = \'%4\'"
-    },
-    {
-        DSqliteHandle::SqlType::TagFiles, "SELECT COUNT (file_property.file_name) AS counter "
-        "FROM file_property WHERE file_property.file_name = \'%1\'"
-    },
-    {
-        DSqliteHandle::SqlType::TagFiles, "INSERT INTO file_property (file_name, tag_1, tag_2, tag_3) "
-        "VALUES(\'%1\', \'%2\', \'%3\', \'%4\')"
-    },
-
-    {
-        DSqliteHandle::SqlType::ChangeFilesName, "UPDATE file_property SET file_name = \'%1\' "
-        "WHERE file_property.file_name = \'%2\'"
-    },
-    {
-        DSqliteHandle::SqlType::ChangeFilesName, "UPDATE tag_with_file SET file_name = \'%1\' "
-        "WHERE tag_with_file.file_name = \'%2\'"
-    },
-
-    {
-        DSqliteHandle::SqlType::ChangeFilesName2, "SELECT tag_with_file.tag_name FROM tag_with_file "
-        "WHERE tag_with_file.file_name = \'%1\'"
-    },
-
     {
         DSqliteHandle::SqlType::ChangeTagsName, "UPDATE file_property SET tag_1 = \'%1\' "
         "WHERE file_property.tag_1 = \'%2\'"
@@ -229,14 +266,6 @@ static const std::multimap<DSqliteHandle::SqlType, QString> SqlTypeWithStrs {
         "WHERE tag_property.tag_name = \'%2\'"
     },
 
-    {DSqliteHandle::SqlType::DeleteFiles, "DELETE FROM tag_with_file WHERE tag_with_file.file_name = \'%1\'"},
-    {DSqliteHandle::SqlType::DeleteFiles, "DELETE FROM file_property WHERE file_property.file_name = \'%1\'"},
-
-    {
-        DSqliteHandle::SqlType::DeleteFiles2, "SELECT tag_with_file.tag_name FROM tag_with_file "
-        "WHERE tag_with_file.file_name = \'%1\'"
-    },
-
     {DSqliteHandle::SqlType::DeleteTags, "DELETE FROM tag_with_file WHERE tag_with_file.tag_name = \'%1\'"},
 
     {
@@ -256,25 +285,6 @@ static const std::multimap<DSqliteHandle::SqlType, QString> SqlTypeWithStrs {
         "WHERE tag_with_file.tag_name = \'%1\'"
     },
 
-    {
-        DSqliteHandle::SqlType::UntagSamePartionFiles, "DELETE FROM tag_with_file WHERE tag_with_file.file_name = \'%1\' "
-        "AND tag_with_file.tag_name = \'%2\'"
-    },
-
-    {
-        DSqliteHandle::SqlType::UntagSamePartionFiles2, "SELECT COUNT(tag_with_file.tag_name) AS counter "
-        "FROM tag_with_file WHERE tag_with_file.file_name = \'%1\'"
-    },
-    {
-        DSqliteHandle::SqlType::UntagSamePartionFiles2, "SELECT tag_with_file.tag_name FROM tag_with_file "
-        "WHERE tag_with_file.file_name = \'%1\'"
-    },
-    {
-        DSqliteHandle::SqlType::UntagSamePartionFiles2, "UPDATE file_property SET tag_1 = \'%1\', tag_2 = \'%2\', tag_3 = \'%3' "
-        "WHERE file_property.file_name = \'%4\'"
-    },
-    {DSqliteHandle::SqlType::UntagSamePartionFiles2, "DELETE FROM file_property WHERE file_property.file_name = \'%1\'"},
-
     {
         DSqliteHandle::SqlType::UntagDiffPartionFiles, "DELETE FROM tag_with_file WHERE tag_with_file.file_name = \'%1\' "
         "AND tag_with_file.tag_name = \'%2\'"
@@ -659,6 +669,13 @@ QVariant DSqliteHandle::disposeClientData(const QMap<QString, QList<QString>> &f
 
             break;
         }
+        case 14: { ///###: get the tags of all the files in directories by one query of every directory.
+            std::lock_guard<std::mutex> raii_lock{ m_mutex };
+            QMap<QString, QVariant> file_and_tags{ this->execSqlstr<DSqliteHandle::SqlType::GetTagsOfFilesInDirectory, QMap<QString, QVariant>>(filesAndTags) };
+            var.setValue(file_and_tags);
+
+            break;
+        }
         default:
             break;
         }
@@ -692,6 +709,8 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
 {
     DSqliteHandle::ReturnCode code = this->checkDBFileExist(path, db_name);
     std::function<void()> initDatabasePtr{ [&]{
+            m_preparedQueries.clear();
+
             if (m_sqlDatabasePtr->isOpen())
             {
                 m_sqlDatabasePtr->close();
@@ -717,7 +736,7 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
     if (code == DSqliteHandle::ReturnCode::NoExist) {
         initDatabasePtr();
 
-        if (m_sqlDatabasePtr->open()) {
+        if (this->openSqlDatabase()) {
             if (m_sqlDatabasePtr->transaction()) {
                 QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
 
@@ -750,6 +769,10 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
                             qWarning() << sqlQuery.lastError().text();
                         }
 
+                        if (!sqlQuery.exec(CREATEINDEXOFTAGWITHFILE)) {
+                            qWarning() << sqlQuery.lastError().text();
+                        }
+
                     } else {
                         DSqliteHandle::ReturnCode return_code{ this->checkDBFileExist(path) };
 
@@ -762,6 +785,10 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
                             if (!sqlQuery.exec(createTagWithFile)) {
                                 qWarning() << sqlQuery.lastError().text();
                             }
+
+                            if (!sqlQuery.exec(CREATEINDEXOFTAGWITHFILE)) {
+                                qWarning() << sqlQuery.lastError().text();
+                            }
                         }
                     }
 
@@ -844,6 +871,21 @@ void DSqliteHandle::connectToSqlite(const QString &path, const QString &db_name)
 
     } else if (code == DSqliteHandle::ReturnCode::Exist) {
         initDatabasePtr();
+
+        ///###: partition databases created by older versions have no index of tag_with_file,
+        ///###: add it once per database instead of on every read or write.
+        const QString DBName{ path + QString{"/"} + db_name };
+
+        if (db_name != QString{ MAINDATABASENAME } && m_indexedDatabases.find(DBName) == m_indexedDatabases.end()
+                && this->openSqlDatabase()) {
+            QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+
+            if (sqlQuery.exec(CREATEINDEXOFTAGWITHFILE)) {
+                m_indexedDatabases.insert(DBName);
+            } else {
+                qWarning() << sqlQuery.lastError().text();
+            }
+        }
     }
 
     this->closeSqlDatabase();
@@ -888,303 +930,220 @@ void DSqliteHandle::connectToShareSqlite(const QString &path, const QString &db_
     }
 }
 
-///###:this is also a auxiliary function. do not need a mutex.
-template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles, QMap<QString,
-                                                                       QList<QString>>, bool>(const QMap<QString, QList<QString>> &forDecreasing, const QString &mountPoint)
+bool DSqliteHandle::openSqlDatabase()
 {
-    if (!forDecreasing.isEmpty() && !mountPoint.isEmpty()) {
-        QMap<QString, QList<QString>>::const_iterator cbeg{ forDecreasing.cbegin() };
-        QMap<QString, QList<QString>>::const_iterator cend{ forDecreasing.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr; ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+    m_preparedQueries.clear();
 
+    if (!m_sqlDatabasePtr || !m_sqlDatabasePtr->open()) {
+        return false;
+    }
 
-        for (; cbeg != cend; ++cbeg) {
+    QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+    const QFileInfo dbInfo{ m_sqlDatabasePtr->databaseName() };
 
-            for (const QString &tagName : cbeg.value()) {
-                QString sql{ itr->second.arg(tagName) };
-                sql = sql.arg(cbeg.key());
+    ///###: journal_mode is persistent in db file, synchronous is only for current connection.
+    ///###: only the local main database uses WAL, partition databases keep their journal mode.
+    if (dbInfo.fileName() == MAINDATABASENAME && dbInfo.absolutePath() == QString{ DATABASE_PATH }
+            && !sqlQuery.exec(JOURNALMODEWAL)) {
+        qWarning() << sqlQuery.lastError().text();
+    }
 
-                if (!m_flag.load(std::memory_order_acquire)) {
+    if (!sqlQuery.exec(SYNCHRONOUSNORMAL)) {
+        qWarning() << sqlQuery.lastError().text();
+    }
 
-                    ///###: delete redundant item in tag_with_file.
-                    if (!sqlQuery.exec(sql)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
+    return true;
+}
 
-                } else {
+bool DSqliteHandle::isDatabaseAvailable(const QString &mountPoint)
+{
+    if (!m_flag.load(std::memory_order_acquire)) {
+        return true;
+    }
 
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
+    return (this->checkDBFileExist(mountPoint) == DSqliteHandle::ReturnCode::Exist);
+}
 
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
+QSqlQuery *DSqliteHandle::preparedQuery(const QString &sql)
+{
+    std::unordered_map<QString, QSqlQuery>::iterator itr{ m_preparedQueries.find(sql) };
 
-                        if (!sqlQuery.exec(sql)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+    if (itr == m_preparedQueries.end()) {
+        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
 
-                    } else {
+        if (!sqlQuery.prepare(sql)) {
+            qWarning() << sqlQuery.lastError().text();
 
-                        return false;
-                    }
-                }
-            }
+            return nullptr;
         }
 
-        return true;
+        itr = m_preparedQueries.emplace(sql, sqlQuery).first;
     }
 
-    return false;
+    return &itr->second;
 }
 
-///###:this is also a auxiliary function. do not need a mutex.
-template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString, QList<QString>>, bool>(
-    const QMap<QString, QList<QString>> &forIncreasing, const QString &mountPoint)
+bool DSqliteHandle::execPreparedSql(const QString &sql, const QVariantList &values)
 {
-    if (!forIncreasing.isEmpty() && !mountPoint.isEmpty()) {
-        QMap<QString, QList<QString>>::const_iterator cbeg{ forIncreasing.cbegin() };
-        QMap<QString, QList<QString>>::const_iterator cend{ forIncreasing.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
+    QSqlQuery *sqlQuery{ this->preparedQuery(sql) };
 
-        for (; cbeg != cend; ++cbeg) {
-
-            for (const QString &tagName : cbeg.value()) {
-                QString sql{ itr->second.arg(cbeg.key()) };
-                sql = sql.arg(tagName);
-
-                if (!m_flag.load(std::memory_order_acquire)) {
+    if (!sqlQuery) {
+        return false;
+    }
 
-                    ///###: tag files
-                    if (!sqlQuery.exec(sql)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
+    for (int index = 0; index < values.size(); ++index) {
+        sqlQuery->bindValue(index, values.at(index));
+    }
 
-                } else {
+    if (!sqlQuery->exec()) {
+        qWarning() << sqlQuery->lastError().text();
 
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
+        return false;
+    }
 
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
+    return true;
+}
 
-                        if (!sqlQuery.exec(sql)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+bool DSqliteHandle::fillBatchFiles(const QList<QString> &files)
+{
+    if (!(this->execPreparedSql(CREATEBATCHFILES)
+            && this->execPreparedSql(CLEARBATCHFILES))) {
+        return false;
+    }
 
-                    } else {
+    for (const QString &file : files) {
 
-                        return false;
-                    }
-                }
-            }
+        if (!this->execPreparedSql(INSERTBATCHFILES, QVariantList{ file })) {
+            return false;
         }
-
-        return true;
     }
 
-    return false;
+    return true;
 }
 
-
-
-template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles3, QList<QString>, bool>(const QList<QString> &forUpdating,
-                                                                                         const QString &mountPoint)
+bool DSqliteHandle::fillBatchPairs(const QMap<QString, QList<QString>> &filesAndTags)
 {
-    if (!forUpdating.isEmpty() && !mountPoint.isEmpty()) {
-        QList<QString>::const_iterator cbeg{ forUpdating.cbegin() };
-        QList<QString>::const_iterator cend{ forUpdating.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> itrOfSqlForDeleting{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFiles) };
-        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itr{ itrOfSqlForDeleting.first };
-        ++itr; ++itr; ++itr; ++itr;
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
-        for (; cbeg != cend; ++cbeg) {
-            QString sqlForGettingTag{ itr->second.arg(*cbeg) };
-            std::vector<QString> leftTags{};
-
-            if (!m_flag.load(std::memory_order_acquire)) {
-
-                if (sqlQuery.exec(sqlForGettingTag)) {
-
-                    while (sqlQuery.next()) {
-                        QString tagName{ sqlQuery.value("tag_name").toString() };
-                        leftTags.push_back(tagName);
-                    }
-                }
-
-            } else {
-
-                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
+    if (!(this->execPreparedSql(CREATEBATCHPAIRS)
+            && this->execPreparedSql(CLEARBATCHPAIRS))) {
+        return false;
+    }
 
-                if (code == DSqliteHandle::ReturnCode::Exist) {
+    QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
+    QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
 
-                    if (sqlQuery.exec(sqlForGettingTag)) {
+    for (; cbeg != cend; ++cbeg) {
 
-                        while (sqlQuery.next()) {
-                            QString tagName{ sqlQuery.value("tag_name").toString() };
-                            leftTags.push_back(tagName);
-                        }
-                    }
+        for (const QString &tagName : cbeg.value()) {
 
-                } else {
-                    return false;
-                }
+            if (!this->execPreparedSql(INSERTBATCHPAIRS, QVariantList{ cbeg.key(), tagName })) {
+                return false;
             }
+        }
+    }
 
-            if (leftTags.empty()) {
-                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForDelRowInFileProperty{itr};
-                --itrForDelRowInFileProperty;
-                QString sqlForDelRowInFileProperty{ itrForDelRowInFileProperty->second.arg(*cbeg) };
-
-
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    if (!sqlQuery.exec(sqlForDelRowInFileProperty)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                } else {
-
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                        if (!sqlQuery.exec(sqlForDelRowInFileProperty)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
-
-                    } else {
-                        return false;
-                    }
-                }
-
-            } else {
-
-                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForCounterFileInFP{ itr };
-                ++itrForCounterFileInFP; ++itrForCounterFileInFP;
-                QString sqlOfCountingFileInFP{ itrForCounterFileInFP->second.arg(*cbeg) };
-
-                int cnter{ 0 };
-
-                if (!m_flag.load(std::memory_order_acquire)) {
-
-                    if (sqlQuery.exec(sqlOfCountingFileInFP)) {
-
-                        if (sqlQuery.next()) {
-                            cnter =  sqlQuery.value("counter").toInt();
-                        }
-                    }
-
-                } else {
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                    if (code == DSqliteHandle::ReturnCode::Exist) {
+    return true;
+}
 
-                        if (sqlQuery.exec(sqlOfCountingFileInFP)) {
-                            cnter = sqlQuery.value("counter").toInt();
-                        }
+bool DSqliteHandle::fillBatchRenames(const std::map<QString, QString> &oldAndNewNames)
+{
+    if (!(this->execPreparedSql(CREATEBATCHRENAMES)
+            && this->execPreparedSql(CLEARBATCHRENAMES))) {
+        return false;
+    }
 
-                    } else {
-                        return false;
-                    }
-                }
+    for (const std::pair<QString, QString> &oldAndNewName : oldAndNewNames) {
 
-                std::size_t size{ leftTags.size() };
+        if (!this->execPreparedSql(INSERTBATCHRENAMES, QVariantList{ oldAndNewName.first, oldAndNewName.second })) {
+            return false;
+        }
+    }
 
-                if (size < 3) {
-                    std::size_t differenceValue{ 3u - size };
+    return true;
+}
 
-                    for (std::size_t index = 0; index < differenceValue; ++index) {
-                        leftTags.push_back(QString{});
-                    }
-                }
+///###:this is also a auxiliary function. do not need a mutex.
+template<>
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles, QMap<QString,
+                                                                       QList<QString>>, bool>(const QMap<QString, QList<QString>> &forDecreasing, const QString &mountPoint)
+{
+    if (!forDecreasing.isEmpty() && !mountPoint.isEmpty()) {
 
+        if (!this->isDatabaseAvailable(mountPoint) || !this->fillBatchPairs(forDecreasing)) {
+            return false;
+        }
 
-                if (cnter > 0) {
-                    std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForUpdating{itr};
-                    ++itrForUpdating;
+        ///###: delete redundant item in tag_with_file.
+        return this->execPreparedSql(UNTAGBATCHPAIRS);
+    }
 
-                    std::size_t sizeOfTags{ leftTags.size() };
+    return false;
+}
 
-                    QString sqlForUpdatingFileProperty{itrForUpdating->second.arg(leftTags[sizeOfTags - 3])};
-                    sqlForUpdatingFileProperty = sqlForUpdatingFileProperty.arg(leftTags[sizeOfTags - 2]);
-                    sqlForUpdatingFileProperty = sqlForUpdatingFileProperty.arg(leftTags[sizeOfTags - 1]);
-                    sqlForUpdatingFileProperty = sqlForUpdatingFileProperty.arg(*cbeg);
+///###:this is also a auxiliary function. do not need a mutex.
+template<>
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString, QList<QString>>, bool>(
+    const QMap<QString, QList<QString>> &forIncreasing, const QString &mountPoint)
+{
+    if (!forIncreasing.isEmpty() && !mountPoint.isEmpty()) {
 
-                    if (!m_flag.load(std::memory_order_acquire)) {
+        if (!this->isDatabaseAvailable(mountPoint) || !this->fillBatchPairs(forIncreasing)) {
+            return false;
+        }
 
-                        if (!sqlQuery.exec(sqlForUpdatingFileProperty)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+        ///###: tag files, the file which has been tagged by the same tag is skipped.
+        return this->execPreparedSql(TAGBATCHPAIRS);
+    }
 
-                    } else {
+    return false;
+}
 
-                        DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
 
-                        if (code == DSqliteHandle::ReturnCode::Exist) {
 
-                            if (!sqlQuery.exec(sqlForUpdatingFileProperty)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
+template<>
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFiles3, QList<QString>, bool>(const QList<QString> &forUpdating,
+                                                                                         const QString &mountPoint)
+{
+    if (!forUpdating.isEmpty() && !mountPoint.isEmpty()) {
 
-                        } else {
-                            return false;
-                        }
+        if (!this->isDatabaseAvailable(mountPoint) || !this->fillBatchFiles(forUpdating)) {
+            return false;
+        }
 
-                    }
+        QSqlQuery *sqlQuery{ this->preparedQuery(GETTAGSOFBATCHFILES) };
 
-                } else {
+        if (!sqlQuery || !sqlQuery->exec()) {
+            return false;
+        }
 
-                    std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForInsertRowInFP{ itr };
-                    ++itrForInsertRowInFP;
-                    ++itrForInsertRowInFP;
-                    ++itrForInsertRowInFP;
-                    std::size_t sizeOfTags{ leftTags.size() };
-                    QString sqlForInsertRowInFP{ itrForInsertRowInFP->second.arg(*cbeg) };
-                    sqlForInsertRowInFP = sqlForInsertRowInFP.arg(leftTags[sizeOfTags - 3]);
-                    sqlForInsertRowInFP = sqlForInsertRowInFP.arg(leftTags[sizeOfTags - 2]);
-                    sqlForInsertRowInFP = sqlForInsertRowInFP.arg(leftTags[sizeOfTags - 1]);
+        ///###: <file, [tags]>, the tags are in the order of being tagged.
+        QMap<QString, QList<QString>> leftTags{};
 
+        while (sqlQuery->next()) {
+            leftTags[sqlQuery->value("file_name").toString()].push_back(sqlQuery->value("tag_name").toString());
+        }
 
-                    if (!m_flag.load(std::memory_order_acquire)) {
+        sqlQuery->finish();
 
-                        if (!sqlQuery.exec(sqlForInsertRowInFP)) {
-                            qWarning() << sqlQuery.lastError().text();
-                            continue;
-                        }
+        ///###: the files which do not have any tag.
+        if (!this->execPreparedSql(DELETEUNTAGGEDFILEPROPERTY)) {
+            return false;
+        }
 
-                    } else {
+        QMap<QString, QList<QString>>::iterator itr{ leftTags.begin() };
+        QMap<QString, QList<QString>>::iterator itrEnd{ leftTags.end() };
 
-                        DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
+        for (; itr != itrEnd; ++itr) {
+            QList<QString> &tags{ itr.value() };
 
-                        if (code == DSqliteHandle::ReturnCode::Exist) {
+            while (tags.size() < 3) {
+                tags.push_back(QStringLiteral(""));
+            }
 
-                            if (!sqlQuery.exec(sqlForInsertRowInFP)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
+            int sizeOfTags{ tags.size() };
+            QVariantList values{ itr.key(), tags[sizeOfTags - 3], tags[sizeOfTags - 2], tags[sizeOfTags - 1] };
 
-                        } else {
-                            return false;
-                        }
-                    }
-                }
+            if (!this->execPreparedSql(UPSERTFILEPROPERTY, values)) {
+                return false;
             }
         }
 
@@ -1397,443 +1356,122 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor,
                             }
                         }
                         result = false;
-                        break;
-                    }
-                    continue;
-                }
-                result = false;
-                break;
-            }
-        }
-        return result;
-    }
-    return false;
-}
-
-
-template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, QString, bool>(const QString &tag_name, const QString &mountPoint)
-{
-    if (!tag_name.isEmpty() && mountPoint == QString{"/home"}) {
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-                  std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFilesThroughColor3) };
-        QSqlQuery sql_query{ *m_sqlDatabasePtr };
-        QString sql_counting{ range.first->second.arg(tag_name) };
-        QString sql_inserting{ (++range.first)->second.arg(tag_name) };
-
-        if (sql_query.exec(sql_counting)) {
-
-            if (sql_query.next()) {
-                int number{ sql_query.value("counter").toInt() };
-
-                if (number == 0) {
-                    sql_query.clear();
-
-                    if (!sql_query.exec(sql_inserting)) {
-                        qWarning() << sql_query.lastError().text();
-
-                        return false;
-                    }
-
-                    emit addNewTags(QVariant{QList<QString>{tag_name}});
-                }
-
-                return true;
-            }
-        }
-    }
-
-    return false;
-}
-
-
-
-template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
-                                std::list<QString>>(const std::list<QString> &sqlStrs, const QString &mountPoint)
-{
-    if (!m_flag.load(std::memory_order_consume) && !sqlStrs.empty() && !mountPoint.isEmpty()) {
-        std::list<QString>::const_iterator cbeg{ sqlStrs.cbegin() };
-        std::list<QString>::const_iterator cend{ sqlStrs.cend() };
-        QSqlQuery sqlQuery{*m_sqlDatabasePtr};
-
-        for (; cbeg != cend; ++cbeg) {
-
-            if (!m_flag.load(std::memory_order_consume)) {
-
-                if (!sqlQuery.exec(*cbeg)) {
-                    qWarning() << sqlQuery.lastError().text();
-                }
-
-            } else {
-
-                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                    if (!sqlQuery.exec(*cbeg)) {
-                        qWarning() << sqlQuery.lastError().text();
-                    }
-
-                } else {
-                    return false;
-                }
-            }
-        }
-
-        return true;
-    }
-
-    return false;
-}
-
-
-template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2, QMap<QString, QList<QString>>>(const QMap<QString, QList<QString>> &fileNameAndTagNames,
-                                                                                                               const QString &mountPoint)
-{
-    if (!fileNameAndTagNames.isEmpty() && !mountPoint.isEmpty() && static_cast<bool>(m_sqlDatabasePtr)) {
-        QMap<QString, QList<QString>>::const_iterator cbeg{ fileNameAndTagNames.cbegin() };
-        QMap<QString, QList<QString>>::const_iterator cend{ fileNameAndTagNames.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::UntagSamePartionFiles2) };
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
-        for (; cbeg != cend; ++cbeg) {
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator rangeBeg{ range.first };
-            QString countTagNamesInTagWithFile{ rangeBeg->second.arg(cbeg.key()) };
-
-
-            if (!m_flag.load(std::memory_order_consume)) {
-
-                if (!sqlQuery.exec(countTagNamesInTagWithFile)) {
-                    qWarning() << sqlQuery.lastError().text();
-                    continue;
-                }
-
-                if (sqlQuery.next()) {
-                    int size{ sqlQuery.value(0).toInt() };
-
-                    if (size == 0) {
-                        std::multimap<DSqliteHandle::SqlType, QString>::const_iterator  rangeEnd{ range.second };
-                        QString deleteRowInFileProperty{ (--rangeEnd)->second.arg(cbeg.key()) };
-
-                        if (!m_flag.load(std::memory_order_consume)) {
-
-                            if (!sqlQuery.exec(deleteRowInFileProperty)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
-
-                        } else {
-
-                            DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                            if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                                if (!sqlQuery.exec(deleteRowInFileProperty)) {
-                                    qWarning() << sqlQuery.lastError().text();
-                                    continue;
-                                }
-
-                            } else {
-                                return false;
-                            }
-                        }
-
-
-                    } else {
-
-                        QString sqlForGetingLeftTag{ (++rangeBeg)->second.arg(cbeg.key()) };
-
-                        if (!m_flag.load(std::memory_order_consume)) {
-
-                            if (!sqlQuery.exec(sqlForGetingLeftTag)) {
-                                qWarning() << sqlQuery.lastError().text();
-                                continue;
-                            }
-
-                            std::deque<QString> leftTags{};
-
-                            while (sqlQuery.next()) {
-                                leftTags.push_back(sqlQuery.value("tag_name").toString());
-                            }
-
-                            std::size_t sizeOfLeftTags{ leftTags.size() };
-                            std::deque<QString>::const_iterator leftTagsCbeg{ leftTags.cbegin() };
-
-                            if (sizeOfLeftTags >= 3u) {
-                                leftTags.erase(leftTagsCbeg, leftTagsCbeg + (sizeOfLeftTags - 3u));
-
-                            } else {
-
-                                for (; size < 3; ++size) {
-                                    leftTags.push_back(QString{});
-                                }
-                            }
-
-                            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForUpdateRow{ (--range.second) };
-                            leftTagsCbeg = leftTags.cbegin();
-                            QString updateRowInFileProperty{ (--itrForUpdateRow)->second.arg(*leftTagsCbeg) };
-                            updateRowInFileProperty = updateRowInFileProperty.arg(*(++leftTagsCbeg));
-                            updateRowInFileProperty = updateRowInFileProperty.arg(*(++leftTagsCbeg));
-                            updateRowInFileProperty = updateRowInFileProperty.arg(cbeg.key());
-
-                            if (!m_flag.load(std::memory_order_consume)) {
-
-                                if (!sqlQuery.exec(updateRowInFileProperty)) {
-                                    qWarning() << sqlQuery.lastError().text();
-                                    continue;
-                                }
-
-                            } else {
-
-                                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                                if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                                    if (!sqlQuery.exec(updateRowInFileProperty)) {
-                                        qWarning() << sqlQuery.lastError().text();
-                                        continue;
-                                    }
-
-                                } else {
-                                    return false;
-                                }
-
-                            }
-                        }
-                    }
-                }
-
-            } else {
-
-                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPoint) };
-
-                if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                    if (sqlQuery.exec(countTagNamesInTagWithFile)) {
-                        qWarning() << sqlQuery.lastError().text();
-                        continue;
-                    }
-
-                    if (sqlQuery.next()) {
-
-                        int size{ sqlQuery.value(0).toInt() };
-
-                        if (size == 0) {
-                            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator  rangeEnd{ range.second };
-                            QString deleteRowInFileProperty{ (--rangeEnd)->second.arg(cbeg.key()) };
-
-                            if (!m_flag.load(std::memory_order_consume)) {
-
-                                if (!sqlQuery.exec(deleteRowInFileProperty)) {
-                                    qWarning() << sqlQuery.lastError().text();
-                                    continue;
-                                }
-
-                            } else {
-
-                                DSqliteHandle::ReturnCode return_code{ this->checkDBFileExist(mountPoint) };
-
-                                if (return_code == DSqliteHandle::ReturnCode::Exist) {
-
-                                    if (!sqlQuery.exec(deleteRowInFileProperty)) {
-                                        qWarning() << sqlQuery.lastError().text();
-                                        continue;
-                                    }
-
-                                } else {
-                                    return false;
-                                }
-                            }
-
-
-                        } else {
-
-                            QString sqlForGetingLeftTag{ (++rangeBeg)->second };
-
-                            if (!m_flag.load(std::memory_order_consume)) {
-
-                                if (!sqlQuery.exec(sqlForGetingLeftTag)) {
-                                    qWarning() << sqlQuery.lastError().text();
-                                    continue;
-                                }
-
-                                std::deque<QString> leftTags{};
-                                int sizeOfTags{ sqlQuery.size() };
-
-                                for (long int index = 0; index < sizeOfTags; ++index) {
-                                    leftTags.push_back(sqlQuery.value(index).toString());
-                                }
-
-                                std::size_t sizeOfLeftTags{ leftTags.size() };
-                                std::deque<QString>::const_iterator leftTagsCbeg{ leftTags.cbegin() };
-
-                                if (sizeOfLeftTags >= 3u) {
-                                    leftTags.erase(leftTagsCbeg, leftTagsCbeg + (sizeOfLeftTags - 3u));
-
-                                } else {
-
-                                    for (; size < 3; ++size) {
-                                        leftTags.push_back(QString{});
-                                    }
-                                }
-
-                                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator itrForUpdateRow{ (--range.second) };
-                                leftTagsCbeg = leftTags.cbegin();
-                                QString updateRowInFileProperty{ (--itrForUpdateRow)->second.arg(*leftTagsCbeg) };
-                                updateRowInFileProperty = updateRowInFileProperty.arg(*(++leftTagsCbeg));
-                                updateRowInFileProperty = updateRowInFileProperty.arg(*(++leftTagsCbeg));
-                                updateRowInFileProperty = updateRowInFileProperty.arg(cbeg.key());
-
-                                if (!m_flag.load(std::memory_order_consume)) {
-
-                                    if (!sqlQuery.exec(updateRowInFileProperty)) {
-                                        qWarning() << sqlQuery.lastError().text();
-                                        continue;
-                                    }
-
-                                } else {
-
-                                    DSqliteHandle::ReturnCode return_code{ this->checkDBFileExist(mountPoint) };
-
-                                    if (return_code == DSqliteHandle::ReturnCode::Exist) {
-
-                                        if (!sqlQuery.exec(updateRowInFileProperty)) {
-                                            qWarning() << sqlQuery.lastError().text();
-                                            continue;
-                                        }
-
-                                    } else {
-                                        return false;
-                                    }
-
-                                }
-
-                            }
-                        }
+                        break;
                     }
+                    continue;
                 }
+                result = false;
+                break;
             }
         }
-
-        return true;
+        return result;
     }
-
     return false;
 }
 
+
 template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteFiles,
-                                std::list<QString>, bool>(const std::list<QString> &files, const QString &mount_point)
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, QString, bool>(const QString &tag_name, const QString &mountPoint)
 {
-
-    if (!files.empty() && !mount_point.isEmpty()) {
-        std::list<QString>::const_iterator file_itr_beg{ files.cbegin() };
-        std::list<QString>::const_iterator file_itr_end{ files.cend() };
+    if (!tag_name.isEmpty() && mountPoint == QString{"/home"}) {
         std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::DeleteFiles) };
+                  std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::TagFilesThroughColor3) };
         QSqlQuery sql_query{ *m_sqlDatabasePtr };
+        QString sql_counting{ range.first->second.arg(tag_name) };
+        QString sql_inserting{ (++range.first)->second.arg(tag_name) };
 
-        if (!m_flag.load(std::memory_order_acquire)) {
+        if (sql_query.exec(sql_counting)) {
 
-            for (; file_itr_beg != file_itr_end; ++file_itr_beg) {
-                std::multimap<DSqliteHandle::SqlType, QString>::const_iterator range_beg{ range.first };
-                QString clear_tag_with_file_table{ range_beg->second.arg(*file_itr_beg) };
-                QString clear_file_property_table{ (++range_beg)->second.arg(*file_itr_beg) };
+            if (sql_query.next()) {
+                int number{ sql_query.value("counter").toInt() };
 
-                if (!sql_query.exec(clear_file_property_table)) {
-                    qWarning() << sql_query.lastError().text();
+                if (number == 0) {
+                    sql_query.clear();
 
-                    return false;
-                }
+                    if (!sql_query.exec(sql_inserting)) {
+                        qWarning() << sql_query.lastError().text();
 
-                if (!sql_query.exec(clear_tag_with_file_table)) {
-                    qWarning() << sql_query.lastError().text();
+                        return false;
+                    }
 
-                    return false;
+                    emit addNewTags(QVariant{QList<QString>{tag_name}});
                 }
-            }
 
-            return true;
+                return true;
+            }
+        }
+    }
 
-        } else {
+    return false;
+}
 
-            DSqliteHandle::ReturnCode code{this->checkDBFileExist(mount_point)};
 
-            if (code == DSqliteHandle::ReturnCode::Exist) {
 
-                for (; file_itr_beg != file_itr_end; ++file_itr_beg) {
-                    std::multimap<DSqliteHandle::SqlType, QString>::const_iterator range_beg{ range.first };
-                    QString clear_tag_with_file_table{ range_beg->second.arg(*file_itr_beg) };
-                    QString clear_file_property_table{ (++range_beg)->second.arg(*file_itr_beg) };
+template<>
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
+                                QMap<QString, QList<QString>>>(const QMap<QString, QList<QString>> &fileNameAndTagNames, const QString &mountPoint)
+{
+    if (!fileNameAndTagNames.isEmpty() && !mountPoint.isEmpty()) {
 
-                    if (sql_query.exec(clear_file_property_table)) {
-                        qWarning() << sql_query.lastError().text();
+        if (!this->isDatabaseAvailable(mountPoint) || !this->fillBatchPairs(fileNameAndTagNames)) {
+            return false;
+        }
 
-                        return false;
-                    }
+        return this->execPreparedSql(UNTAGBATCHPAIRS);
+    }
 
-                    if (sql_query.exec(clear_tag_with_file_table)) {
-                        qWarning() << sql_query.lastError().text();
+    return false;
+}
 
-                        return false;
-                    }
-                }
 
-                return true;
-            }
-        }
+template<>
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2, QMap<QString, QList<QString>>>(const QMap<QString, QList<QString>> &fileNameAndTagNames,
+                                                                                                               const QString &mountPoint)
+{
+    if (!fileNameAndTagNames.isEmpty() && !mountPoint.isEmpty() && static_cast<bool>(m_sqlDatabasePtr)) {
+        ///###: the left tags of files are written to file_property as same as tagging files.
+        return this->helpExecSql<DSqliteHandle::SqlType::TagFiles3, QList<QString>, bool>(fileNameAndTagNames.keys(), mountPoint);
     }
 
     return false;
 }
 
 template<>
-QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteFiles2,
-                                                         std::list<QString>, QMap<QString, QList<QString>>>(const std::list<QString> &files, const QString &mount_point)
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteFiles,
+                                std::list<QString>, bool>(const std::list<QString> &files, const QString &mount_point)
 {
-    QMap<QString, QList<QString>> file_and_tags{};
 
     if (!files.empty() && !mount_point.isEmpty()) {
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::DeleteFiles2) };
-        QSqlQuery sql_query{ *m_sqlDatabasePtr };
-
 
-        if (!m_flag.load(std::memory_order_acquire)) {
-
-            for (const QString &file : files) {
-                QString sql_for_getting_tags{ range.first->second.arg(file) };
-
-                if (sql_query.exec(sql_for_getting_tags)) {
+        if (!this->isDatabaseAvailable(mount_point) || !this->fillBatchFiles(QList<QString>::fromStdList(files))) {
+            return false;
+        }
 
-                    while (sql_query.next()) {
-                        QString tag_name{ sql_query.value("tag_name").toString() };
-                        file_and_tags[file].push_back(tag_name);
-                    }
-                }
-            }
+        return (this->execPreparedSql(DELETEBATCHFILESINFILEPROPERTY) && this->execPreparedSql(DELETEBATCHFILESINTAGWITHFILE));
+    }
 
-        } else {
+    return false;
+}
 
-            DSqliteHandle::ReturnCode code{this->checkDBFileExist(mount_point)};
+template<>
+QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteFiles2,
+                                                         std::list<QString>, QMap<QString, QList<QString>>>(const std::list<QString> &files, const QString &mount_point)
+{
+    QMap<QString, QList<QString>> file_and_tags{};
 
-            if (code == DSqliteHandle::ReturnCode::Exist) {
+    if (!files.empty() && !mount_point.isEmpty()) {
 
-                for (const QString &file : files) {
-                    QString sql_for_getting_tags{ range.first->second.arg(file) };
+        if (this->isDatabaseAvailable(mount_point) && this->fillBatchFiles(QList<QString>::fromStdList(files))) {
+            QSqlQuery *sql_query{ this->preparedQuery(GETTAGSOFBATCHFILES) };
 
-                    if (sql_query.exec(sql_for_getting_tags)) {
+            if (sql_query && sql_query->exec()) {
 
-                        while (sql_query.next()) {
-                            QString tag_name{ sql_query.value("tag_name").toString() };
-                            file_and_tags[file].push_back(tag_name);
-                        }
-                    }
+                while (sql_query->next()) {
+                    QString tag_name{ sql_query->value("tag_name").toString() };
+                    file_and_tags[sql_query->value("file_name").toString()].push_back(tag_name);
                 }
 
+                sql_query->finish();
             }
         }
     }
@@ -2085,44 +1723,17 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteTags3, QList<QStri
 
 
 template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeFilesName, std::map<QString, QString>>(const std::map<QString, QString> &sqlStrs, const QString &mountPoint)
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeFilesName, std::map<QString, QString>>(const std::map<QString, QString> &oldAndNewNames, const QString &mountPoint)
 {
-    if (!sqlStrs.empty() && !mountPoint.isEmpty()) {
-        std::map<QString, QString>::const_iterator sqlCBeg{ sqlStrs.cbegin() };
-        std::map<QString, QString>::const_iterator sqlCEnd{ sqlStrs.cend() };
-        QSqlQuery sqlQuery{ *m_sqlDatabasePtr };
-
-        for (; sqlCBeg != sqlCEnd; ++sqlCBeg) {
-
-            if (!m_flag.load(std::memory_order_consume)) {
-
-                if (!sqlQuery.exec(sqlCBeg->first)) {
-                    qWarning() << sqlQuery.lastError().text();
-                }
-
-                if (!sqlQuery.exec(sqlCBeg->second)) {
-                    qWarning() << sqlQuery.lastError().text();
-                }
-
-            } else {
-                DSqliteHandle::ReturnCode code{this->checkDBFileExist(mountPoint)};
-
-                if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                    if (!sqlQuery.exec(sqlCBeg->first)) {
-                        qWarning() << sqlQuery.lastError().text();
-                    }
+    if (!oldAndNewNames.empty() && !mountPoint.isEmpty()) {
 
-                    if (!sqlQuery.exec(sqlCBeg->second)) {
-                        qWarning() << sqlQuery.lastError().text();
-                    }
-
-                } else {
-                    return false;
-                }
-            }
+        if (!this->isDatabaseAvailable(mountPoint) || !this->fillBatchRenames(oldAndNewNames)) {
+            return false;
         }
-        return true;
+
+        return (this->execPreparedSql(MOVEBATCHRENAMESTOTEMPKEY) && this->execPreparedSql(RENAMEBATCHFILESINFILEPROPERTY)
+                && this->execPreparedSql(RESTOREUNRENAMEDFILESINFILEPROPERTY) && this->execPreparedSql(DELETEUNRESTOREDFILESINFILEPROPERTY)
+                && this->execPreparedSql(RENAMEBATCHFILESINTAGWITHFILE));
     }
     return false;
 }
@@ -2134,42 +1745,23 @@ QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType:
     QMap<QString, QList<QString>> file_with_tags{};
 
     if (!files.empty()) {
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(SqlType::ChangeFilesName2) };
-        std::map<QString, QString>::const_iterator file_beg{ files.cbegin() };
-        std::map<QString, QString>::const_iterator file_end{ files.cend() };
-        QSqlQuery sql_query{ *m_sqlDatabasePtr };
+        QList<QString> file_names{};
 
+        for (const std::pair<QString, QString> &file : files) {
+            file_names.push_back(file.first);
+        }
 
-        if (!m_flag.load(std::memory_order_consume)) {
-
-            for (; file_beg != file_end; ++file_beg) {
+        if (this->isDatabaseAvailable(mount_point) && this->fillBatchFiles(file_names)) {
+            QSqlQuery *sql_query{ this->preparedQuery(GETTAGSOFBATCHFILES) };
 
-                if (sql_query.exec(range.first->second.arg(file_beg->first))) {
+            if (sql_query && sql_query->exec()) {
 
-                    while (sql_query.next()) {
-                        QString tag_name{ sql_query.value("tag_name").toString() };
-                        file_with_tags[file_beg->first].push_back(tag_name);
-                    }
+                while (sql_query->next()) {
+                    QString tag_name{ sql_query->value("tag_name").toString() };
+                    file_with_tags[sql_query->value("file_name").toString()].push_back(tag_name);
                 }
-            }
-
-        } else {
-
-            DSqliteHandle::ReturnCode code{this->checkDBFileExist(mount_point)};
 
-            if (code == DSqliteHandle::ReturnCode::Exist) {
-
-                for (; file_beg != file_end; ++file_beg) {
-
-                    if (sql_query.exec(range.first->second.arg(file_beg->first))) {
-
-                        while (sql_query.next()) {
-                            QString tag_name{ sql_query.value("tag_name").toString() };
-                            file_with_tags[file_beg->first].push_back(tag_name);
-                        }
-                    }
-                }
+                sql_query->finish();
             }
         }
     }
@@ -2378,7 +1970,7 @@ QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType:
                     if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                         this->connectToShareSqlite(partion_itr_beg->second);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                        if (m_sqlDatabasePtr && this->openSqlDatabase()) {
                             QSqlQuery sql_query{ *m_sqlDatabasePtr };
 
                             for (const QString &tag_name : tag_names) {
@@ -2508,7 +2100,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFiles, bool>(const QMa
                     }
                 }
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                     bool valueOfDelRedundant{ true };
 
                     if (!decreased.isEmpty()) {
@@ -2601,7 +2193,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFiles, bool>(const QMa
             if (code == DSqliteHandle::ReturnCode::Exist || code == DSqliteHandle::ReturnCode::NoExist) {
                 this->connectToShareSqlite(unixDeviceAndMountPoint.second);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
                     bool valueOfInsertNew{ true };
                     valueOfInsertNew = this->helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString, QList<QString>>,
@@ -2661,7 +2253,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFilesThroughColor, boo
         this->connectToShareSqlite("/home", ".__main.db");
         bool the_result{ true };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, QString, bool>(filesAndTags.cbegin().key(), "/home");
         }
 
@@ -2738,7 +2330,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::TagFilesThroughColor, boo
                     }
 
                     if (!sqlStrs.empty()) {
-                        if (m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                        if (this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                             bool value = this->helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor,
                                  std::list<std::tuple<QString, QString, QString, QString, QString, QString>>, bool>(sqlStrs, cbeg.key());
 
@@ -2786,7 +2378,6 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::UntagSamePartionFiles, bo
 {
     if (!filesAndTags.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
-        QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
         QPair<QString, QString> unixDeviceAndMountPoint{ DSqliteHandle::getMountPointOfFile(DUrl::fromLocalFile(cbeg.key()), m_partionsOfDevices) };
         DSqliteHandle::ReturnCode code{ this->checkDBFileExist(unixDeviceAndMountPoint.second) };
 
@@ -2805,54 +2396,27 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::UntagSamePartionFiles, bo
 
             this->connectToShareSqlite(unixDeviceAndMountPoint.second);
 
-            if (static_cast<bool>(m_sqlDatabasePtr)) {
-                std::pair<std::multimap<SqlType, QString>::const_iterator,
-                    std::multimap<SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(SqlType::UntagSamePartionFiles) };
+            if (static_cast<bool>(m_sqlDatabasePtr) && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
+                bool resultOfDeleteRowInTagWithFile{ this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
+                                                     QMap<QString, QList<QString>>, bool>(file_with_tags, unixDeviceAndMountPoint.second) };
+                bool resultOfUpdateFileProperty{ false };
 
-                if (range.first != range.second) {
-
-                    ///###: [sql].
-                    std::list<QString> sqlForDeletingRowOfTagWithFile{};
-                    cbeg = file_with_tags.cbegin(); //###:!!!!!!!!
-                    cend = file_with_tags.cend();//###:!!!!!!!!!
-
-                    for (; cbeg != cend; ++cbeg) {
-                        std::multimap<SqlType, QString>::const_iterator rangeCBeg{ range.first };
-                        QString fileLocalName{ cbeg.key() };
-                        QList<QString>::const_iterator cTagBeg{ cbeg.value().cbegin() };
-                        QList<QString>::const_iterator cTagEnd{ cbeg.value().cend() };
-
-                        for (; cTagBeg != cTagEnd; ++cTagBeg) {
-                            QString deletingRowOfTagWithFile{ rangeCBeg->second.arg(fileLocalName) };
-                            deletingRowOfTagWithFile = deletingRowOfTagWithFile.arg(*cTagBeg);
-                            sqlForDeletingRowOfTagWithFile.push_back(deletingRowOfTagWithFile);
-                        }
-                    }
-
-                    if (!sqlForDeletingRowOfTagWithFile.empty() && m_sqlDatabasePtr->open()
-                            && m_sqlDatabasePtr->transaction()) {
-                        bool resultOfDeleteRowInTagWithFile{ this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles,
-                                                             std::list<QString>, bool>(sqlForDeletingRowOfTagWithFile, unixDeviceAndMountPoint.second) };
-                        bool resultOfUpdateFileProperty{ false };
-
-                        if (resultOfDeleteRowInTagWithFile) {
-                            resultOfUpdateFileProperty = this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2,
-                            QMap<QString, QList<QString>>, bool>(file_with_tags, unixDeviceAndMountPoint.second);
-                        }
+                if (resultOfDeleteRowInTagWithFile) {
+                    resultOfUpdateFileProperty = this->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2,
+                    QMap<QString, QList<QString>>, bool>(file_with_tags, unixDeviceAndMountPoint.second);
+                }
 
-                        if (!(resultOfDeleteRowInTagWithFile && resultOfUpdateFileProperty
-                                && m_sqlDatabasePtr->commit())) {
-                            m_sqlDatabasePtr->rollback();
-                            this->closeSqlDatabase();
+                if (!(resultOfDeleteRowInTagWithFile && resultOfUpdateFileProperty
+                        && m_sqlDatabasePtr->commit())) {
+                    m_sqlDatabasePtr->rollback();
+                    this->closeSqlDatabase();
 
-                            return false;
-                        }
+                    return false;
+                }
 
-                        this->closeSqlDatabase();
+                this->closeSqlDatabase();
 
-                        return true;
-                    }
-                }
+                return true;
             }
 
         } else {
@@ -2927,8 +2491,6 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteFiles, bool>(const
     if (!filesAndTags.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
-        std::pair<std::map<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::map<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::DeleteFiles) };
 
         ///###: <mount-point, [files]>
         std::map<QString, std::list<QString>> filesOfPartions{};
@@ -2968,7 +2530,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteFiles, bool>(const
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToShareSqlite(itr_partion_and_files->first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase()) {
                     QMap<QString, QList<QString>> file_and_tags_partion{
                         this->helpExecSql<DSqliteHandle::SqlType::DeleteFiles2,
                         std::list<QString>, QMap<QString, QList<QString>>>(itr_partion_and_files->second, itr_partion_and_files->first)
@@ -3003,7 +2565,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteFiles, bool>(const
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToShareSqlite(itr_partion_and_files->first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
                     bool result{ this->helpExecSql<DSqliteHandle::SqlType::DeleteFiles,
                                  std::list<QString>, bool>(itr_partion_and_files->second, itr_partion_and_files->first) };
@@ -3046,7 +2608,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteTags, bool>(const Q
         bool the_result{ true };
         QList<QString> the_tags_for_deleting{ filesAndTags.keys() };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::DeleteTags3, QList<QString>, bool>(the_tags_for_deleting, "/home");
         }
 
@@ -3096,7 +2658,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::DeleteTags, bool>(const Q
                             bool flagForDeleteInTagWithFile{ false };
                             bool flagForUpdatingFileProperty{ false };
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+                            if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
                                 flagForDeleteInTagWithFile = this->helpExecSql<DSqliteHandle::SqlType::DeleteTags,
                                 std::list<QString>, bool>(sqlStrs, mountPointItr->second);
 
@@ -3149,8 +2711,6 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
     if (!filesAndTags.isEmpty()) {
         QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
-        std::pair<std::multimap<DSqliteHandle::SqlType, QString>::const_iterator,
-            std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::ChangeFilesName) };
 
         std::map<QString, std::map<QString, QString>> partionsAndFileNames{};
 
@@ -3173,7 +2733,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
             if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                 this->connectToShareSqlite(partion_and_file_names.first);
 
-                if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                if (m_sqlDatabasePtr && this->openSqlDatabase()) {
                     QMap<QString, QList<QString>> file_with_tags{
                         this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
                         QMap<QString, QList<QString>>>(partion_and_file_names.second, partion_and_file_names.first)
@@ -3193,110 +2753,92 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeFilesName, bool>(co
         }
 
 
-        std::map<QString, std::map<QString, QString>> sqlForChangingFilesName{};
         std::map<QString, std::map<QString, QString>> partionsAndFileNames_backup{ partionsAndFileNames };
 
         if (!partionsAndFileNames.empty()) {
-            std::map<QString, std::map<QString, QString>>::const_iterator partionBeg{ partionsAndFileNames.cbegin() };
-            std::map<QString, std::map<QString, QString>>::const_iterator partionEnd{ partionsAndFileNames.cend() };
-
-            for (; partionBeg != partionEnd; ++partionBeg) {
-
-                for (const std::pair<QString, QString> &oldAndNewName : partionBeg->second) {
-                    std::map<DSqliteHandle::SqlType, QString>::const_iterator rangeBeg{ range.first };
-                    QString updateFileProperty{ rangeBeg->second.arg(oldAndNewName.second)};
-                    updateFileProperty = updateFileProperty.arg(oldAndNewName.first);
-
-                    QString updateTagWithFile{ (++rangeBeg)->second.arg(oldAndNewName.second) };
-                    updateTagWithFile = updateTagWithFile.arg(oldAndNewName.first);
-                    sqlForChangingFilesName[partionBeg->first].emplace(updateFileProperty, updateTagWithFile);
-                }
-            }
-
-            if (!sqlForChangingFilesName.empty()) {
-                bool result{ true };
+            bool result{ true };
 
-                for (const std::pair<QString, std::map<QString, QString>> &mountPointAndSqls : sqlForChangingFilesName) {
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPointAndSqls.first) };
+            ///###: rename all files of a partion by one set-based statement in one transaction.
+            for (const std::pair<QString, std::map<QString, QString>> &mountPointAndNames : partionsAndFileNames) {
+                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mountPointAndNames.first) };
 
-                    if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
-                        this->connectToShareSqlite(mountPointAndSqls.first);
+                if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
+                    this->connectToShareSqlite(mountPointAndNames.first);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
-                            bool resultOfExecSql{ this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName,
-                                                  std::map<QString, QString>, bool>(mountPointAndSqls.second, mountPointAndSqls.first) };
+                    if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
+                        bool resultOfExecSql{ this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName,
+                                              std::map<QString, QString>, bool>(mountPointAndNames.second, mountPointAndNames.first) };
 
-                            if (!(resultOfExecSql && m_sqlDatabasePtr->commit())) {
-                                m_sqlDatabasePtr->rollback();
-                                result = false;
+                        if (!(resultOfExecSql && m_sqlDatabasePtr->commit())) {
+                            m_sqlDatabasePtr->rollback();
+                            result = false;
 
-                                partionsAndFileNames_backup.erase(mountPointAndSqls.first);
-                                file_with_tags_in_partion.remove(mountPointAndSqls.first);
-                            }
+                            partionsAndFileNames_backup.erase(mountPointAndNames.first);
+                            file_with_tags_in_partion.remove(mountPointAndNames.first);
                         }
                     }
                 }
+            }
 
-                this->closeSqlDatabase();
+            this->closeSqlDatabase();
 
-                QMap<QString, QList<QString>> file_with_tags_new{};
+            QMap<QString, QList<QString>> file_with_tags_new{};
 
-                for (const std::pair<QString, std::map<QString, QString>> &mount_point_and_file_names : partionsAndFileNames_backup) {
-                    std::map<QString, QString> new_and_old_names{};
+            for (const std::pair<QString, std::map<QString, QString>> &mount_point_and_file_names : partionsAndFileNames_backup) {
+                std::map<QString, QString> new_and_old_names{};
 
-                    for (const std::pair<QString, QString> &old_and_new_name : mount_point_and_file_names.second) {
-                        new_and_old_names[old_and_new_name.second] = old_and_new_name.first;
-                    }
+                for (const std::pair<QString, QString> &old_and_new_name : mount_point_and_file_names.second) {
+                    new_and_old_names[old_and_new_name.second] = old_and_new_name.first;
+                }
 
-                    DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mount_point_and_file_names.first) };
+                DSqliteHandle::ReturnCode code{ this->checkDBFileExist(mount_point_and_file_names.first) };
 
-                    if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
-                        this->connectToShareSqlite(mount_point_and_file_names.first);
+                if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
+                    this->connectToShareSqlite(mount_point_and_file_names.first);
 
-                        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
-                            QMap<QString, QList<QString>> file_with_tags{
-                                this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
-                                QMap<QString, QList<QString>>>(new_and_old_names, mount_point_and_file_names.first)
-                            };
+                    if (m_sqlDatabasePtr && this->openSqlDatabase()) {
+                        QMap<QString, QList<QString>> file_with_tags{
+                            this->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
+                            QMap<QString, QList<QString>>>(new_and_old_names, mount_point_and_file_names.first)
+                        };
 
-                            using namespace impl;
-                            file_with_tags_new += file_with_tags;
-                        }
+                        using namespace impl;
+                        file_with_tags_new += file_with_tags;
                     }
                 }
+            }
 
-                QMap<QString, QList<QString>> file_with_tags_old{};
-                QMap<QString, QMap<QString, QList<QString>>>::const_iterator itr_beg{ file_with_tags_in_partion.cbegin() };
-                QMap<QString, QMap<QString, QList<QString>>>::const_iterator itr_end{ file_with_tags_in_partion.cend() };
+            QMap<QString, QList<QString>> file_with_tags_old{};
+            QMap<QString, QMap<QString, QList<QString>>>::const_iterator itr_beg{ file_with_tags_in_partion.cbegin() };
+            QMap<QString, QMap<QString, QList<QString>>>::const_iterator itr_end{ file_with_tags_in_partion.cend() };
 
-                for (; itr_beg != itr_end; ++itr_beg) {
-                    using namespace impl;
-                    file_with_tags_old += itr_beg.value();
-                }
+            for (; itr_beg != itr_end; ++itr_beg) {
+                using namespace impl;
+                file_with_tags_old += itr_beg.value();
+            }
 
-                QMap<QString, QVariant> file_with_tags_var{};
-                QMap<QString, QList<QString>>::iterator file_with_tags_beg{ file_with_tags_old.begin() };
-                QMap<QString, QList<QString>>::iterator file_with_tags_end{ file_with_tags_old.end() };
+            QMap<QString, QVariant> file_with_tags_var{};
+            QMap<QString, QList<QString>>::iterator file_with_tags_beg{ file_with_tags_old.begin() };
+            QMap<QString, QList<QString>>::iterator file_with_tags_end{ file_with_tags_old.end() };
 
-                for (; file_with_tags_beg != file_with_tags_end; ++file_with_tags_beg) {
-                    file_with_tags_var[file_with_tags_beg.key()] = QVariant{ file_with_tags_beg.value() };
-                }
+            for (; file_with_tags_beg != file_with_tags_end; ++file_with_tags_beg) {
+                file_with_tags_var[file_with_tags_beg.key()] = QVariant{ file_with_tags_beg.value() };
+            }
 
-                emit untagFiles(file_with_tags_var);
+            emit untagFiles(file_with_tags_var);
 
-                file_with_tags_var.clear();
-                file_with_tags_beg = file_with_tags_new.begin();
-                file_with_tags_end = file_with_tags_new.end();
+            file_with_tags_var.clear();
+            file_with_tags_beg = file_with_tags_new.begin();
+            file_with_tags_end = file_with_tags_new.end();
 
-                for (; file_with_tags_beg != file_with_tags_end; ++file_with_tags_beg) {
-                    file_with_tags_var[file_with_tags_beg.key()] = QVariant{ file_with_tags_beg.value() };
-                }
+            for (; file_with_tags_beg != file_with_tags_end; ++file_with_tags_beg) {
+                file_with_tags_var[file_with_tags_beg.key()] = QVariant{ file_with_tags_beg.value() };
+            }
 
-                emit filesWereTagged(file_with_tags_var);
-                this->closeSqlDatabase();
+            emit filesWereTagged(file_with_tags_var);
+            this->closeSqlDatabase();
 
-                return result;
-            }
+            return result;
         }
     }
 
@@ -3319,7 +2861,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagsName, bool>(con
         this->connectToShareSqlite("/home", ".__main.db");
         bool the_result{ true };
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             the_result = this->helpExecSql<DSqliteHandle::SqlType::ChangeTagsName2, QMap<QString, QList<QString>>, bool>(filesAndTags, "/home");
         }
 
@@ -3370,7 +2912,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagsName, bool>(con
                             bool resultOfChangeNameOfTag{ true };
                             bool flagOfTransaction{ true };
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                            if (m_sqlDatabasePtr && this->openSqlDatabase()) {
                                 flagOfTransaction = m_sqlDatabasePtr->transaction();
 
                                 if (flagOfTransaction) {
@@ -3439,7 +2981,7 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsThroughF
             this->connectToShareSqlite(partionAndMountPoint.second);
 
             ///###: no transaction.
-            if (m_sqlDatabasePtr->open()) {
+            if (this->openSqlDatabase()) {
                 tags = this->helpExecSql<DSqliteHandle::SqlType::GetTagsThroughFile,
                 QString, QList<QString>>(sqlForGetTagsThroughFile, partionAndMountPoint.second);
             }
@@ -3485,7 +3027,7 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThrough
                         if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
                             this->connectToShareSqlite(mountPointItr->second);
 
-                            if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+                            if (m_sqlDatabasePtr && this->openSqlDatabase()) {
 
                                 QList<QString> filesOfPartion{ this->helpExecSql<DSqliteHandle::SqlType::GetFilesThroughTag,
                                                                QString, QList<QString>>(sqlForGetFilesThroughTag, mountPointItr->second) };
@@ -3523,15 +3065,42 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetSameTagsOfDi
         QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
         QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
 
+        ///###: <mount-point, [files]>
+        std::map<QString, QList<QString>> filesOfPartions{};
+
         for (; cbeg != cend; ++cbeg) {
-            QMap<QString, QList<QString>> file{};
-            file.insert(cbeg.key(), cbeg.value());
+            QPair<QString, QString> unixDeviceAndMountPoint{ DSqliteHandle::getMountPointOfFile(DUrl::fromLocalFile(cbeg.key()), m_partionsOfDevices) };
+
+            if (!unixDeviceAndMountPoint.second.isEmpty()) {
+                filesOfPartions[unixDeviceAndMountPoint.second].push_back(this->remove_mount_point(cbeg.key(), unixDeviceAndMountPoint.second));
+            }
+        }
+
+        ///###: count the tags of all files in a partion by one query, instead of connecting sqlite for every file.
+        for (const std::pair<QString, QList<QString>> &partionAndFiles : filesOfPartions) {
+            DSqliteHandle::ReturnCode code{ this->checkDBFileExist(partionAndFiles.first) };
+
+            if (code == DSqliteHandle::ReturnCode::NoExist || code == DSqliteHandle::ReturnCode::Exist) {
+                this->connectToShareSqlite(partionAndFiles.first);
+
+                if (m_sqlDatabasePtr && this->openSqlDatabase() && this->isDatabaseAvailable(partionAndFiles.first)
+                        && this->fillBatchFiles(partionAndFiles.second)) {
+                    QSqlQuery *sqlQuery{ this->preparedQuery(COUNTTAGSOFBATCHFILES) };
+
+                    if (sqlQuery && sqlQuery->exec()) {
 
-            QList<QString> tagsNames{ this->execSqlstr<DSqliteHandle::SqlType::GetTagsThroughFile, QList<QString>>(file) };
-            for (const QString &tagName : tagsNames) {
-                ++countForTags[tagName];
+                        while (sqlQuery->next()) {
+                            QString tagName{ sqlQuery->value("tag_name").toString() };
+                            countForTags[tagName] += static_cast<std::size_t>(sqlQuery->value("counter").toInt());
+                        }
+
+                        sqlQuery->finish();
+                    }
+                }
             }
         }
+
+        this->closeSqlDatabase();
     }
 
     int size{ filesAndTags.size() };
@@ -3557,6 +3126,97 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetSameTagsOfDi
 }
 
 
+template<>
+QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsOfFilesInDirectory, QMap<QString, QVariant>>(const QMap<QString, QList<QString>> &filesAndTags)
+{
+    QMap<QString, QVariant> fileAndTags{};
+    QMap<QString, QList<QString>>::const_iterator cbeg{ filesAndTags.cbegin() };
+    QMap<QString, QList<QString>>::const_iterator cend{ filesAndTags.cend() };
+
+    for (; cbeg != cend; ++cbeg) {
+        QString directory{ cbeg.key() };
+
+        if (!directory.endsWith(QChar('/'))) {
+            directory.append(QChar('/'));
+        }
+
+        QPair<QString, QString> unixDeviceAndMountPoint{ DSqliteHandle::getMountPointOfFile(DUrl::fromLocalFile(directory), m_partionsOfDevices) };
+
+        if (unixDeviceAndMountPoint.second.isEmpty()) {
+            continue;
+        }
+
+        DSqliteHandle::ReturnCode code{ this->checkDBFileExist(unixDeviceAndMountPoint.second) };
+
+        if (code != DSqliteHandle::ReturnCode::NoExist && code != DSqliteHandle::ReturnCode::Exist) {
+            continue;
+        }
+
+        this->connectToShareSqlite(unixDeviceAndMountPoint.second);
+
+        if (!m_sqlDatabasePtr || !this->openSqlDatabase() || !this->isDatabaseAvailable(unixDeviceAndMountPoint.second)) {
+            continue;
+        }
+
+        ///###: the file names are saved without the mount point, so the children of the directory are in the range of
+        ///###: ("prefix/", "prefix0"), '0' is the next character of '/'. the index of file_name is used by this range.
+        QString prefix{ this->remove_mount_point(directory, unixDeviceAndMountPoint.second) };
+        QSqlQuery *sqlQuery{ nullptr };
+
+        if (prefix.isEmpty()) {
+            sqlQuery = this->preparedQuery(GETTAGSOFALLFILES);
+        } else if (this->execPreparedSql(CREATEINDEXOFTAGWITHFILE)) {
+            sqlQuery = this->preparedQuery(GETTAGSOFFILESINRANGE);
+
+            if (sqlQuery) {
+                QString upperBound{ prefix };
+                upperBound[upperBound.size() - 1] = QChar('0');
+                sqlQuery->bindValue(0, prefix);
+                sqlQuery->bindValue(1, upperBound);
+            }
+        }
+
+        if (!sqlQuery || !sqlQuery->exec()) {
+            qWarning() << (sqlQuery ? sqlQuery->lastError().text() : QString{ "failed to prepare the query of directory tags" });
+            continue;
+        }
+
+        ///###: <file, [tags]>, only the direct children of the directory.
+        QMap<QString, QList<QString>> tagsOfChildren{};
+
+        while (sqlQuery->next()) {
+            QString fileName{ sqlQuery->value("file_name").toString() };
+
+            if (fileName.indexOf(QChar('/'), prefix.size()) != -1) {
+                continue;
+            }
+
+            tagsOfChildren[fileName].push_back(Tag::restore_escaped_en_skim(sqlQuery->value("tag_name").toString()));
+        }
+
+        sqlQuery->finish();
+
+        QMap<QString, QList<QString>>::const_iterator childItr{ tagsOfChildren.cbegin() };
+        QMap<QString, QList<QString>>::const_iterator childItrEnd{ tagsOfChildren.cend() };
+
+        for (; childItr != childItrEnd; ++childItr) {
+            QString file{ unixDeviceAndMountPoint.second };
+
+            if (file.endsWith(QChar('/')) && childItr.key().startsWith(QChar('/'))) {
+                file.chop(1);
+            }
+
+            file += childItr.key();
+            fileAndTags[Tag::restore_escaped_en_skim(file)] = QVariant{ childItr.value() };
+        }
+    }
+
+    this->closeSqlDatabase();
+
+    return fileAndTags;
+}
+
+
 template<>
 QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetAllTags, QMap<QString, QVariant>>(const QMap<QString, QList<QString>> &filesAndTags)
 {
@@ -3568,7 +3228,7 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetAll
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetAllTags) };
         this->connectToShareSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase()) {
             QSqlQuery sql_query{ *m_sqlDatabasePtr };
 
             if (sql_query.exec(range.first->second)) {
@@ -3600,7 +3260,7 @@ QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTag
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::GetTagColor) };
         this->connectToShareSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase()) {
             QMap<QString, QList<QString>>::const_iterator c_beg{ fileAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ fileAndTags.cend() };
             QString sql_str{ range.first->second };
@@ -3633,7 +3293,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::ChangeTagColor, bool>(con
             std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::ChangeTagColor) };
         this->connectToShareSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
             QMap<QString, QList<QString>>::const_iterator c_beg{ filesAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ filesAndTags.cend() };
             QSqlQuery sql_query{ *m_sqlDatabasePtr };
@@ -3674,7 +3334,7 @@ bool DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::BeforeTagFiles, bool>(con
                   std::multimap<DSqliteHandle::SqlType, QString>::const_iterator> range{ SqlTypeWithStrs.equal_range(DSqliteHandle::SqlType::BeforeTagFiles) };
         this->connectToShareSqlite("/home", ".__main.db");
 
-        if (m_sqlDatabasePtr && m_sqlDatabasePtr->open() && m_sqlDatabasePtr->transaction()) {
+        if (m_sqlDatabasePtr && this->openSqlDatabase() && m_sqlDatabasePtr->transaction()) {
 
             QMap<QString, QList<QString>>::const_iterator c_beg{ filesAndTags.cbegin() };
             QMap<QString, QList<QString>>::const_iterator c_end{ filesAndTags.cend() };
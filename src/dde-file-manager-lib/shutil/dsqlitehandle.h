@@ -9,6 +9,7 @@
 #include <mutex>
 #include <regex>
 #include <memory>
+#include <set>
 #include <unordered_map>
 
 #include <QDir>
@@ -75,6 +76,7 @@ public:
 
         GetTagsThroughFile,
         GetSameTagsOfDiffFiles,
+        GetTagsOfFilesInDirectory,
 
         UntagDiffPartionFiles,
 
@@ -123,6 +125,9 @@ private:
 
     inline void closeSqlDatabase()noexcept
     {
+        ///###: the prepared statements must be released before the connection closed.
+        m_preparedQueries.clear();
+
         if (m_sqlDatabasePtr && m_sqlDatabasePtr->isOpen()) {
             m_sqlDatabasePtr->close();
         }
@@ -185,10 +190,50 @@ private:
      */
     void connectToShareSqlite(const QString &path, const QString &db_name = ".__deepin.db");
 
+    /**
+     * @brief openSqlDatabase 打开数据库连接，本地的主数据库(.__main.db)启用WAL日志模式
+     * WAL模式会持久化到db文件中，批量写入时不再每次提交都同步整个数据库文件，
+     * 分区数据库(.__deepin.db)保持原来的日志模式
+     * @return 是否打开成功
+     */
+    bool openSqlDatabase();
+
+    /**
+     * @brief isDatabaseAvailable 分区被卸载后(m_flag)数据库可能已不存在，执行语句前检查
+     * @param mountPoint 挂载点
+     */
+    bool isDatabaseAvailable(const QString &mountPoint);
+
+    /**
+     * @brief preparedQuery 获取当前连接中缓存的预编译语句，同一条语句只编译一次
+     * 缓存在连接关闭(closeSqlDatabase)或重新连接时释放
+     * @param sql 语句，参数使用 ? 占位
+     * @return 编译失败时返回空指针
+     */
+    QSqlQuery *preparedQuery(const QString &sql);
+
+    /**
+     * @brief execPreparedSql 绑定参数并执行预编译语句
+     * @param sql 语句
+     * @param values 按占位符顺序绑定的参数
+     */
+    bool execPreparedSql(const QString &sql, const QVariantList &values = QVariantList{});
+
+    /**
+     * @brief fillBatchFiles/fillBatchPairs/fillBatchRenames 将一批文件写入临时表
+     * 之后通过一条基于集合的语句处理整批文件，而不是每个文件各执行一次
+     */
+    bool fillBatchFiles(const QList<QString> &files);
+    bool fillBatchPairs(const QMap<QString, QList<QString>> &filesAndTags);
+    bool fillBatchRenames(const std::map<QString, QString> &oldAndNewNames);
+
     std::unique_ptr<std::map<QString, std::multimap<QString, QString>>> m_partionsOfDevices{ nullptr };
     std::unique_ptr<QSqlDatabase> m_sqlDatabasePtr{ nullptr };
     std::atomic<bool> m_flag{ false };
     std::mutex m_mutex{};
+    std::unordered_map<QString, QSqlQuery> m_preparedQueries{};
+    ///###: partition databases which already have the index of tag_with_file.
+    std::set<QString> m_indexedDatabases{};
 
     QList<QString> m_newAddedTags{};
 };
@@ -215,6 +260,9 @@ QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetSameTagsOfDi
 template<>
 QList<QString> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetFilesThroughTag, QList<QString>>(const QMap<QString, QList<QString>> &filesAndTags);
 
+template<>///###: ---------------------------------------------------------------><Directory, []> -> <File, [Tags]>
+QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetTagsOfFilesInDirectory, QMap<QString, QVariant>>(const QMap<QString, QList<QString>> &filesAndTags);
+
 template<>
 QMap<QString, QVariant> DSqliteHandle::execSqlstr<DSqliteHandle::SqlType::GetAllTags, QMap<QString, QVariant>>(const QMap<QString, QList<QString>> &filesAndTags);
 
@@ -272,8 +320,8 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::TagFilesThroughColor3, Q
 
 ///###: untag files in same/diff partion.
 template<>
-bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles, std::list<QString>, bool>(
-    const std::list<QString> &sqlStrs, const QString &mountPoint);
+bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles, QMap<QString, QList<QString>>, bool>(
+    const QMap<QString, QList<QString>> &fileNameAndTagNames, const QString &mountPoint);
 template<>
 bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2, QMap<QString, QList<QString>>, bool>(const QMap<QString, QList<QString>> &fileNameAndTagNames,
                                                                                                                      const QString &mountPoint);
@@ -306,9 +354,9 @@ bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::DeleteTags3, QList<QStri
 
 
 ///###: change file(s) name.
-template<>
+template<> ///###: -------------------------------------------------------------> <OldFileName, NewFileName>
 bool DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeFilesName,
-     std::map<QString, QString>, bool>(const std::map<QString, QString> &sqlStrs, const QString &mountPoint);
+     std::map<QString, QString>, bool>(const std::map<QString, QString> &oldAndNewNames, const QString &mountPoint);
 
 template<>
 QMap<QString, QList<QString>> DSqliteHandle::helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
@@ -1651,8 +1651,7 @@ DFMGlobal::MenuExtension FileUtils::getMenuExtension(const DUrlList &urlList)
 
 bool FileUtils::isGvfsMountFile(const QString &filePath, const bool &isEx)
 {
-    static QMutex mutex;
-    QMutexLocker lk(&mutex);
+    // 目录加载和拷贝线程会逐个文件调用, 此处不加锁, 由 DStorageInfo 的挂载表快照保证线程安全
     if (filePath.isEmpty())
         return false;
 
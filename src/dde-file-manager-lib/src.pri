@@ -207,6 +207,7 @@ HEADERS += \
     $$PWD/plugins/dfmadditionalmenu.h \
     $$PWD/dialogs/connecttoserverdialog.h \
     $$PWD/shutil/dfmfilelistfile.h \
+    $$PWD/shutil/dfmtrashinfoindex.h \
     $$PWD/views/dfmsplitter.h \
     $$PWD/dbus/dbussysteminfo.h \
     $$PWD/models/deviceinfoparser.h \
@@ -444,6 +445,7 @@ SOURCES += \
     $$PWD/plugins/dfmadditionalmenu.cpp \
     $$PWD/dialogs/connecttoserverdialog.cpp \
     $$PWD/shutil/dfmfilelistfile.cpp \
+    $$PWD/shutil/dfmtrashinfoindex.cpp \
     $$PWD/views/dfmsplitter.cpp \
     $$PWD/dbus/dbussysteminfo.cpp \
     $$PWD/models/deviceinfoparser.cpp \
@@ -23,8 +23,20 @@
 #include <QDebug>
 #include <QVariant>
 #include <QStorageInfo>
+#include <QReadLocker>
+#include <QWriteLocker>
 
 #ifndef DDE_ANYTHINGMONITOR
+///###: the directories of which the tags are cached, the cache is dropped when it is full.
+static constexpr const int MaxCountOfCachedDirectories{ 256 };
+
+static QString parentDirectoryOfFile(const QString &file) noexcept
+{
+    int index{ file.lastIndexOf(QChar('/')) };
+
+    return index > 0 ? file.left(index) : QString{ "/" };
+}
+
 static QString randomColor() noexcept
 {
     std::random_device device{};
@@ -75,6 +87,15 @@ QList<QString> TagManager::getTagsThroughFiles(const QList<DUrl> &files)
 {
     QMap<QString, QVariant> string_var{};
 
+    ///###: the views query the tags file by file, answer them by the tags of the whole directory.
+    if (files.size() == 1 && files.first().isLocalFile()) {
+        const QString &file = files.first().toLocalFile();
+
+        if (!file.isEmpty()) {
+            return this->getTagsOfFilesInDirectory(DUrl::fromLocalFile(parentDirectoryOfFile(file))).value(file);
+        }
+    }
+
     if (!files.isEmpty()) {
 
         for (const DUrl &url : files) {
@@ -88,6 +109,75 @@ QList<QString> TagManager::getTagsThroughFiles(const QList<DUrl> &files)
     return QList<QString> {};
 }
 
+QMap<QString, QList<QString>> TagManager::getTagsOfFilesInDirectory(const DUrl &directory)
+{
+    QMap<QString, QList<QString>> file_and_tags{};
+    QString dir_path{ directory.toLocalFile() };
+
+    if (dir_path.isEmpty()) {
+        return file_and_tags;
+    }
+
+    if (dir_path.size() > 1 && dir_path.endsWith(QChar('/'))) {
+        dir_path.chop(1);
+    }
+
+    quint64 generation{ 0 };
+
+    {
+        QReadLocker raii_lock{ &m_tagsCacheLock };
+        QHash<QString, QMap<QString, QList<QString>>>::const_iterator itr{ m_tagsCacheOfDirectories.constFind(dir_path) };
+
+        if (itr != m_tagsCacheOfDirectories.cend()) {
+            return itr.value();
+        }
+
+        generation = m_tagsCacheGeneration;
+    }
+
+    QMap<QString, QVariant> string_var{ { dir_path, QVariant{ QList<QString>{} } } };
+    QVariant var{ TagManagerDaemonController::instance()->disposeClientData(string_var, Tag::ActionType::GetTagsOfFilesInDirectory) };
+    string_var = var.toMap();
+
+    QMap<QString, QVariant>::const_iterator c_beg{ string_var.cbegin() };
+    QMap<QString, QVariant>::const_iterator c_end{ string_var.cend() };
+
+    for (; c_beg != c_end; ++c_beg) {
+        file_and_tags[c_beg.key()] = c_beg.value().toStringList();
+    }
+
+    QWriteLocker raii_lock{ &m_tagsCacheLock };
+
+    ///###: the tags were changed during the query, the result may be out of date.
+    if (generation == m_tagsCacheGeneration) {
+
+        if (m_tagsCacheOfDirectories.size() >= MaxCountOfCachedDirectories) {
+            m_tagsCacheOfDirectories.clear();
+        }
+
+        m_tagsCacheOfDirectories[dir_path] = file_and_tags;
+    }
+
+    return file_and_tags;
+}
+
+void TagManager::removeTagsCacheOfFiles(const QList<QString> &files)
+{
+    QWriteLocker raii_lock{ &m_tagsCacheLock };
+    ++m_tagsCacheGeneration;
+
+    for (const QString &file : files) {
+        m_tagsCacheOfDirectories.remove(parentDirectoryOfFile(Tag::restore_escaped_en_skim(file)));
+    }
+}
+
+void TagManager::clearTagsCache()
+{
+    QWriteLocker raii_lock{ &m_tagsCacheLock };
+    ++m_tagsCacheGeneration;
+    m_tagsCacheOfDirectories.clear();
+}
+
 QMap<QString, QColor> TagManager::getTagColor(const QList<QString> &tags) const
 {
     QMap<QString, QColor> tag_and_color{};
@@ -226,6 +316,7 @@ bool TagManager::makeFilesTags(const QList<QString> &tags, const QList<DUrl> &fi
 
         if (insert_tags_var.toBool()) {
             tag_files_var = TagManagerDaemonController::instance()->disposeClientData(file_and_tag, Tag::ActionType::MakeFilesTags);
+            this->removeTagsCacheOfFiles(file_and_tag.keys());
         }
 
         if (insert_tags_var.toBool()) {
@@ -266,6 +357,7 @@ bool TagManager::removeTagsOfFiles(const QList<QString> &tags, const QList<DUrl>
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(file_and_tag, Tag::ActionType::RemoveTagsOfFiles) };
         result = var.toBool();
+        this->removeTagsCacheOfFiles(file_and_tag.keys());
     }
 
     return result;
@@ -284,6 +376,7 @@ bool TagManager::deleteTags(const QList<QString> &tags)
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(tag_and_placeholder, Tag::ActionType::DeleteTags) };
         result = var.toBool();
+        this->clearTagsCache();
     }
 
     return result;
@@ -303,6 +396,9 @@ bool TagManager::deleteFiles(const QList<DUrl> &fileList)
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(local_url_and_placeholder, Tag::ActionType::DeleteFiles) };
         result = var.toBool();
+#ifndef DDE_ANYTHINGMONITOR
+        TagManager::instance()->removeTagsCacheOfFiles(local_url_and_placeholder.keys());
+#endif
     }
 
     return result;
@@ -388,6 +484,7 @@ void TagManager::init_connect()noexcept
     });
 
     connect(TagManagerDaemonController::instance(), &TagManagerDaemonController::deleteTags, this, [ = ](const QVariant & be_deleted_tags) {
+        this->clearTagsCache();
 
         emit this->deleteTag(be_deleted_tags.toStringList());
     });
@@ -414,6 +511,7 @@ void TagManager::init_connect()noexcept
             old_and_new[c_beg.key()] = c_beg.value().toString();
         }
 
+        this->clearTagsCache();
         emit this->changeTagName(old_and_new);
     });
 
@@ -426,6 +524,7 @@ void TagManager::init_connect()noexcept
             file_and_tags[the_beg.key()] = the_beg.value().toStringList();
         }
 
+        this->removeTagsCacheOfFiles(file_and_tags.keys());
         emit this->filesWereTagged(file_and_tags);
     });
 
@@ -438,6 +537,7 @@ void TagManager::init_connect()noexcept
             file_and_tags[the_beg.key()] = the_beg.value().toStringList();
         }
 
+        this->removeTagsCacheOfFiles(file_and_tags.keys());
         emit this->untagFiles(file_and_tags);
     });
 }
@@ -451,6 +551,7 @@ bool TagManager::changeTagName(const QPair<QString, QString> &oldAndNewName)
         QMap<QString, QVariant> tag_name{ {oldAndNewName.first, QVariant{oldAndNewName.second}} };
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(tag_name, Tag::ActionType::ChangeTagName) };
         result = var.toBool();
+        this->clearTagsCache();
     }
 
     return result;
@@ -469,6 +570,7 @@ bool TagManager::makeFilesTagThroughColor(const QString &color, const QList<DUrl
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(local_url_and_tag, Tag::ActionType::MakeFilesTagThroughColor) };
         result = var.toBool();
+        this->removeTagsCacheOfFiles(local_url_and_tag.keys());
     }
 
     return result;
@@ -488,6 +590,15 @@ bool TagManager::changeFilesName(const QList<QPair<QByteArray, QByteArray>> &old
 
         QVariant var{ TagManagerDaemonController::instance()->disposeClientData(old_and_new_name, Tag::ActionType::ChangeFilesName) };
         result = var.toBool();
+#ifndef DDE_ANYTHINGMONITOR
+        QList<QString> renamed_files{ old_and_new_name.keys() };
+
+        for (const QVariant &new_name : old_and_new_name) {
+            renamed_files.push_back(new_name.toString());
+        }
+
+        TagManager::instance()->removeTagsCacheOfFiles(renamed_files);
+#endif
     }
 
     return result;
@@ -15,8 +15,10 @@
 #include <interfaces/durl.h>
 
 #include <QMap>
+#include <QHash>
 #include <QList>
 #include <QDebug>
+#include <QReadWriteLock>
 
 
 
@@ -86,6 +88,9 @@ public:
 
     QList<QString> getTagsThroughFiles(const QList<DUrl>& files);
 
+    ///###: <file, [tags]> of the files(which have tags) in the directory, by one call to the daemon.
+    QMap<QString, QList<QString>> getTagsOfFilesInDirectory(const DUrl& directory);
+
     QMap<QString, QColor> getTagColor(const QList<QString>& tags) const;
     QString getTagColorName(const QString &tag) const;
     QString getTagIconName(const QString &tag) const;
@@ -135,6 +140,15 @@ signals:
 
 private:
     void init_connect()noexcept;
+
+    void removeTagsCacheOfFiles(const QList<QString>& files);
+    void clearTagsCache();
+
+    QReadWriteLock m_tagsCacheLock{};
+    ///###: every change of tags increases it, the result queried before a change is not cached.
+    quint64 m_tagsCacheGeneration{ 0 };
+    ///###: <directory, <file, [tags]>>
+    QHash<QString, QMap<QString, QList<QString>>> m_tagsCacheOfDirectories{};
 #endif
 };
 
@@ -49,7 +49,8 @@ enum class ActionType : std::size_t {
     GetAllTags = 10,
     BeforeMakeFilesTags,
     GetTagsColor,
-    ChangeTagColor
+    ChangeTagColor,
+    GetTagsOfFilesInDirectory
 };
 
 extern const QMap<QString, QString> ColorsWithNames;
@@ -169,6 +169,7 @@ void DFMFileBasicInfoWidgetPrivate::startCalcFolderSize()
 
     if (!m_sizeWorker) {
         m_sizeWorker = new DFileStatisticsJob(q);
+        m_sizeWorker->setFileHints(DFileStatisticsJob::DeduplicateHardLinks);
         QObject::connect(m_sizeWorker, &DFileStatisticsJob::dataNotify, q, &DFMFileBasicInfoWidget::updateSizeText);
     }
 
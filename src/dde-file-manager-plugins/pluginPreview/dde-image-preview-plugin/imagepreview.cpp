@@ -41,6 +41,47 @@ DWIDGET_USE_NAMESPACE
 
 DFM_USE_NAMESPACE
 
+#define QT_IMAGE_MIME_TYPE "application/x-qt-image"
+
+/**
+ * @brief ImageMimeData 复制图片时提供的剪贴板数据
+ * 只有在粘贴方真正请求图片数据时才解码文件，复制操作本身不再解码整张原图
+ */
+class ImageMimeData : public QMimeData
+{
+public:
+    explicit ImageMimeData(const QString &fileName)
+        : m_fileName(fileName)
+    {
+    }
+
+    bool hasFormat(const QString &mimeType) const override
+    {
+        return mimeType == QT_IMAGE_MIME_TYPE || QMimeData::hasFormat(mimeType);
+    }
+
+    QStringList formats() const override
+    {
+        return QMimeData::formats() << QT_IMAGE_MIME_TYPE;
+    }
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QVariant::Type type) const override
+    {
+        if (mimeType != QT_IMAGE_MIME_TYPE)
+            return QMimeData::retrieveData(mimeType, type);
+
+        if (m_image.isNull())
+            m_image = QImage(m_fileName);
+
+        return m_image;
+    }
+
+private:
+    QString m_fileName;
+    mutable QImage m_image;
+};
+
 ImagePreview::ImagePreview(QObject *parent)
     : DFMFilePreview(parent)
 {
@@ -153,11 +194,7 @@ QString ImagePreview::title() const
 
 void ImagePreview::copyFile() const
 {
-    QMimeData *data = new QMimeData();
-    QImage image(m_url.toLocalFile());
-
-    if (!image.isNull())
-        data->setImageData(image);
+    QMimeData *data = new ImageMimeData(m_url.toLocalFile());
 
     DFMGlobal::setUrlsToClipboard({m_url}, DFMGlobal::CopyAction, data);
 }
@@ -33,12 +33,50 @@
 #include <QLabel>
 #include <QDebug>
 #include <QMovie>
+#include <QTimer>
+#include <QThreadPool>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QtConcurrent>
 
 #define MIN_SIZE QSize(400, 300)
+//! 每次滚轮缩放的倍数
+#define ZOOM_STEP 1.25
+//! 最多放大到一个图片像素占几个屏幕像素
+#define MAX_PIXEL_SCALE 4.0
+//! 停止缩放、拖动多久后再解码高分辨率图块(毫秒)
+#define TILE_DELAY 100
+//! 不支持裁剪解码的格式(如 png)放大时解码一次整张图片作为图块，解码的像素数不超过此值(约 64MB)
+#define MAX_FULL_DECODE_PIXELS (16 * 1024 * 1024)
+
+static QThreadPool *decodeThreadPool()
+{
+    // 大图解码的内存占用很高，只用一个线程串行解码
+    static QThreadPool pool;
+    static bool initialized = [] {
+        pool.setMaxThreadCount(1);
+        return true;
+    }();
+    Q_UNUSED(initialized)
+
+    return &pool;
+}
 
 ImageView::ImageView(const QString &fileName, const QByteArray &format, QWidget *parent)
     : QLabel(parent)
+    , m_imageSerial(new QAtomicInt(0))
+    , m_tileSerial(new QAtomicInt(0))
+    , m_imageWatcher(new QFutureWatcher<QImage>(this))
+    , m_tileWatcher(new QFutureWatcher<QImage>(this))
+    , m_tileTimer(new QTimer(this))
 {
+    m_tileTimer->setSingleShot(true);
+    m_tileTimer->setInterval(TILE_DELAY);
+
+    connect(m_imageWatcher, &QFutureWatcher<QImage>::finished, this, &ImageView::onImageDecoded);
+    connect(m_tileWatcher, &QFutureWatcher<QImage>::finished, this, &ImageView::onTileDecoded);
+    connect(m_tileTimer, &QTimer::timeout, this, &ImageView::requestTile);
+
     setFile(fileName, format);
     setMinimumSize(MIN_SIZE);
     setAlignment(Qt::AlignCenter);
@@ -46,6 +84,18 @@ ImageView::ImageView(const QString &fileName, const QByteArray &format, QWidget
 
 void ImageView::setFile(const QString &fileName, const QByteArray &format)
 {
+    // 使之前的解码请求全部过期，并且不再接收之前的解码结果
+    m_imageSerial->ref();
+    m_tileSerial->ref();
+    m_imageWatcher->setFuture(QFuture<QImage>());
+    m_tileWatcher->setFuture(QFuture<QImage>());
+    m_tileTimer->stop();
+    m_image = QImage();
+    m_tile = QImage();
+    m_tileScale = 0;
+    m_scale = 1;
+    m_displaySize = QSize();
+
     if (format == QByteArrayLiteral("gif")) {
         if (movie) {
             movie->stop(); // blumia: we need to stop it first before we load a new file
@@ -71,23 +121,315 @@ void ImageView::setFile(const QString &fileName, const QByteArray &format)
         tmpMovie->deleteLater();
     }
 
-    QImageReader reader(fileName, format);
+    m_fileName = fileName;
+    m_format = format;
 
+    // 只读取文件头得到图片大小，解码放到线程中进行
+    QImageReader reader(fileName, format);
     m_sourceSize = reader.size();
+    m_supportsClipRect = reader.supportsOption(QImageIOHandler::ClipRect);
+
+    QSize scaledSize;
 
-    const QSize &dsize = qApp->desktop()->size();
-    qreal device_pixel_ratio = this->devicePixelRatioF();
+    if (m_sourceSize.isValid()) {
+        const QSize &dsize = qApp->desktop()->size();
+        qreal device_pixel_ratio = this->devicePixelRatioF();
 
-    QPixmap pixmap = QPixmap::fromImageReader(&reader).scaled(QSize(qMin(static_cast<int>(dsize.width() * 0.7 * device_pixel_ratio), m_sourceSize.width()),
-                                                                    qMin(static_cast<int>(dsize.height() * 0.8 * device_pixel_ratio), m_sourceSize.height())),
-                                                              Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        scaledSize = m_sourceSize.scaled(QSize(qMin(static_cast<int>(dsize.width() * 0.7 * device_pixel_ratio), m_sourceSize.width()),
+                                               qMin(static_cast<int>(dsize.height() * 0.8 * device_pixel_ratio), m_sourceSize.height())),
+                                         Qt::KeepAspectRatio);
+        m_displaySize = scaledSize / device_pixel_ratio;
+        m_center = QPointF(m_sourceSize.width() / 2.0, m_sourceSize.height() / 2.0);
+    }
 
-    pixmap.setDevicePixelRatio(device_pixel_ratio);
+    // 只按显示的分辨率解码，不必先解码出原图再缩小
+    m_imageWatcher->setFuture(decode(m_imageSerial, QRect(), scaledSize));
 
-    setPixmap(pixmap);
+    updateGeometry();
+    update();
 }
 
 QSize ImageView::sourceSize() const
 {
     return m_sourceSize;
 }
+
+QSize ImageView::sizeHint() const
+{
+    if (movie || !m_displaySize.isValid())
+        return QLabel::sizeHint();
+
+    return m_displaySize.expandedTo(MIN_SIZE);
+}
+
+QImage ImageView::readImage(const QString &fileName, const QByteArray &format, const QRect &clipRect, const QSize &scaledSize)
+{
+    QImageReader reader(fileName, format);
+
+    // 支持 ClipRect/ScaledSize 的格式(如 jpeg)在解码时直接裁剪和缩小，其它格式由 QImageReader 解码后处理
+    if (clipRect.isValid())
+        reader.setClipRect(clipRect);
+
+    if (scaledSize.isValid())
+        reader.setScaledSize(scaledSize);
+
+    const QImage &image = reader.read();
+
+    if (image.isNull())
+        qWarning() << "read image failed :" << fileName << reader.errorString();
+
+    return image;
+}
+
+void ImageView::paintEvent(QPaintEvent *event)
+{
+    if (movie || m_image.isNull())
+        return QLabel::paintEvent(event);
+
+    QPainter painter(this);
+    const QRectF &target = imageRect();
+
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(target, m_image);
+
+    if (!m_tile.isNull() && m_scale > 1) {
+        const qreal scale = fitScale() * m_scale;
+        // 图块可能是整张原图，只绘制其中可见的部分
+        const QRect &visible = visibleSourceRect() & m_tileSourceRect;
+        const qreal tileScaleX = static_cast<qreal>(m_tile.width()) / m_tileSourceRect.width();
+        const qreal tileScaleY = static_cast<qreal>(m_tile.height()) / m_tileSourceRect.height();
+
+        if (!visible.isEmpty()) {
+            painter.drawImage(QRectF(target.topLeft() + QPointF(visible.topLeft()) * scale, QSizeF(visible.size()) * scale),
+                              m_tile,
+                              QRectF((visible.x() - m_tileSourceRect.x()) * tileScaleX, (visible.y() - m_tileSourceRect.y()) * tileScaleY,
+                                     visible.width() * tileScaleX, visible.height() * tileScaleY));
+        }
+    }
+}
+
+void ImageView::resizeEvent(QResizeEvent *event)
+{
+    QLabel::resizeEvent(event);
+
+    clampCenter();
+
+    if (m_scale > 1)
+        m_tileTimer->start();
+}
+
+void ImageView::wheelEvent(QWheelEvent *event)
+{
+    if (movie || m_image.isNull())
+        return QLabel::wheelEvent(event);
+
+    const int delta = event->angleDelta().y();
+
+    if (delta == 0)
+        return;
+
+    setScale(delta > 0 ? m_scale * ZOOM_STEP : m_scale / ZOOM_STEP, event->posF());
+    event->accept();
+}
+
+void ImageView::mousePressEvent(QMouseEvent *event)
+{
+    m_lastMousePos = event->pos();
+
+    QLabel::mousePressEvent(event);
+}
+
+void ImageView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!(event->buttons() & Qt::LeftButton) || m_scale <= 1 || m_image.isNull())
+        return QLabel::mouseMoveEvent(event);
+
+    m_center -= QPointF(event->pos() - m_lastMousePos) / (fitScale() * m_scale);
+    m_lastMousePos = event->pos();
+    clampCenter();
+    update();
+    m_tileTimer->start();
+}
+
+QFuture<QImage> ImageView::decode(const QSharedPointer<QAtomicInt> &serial, const QRect &clipRect, const QSize &scaledSize) const
+{
+    const int currentSerial = serial->load();
+    const QString fileName = m_fileName;
+    const QByteArray format = m_format;
+
+    return QtConcurrent::run(decodeThreadPool(), [serial, currentSerial, fileName, format, clipRect, scaledSize] {
+        // 排队期间已经有了新的请求(如切换到了下一个文件)，不再解码
+        if (serial->load() != currentSerial)
+            return QImage();
+
+        return readImage(fileName, format, clipRect, scaledSize);
+    });
+}
+
+void ImageView::onImageDecoded()
+{
+    // 切换文件时取消监视的空结果
+    if (m_imageWatcher->future().resultCount() == 0)
+        return;
+
+    QImage image = m_imageWatcher->result();
+
+    if (image.isNull())
+        return;
+
+    // 无法从文件头得到大小的格式，解码后再按显示大小缩小
+    if (!m_sourceSize.isValid()) {
+        const QSize &dsize = qApp->desktop()->size();
+        qreal device_pixel_ratio = this->devicePixelRatioF();
+
+        m_sourceSize = image.size();
+        image = image.scaled(QSize(qMin(static_cast<int>(dsize.width() * 0.7 * device_pixel_ratio), m_sourceSize.width()),
+                                   qMin(static_cast<int>(dsize.height() * 0.8 * device_pixel_ratio), m_sourceSize.height())),
+                             Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        m_displaySize = image.size() / device_pixel_ratio;
+        m_center = QPointF(m_sourceSize.width() / 2.0, m_sourceSize.height() / 2.0);
+        updateGeometry();
+    }
+
+    m_image = image;
+    update();
+}
+
+void ImageView::onTileDecoded()
+{
+    // 请求图块后切换了文件或者缩小回了原始大小，丢弃过期的图块
+    if (m_tileWatcher->future().resultCount() == 0 || m_pendingTileSerial != m_tileSerial->load())
+        return;
+
+    const QImage &image = m_tileWatcher->result();
+
+    if (image.isNull())
+        return;
+
+    m_tile = image;
+    m_tileSourceRect = m_pendingTileSourceRect;
+    m_tileScale = m_pendingTileScale;
+    update();
+}
+
+void ImageView::requestTile()
+{
+    // 整张图片已经是原图分辨率时不需要图块
+    if (m_scale <= 1 || m_image.isNull() || m_image.width() >= m_sourceSize.width())
+        return;
+
+    // 图块的分辨率最高为原图的分辨率，大小不超过控件本身的像素数
+    qreal tileScale = qMin<qreal>(1, fitScale() * m_scale * devicePixelRatioF());
+    const QRect &sourceRect = visibleSourceRect();
+
+    if (sourceRect.isEmpty())
+        return;
+
+    // 不支持裁剪解码的格式每个图块都要解码整张图片，改为按当前需要的分辨率解码一次整张图片，
+    // 之后缩放和拖动都使用此图块，继续放大需要更高的分辨率时才重新解码，解码的像素数有上限
+    if (!m_supportsClipRect)
+        tileScale = qMin(tileScale, qSqrt(MAX_FULL_DECODE_PIXELS / (static_cast<qreal>(m_sourceSize.width()) * m_sourceSize.height())));
+
+    if (!m_tile.isNull() && m_tileSourceRect.contains(sourceRect) && m_tileScale >= tileScale)
+        return;
+
+    if (!m_supportsClipRect) {
+        const QSize &scaledSize = (QSizeF(m_sourceSize) * tileScale).toSize();
+
+        // 分辨率不比已经显示的图片高
+        if (scaledSize.width() <= m_image.width())
+            return;
+
+        // 分辨率足够的图块正在解码
+        if (m_pendingTileSerial == m_tileSerial->load() && m_tileWatcher->isRunning() && m_pendingTileScale >= tileScale)
+            return;
+
+        m_pendingTileSerial = m_tileSerial->fetchAndAddOrdered(1) + 1;
+        m_pendingTileSourceRect = QRect(QPoint(0, 0), m_sourceSize);
+        m_pendingTileScale = tileScale;
+        m_tileWatcher->setFuture(decode(m_tileSerial, QRect(), tileScale < 1 ? scaledSize : QSize()));
+        return;
+    }
+
+    m_pendingTileSerial = m_tileSerial->fetchAndAddOrdered(1) + 1;
+    m_pendingTileSourceRect = sourceRect;
+    m_pendingTileScale = tileScale;
+    m_tileWatcher->setFuture(decode(m_tileSerial, sourceRect, (QSizeF(sourceRect.size()) * tileScale).toSize()));
+}
+
+void ImageView::setScale(qreal scale, const QPointF &anchor)
+{
+    const qreal maxScale = qMax<qreal>(1, MAX_PIXEL_SCALE / (fitScale() * devicePixelRatioF()));
+
+    scale = qBound<qreal>(1, scale, maxScale);
+
+    if (qFuzzyCompare(scale, m_scale))
+        return;
+
+    // 保持鼠标下的图片位置不变
+    const QPointF &sourcePos = (anchor - imageRect().topLeft()) / (fitScale() * m_scale);
+
+    m_scale = scale;
+    m_center = sourcePos - (anchor - QRectF(rect()).center()) / (fitScale() * m_scale);
+    clampCenter();
+
+    if (m_scale <= 1) {
+        m_tileTimer->stop();
+
+        // 不支持裁剪解码的格式保留解码好的整张图片，再次放大时不用重新解码
+        if (m_supportsClipRect) {
+            m_tileSerial->ref();
+            m_tileWatcher->setFuture(QFuture<QImage>());
+            m_tile = QImage();
+            m_tileScale = 0;
+        }
+    } else {
+        m_tileTimer->start();
+    }
+
+    update();
+}
+
+void ImageView::clampCenter()
+{
+    if (!m_sourceSize.isValid())
+        return;
+
+    const qreal scale = fitScale() * m_scale;
+    const qreal halfWidth = width() / scale / 2;
+    const qreal halfHeight = height() / scale / 2;
+
+    // 图片比控件小的方向居中显示，否则不允许拖出图片的边界
+    if (m_sourceSize.width() <= halfWidth * 2)
+        m_center.setX(m_sourceSize.width() / 2.0);
+    else
+        m_center.setX(qBound(halfWidth, m_center.x(), m_sourceSize.width() - halfWidth));
+
+    if (m_sourceSize.height() <= halfHeight * 2)
+        m_center.setY(m_sourceSize.height() / 2.0);
+    else
+        m_center.setY(qBound(halfHeight, m_center.y(), m_sourceSize.height() - halfHeight));
+}
+
+qreal ImageView::fitScale() const
+{
+    if (!m_sourceSize.isValid() || m_sourceSize.width() <= 0)
+        return 1;
+
+    return static_cast<qreal>(m_displaySize.width()) / m_sourceSize.width();
+}
+
+QRectF ImageView::imageRect() const
+{
+    const qreal scale = fitScale() * m_scale;
+
+    return QRectF(QRectF(rect()).center() - m_center * scale, QSizeF(m_sourceSize) * scale);
+}
+
+QRect ImageView::visibleSourceRect() const
+{
+    const qreal scale = fitScale() * m_scale;
+    const QRectF sourceRect(-imageRect().topLeft() / scale, QSizeF(size()) / scale);
+
+    return sourceRect.toAlignedRect() & QRect(QPoint(0, 0), m_sourceSize);
+}
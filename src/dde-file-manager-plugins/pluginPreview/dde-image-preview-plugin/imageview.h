@@ -24,6 +24,11 @@
 #define IMAGEVIEW_H
 
 #include <QLabel>
+#include <QImage>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+
+class QTimer;
 
 class ImageView : public QLabel
 {
@@ -33,10 +38,62 @@ public:
 
     void setFile(const QString &fileName, const QByteArray &format);
     QSize sourceSize() const;
+    QSize sizeHint() const override;
+
+    //! 按 scaledSize 解码图片中的 clipRect 区域，clipRect 无效时解码整张图片
+    static QImage readImage(const QString &fileName, const QByteArray &format, const QRect &clipRect, const QSize &scaledSize);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
 
 private:
+    QFuture<QImage> decode(const QSharedPointer<QAtomicInt> &serial, const QRect &clipRect, const QSize &scaledSize) const;
+    void onImageDecoded();
+    void onTileDecoded();
+    void requestTile();
+
+    void setScale(qreal scale, const QPointF &anchor);
+    void clampCenter();
+    qreal fitScale() const;
+    QRectF imageRect() const;
+    QRect visibleSourceRect() const;
+
     QSize m_sourceSize;
     QMovie *movie = nullptr;
+
+    QString m_fileName;
+    QByteArray m_format;
+    //! 适应窗口时的显示大小(逻辑像素)
+    QSize m_displaySize;
+    //! 按显示大小解码的整张图片
+    QImage m_image;
+    //! 格式支持解码时裁剪(如 jpeg)，否则每次解码图块都要解码整张图片
+    bool m_supportsClipRect = false;
+
+    //! 相对于适应窗口大小的缩放比例
+    qreal m_scale = 1;
+    //! 控件中心对应的图片坐标
+    QPointF m_center;
+    QPoint m_lastMousePos;
+
+    //! 放大后可见区域的高分辨率图块，m_tileSourceRect 为其在图片中的区域
+    QImage m_tile;
+    QRect m_tileSourceRect;
+    qreal m_tileScale = 0;
+    QRect m_pendingTileSourceRect;
+    qreal m_pendingTileScale = 0;
+    int m_pendingTileSerial = 0;
+
+    //! 解码请求的序号，排队中的过期请求不再解码
+    QSharedPointer<QAtomicInt> m_imageSerial;
+    QSharedPointer<QAtomicInt> m_tileSerial;
+    QFutureWatcher<QImage> *m_imageWatcher;
+    QFutureWatcher<QImage> *m_tileWatcher;
+    QTimer *m_tileTimer;
 };
 
 #endif // IMAGEVIEW_H
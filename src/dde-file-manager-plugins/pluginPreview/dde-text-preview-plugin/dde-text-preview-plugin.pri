@@ -1,9 +1,13 @@
 SOURCES += \
     textpreview.cpp \
+    textfileindex.cpp \
+    largetextview.cpp \
     $$PWD/textpreviewplugin.cpp
 
 HEADERS += \
     textpreview.h \
+    textfileindex.h \
+    largetextview.h \
     $$PWD/textpreviewplugin.h
 
 
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "largetextview.h"
+#include "textfileindex.h"
+
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextOption>
+
+//! 制表符宽度(空格数)
+#define TABSTOPSIZE 8
+
+LargeTextView::LargeTextView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    viewport()->setBackgroundRole(QPalette::Base);
+    viewport()->setAutoFillBackground(true);
+    verticalScrollBar()->setSingleStep(1);
+}
+
+void LargeTextView::setIndex(TextFileIndex *index)
+{
+    if (m_index)
+        disconnect(m_index, nullptr, this, nullptr);
+
+    m_index = index;
+    m_contentWidth = 0;
+
+    if (m_index)
+        connect(m_index, &TextFileIndex::lineCountChanged, this, &LargeTextView::updateScrollBars);
+
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    updateScrollBars();
+    viewport()->update();
+}
+
+TextFileIndex *LargeTextView::index() const
+{
+    return m_index;
+}
+
+void LargeTextView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+
+    if (!m_index)
+        return;
+
+    QPainter painter(viewport());
+    const QFontMetrics &fm = fontMetrics();
+    const int lineHeight = fm.lineSpacing();
+    const QStringList &lines = m_index->lines(verticalScrollBar()->value(), visibleLineCount());
+    const int x = -horizontalScrollBar()->value();
+    int y = 0;
+    int contentWidth = m_contentWidth;
+    QTextOption option;
+
+    option.setWrapMode(QTextOption::NoWrap);
+    option.setTabStopDistance(fm.horizontalAdvance(QLatin1Char(' ')) * TABSTOPSIZE);
+    painter.setPen(palette().color(QPalette::Text));
+
+    for (const QString &line : lines) {
+        const int width = fm.horizontalAdvance(line);
+
+        painter.drawText(QRectF(x, y, qMax(width, viewport()->width()) + fm.maxWidth(), lineHeight), line, option);
+        contentWidth = qMax(contentWidth, width);
+        y += lineHeight;
+    }
+
+    // 行宽只有在绘制时才知道，遇到更宽的行时再扩大横向滚动范围
+    if (contentWidth != m_contentWidth) {
+        m_contentWidth = contentWidth;
+        updateScrollBars();
+    }
+}
+
+void LargeTextView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+
+    updateScrollBars();
+}
+
+void LargeTextView::updateScrollBars()
+{
+    const int visibleLines = visibleLineCount();
+    const qint64 lineCount = m_index ? m_index->lineCount() : 0;
+    const qint64 maxValue = qMax<qint64>(0, lineCount - visibleLines + 1);
+
+    verticalScrollBar()->setPageStep(visibleLines);
+    verticalScrollBar()->setRange(0, static_cast<int>(qMin<qint64>(maxValue, INT_MAX)));
+
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(fontMetrics().averageCharWidth());
+    horizontalScrollBar()->setRange(0, qMax(0, m_contentWidth - viewport()->width()));
+}
+
+int LargeTextView::visibleLineCount() const
+{
+    return viewport()->height() / fontMetrics().lineSpacing() + 1;
+}
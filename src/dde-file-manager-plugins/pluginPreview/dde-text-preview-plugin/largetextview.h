@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LARGETEXTVIEW_H
+#define LARGETEXTVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QPointer>
+
+class TextFileIndex;
+
+/**
+ * @brief LargeTextView 大文本文件的预览控件
+ * 纵向滚动条以行为单位，每次绘制只从 TextFileIndex 中取出可见的几行进行解码和排版
+ */
+class LargeTextView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LargeTextView(QWidget *parent = nullptr);
+
+    void setIndex(TextFileIndex *index);
+    TextFileIndex *index() const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private slots:
+    void updateScrollBars();
+
+private:
+    int visibleLineCount() const;
+
+    QPointer<TextFileIndex> m_index;
+    //! 已经绘制过的行的最大宽度，用于横向滚动
+    int m_contentWidth = 0;
+};
+
+#endif // LARGETEXTVIEW_H
@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textfileindex.h"
+
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+//! 建立索引时通知界面更新行数的最小间隔(毫秒)
+#define NOTIFYINTERVAL 100
+//! 建立索引时每次读取的大小
+#define INDEXCHUNKSIZE (1024 * 1024)
+//! 读取显示的文本时每次读取的大小
+#define LINESCHUNKSIZE (64 * 1024)
+
+TextFileIndex::TextFileIndex(QObject *parent)
+    : QObject(parent)
+{
+
+}
+
+TextFileIndex::~TextFileIndex()
+{
+    close();
+}
+
+bool TextFileIndex::open(const QString &filePath)
+{
+    close();
+
+    m_file.setFileName(filePath);
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "open file failed :" << filePath << m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+
+    if (m_size <= 0) {
+        m_file.close();
+        m_size = 0;
+        return false;
+    }
+
+    m_future = QtConcurrent::run(this, &TextFileIndex::buildIndex);
+
+    return true;
+}
+
+void TextFileIndex::close()
+{
+    m_canceled.store(1);
+    m_future.waitForFinished();
+
+    if (m_file.isOpen())
+        m_file.close();
+
+    m_size = 0;
+    m_checkpoints.clear();
+    m_lineCount.store(0);
+    m_finished.store(0);
+    m_canceled.store(0);
+}
+
+bool TextFileIndex::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+bool TextFileIndex::isFinished() const
+{
+    return m_finished.load();
+}
+
+qint64 TextFileIndex::fileSize() const
+{
+    return m_size;
+}
+
+qint64 TextFileIndex::lineCount() const
+{
+    return m_lineCount.load();
+}
+
+QStringList TextFileIndex::lines(qint64 firstLine, int count) const
+{
+    QStringList result;
+
+    if (!m_file.isOpen() || firstLine < 0 || count <= 0)
+        return result;
+
+    qint64 line = 0;
+    qint64 pos = 0;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        const qint64 checkpoint = firstLine / kCheckpointInterval;
+
+        if (checkpoint >= m_checkpoints.size())
+            return result;
+
+        line = checkpoint * kCheckpointInterval;
+        pos = m_checkpoints.at(static_cast<int>(checkpoint));
+    }
+
+    Window window(LINESCHUNKSIZE);
+
+    // 从记录点向后找到第一行，最多跳过 kCheckpointInterval - 1 行
+    while (line < firstLine && pos >= 0 && pos < m_size) {
+        pos = nextLineStartInFile(&window, pos);
+        ++line;
+    }
+
+    while (result.size() < count && pos >= 0 && pos < m_size) {
+        qint64 lineEnd = pos;
+        const qint64 next = nextLineStartInFile(&window, pos, &lineEnd);
+
+        if (next < 0)
+            break;
+
+        result << QString::fromLocal8Bit(window.buffer.constData() + (pos - window.start), static_cast<int>(lineEnd - pos));
+        pos = next;
+    }
+
+    return result;
+}
+
+bool TextFileIndex::fillWindow(TextFileIndex::Window *window, qint64 pos) const
+{
+    const qint64 windowEnd = window->start + window->length;
+
+    if (pos >= window->start && pos < windowEnd && (window->atEnd || pos + kMaxLineLength < windowEnd))
+        return true;
+
+    const qint64 size = qMin(window->chunkSize, m_size - pos);
+
+    window->buffer.resize(static_cast<int>(qMax<qint64>(size, 0)));
+    window->start = pos;
+    window->length = 0;
+
+    while (window->length < size) {
+        const ssize_t ret = ::pread(m_file.handle(), window->buffer.data() + window->length,
+                                    static_cast<size_t>(size - window->length), pos + window->length);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret <= 0)
+            break;
+
+        window->length += ret;
+    }
+
+    // 读到的数据比预期少说明文件被截断了，之后不再向后读取
+    window->atEnd = window->length < size || pos + window->length >= m_size;
+
+    return window->length > 0;
+}
+
+qint64 TextFileIndex::nextLineStartInFile(TextFileIndex::Window *window, qint64 pos, qint64 *lineEnd) const
+{
+    if (!fillWindow(window, pos))
+        return -1;
+
+    qint64 end = 0;
+    const qint64 next = nextLineStart(window->buffer.constData(), window->length, pos - window->start, &end);
+
+    if (lineEnd)
+        *lineEnd = window->start + end;
+
+    return window->start + next;
+}
+
+qint64 TextFileIndex::nextLineStart(const char *data, qint64 size, qint64 pos, qint64 *lineEnd)
+{
+    const qint64 limit = qMin(size - pos, kMaxLineLength);
+    const char *newline = reinterpret_cast<const char *>(memchr(data + pos, '\n', static_cast<size_t>(limit)));
+
+    if (newline) {
+        qint64 end = newline - data;
+
+        if (lineEnd)
+            *lineEnd = (end > pos && data[end - 1] == '\r') ? end - 1 : end;
+
+        return end + 1;
+    }
+
+    qint64 end = pos + limit;
+
+    // 超长行在 UTF-8 字符的边界处折断，避免把一个字符拆成两半
+    if (end < size) {
+        for (int i = 0; i < 3 && end - 1 > pos && (data[end] & 0xC0) == 0x80; ++i)
+            --end;
+    }
+
+    if (lineEnd)
+        *lineEnd = end;
+
+    return end;
+}
+
+void TextFileIndex::buildIndex()
+{
+    QElapsedTimer timer;
+    Window window(INDEXCHUNKSIZE);
+    qint64 pos = 0;
+    qint64 line = 0;
+
+    timer.start();
+
+    while (pos < m_size) {
+        if (line % kCheckpointInterval == 0) {
+            if (m_canceled.load())
+                return;
+
+            {
+                QMutexLocker locker(&m_mutex);
+                m_checkpoints.append(pos);
+            }
+
+            if (timer.elapsed() > NOTIFYINTERVAL) {
+                Q_EMIT lineCountChanged();
+                timer.restart();
+            }
+        }
+
+        pos = nextLineStartInFile(&window, pos);
+
+        // 文件被截断，索引到已读取的位置为止
+        if (pos < 0)
+            break;
+
+        m_lineCount.store(++line);
+    }
+
+    m_finished.store(1);
+
+    Q_EMIT lineCountChanged();
+    Q_EMIT finished();
+}
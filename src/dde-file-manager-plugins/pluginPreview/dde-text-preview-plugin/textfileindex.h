@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEXTFILEINDEX_H
+#define TEXTFILEINDEX_H
+
+#include <QObject>
+#include <QFile>
+#include <QFuture>
+#include <QMutex>
+#include <QVector>
+#include <QStringList>
+
+/**
+ * @brief TextFileIndex 大文本文件的行索引
+ * 后台线程按块 pread 文件，扫描换行符建立稀疏的行起始位置索引(每 kCheckpointInterval 行记录一次)，
+ * 读取时从最近的记录点向后查找，只读取和解码需要显示的几行文本，内存占用与文件大小基本无关。
+ * 不使用 mmap，文件在预览期间被其它程序截断时只会读到更少的内容，不会因访问映射区域触发 SIGBUS
+ */
+class TextFileIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    //! 每隔多少行记录一次行起始位置
+    static constexpr int kCheckpointInterval = 256;
+    //! 单行最多的字节数，超出的部分折到下一行显示
+    static constexpr qint64 kMaxLineLength = 4096;
+
+    explicit TextFileIndex(QObject *parent = nullptr);
+    ~TextFileIndex() override;
+
+    bool open(const QString &filePath);
+    void close();
+
+    bool isOpen() const;
+    bool isFinished() const;
+    qint64 fileSize() const;
+    //! 目前已经索引到的行数，索引建立完成前会不断增长
+    qint64 lineCount() const;
+
+    //! 获取从 firstLine 开始最多 count 行的文本
+    QStringList lines(qint64 firstLine, int count) const;
+
+    //! 返回 pos 所在行的下一行的起始位置，lineEnd 为该行不含换行符的结束位置
+    static qint64 nextLineStart(const char *data, qint64 size, qint64 pos, qint64 *lineEnd = nullptr);
+
+Q_SIGNALS:
+    void lineCountChanged();
+    void finished();
+
+private:
+    //! 文件中一段连续的内容
+    struct Window {
+        explicit Window(qint64 chunkSize) : chunkSize(chunkSize) {}
+
+        //! 每次读取的大小
+        const qint64 chunkSize;
+        QByteArray buffer;
+        qint64 start = 0;
+        qint64 length = 0;
+        //! 缓冲区已读到文件末尾(或者文件被截断后的末尾)
+        bool atEnd = false;
+    };
+
+    //! 保证 pos 所在的行(最多 kMaxLineLength 字节)在缓冲区中，pos 处已经没有数据时返回 false
+    bool fillWindow(Window *window, qint64 pos) const;
+    //! 返回 pos 所在行的下一行在文件中的起始位置，读取失败时返回 -1
+    qint64 nextLineStartInFile(Window *window, qint64 pos, qint64 *lineEnd = nullptr) const;
+    void buildIndex();
+
+    QFile m_file;
+    qint64 m_size = 0;
+
+    mutable QMutex m_mutex;
+    //! 第 i * kCheckpointInterval 行的起始位置
+    QVector<qint64> m_checkpoints;
+    QAtomicInteger<qint64> m_lineCount;
+    QAtomicInt m_finished;
+    QAtomicInt m_canceled;
+    QFuture<void> m_future;
+};
+
+#endif // TEXTFILEINDEX_H
@@ -21,6 +21,8 @@
 */
 
 #include "textpreview.h"
+#include "textfileindex.h"
+#include "largetextview.h"
 #include "dabstractfileinfo.h"
 #include "dfileservices.h"
 
@@ -28,28 +30,39 @@
 #include <QMimeType>
 #include <QMimeDatabase>
 #include <QUrl>
+#include <QFile>
 #include <QFileInfo>
 #include <QPlainTextEdit>
+#include <QStackedWidget>
 #include <QDebug>
 #include <QScrollBar>
 #include <QTimer>
 
-using namespace std;
 DFM_USE_NAMESPACE
 
 #define READTEXTSIZE 100000
+//! 超过此大小的文件使用大文件模式预览
+#define LARGEFILESIZE (4 * 1024 * 1024)
 
 TextPreview::TextPreview(QObject *parent):
     DFMFilePreview(parent)
 {
     m_timer = new QTimer(this);
     connect(m_timer, &QTimer::timeout, this, &TextPreview::appendText);
+
+    m_textIndex = new TextFileIndex(this);
 }
 
 TextPreview::~TextPreview()
 {
-    if (m_textBrowser)
-        m_textBrowser->deleteLater();
+    // m_textIndex随本对象一起析构，而m_contentWidget延迟删除，先断开视图与索引的关联，
+    // 避免视图在删除前绘制时访问已经析构的索引
+    if (m_contentWidget) {
+        m_largeTextView->setIndex(nullptr);
+        m_contentWidget->deleteLater();
+    }
+
+    m_textIndex->close();
 
     if(m_timer){
         m_timer->stop();
@@ -70,39 +83,59 @@ bool TextPreview::setFileUrl(const DUrl &url)
     if (!info)
         return false;
 
-    m_device.open(info->toLocalFile().toLocal8Bit().data(), ios::binary);
+    const QString &filePath = info->toLocalFile();
+    QFile file(filePath);
 
-    if(!m_device.is_open()){
+    if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "open file failed :" << m_url;
         return false;
     }
 
-    if (!m_textBrowser) {
-        m_textBrowser = new QPlainTextEdit();
+    if (!m_contentWidget) {
+        m_contentWidget = new QStackedWidget();
+        m_contentWidget->setFixedSize(800, 500);
+
+        m_textBrowser = new QPlainTextEdit(m_contentWidget);
 
         m_textBrowser->setReadOnly(true);
         m_textBrowser->setTextInteractionFlags(Qt::TextSelectableByMouse | Qt::TextSelectableByKeyboard);
         m_textBrowser->setWordWrapMode(QTextOption::NoWrap);
-        m_textBrowser->setFixedSize(800, 500);
         m_textBrowser->setFocusPolicy(Qt::NoFocus);
         m_textBrowser->setContextMenuPolicy(Qt::NoContextMenu);
+
+        m_largeTextView = new LargeTextView(m_contentWidget);
+        m_largeTextView->setFocusPolicy(Qt::NoFocus);
+        m_largeTextView->setContextMenuPolicy(Qt::NoContextMenu);
+
+        m_contentWidget->addWidget(m_textBrowser);
+        m_contentWidget->addWidget(m_largeTextView);
     }
 
     m_title = info->fileName();
 
-    long len = m_device.seekg(0, ios::end).tellg();
+    const qint64 len = file.size();
     if (len <= 0)
         return false;
 
-    vector<char> buf(static_cast<unsigned long>(len));
-    m_device.seekg(0, ios::beg).read(&buf[0], static_cast<streamsize>(buf.size()));
-    m_device.close();
+    m_largeTextView->setIndex(nullptr);
+    m_textIndex->close();
+    m_textData.clear();
+
+    // 大文件映射到内存后在后台建立行索引，只解码可见的行，打开速度和内存占用与文件大小无关
+    if (len > LARGEFILESIZE && m_textIndex->open(filePath)) {
+        m_textBrowser->clear();
+        m_largeTextView->setIndex(m_textIndex);
+        m_contentWidget->setCurrentWidget(m_largeTextView);
+
+        Q_EMIT titleChanged();
+
+        return true;
+    }
+
+    m_textData = QString::fromLocal8Bit(file.readAll());
+    file.close();
 
-    char *txt = new char[buf.size() + 1];
-    copy(buf.begin(), buf.end(), txt);
-    m_textData = QString::fromLocal8Bit(txt, static_cast<int>(buf.size()));
-    delete [] txt;
-    txt = nullptr;
+    m_contentWidget->setCurrentWidget(m_textBrowser);
     m_textSize = m_textData.count();
     m_readSize = m_textSize > READTEXTSIZE ? READTEXTSIZE : m_textSize;
     if(m_textSize > m_readSize) {
@@ -125,7 +158,7 @@ DUrl TextPreview::fileUrl() const
 
 QWidget *TextPreview::contentWidget() const
 {
-    return m_textBrowser;
+    return m_contentWidget;
 }
 
 QString TextPreview::title() const
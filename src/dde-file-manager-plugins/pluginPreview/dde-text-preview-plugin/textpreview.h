@@ -30,12 +30,14 @@
 #include "dfmfilepreview.h"
 #include "durl.h"
 
-#include <fstream>
-
 QT_BEGIN_NAMESPACE
 class QPlainTextEdit;
+class QStackedWidget;
 QT_END_NAMESPACE
 
+class TextFileIndex;
+class LargeTextView;
+
 class TextPreview : public DFM_NAMESPACE::DFMFilePreview
 {
     Q_OBJECT
@@ -61,10 +63,14 @@ private:
     DUrl m_url;
     QString m_title;
 
-    QPointer<QPlainTextEdit> m_textBrowser;
+    QPointer<QStackedWidget> m_contentWidget;
+
+    QPlainTextEdit *m_textBrowser {nullptr};
+
+    //! 大文件预览时只解码和绘制可见的行
+    LargeTextView *m_largeTextView {nullptr};
 
-    //! 操作文件的对象
-    std::ifstream m_device;
+    TextFileIndex *m_textIndex {nullptr};
 
     QTimer *m_timer {nullptr};
 
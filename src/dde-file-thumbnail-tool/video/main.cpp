@@ -28,8 +28,116 @@
 #include <sstream>
 #include <cstring>
 
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// 请求中文件路径的最大长度
+static const uint32_t kMaxPathLength = 64 * 1024;
+
+static bool readFull(int fd, void *data, size_t size)
+{
+    char *buffer = static_cast<char *>(data);
+
+    while (size > 0) {
+        ssize_t ret = read(fd, buffer, size);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret <= 0)
+            return false;
+
+        buffer += ret;
+        size -= static_cast<size_t>(ret);
+    }
+
+    return true;
+}
+
+static bool writeFull(int fd, const void *data, size_t size)
+{
+    const char *buffer = static_cast<const char *>(data);
+
+    while (size > 0) {
+        ssize_t ret = write(fd, buffer, size);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret <= 0)
+            return false;
+
+        buffer += ret;
+        size -= static_cast<size_t>(ret);
+    }
+
+    return true;
+}
+
+static bool writeReply(int fd, int32_t status, const void *data, uint32_t size)
+{
+    const uint32_t header[2] = { static_cast<uint32_t>(status), size };
+
+    return writeFull(fd, header, sizeof(header)) && writeFull(fd, data, size);
+}
+
+/*!
+ * \brief 常驻模式，由文件管理器启动后通过管道依次生成缩略图，直到标准输入被关闭
+ * 请求: uint32 缩略图大小, uint32 路径长度, 路径
+ * 回复: int32 状态(0 为成功), uint32 数据长度, 数据(成功时为 png 图片, 失败时为错误信息)
+ * 整数均为本机字节序
+ */
+static int runBatch()
+{
+    // 回复写入原来的标准输出，标准输出改为标准错误，避免其它库的输出混入回复中
+    int replyFd = dup(STDOUT_FILENO);
+
+    if (replyFd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+        return -1;
+
+    ffmpegthumbnailer::VideoThumbnailer vt(0, false, true, 20, false);
+    std::vector<uint8_t> imageData;
+    std::string path;
+
+    for (;;) {
+        uint32_t header[2];
+
+        if (!readFull(STDIN_FILENO, header, sizeof(header)) || header[1] > kMaxPathLength)
+            break;
+
+        path.resize(header[1]);
+
+        if (!readFull(STDIN_FILENO, &path[0], header[1]))
+            break;
+
+        imageData.clear();
+
+        try {
+            vt.setThumbnailSize(static_cast<int>(header[0]));
+            vt.generateThumbnail(path, ThumbnailerImageTypeEnum::Png, imageData);
+        } catch (std::exception &e) {
+            if (!writeReply(replyFd, -1, e.what(), static_cast<uint32_t>(strlen(e.what()))))
+                break;
+
+            continue;
+        }
+
+        if (!writeReply(replyFd, 0, imageData.data(), static_cast<uint32_t>(imageData.size())))
+            break;
+    }
+
+    close(replyFd);
+
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
+    if (argc == 2 && strcmp(argv[1], "--batch") == 0) {
+        return runBatch();
+    }
+
     if (argc != 3) {
         return -1;
     }
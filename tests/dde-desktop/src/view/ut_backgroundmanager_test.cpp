@@ -6,6 +6,9 @@
 #include <QScopedPointer>
 #include <QGuiApplication>
 #include <QScreen>
+#include <QTemporaryDir>
+
+#include <utime.h>
 
 #define private public
 #define protected public
@@ -218,6 +221,45 @@ TEST_F(BackgroundManagerTest, onResetBackgroundImage)
     EXPECT_EQ(oldImages, newImages);
 }
 
+TEST_F(BackgroundManagerTest, loadWallpaper)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    //内容为jpeg，后缀为png
+    QString path = dir.filePath("wallpaper.png");
+    QImage source(400, 200, QImage::Format_RGB32);
+    source.fill(Qt::red);
+    ASSERT_TRUE(source.save(path, "JPG"));
+
+    QSize trueSize(100, 100);
+    QImage image = BackgroundManager::loadWallpaper(QUrl::fromLocalFile(path).toString(), trueSize);
+    EXPECT_EQ(image.size(), trueSize);
+
+    QString cachePath = BackgroundManager::wallpaperCachePath(path, trueSize);
+    EXPECT_TRUE(QFile::exists(cachePath));
+    EXPECT_EQ(BackgroundManager::readWallpaperCache(cachePath, trueSize), image);
+    EXPECT_TRUE(BackgroundManager::readWallpaperCache(cachePath, QSize(50, 50)).isNull());
+
+    //命中缓存时更新修改时间
+    QFileInfo cacheInfo(cachePath);
+    const QDateTime oldTime = cacheInfo.lastModified().addSecs(-60);
+    struct utimbuf times;
+    times.actime = times.modtime = static_cast<time_t>(oldTime.toMSecsSinceEpoch() / 1000);
+    ASSERT_EQ(0, utime(QFile::encodeName(cachePath).constData(), &times));
+    EXPECT_EQ(BackgroundManager::loadWallpaper(path, trueSize), image);
+    cacheInfo.refresh();
+    EXPECT_GT(cacheInfo.lastModified(), oldTime);
+
+    //截断的缓存不可用，重新解码原图
+    ASSERT_TRUE(QFile::resize(cachePath, 16));
+    EXPECT_TRUE(BackgroundManager::readWallpaperCache(cachePath, trueSize).isNull());
+    EXPECT_EQ(BackgroundManager::loadWallpaper(path, trueSize).size(), trueSize);
+    QFile::remove(cachePath);
+
+    EXPECT_TRUE(BackgroundManager::loadWallpaper(dir.filePath("notexist.jpg"), trueSize).isNull());
+}
+
 TEST_F(BackgroundManagerTest, onRestBackgroundManager)
 {
     bool unknow = m_manager->m_preview || m_manager->isEnabled();
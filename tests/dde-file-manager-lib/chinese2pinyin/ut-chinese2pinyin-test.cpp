@@ -12,3 +12,11 @@ TEST(Chinese2PinYintest,Chinese2PinYin)
     EXPECT_EQ(temp,compare);
     EXPECT_GE(result.size(),sz);
 }
+
+TEST(Chinese2PinYintest,Chinese2PinYin_through_table)
+{
+    EXPECT_EQ(Pinyin::Chinese2Pinyin(QString::fromUtf8("\xe4\xb8\xad\xe6\x96\x87" "abc")), QString("zhong1wen2abc"));
+    EXPECT_EQ(Pinyin::Chinese2Pinyin(QString::fromUtf8("\xe3\x90\x80")), QString("qiu1"));
+    EXPECT_EQ(Pinyin::Chinese2Pinyin(QString::fromUtf8("\xef\xa8\xad")), QString("he4"));
+    EXPECT_TRUE(Pinyin::Chinese2Pinyin(QString()).isEmpty());
+}
@@ -172,6 +172,92 @@ TEST_F(FileControllerTest, tst_create_director)
     DumpDirector(dirIterator);
 }
 
+TEST_F(FileControllerTest, tst_local_dir_iterator)
+{
+    const QString dirPath = TestHelper::createTmpDir();
+    TestHelper::createTmpFileName("a", dirPath);
+    TestHelper::createTmpFileName(".h", dirPath);
+    QDir(dirPath).mkdir("d");
+    QFile::link(dirPath + "/d", dirPath + "/ld");
+    QFile::link(dirPath + "/none", dirPath + "/bl");
+
+    auto iterate = [&](QDir::Filters filters) {
+        QStringList names;
+        DFMLocalDirIterator iterator(dirPath, filters);
+        while (iterator.hasNext()) {
+            iterator.next();
+            EXPECT_TRUE(iterator.fileInfo() != nullptr);
+            EXPECT_EQ(dirPath + "/" + iterator.fileName(), iterator.fileUrl().toLocalFile());
+            names << iterator.fileName();
+        }
+        names.sort();
+        return names;
+    };
+
+    EXPECT_EQ(QStringList({"a", "d", "ld"}), iterate(QDir::AllEntries | QDir::NoDotAndDotDot));
+    EXPECT_EQ(QStringList({".h", "a", "bl", "d", "ld"}), iterate(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System));
+    EXPECT_EQ(QStringList({".", "..", "d", "ld"}), iterate(QDir::Dirs));
+    EXPECT_EQ(QStringList({"a"}), iterate(QDir::Files | QDir::NoSymLinks));
+
+    EXPECT_TRUE(DFMLocalDirIterator::canIterate(QDir::AllEntries, QStringList(), QDirIterator::NoIteratorFlags));
+    EXPECT_FALSE(DFMLocalDirIterator::canIterate(QDir::AllEntries, QStringList("*.txt"), QDirIterator::NoIteratorFlags));
+    EXPECT_FALSE(DFMLocalDirIterator::canIterate(QDir::AllEntries | QDir::Readable, QStringList(), QDirIterator::NoIteratorFlags));
+
+    DFMLocalDirIterator invalid(dirPath + "/none", QDir::AllEntries);
+    EXPECT_FALSE(invalid.hasNext());
+
+    TestHelper::deleteTmpFile(dirPath);
+}
+
+TEST_F(FileControllerTest, tst_local_dir_iterator_file_info)
+{
+    const QString dirPath = TestHelper::createTmpDir();
+    QFile file(dirPath + "/a");
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("12345");
+    file.close();
+    QDir(dirPath).mkdir("d");
+    QFile::link(dirPath + "/d", dirPath + "/ld");
+
+    // 文件信息使用目录项和预读的属性，迭代器销毁后仍然有效
+    QList<DAbstractFileInfoPointer> infos;
+    {
+        DFMLocalDirIterator iterator(dirPath, QDir::AllEntries | QDir::NoDotAndDotDot);
+        while (iterator.hasNext()) {
+            iterator.next();
+            infos << iterator.fileInfo();
+        }
+    }
+    EXPECT_EQ(3, infos.size());
+
+    for (const DAbstractFileInfoPointer &info : infos) {
+        ASSERT_TRUE(info != nullptr);
+        const QFileInfo expected(info->absoluteFilePath());
+        EXPECT_TRUE(info->exists());
+        EXPECT_EQ(expected.isSymLink(), info->isSymLink());
+        EXPECT_EQ(expected.isDir(), info->isDir());
+        EXPECT_EQ(expected.isFile(), info->isFile());
+        if (info->fileName() == "a") {
+            EXPECT_EQ(5, info->size());
+            EXPECT_EQ(expected.lastModified(), info->lastModified());
+        }
+    }
+
+    // 刷新后重新读取文件属性
+    for (const DAbstractFileInfoPointer &info : infos) {
+        if (info->fileName() != "a")
+            continue;
+        QFile::resize(info->absoluteFilePath(), 10);
+        info->refresh();
+        EXPECT_EQ(10, info->size());
+        QFile::remove(info->absoluteFilePath());
+        info->refresh();
+        EXPECT_FALSE(info->exists());
+    }
+
+    TestHelper::deleteTmpFile(dirPath);
+}
+
 TEST_F(FileControllerTest, tst_open_file)
 {
     stub_ext::StubExt stext;
@@ -11,6 +11,7 @@
 #include <dfmevent.h>
 
 #include <QTimer>
+#include <QBuffer>
 #include <QSignalSpy>
 
 using namespace stub_ext;
@@ -348,5 +349,58 @@ TEST_F(TestRecentController, tst_decompressFile)
     st.set_lamda(&DFileService::decompressFile, []() { return true; });
     EXPECT_TRUE(m_controller->decompressFile(event));
 }
+
+TEST_F(TestRecentController, tst_readXbelEntries)
+{
+    QByteArray content("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                       "<xbel version=\"1.0\">\n"
+                       "  <bookmark href=\"file:///tmp/recent_a.txt\" modified=\"2021-01-01T00:00:00Z\"/>\n"
+                       "  <bookmark href=\"file:///tmp/recent%20b.txt\" modified=\"2021-01-02T00:00:00Z\"/>\n"
+                       "  <bookmark href=\"smb://host/share/c.txt\" modified=\"2021-01-03T00:00:00Z\"/>\n"
+                       "</xbel>\n");
+    QBuffer buffer(&content);
+    ASSERT_TRUE(buffer.open(QIODevice::ReadOnly));
+
+    const QHash<DUrl, QString> &entries = RecentController::readXbelEntries(&buffer);
+    EXPECT_EQ(entries.size(), 2);
+    EXPECT_EQ(entries.value(DUrl::fromRecentFile("/tmp/recent_a.txt")), QString("2021-01-01T00:00:00Z"));
+    EXPECT_EQ(entries.value(DUrl::fromRecentFile("/tmp/recent b.txt")), QString("2021-01-02T00:00:00Z"));
+}
+
+TEST_F(TestRecentController, tst_handleFileChanged_removeDeletedFile)
+{
+    const QString filePath = TestHelper::createTmpFile(".txt");
+    const QString xbelPath = TestHelper::createTmpFile(".xbel");
+    auto writeXbel = [&](const QString &modified) {
+        QFile xbel(xbelPath);
+        ASSERT_TRUE(xbel.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        xbel.write(QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                           "<xbel version=\"1.0\">\n"
+                           "  <bookmark href=\"%1\" modified=\"%2\"/>\n"
+                           "</xbel>\n").arg(QUrl::fromLocalFile(filePath).toString(), modified).toUtf8());
+    };
+
+    const QString oldXbelPath = m_controller->m_xbelPath;
+    const QHash<DUrl, QString> oldSnapshot = m_controller->m_xbelSnapshot;
+    m_controller->m_xbelPath = xbelPath;
+    m_controller->m_xbelSnapshot.clear();
+    m_controller->m_xbelSize = -1;
+
+    const DUrl recentUrl = DUrl::fromRecentFile(filePath);
+    writeXbel("2021-01-01T00:00:00Z");
+    m_controller->handleFileChanged();
+    EXPECT_TRUE(m_controller->m_xbelSnapshot.contains(recentUrl));
+
+    // 文件已删除，xbel中的记录仍在，再次解析时移除
+    QFile::remove(filePath);
+    writeXbel("2021-01-02T00:00:00.000Z");
+    m_controller->handleFileChanged();
+    EXPECT_FALSE(m_controller->m_xbelSnapshot.contains(recentUrl));
+
+    m_controller->m_xbelPath = oldXbelPath;
+    m_controller->m_xbelSnapshot = oldSnapshot;
+    m_controller->m_xbelSize = -1;
+    TestHelper::deleteTmpFile(xbelPath);
+}
 }
 
@@ -350,6 +350,72 @@ TEST_F(TestDFileSystemModel, test_setAdvanceSearchFilter)
 
 }
 
+TEST_F(TestDFileSystemModel, test_mergeFileEvents)
+{
+    typedef DFileSystemModelPrivate d_t;
+    const DUrl urlA = DUrl::fromLocalFile(tmpDirUrl.path() + "/a");
+    const DUrl urlB = DUrl::fromLocalFile(tmpDirUrl.path() + "/b");
+    const DUrl urlC = DUrl::fromLocalFile(tmpDirUrl.path() + "/c");
+    const DUrl urlD = DUrl::fromLocalFile(tmpDirUrl.path() + "/d");
+
+    QQueue<QPair<d_t::EventType, DUrl>> events;
+    events << qMakePair(d_t::AddFile, urlA) << qMakePair(d_t::RmFile, urlA)
+           << qMakePair(d_t::AddFile, urlB) << qMakePair(d_t::AddFile, urlB)
+           << qMakePair(d_t::RmFile, urlC) << qMakePair(d_t::AddFile, urlC)
+           << qMakePair(d_t::AddFileUnfiltered, urlD) << qMakePair(d_t::RmFile, urlD);
+
+    const QList<QPair<d_t::EventType, DUrl>> &merged = m_model->d_func()->mergeFileEvents(events);
+    ASSERT_EQ(2, merged.count());
+    EXPECT_EQ(qMakePair(d_t::AddFile, urlB), merged.at(0));
+    EXPECT_EQ(qMakePair(d_t::AddFile, urlC), merged.at(1));
+}
+
+TEST(FileSystemNodeTest, insertAndTakeNodesByIndex)
+{
+    QReadWriteLock lk;
+    QString tmpDirPath = TestHelper::createTmpDir();
+    DAbstractFileInfoPointer info = DFileService::instance()->createFileInfo(nullptr, DUrl::fromLocalFile(tmpDirPath));
+    FileSystemNode node(nullptr, info, nullptr, &lk);
+    bool isCache = false;
+
+    auto createChildren = [&](const QStringList &names) {
+        QList<FileSystemNodePointer> list;
+        for (const QString &name : names) {
+            DUrl url = DUrl::fromLocalFile(tmpDirPath + "/" + name);
+            list << FileSystemNodePointer(new FileSystemNode(&node, DFileService::instance()->createFileInfo(nullptr, url), nullptr, &lk));
+        }
+        return list;
+    };
+    auto childNames = [&node]() {
+        QStringList list;
+        for (const FileSystemNodePointer &child : node.visibleChildren)
+            list << child->fileInfo->fileName();
+        return list;
+    };
+
+    node.insertChildren(0, createChildren({"a", "d"}), &isCache);
+    node.insertChildren(1, createChildren({"b", "c"}), &isCache);
+    node.insertChildren(100, createChildren({"e"}), &isCache);
+    EXPECT_EQ(QStringList({"a", "b", "c", "d", "e"}), childNames());
+    EXPECT_EQ(5, node.children.count());
+
+    const DUrlList urls {DUrl::fromLocalFile(tmpDirPath + "/e"), DUrl::fromLocalFile(tmpDirPath + "/b"),
+                         DUrl::fromLocalFile(tmpDirPath + "/c"), DUrl::fromLocalFile(tmpDirPath + "/x")};
+    EXPECT_EQ(QList<int>({1, 2, 4}), node.indexesOfChildren(urls));
+
+    const QList<FileSystemNodePointer> &fresh = node.newChildren(createChildren({"a", "f"}));
+    ASSERT_EQ(1, fresh.count());
+    EXPECT_EQ(QString("f"), fresh.first()->fileInfo->fileName());
+
+    node.takeNodesByIndex(1, 2, &isCache);
+    EXPECT_EQ(QStringList({"a", "d", "e"}), childNames());
+    EXPECT_FALSE(node.childContains(DUrl::fromLocalFile(tmpDirPath + "/b")));
+
+    node.visibleChildren.clear();
+    node.children.clear();
+    TestHelper::deleteTmpFile(tmpDirPath);
+}
+
 TEST(FileSystemNodeTest, setNodeVisible)
 {
     QReadWriteLock lk;
@@ -399,4 +465,46 @@ TEST(FileSystemNodeTest, takeNodeByUrl)
     EXPECT_EQ(ret, data);
 }
 
+
+TEST(FileSystemNodeTest, sortAllChildren)
+{
+    QReadWriteLock lk;
+    QString tmpDirPath = TestHelper::createTmpDir();
+    DAbstractFileInfoPointer info = DFileService::instance()->createFileInfo(nullptr, DUrl::fromLocalFile(tmpDirPath));
+    FileSystemNode node(nullptr, info, nullptr, &lk);
+
+    QProcess::execute("mkdir " + tmpDirPath + "/z");
+    const QStringList names {"b", "10", "_c", "A", "2"};
+    for (const QString &name : names)
+        TestHelper::createTmpFileName(name, tmpDirPath);
+
+    for (const QString &name : QStringList(names) << "z") {
+        DUrl url = DUrl::fromLocalFile(tmpDirPath + "/" + name);
+        FileSystemNodePointer child(new FileSystemNode(&node, DFileService::instance()->createFileInfo(nullptr, url), nullptr, &lk));
+        node.noLockAppendChildren(url, child);
+    }
+
+    auto sortedNames = [&node]() {
+        QStringList list;
+        for (const FileSystemNodePointer &child : node.visibleChildren)
+            list << child->fileInfo->fileName();
+        return list;
+    };
+
+    bool cancel = false;
+    node.sortAllChildren(FileSortFunction::compareFileListByDisplayName, Qt::AscendingOrder, &cancel);
+    EXPECT_EQ(QStringList({"z", "2", "10", "A", "b", "_c"}), sortedNames());
+
+    node.sortAllChildren(FileSortFunction::compareFileListByDisplayName, Qt::DescendingOrder, &cancel);
+    EXPECT_EQ(QStringList({"z", "_c", "b", "A", "10", "2"}), sortedNames());
+
+    // 取消时保持原来的顺序
+    cancel = true;
+    node.sortAllChildren(FileSortFunction::compareFileListByDisplayName, Qt::AscendingOrder, &cancel);
+    EXPECT_EQ(QStringList({"z", "_c", "b", "A", "10", "2"}), sortedNames());
+
+    node.visibleChildren.clear();
+    TestHelper::deleteTmpFile(tmpDirPath);
+}
+
 }
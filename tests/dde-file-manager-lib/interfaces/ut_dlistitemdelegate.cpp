@@ -32,6 +32,7 @@
 #define protected public
 #define private public
 #include "interfaces/dlistitemdelegate.h"
+#include "interfaces/private/dstyleditemdelegate_p.h"
 #include "views/dfileview.h"
 #include "testhelper.h"
 
@@ -117,6 +118,23 @@ TEST_F(TestDListItemDelegate, test_updateItemSizeHint)
     dlistIdl->updateItemSizeHint();
 }
 
+TEST_F(TestDListItemDelegate, test_elideText_cache)
+{
+    auto d = dlistIdl->d_func();
+    const QString &text = QString("elide_text_cache_test_").repeated(10);
+
+    d->clearTextLayoutCache();
+    const QString &elided = d->elideText(text, QSizeF(100, 30), QTextOption::NoWrap, QFont(), Qt::ElideRight, 20);
+    EXPECT_EQ(d->elideText(text, QSizeF(100, 30), QTextOption::NoWrap, QFont(), Qt::ElideRight, 20), elided);
+    EXPECT_EQ(d->elidedTextCache.count(), 1);
+
+    d->elideText(text, QSizeF(120, 30), QTextOption::NoWrap, QFont(), Qt::ElideRight, 20);
+    EXPECT_EQ(d->elidedTextCache.count(), 2);
+
+    dlistIdl->updateItemSizeHint();
+    EXPECT_EQ(d->elidedTextCache.count(), 0);
+}
+
 TEST_F(TestDListItemDelegate, test_eventFilter)
 {
     QObject *object = new QObject();
@@ -29,6 +29,9 @@
 #include <QSemaphore>
 #include <QWaitCondition>
 #include <QMutex>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QElapsedTimer>
 
 #define private public
 #include "fileoperations/filejob.h"
@@ -261,39 +264,204 @@ TEST_F(DThumbnailProviderTest, test_removeInProduceQueue)
 {
     QFileInfo pngInfo(THUMBNAIL_RESOURCE"logo.png");
     ASSERT_TRUE(pngInfo.exists());
-    QFileInfo txtInfo(THUMBNAIL_RESOURCE"hello.txt");
-    ASSERT_TRUE(pngInfo.exists());
-    QString savePngImage = calculateThumbnailPath(pngInfo);
-    QString saveTxtImage = calculateThumbnailPath(txtInfo);
-    QString thumbnailPngPath;
-    QString thumbnailTxtPath;
-    QSemaphore sem(0);
-    thumbnailProvide->appendToProduceQueue(pngInfo, DThumbnailProvider::Normal, [&](const QString & path) {
-        thumbnailPngPath = path;
-        sem.release();
-        QMutexLocker locker(&mutex);
-        condition.notify_one();
+    auto d = thumbnailProvide->d_func();
+    d->workerPool.waitForDone();
+    // 占满工作线程计数，使任务停留在队列中
+    d->workerCount = d->workerPool.maxThreadCount();
+
+    bool called = false;
+    thumbnailProvide->appendToProduceQueue(pngInfo, DThumbnailProvider::Normal, [&](const QString &) {
+        called = true;
     });
-    QMutexLocker locker(&mutex);
-    condition.wait(&mutex, 2000); // 需要等appendToProduceQueue执行完成才能进行移除
-    thumbnailProvide->removeInProduceQueue(pngInfo, DThumbnailProvider::Normal);
     const QPair<QString, DThumbnailProvider::Size> &tmpKey = qMakePair(pngInfo.absoluteFilePath(), DThumbnailProvider::Normal);
-    auto discardedProduceInfos = thumbnailProvide->d_func()->discardedProduceInfos;
-    ASSERT_TRUE(discardedProduceInfos.contains(tmpKey));
-    discardedProduceInfos.remove(tmpKey);
-    sem.tryAcquire(2, 2000);
-    QFile savePngFile(savePngImage);
-    if(savePngFile.exists()) {
-        savePngFile.remove();
+    EXPECT_TRUE(d->producePriority.contains(tmpKey));
+    EXPECT_EQ(d->produceQueue.size(), 1);
+
+    thumbnailProvide->removeInProduceQueue(pngInfo, DThumbnailProvider::Normal);
+    EXPECT_FALSE(d->producePriority.contains(tmpKey));
+    EXPECT_TRUE(d->produceQueue.isEmpty());
+
+    d->workerCount = 0;
+    EXPECT_FALSE(called);
+}
+
+TEST_F(DThumbnailProviderTest, test_raiseInProduceQueue)
+{
+    QFileInfo pngInfo(THUMBNAIL_RESOURCE"logo.png");
+    ASSERT_TRUE(pngInfo.exists());
+    QFileInfo txtInfo(THUMBNAIL_RESOURCE"hello.txt");
+    ASSERT_TRUE(txtInfo.exists());
+    auto d = thumbnailProvide->d_func();
+    d->workerPool.waitForDone();
+    d->workerCount = d->workerPool.maxThreadCount();
+
+    thumbnailProvide->appendToProduceQueue(pngInfo, DThumbnailProvider::Normal);
+    thumbnailProvide->appendToProduceQueue(txtInfo, DThumbnailProvider::Normal);
+    ASSERT_EQ(d->produceQueue.size(), 2);
+    // 后请求的文件先生成
+    EXPECT_EQ(d->produceQueue.last().fileInfo.absoluteFilePath(), txtInfo.absoluteFilePath());
+
+    thumbnailProvide->raiseInProduceQueue(pngInfo, DThumbnailProvider::Normal);
+    EXPECT_EQ(d->produceQueue.last().fileInfo.absoluteFilePath(), pngInfo.absoluteFilePath());
+
+    // 重复请求不会加入新的任务，只提升其优先级
+    thumbnailProvide->appendToProduceQueue(txtInfo, DThumbnailProvider::Normal);
+    ASSERT_EQ(d->produceQueue.size(), 2);
+    EXPECT_EQ(d->produceQueue.last().fileInfo.absoluteFilePath(), txtInfo.absoluteFilePath());
+
+    thumbnailProvide->removeInProduceQueue(pngInfo, DThumbnailProvider::Normal);
+    thumbnailProvide->removeInProduceQueue(txtInfo, DThumbnailProvider::Normal);
+    EXPECT_TRUE(d->produceQueue.isEmpty());
+    d->workerCount = 0;
+}
+
+TEST_F(DThumbnailProviderTest, test_waitForProcessFinished_canceled)
+{
+    auto d = thumbnailProvide->d_func();
+    QSharedPointer<QAtomicInt> canceled(new QAtomicInt(1));
+    d->currentTaskCanceled.setLocalData(canceled);
+
+    QProcess process;
+    process.start("sleep", {"10"});
+    if (process.waitForStarted()) {
+        QElapsedTimer timer;
+        timer.start();
+        EXPECT_FALSE(d->waitForProcessFinished(process));
+        EXPECT_LT(timer.elapsed(), 5000);
+    }
+
+    d->currentTaskCanceled.setLocalData(QSharedPointer<QAtomicInt>());
+    EXPECT_FALSE(d->isCurrentTaskCanceled());
+}
+
+TEST_F(DThumbnailProviderTest, test_requestToolWorker)
+{
+    auto d = thumbnailProvide->d_func();
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    // 模拟常驻模式的工具，返回一个错误的回复后等待
+    const QString &errorTool = dir.filePath("error-tool");
+    QFile errorToolFile(errorTool);
+    ASSERT_TRUE(errorToolFile.open(QIODevice::WriteOnly));
+    errorToolFile.write("#!/bin/sh\nprintf '\\377\\377\\377\\377\\004\\000\\000\\000fail'\nexec sleep 10\n");
+    errorToolFile.close();
+    errorToolFile.setPermissions(errorToolFile.permissions() | QFile::ExeOwner);
+
+    QByteArray data;
+    QString errorString;
+    EXPECT_FALSE(d->requestToolWorker(errorTool, DThumbnailProvider::Normal, "/tmp/test.mp4", &data, &errorString));
+    if (QSysInfo::ByteOrder == QSysInfo::LittleEndian)
+        EXPECT_EQ(QString("fail"), errorString);
+    d->clearToolWorkers();
+    EXPECT_TRUE(d->idleToolWorkers.isEmpty());
+
+    errorString.clear();
+    EXPECT_FALSE(d->requestToolWorker(dir.filePath("not-exists-tool"), DThumbnailProvider::Normal, "/tmp/test.mp4", &data, &errorString));
+    EXPECT_FALSE(errorString.isEmpty());
+}
+
+TEST_F(DThumbnailProviderTest, test_requestToolWorker_canceled)
+{
+    auto d = thumbnailProvide->d_func();
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    const QString &sleepTool = dir.filePath("sleep-tool");
+    QFile sleepToolFile(sleepTool);
+    ASSERT_TRUE(sleepToolFile.open(QIODevice::WriteOnly));
+    sleepToolFile.write("#!/bin/sh\nexec sleep 10\n");
+    sleepToolFile.close();
+    sleepToolFile.setPermissions(sleepToolFile.permissions() | QFile::ExeOwner);
+
+    QSharedPointer<QAtomicInt> canceled(new QAtomicInt(1));
+    d->currentTaskCanceled.setLocalData(canceled);
+
+    QByteArray data;
+    QString errorString;
+    QElapsedTimer timer;
+    timer.start();
+    EXPECT_FALSE(d->requestToolWorker(sleepTool, DThumbnailProvider::Normal, "/tmp/test.mp4", &data, &errorString));
+    EXPECT_LT(timer.elapsed(), 5000);
+    EXPECT_TRUE(d->idleToolWorkers.isEmpty());
+
+    d->currentTaskCanceled.setLocalData(QSharedPointer<QAtomicInt>());
+}
+
+TEST_F(DThumbnailProviderTest, test_requestToolWorker_retry)
+{
+    auto d = thumbnailProvide->d_func();
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString &countFile = dir.filePath("count");
+
+    auto createTool = [&](const QString &name, const QByteArray &body) {
+        const QString &tool = dir.filePath(name);
+        QFile toolFile(tool);
+        toolFile.open(QIODevice::WriteOnly);
+        toolFile.write("#!/bin/sh\necho x >> " + QFile::encodeName(countFile) + "\n" + body);
+        toolFile.close();
+        toolFile.setPermissions(toolFile.permissions() | QFile::ExeOwner);
+        return tool;
+    };
+    auto startCount = [&] {
+        QFile file(countFile);
+        return file.open(QIODevice::ReadOnly) ? file.readAll().count('x') : 0;
+    };
+    auto waitForExited = [](ThumbnailToolWorker *worker) {
+        QElapsedTimer timer;
+        timer.start();
+
+        while (!worker->hasExited() && timer.elapsed() < 5000)
+            QThread::msleep(10);
+    };
+
+    // 发送请求前已经退出的进程可以重试，读取请求后没有回复就退出(处理中崩溃)的不能重试
+    const QString &exitTool = createTool("exit-tool", "exit 0\n");
+    // 读完整个请求(8字节请求头 + "/tmp/test.mp4")后再崩溃，保证请求已经写入成功
+    const QString &crashTool = createTool("crash-tool", "head -c 21 > /dev/null\nkill -KILL $$\n");
+    QByteArray data;
+    {
+        ThumbnailToolWorker worker(exitTool);
+        ASSERT_TRUE(worker.start());
+        waitForExited(&worker);
+        EXPECT_EQ(ThumbnailToolWorker::ReplyDead, worker.request(64, "/tmp/test.mp4", &data, nullptr));
+    }
+    {
+        ThumbnailToolWorker worker(crashTool);
+        ASSERT_TRUE(worker.start());
+        EXPECT_EQ(ThumbnailToolWorker::ReplyBroken, worker.request(64, "/tmp/test.mp4", &data, nullptr));
     }
+    QFile::remove(countFile);
+
+    // 空闲期间退出的进程换一个新进程重试一次，新进程出错后不再重试
+    QSharedPointer<ThumbnailToolWorker> idleWorker(new ThumbnailToolWorker(exitTool));
+    ASSERT_TRUE(idleWorker->start());
+    waitForExited(idleWorker.data());
+    d->idleToolWorkers.insert(exitTool, idleWorker);
+    idleWorker.clear();
+    QString errorString;
+    EXPECT_FALSE(d->requestToolWorker(exitTool, DThumbnailProvider::Normal, "/tmp/test.mp4", &data, &errorString));
+    EXPECT_EQ(2, startCount());
+    EXPECT_TRUE(d->idleToolWorkers.isEmpty());
+    QFile::remove(countFile);
+
+    // 处理请求时崩溃的不重试
+    idleWorker.reset(new ThumbnailToolWorker(crashTool));
+    ASSERT_TRUE(idleWorker->start());
+    d->idleToolWorkers.insert(crashTool, idleWorker);
+    idleWorker.clear();
+    EXPECT_FALSE(d->requestToolWorker(crashTool, DThumbnailProvider::Normal, "/tmp/test.mp4", &data, &errorString));
+    EXPECT_EQ(1, startCount());
+    EXPECT_TRUE(d->idleToolWorkers.isEmpty());
 }
 
 TEST_F(DThumbnailProviderTest, test_errorString)
 {
     QString simpleError = "test error";
-    thumbnailProvide->d_func()->errorString = simpleError;
+    thumbnailProvide->d_func()->errorString.setLocalData(simpleError);
     EXPECT_EQ(thumbnailProvide->errorString(), simpleError);
-    thumbnailProvide->d_func()->errorString = "";
+    thumbnailProvide->d_func()->errorString.setLocalData("");
 }
 
 TEST_F(DThumbnailProviderTest, test_hasThumbnail_no_file)
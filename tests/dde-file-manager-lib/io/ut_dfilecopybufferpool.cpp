@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "dfilecopybufferpool.h"
+
+#include <unistd.h>
+
+using namespace testing;
+DFM_USE_NAMESPACE
+
+class DFileCopyBufferPoolTest: public testing::Test
+{
+public:
+    DFileCopyBufferPool *pool = nullptr;
+    qint64 maxCachedSize = 0;
+
+    virtual void SetUp() override
+    {
+        pool = DFileCopyBufferPool::instance();
+        maxCachedSize = pool->maxCachedSize();
+        pool->clear();
+        std::cout << "start DFileCopyBufferPoolTest" << std::endl;
+    }
+
+    virtual void TearDown() override
+    {
+        pool->setMaxCachedSize(maxCachedSize);
+        pool->clear();
+        std::cout << "end DFileCopyBufferPoolTest" << std::endl;
+    }
+};
+
+TEST_F(DFileCopyBufferPoolTest, can_reuse_aligned_buffer)
+{
+    const qint64 pageSize = getpagesize();
+    char *buffer = pool->acquire(pageSize + 1);
+    ASSERT_TRUE(buffer);
+    EXPECT_EQ(0, reinterpret_cast<quintptr>(buffer) % static_cast<quintptr>(pageSize));
+
+    pool->release(buffer);
+    EXPECT_EQ(2 * pageSize, pool->cachedSize());
+
+    // 大小取整后相同的请求复用同一个缓冲区
+    EXPECT_EQ(buffer, pool->acquire(2 * pageSize));
+    EXPECT_EQ(0, pool->cachedSize());
+    pool->release(buffer);
+    pool->release(nullptr);
+}
+
+TEST_F(DFileCopyBufferPoolTest, can_share_power_of_two_size_class)
+{
+    const qint64 pageSize = getpagesize();
+    char *buffer = pool->acquire(3 * pageSize);
+    ASSERT_TRUE(buffer);
+
+    pool->release(buffer);
+    EXPECT_EQ(4 * pageSize, pool->cachedSize());
+
+    // 同一级内大小不同的请求也复用同一个缓冲区
+    EXPECT_EQ(buffer, pool->acquire(4 * pageSize - 1));
+    pool->release(buffer);
+}
+
+TEST_F(DFileCopyBufferPoolTest, can_limit_cached_size)
+{
+    const qint64 pageSize = getpagesize();
+    pool->setMaxCachedSize(pageSize);
+
+    char *buffer1 = pool->acquire(pageSize);
+    char *buffer2 = pool->acquire(pageSize);
+    ASSERT_NE(buffer1, buffer2);
+
+    pool->release(buffer1);
+    pool->release(buffer2);
+    EXPECT_EQ(pageSize, pool->cachedSize());
+
+    pool->setMaxCachedSize(0);
+    EXPECT_EQ(0, pool->cachedSize());
+}
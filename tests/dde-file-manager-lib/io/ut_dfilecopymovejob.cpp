@@ -2,6 +2,7 @@
 
 #include "fcntl.h"
 #include "sys/mman.h"
+#include "sys/stat.h"
 #define private public
 #define protected public
 #include "deviceinfo/udisklistener.h"
@@ -19,6 +20,7 @@
 #include "testhelper.h"
 
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QThread>
 #include <QProcess>
 #include <QtConcurrent>
@@ -814,25 +816,30 @@ TEST_F(DFileCopyMoveJobTest, start_run_moveMOde)
     job->stop();
 }
 
-TEST_F(DFileCopyMoveJobTest, start_getWriteBytes)
+TEST_F(DFileCopyMoveJobTest, start_getCompletedDataSize)
 {
     DFileCopyMoveJobPrivate *jobd = job->d_func();
     ASSERT_TRUE(jobd);
-    EXPECT_TRUE(0 == jobd->getWriteBytes(-1));
-    DUrl from;
-    from.setScheme(FILE_SCHEME);
-    from.setPath("/proc/self/task/9018765463");
-    QProcess::execute("mkdir " + from.toLocalFile());
-    from.setPath("/proc/self/task/9018765463/io");
-    QProcess::execute("touch " + from.toLocalFile());
-    EXPECT_TRUE(0 == jobd->getWriteBytes(9018765463));
-    QFile file(from.toLocalFile());
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QByteArray("write_bytes: ioio"));
-        file.close();
-    }
-    EXPECT_TRUE(0 == jobd->getWriteBytes(9018765463));
-    TestHelper::deleteTmpFile("/proc/self/task/9018765463");
+    jobd->completedDataSize = 0;
+    jobd->m_refineCopySize = 0;
+    QList<QFuture<void>> results;
+    for (int i = 0; i < 4; ++i) {
+        results << QtConcurrent::run([jobd]() {
+            for (int j = 0; j < 1000; ++j) {
+                jobd->completedDataSize += 2;
+                jobd->countrefinesize(3);
+            }
+        });
+    }
+    for (QFuture<void> &result : results)
+        result.waitForFinished();
+    EXPECT_EQ(8000, jobd->getCompletedDataSize());
+    EXPECT_EQ(12000, jobd->m_refineCopySize.load());
+
+    // 没有目标设备的 sysfs 信息时不等待同步
+    jobd->targetDeviceStartSectorsWritten = -1;
+    jobd->waitForTargetDeviceSync();
+    EXPECT_FALSE(jobd->m_isSyncingTargetDevice.load());
     job->stop();
 }
 
@@ -1927,3 +1934,200 @@ TEST_F(DFileCopyMoveJobTest, start_writeToFileByQueue)
     TestHelper::deleteTmpFile(dirurl.path());
     job->stop();
 }
+
+TEST_F(DFileCopyMoveJobTest, start_doCopyFileByKernel)
+{
+    DFileCopyMoveJobPrivate *jobd = job->d_func();
+    ASSERT_TRUE(jobd);
+    qint64 copiedSize = -1;
+    EXPECT_EQ(DFileCopyMoveJobPrivate::KernelCopyFallback, jobd->doCopyFileByKernel(-1, -1, 10, copiedSize));
+    EXPECT_EQ(0, copiedSize);
+
+    QString fromPath = TestHelper::createTmpFile(".from");
+    QString toPath = TestHelper::createTmpFile(".to");
+    QFile fromFile(fromPath);
+    ASSERT_TRUE(fromFile.open(QIODevice::WriteOnly));
+    QByteArray data(3 * 1024 * 1024 + 17, 'k');
+    fromFile.write(data);
+    fromFile.close();
+
+    int fromFd = open(fromPath.toLocal8Bit().data(), O_RDONLY);
+    int toFd = open(toPath.toLocal8Bit().data(), O_WRONLY | O_TRUNC);
+    jobd->state = DFileCopyMoveJob::RunningState;
+    EXPECT_EQ(DFileCopyMoveJobPrivate::KernelCopyFinished, jobd->doCopyFileByKernel(fromFd, toFd, data.size(), copiedSize));
+    EXPECT_EQ(data.size(), copiedSize);
+    close(fromFd);
+    close(toFd);
+
+    QFile toFile(toPath);
+    ASSERT_TRUE(toFile.open(QIODevice::ReadOnly));
+    EXPECT_TRUE(toFile.readAll() == data);
+    toFile.close();
+
+    jobd->state = DFileCopyMoveJob::StoppedState;
+    TestHelper::deleteTmpFiles({fromPath, toPath});
+}
+
+TEST_F(DFileCopyMoveJobTest, start_initSmallFileCopyThreadCount)
+{
+    DFileCopyMoveJobPrivate *jobd = job->d_func();
+    ASSERT_TRUE(jobd);
+    EXPECT_EQ(2, DFileCopyMoveJobPrivate::copyThreadCountOfDevice(DFileCopyMoveJobPrivate::HddDevice));
+    EXPECT_LT(DFileCopyMoveJobPrivate::copyThreadCountOfDevice(DFileCopyMoveJobPrivate::HddDevice),
+              DFileCopyMoveJobPrivate::copyThreadCountOfDevice(DFileCopyMoveJobPrivate::SsdDevice));
+    EXPECT_EQ(DFileCopyMoveJobPrivate::HddDevice, DFileCopyMoveJobPrivate::copyDeviceType(QString()));
+
+    jobd->sourceUrlList = DUrlList() << DUrl::fromLocalFile(QDir::tempPath());
+    const int traversalThreadCount = DFileCopyMoveJobPrivate::copyThreadCountOfDevice(DFileCopyMoveJobPrivate::copyDeviceType(QDir::tempPath()));
+    jobd->m_targetDeviceType = DFileCopyMoveJobPrivate::HddDevice;
+    jobd->initSmallFileCopyThreadCount();
+    EXPECT_EQ(2, jobd->m_pool.maxThreadCount());
+    EXPECT_EQ(traversalThreadCount, jobd->m_traversalPool.maxThreadCount());
+
+    // 队列未满时直接返回，队列已满时拷贝线程取走文件后被唤醒
+    jobd->waitForThreadInfoQueue();
+    const int maxCount = jobd->m_pool.maxThreadCount() * 4;
+    {
+        QMutexLocker lk(&jobd->m_threadMutex);
+        for (int i = 0; i < maxCount; ++i)
+            jobd->m_threadInfos << QSharedPointer<DFileCopyMoveJobPrivate::ThreadCopyInfo>(new DFileCopyMoveJobPrivate::ThreadCopyInfo);
+    }
+    jobd->setState(DFileCopyMoveJob::RunningState);
+    QFuture<void> dequeue = QtConcurrent::run([jobd]() {
+        QThread::msleep(50);
+        QMutexLocker lk(&jobd->m_threadMutex);
+        jobd->m_threadInfos.dequeue();
+        jobd->m_threadInfoCondition.wakeAll();
+    });
+    QElapsedTimer timer;
+    timer.start();
+    jobd->waitForThreadInfoQueue();
+    EXPECT_LT(timer.elapsed(), 1000);
+    dequeue.waitForFinished();
+    jobd->clearThreadPool();
+    jobd->setState(DFileCopyMoveJob::StoppedState);
+    job->stop();
+}
+
+TEST_F(DFileCopyMoveJobTest, start_prefetchDirEntries)
+{
+    DFileCopyMoveJobPrivate *jobd = job->d_func();
+    ASSERT_TRUE(jobd);
+    const QString dirPath = TestHelper::createTmpDir();
+    QDir(dirPath).mkpath("sub/child");
+    TestHelper::createTmpFileName("a", dirPath + "/sub");
+    const DUrl subUrl = DUrl::fromLocalFile(dirPath + "/sub");
+
+    QList<DAbstractFileInfoPointer> entries;
+    EXPECT_FALSE(jobd->takeDirEntries(subUrl, entries));
+
+    jobd->prefetchDirEntries(subUrl, false);
+    EXPECT_TRUE(jobd->takeDirEntries(subUrl, entries));
+    EXPECT_EQ(2, entries.count());
+    EXPECT_FALSE(jobd->takeDirEntries(subUrl, entries));
+
+    // 空目录重新使用迭代器读取
+    jobd->prefetchDirEntries(DUrl::fromLocalFile(dirPath + "/sub/child"), false);
+    EXPECT_FALSE(jobd->takeDirEntries(DUrl::fromLocalFile(dirPath + "/sub/child"), entries));
+
+    // 并行遍历拷贝目录，目录结构和文件都完整
+    const QString targetPath = TestHelper::createTmpDir();
+    job->setMode(DFileCopyMoveJob::CopyMode);
+    job->setRefine(DFileCopyMoveJob::RefineLocal);
+    if (QThread::currentThread()->loopLevel() <= 0) {
+        // 确保对象所在线程有事件循环
+        job->moveToThread(qApp->thread());
+    }
+    job->start(DUrlList() << DUrl::fromLocalFile(dirPath), DUrl::fromLocalFile(targetPath));
+    QElapsedTimer timer;
+    timer.start();
+    while (!job->isFinished() && timer.elapsed() < 10000) {
+        QThread::msleep(100);
+    }
+    const QString copied = targetPath + "/" + QFileInfo(dirPath).fileName();
+    EXPECT_TRUE(QFileInfo(copied + "/sub/child").isDir());
+    EXPECT_EQ(QFileInfo(dirPath + "/sub/a").exists(), QFileInfo(copied + "/sub/a").exists());
+    EXPECT_TRUE(jobd->m_dirEntriesFutures.isEmpty());
+
+    TestHelper::deleteTmpFiles({dirPath, targetPath});
+}
+
+TEST_F(DFileCopyMoveJobTest, start_doCopySparseFile)
+{
+    DFileCopyMoveJobPrivate *jobd = job->d_func();
+    ASSERT_TRUE(jobd);
+
+    QString fromPath = TestHelper::createTmpFile(".from");
+    QString toPath = TestHelper::createTmpFile(".to");
+    const qint64 fileSize = 16 * 1024 * 1024;
+    QByteArray data(64 * 1024, 's');
+    QFile fromFile(fromPath);
+    ASSERT_TRUE(fromFile.open(QIODevice::WriteOnly));
+    ASSERT_TRUE(fromFile.resize(fileSize));
+    fromFile.seek(4 * 1024 * 1024);
+    fromFile.write(data);
+    fromFile.close();
+
+    int fromFd = open(fromPath.toLocal8Bit().data(), O_RDONLY);
+    int toFd = open(toPath.toLocal8Bit().data(), O_WRONLY | O_TRUNC);
+    jobd->state = DFileCopyMoveJob::RunningState;
+    qint64 copiedSize = -1;
+    EXPECT_EQ(DFileCopyMoveJobPrivate::KernelCopyFinished, jobd->doCopySparseFile(fromFd, toFd, fileSize, copiedSize));
+    EXPECT_EQ(fileSize, copiedSize);
+    close(fromFd);
+    close(toFd);
+
+    // 目标文件也要保留空洞，空洞只计入进度，不计入需要等待设备同步的大小
+    struct stat fromStat;
+    struct stat toStat;
+    ASSERT_EQ(0, stat(fromPath.toLocal8Bit().data(), &fromStat));
+    ASSERT_EQ(0, stat(toPath.toLocal8Bit().data(), &toStat));
+    if (fromStat.st_blocks * 512 < fileSize) {
+        EXPECT_LT(toStat.st_blocks * 512, fileSize);
+        EXPECT_GT(jobd->completedDataSizeWithoutWrite.load(), 0);
+        EXPECT_LE(jobd->completedDataSizeWithoutWrite.load(), fileSize - data.size());
+    }
+
+    QFile toFile(toPath);
+    ASSERT_TRUE(toFile.open(QIODevice::ReadOnly));
+    EXPECT_EQ(fileSize, toFile.size());
+    toFile.seek(4 * 1024 * 1024);
+    EXPECT_TRUE(toFile.read(data.size()) == data);
+    toFile.seek(fileSize - 1);
+    EXPECT_TRUE(toFile.read(1) == QByteArray(1, '\0'));
+    toFile.close();
+
+    jobd->state = DFileCopyMoveJob::StoppedState;
+    EXPECT_EQ(DFileCopyMoveJobPrivate::KernelCopyCanceled, jobd->doCopySparseFile(-1, -1, fileSize, copiedSize));
+    TestHelper::deleteTmpFiles({fromPath, toPath});
+}
+
+TEST_F(DFileCopyMoveJobTest, start_waitForTargetDeviceSync)
+{
+    DFileCopyMoveJobPrivate *jobd = job->d_func();
+    ASSERT_TRUE(jobd);
+
+    jobd->state = DFileCopyMoveJob::RunningState;
+    jobd->targetSysDevPath = "/proc/ut_dfilecopymovejob_no_such_device";
+    jobd->targetDeviceStartSectorsWritten = 0;
+
+    // 全部是空洞时设备上没有扇区写入，不需要等待
+    jobd->completedDataSize = 1024 * 1024;
+    jobd->completedDataSizeWithoutWrite = 1024 * 1024;
+    QElapsedTimer timer;
+    timer.start();
+    jobd->waitForTargetDeviceSync();
+    EXPECT_LT(timer.elapsed(), 1000);
+
+    // 扇区计数一直不增长时超时结束等待
+    jobd->completedDataSizeWithoutWrite = 0;
+    jobd->syncStallTimeout = 5;
+    timer.restart();
+    jobd->waitForTargetDeviceSync();
+    EXPECT_GE(timer.elapsed(), 5);
+    EXPECT_LT(timer.elapsed(), 1000);
+
+    jobd->completedDataSize = 0;
+    jobd->targetDeviceStartSectorsWritten = -1;
+    jobd->state = DFileCopyMoveJob::StoppedState;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <QFile>
+
+#include "dfilecopypipeline.h"
+#include "testhelper.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace testing;
+DFM_USE_NAMESPACE
+
+class DFileCopyPipelineTest: public testing::Test
+{
+public:
+    QString fromPath;
+    QString toPath;
+    QByteArray data;
+
+    virtual void SetUp() override
+    {
+        fromPath = TestHelper::createTmpFile(".from");
+        toPath = TestHelper::createTmpFile(".to");
+        data.resize(5 * 1024 * 1024 + 123);
+        for (int i = 0; i < data.size(); ++i)
+            data[i] = static_cast<char>(i % 251);
+
+        QFile file(fromPath);
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(data);
+            file.close();
+        }
+        std::cout << "start DFileCopyPipelineTest" << std::endl;
+    }
+
+    virtual void TearDown() override
+    {
+        TestHelper::deleteTmpFiles({fromPath, toPath});
+        std::cout << "end DFileCopyPipelineTest" << std::endl;
+    }
+};
+
+TEST_F(DFileCopyPipelineTest, can_copy)
+{
+    DFileCopyPipeline pipeline(3, 1024 * 1024);
+    EXPECT_EQ(0, pipeline.copy(-1, -1, 0, data.size()));
+
+    int fromFd = open(fromPath.toLocal8Bit().data(), O_RDONLY);
+    int toFd = open(toPath.toLocal8Bit().data(), O_WRONLY | O_TRUNC);
+    qint64 progressSize = 0;
+    EXPECT_EQ(data.size(), pipeline.copy(fromFd, toFd, 0, data.size(), [&](qint64 size) {
+        progressSize += size;
+        return true;
+    }));
+    EXPECT_EQ(data.size(), progressSize);
+    EXPECT_EQ(0, pipeline.error());
+    close(fromFd);
+    close(toFd);
+
+    QFile file(toPath);
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    EXPECT_TRUE(file.readAll() == data);
+}
+
+TEST_F(DFileCopyPipelineTest, can_copy_from_offset)
+{
+    DFileCopyPipeline pipeline(2, 512 * 1024);
+    const qint64 offset = 1024 * 1024 + 7;
+
+    int fromFd = open(fromPath.toLocal8Bit().data(), O_RDONLY);
+    int toFd = open(toPath.toLocal8Bit().data(), O_WRONLY | O_TRUNC);
+    EXPECT_EQ(data.size() - offset, pipeline.copy(fromFd, toFd, offset, data.size() - offset));
+    close(fromFd);
+    close(toFd);
+
+    QFile file(toPath);
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    EXPECT_EQ(data.size(), file.size());
+    EXPECT_TRUE(file.readAll().mid(static_cast<int>(offset)) == data.mid(static_cast<int>(offset)));
+}
+
+TEST_F(DFileCopyPipelineTest, can_stop)
+{
+    DFileCopyPipeline pipeline(2, 1024 * 1024);
+
+    int fromFd = open(fromPath.toLocal8Bit().data(), O_RDONLY);
+    int toFd = open(toPath.toLocal8Bit().data(), O_WRONLY | O_TRUNC);
+    qint64 copied = pipeline.copy(fromFd, toFd, 0, data.size(), [](qint64) {
+        return false;
+    });
+    EXPECT_TRUE(copied > 0 && copied < data.size());
+    EXPECT_EQ(0, pipeline.error());
+    close(fromFd);
+    close(toFd);
+}
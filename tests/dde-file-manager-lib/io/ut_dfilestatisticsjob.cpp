@@ -21,6 +21,11 @@
 
 #include <gtest/gtest.h>
 #include <QDateTime>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
+
+#include <unistd.h>
 
 #include "dfilestatisticsjob.h"
 
@@ -123,3 +128,45 @@ TEST_F(DFileStatisticsJobTest,can_running_ExcludeSourceFile) {
     }
     job->stop();
 }
+
+TEST_F(DFileStatisticsJobTest,can_running_local_walker) {
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    ASSERT_TRUE(QDir(dir.path()).mkpath("a/b"));
+
+    QFile file(dir.filePath("a/b/file"));
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(100, 'x'));
+    file.close();
+    ASSERT_EQ(0, ::link(QFile::encodeName(dir.filePath("a/b/file")).constData(),
+                        QFile::encodeName(dir.filePath("a/link")).constData()));
+
+    auto runJob = [&](DFileStatisticsJob::FileHints hints) {
+        DFileStatisticsJob statisticsJob;
+        statisticsJob.setFileHints(hints);
+        statisticsJob.start(DUrlList() << DUrl::fromLocalFile(dir.path()));
+        statisticsJob.wait();
+
+        EXPECT_EQ(2, statisticsJob.filesCount());
+        EXPECT_EQ(3, statisticsJob.directorysCount());
+        return statisticsJob.totalSize();
+    };
+
+    EXPECT_EQ(200, runJob(DFileStatisticsJob::FileHints()));
+    EXPECT_EQ(100, runJob(DFileStatisticsJob::DeduplicateHardLinks));
+    // 第二次统计使用缓存，结果相同
+    EXPECT_EQ(100, runJob(DFileStatisticsJob::DeduplicateHardLinks));
+
+    // 子目录变化后缓存失效
+    QFile newFile(dir.filePath("a/b/new"));
+    ASSERT_TRUE(newFile.open(QIODevice::WriteOnly));
+    newFile.write(QByteArray(10, 'x'));
+    newFile.close();
+
+    DFileStatisticsJob statisticsJob;
+    statisticsJob.setFileHints(DFileStatisticsJob::DeduplicateHardLinks);
+    statisticsJob.start(DUrlList() << DUrl::fromLocalFile(dir.path()));
+    statisticsJob.wait();
+    EXPECT_EQ(3, statisticsJob.filesCount());
+    EXPECT_EQ(110, statisticsJob.totalSize());
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "dfilewritebackcontroller.h"
+#include "testhelper.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace testing;
+DFM_USE_NAMESPACE
+
+class DFileWritebackControllerTest: public testing::Test
+{
+public:
+    QString toPath;
+    int toFd = -1;
+    QByteArray data;
+    DFileWritebackController controller;
+
+    virtual void SetUp() override
+    {
+        toPath = TestHelper::createTmpFile(".to");
+        toFd = open(toPath.toLocal8Bit().constData(), O_WRONLY | O_TRUNC);
+        data.fill('a', 64 * 1024);
+
+        DFileWritebackController::Policy policy;
+        policy.rangeSize = 128 * 1024;
+        policy.syncSize = 256 * 1024;
+        policy.syncInterval = 60 * 1000;
+        controller.setPolicy(policy);
+        controller.setEnabled(true);
+        std::cout << "start DFileWritebackControllerTest" << std::endl;
+    }
+
+    virtual void TearDown() override
+    {
+        if (toFd >= 0)
+            close(toFd);
+        TestHelper::deleteTmpFiles({toPath});
+        std::cout << "end DFileWritebackControllerTest" << std::endl;
+    }
+};
+
+TEST_F(DFileWritebackControllerTest, can_choose_policy)
+{
+    EXPECT_TRUE(DFileWritebackController::needWriteback("vfat"));
+    EXPECT_TRUE(DFileWritebackController::needWriteback("cifs"));
+    EXPECT_TRUE(DFileWritebackController::needWriteback(QString(), true));
+    EXPECT_FALSE(DFileWritebackController::needWriteback("ext4"));
+
+    EXPECT_EQ(0, DFileWritebackController::policyOfFileSystem(QString(), true).rangeSize);
+    EXPECT_LT(DFileWritebackController::policyOfFileSystem("vfat").syncSize,
+              DFileWritebackController::policyOfFileSystem("ext4").syncSize);
+}
+
+TEST_F(DFileWritebackControllerTest, can_count_durable_size)
+{
+    ASSERT_GE(toFd, 0);
+    DFileWriteback writeback(&controller, toFd);
+    qint64 offset = 0;
+
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(data.size(), write(toFd, data.constData(), static_cast<size_t>(data.size())));
+        EXPECT_TRUE(writeback.written(offset, data.size()));
+        offset += data.size();
+    }
+    // 未到达同步的大小
+    EXPECT_EQ(0, controller.durableSize());
+
+    ASSERT_EQ(data.size(), write(toFd, data.constData(), static_cast<size_t>(data.size())));
+    EXPECT_TRUE(writeback.written(offset, data.size()));
+    offset += data.size();
+    EXPECT_EQ(offset, controller.durableSize());
+
+    ASSERT_EQ(data.size(), write(toFd, data.constData(), static_cast<size_t>(data.size())));
+    EXPECT_TRUE(writeback.written(offset, data.size()));
+    offset += data.size();
+    writeback.skipped(100);
+    EXPECT_TRUE(writeback.finish());
+    EXPECT_EQ(offset + 100, controller.durableSize());
+
+    writeback.discard();
+    EXPECT_EQ(0, controller.durableSize());
+}
+
+TEST_F(DFileWritebackControllerTest, can_sync_by_function)
+{
+    int syncCount = 0;
+    DFileWriteback writeback(&controller, -1, [&syncCount]() {
+        ++syncCount;
+        return true;
+    });
+
+    EXPECT_TRUE(writeback.written(0, 300 * 1024));
+    EXPECT_EQ(1, syncCount);
+    EXPECT_TRUE(writeback.finish());
+    EXPECT_EQ(1, syncCount);
+    EXPECT_EQ(300 * 1024, controller.durableSize());
+
+    controller.reset();
+    controller.setEnabled(false);
+    EXPECT_TRUE(writeback.written(300 * 1024, 300 * 1024));
+    EXPECT_EQ(1, syncCount);
+    EXPECT_EQ(0, controller.durableSize());
+}
+
+TEST_F(DFileWritebackControllerTest, can_retry_and_abandon)
+{
+    bool syncOk = false;
+    {
+        DFileWriteback writeback(&controller, -1, [&syncOk]() {
+            return syncOk;
+        });
+
+        // 同步失败时保留未同步的数据，finish()再次同步
+        EXPECT_FALSE(writeback.written(0, 300 * 1024));
+        EXPECT_EQ(EIO, writeback.error());
+        EXPECT_EQ(0, controller.durableSize());
+        syncOk = true;
+        EXPECT_TRUE(writeback.finish());
+        EXPECT_EQ(0, writeback.error());
+        EXPECT_EQ(300 * 1024, controller.durableSize());
+
+        EXPECT_TRUE(writeback.written(300 * 1024, 100));
+        EXPECT_EQ(300 * 1024, controller.durableSize());
+    }
+    // 没有同步完就放弃的文件，未同步的数据也计入已落盘的大小
+    EXPECT_EQ(300 * 1024 + 100, controller.durableSize());
+}
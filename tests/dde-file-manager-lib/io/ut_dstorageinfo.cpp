@@ -25,6 +25,7 @@
 #include <QDebug>
 #include <QProcess>
 #include <QRegularExpressionMatch>
+#include <QtConcurrent>
 #undef signals
 extern "C" {
 #include <gio/gio.h>
@@ -309,3 +310,38 @@ TEST_F(DStorageInfoTest,can_static_isCdRomDevice) {
     url.setPath("~/test.log");
     TestHelper::deleteTmpFiles(QStringList() << url.toLocalFile());
 }
+
+TEST_F(DStorageInfoTest,can_static_device_from_mount_table_cache) {
+    const QString &path = QDir::homePath();
+    DStorageInfo info(path);
+    EXPECT_EQ(info.isLocalDevice(), DStorageInfo::isLocalDevice(path));
+    EXPECT_EQ(info.isLowSpeedDevice(), DStorageInfo::isLowSpeedDevice(path));
+    EXPECT_EQ(info.device().startsWith("/dev/sr"), DStorageInfo::isCdRomDevice(path));
+
+    DStorageInfo::invalidateMountTableCache();
+    EXPECT_EQ(info.isLocalDevice(), DStorageInfo::isLocalDevice(path));
+    EXPECT_EQ(DStorageInfo("/").isLocalDevice(), DStorageInfo::isLocalDevice("/"));
+}
+
+TEST_F(DStorageInfoTest,can_static_query_mount_table_concurrently) {
+    const QString &path = QDir::homePath();
+    const bool isLocal = DStorageInfo::isLocalDevice(path);
+    QList<QFuture<bool>> futures;
+
+    for (int i = 0; i < 4; ++i) {
+        futures << QtConcurrent::run([path, isLocal]() {
+            for (int j = 0; j < 1000; ++j) {
+                if (DStorageInfo::isLocalDevice(path) != isLocal)
+                    return false;
+            }
+
+            return true;
+        });
+    }
+
+    for (int i = 0; i < 10; ++i)
+        DStorageInfo::invalidateMountTableCache();
+
+    for (QFuture<bool> &future : futures)
+        EXPECT_TRUE(future.result());
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+extern "C"
+{
+#include "database.h"
+#include "fsearch.h"
+#include "fsearch_config.h"
+}
+
+#include <gtest/gtest.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+
+#include <string.h>
+#include <sys/types.h>
+#include <utime.h>
+
+namespace  {
+    class TestFSearchSnapshot : public testing::Test {
+    public:
+        void SetUp() override
+        {
+            config = static_cast<FsearchConfig *>(calloc(1, sizeof(FsearchConfig)));
+            config_load_default(config);
+            config->locations = nullptr;
+
+            ASSERT_TRUE(tempDir.isValid());
+            path = tempDir.path().toLocal8Bit();
+            QDir(tempDir.path()).mkpath("sub");
+            createFile("a.txt");
+            createFile("b.txt");
+            createFile("sub/c.txt");
+        }
+
+        void TearDown() override
+        {
+            config_free(config);
+
+            // 快照保存在 fsearch 配置目录下以搜索路径的 sha256 命名的目录中
+            const QString &checksum = QCryptographicHash::hash(path, QCryptographicHash::Sha256).toHex();
+            QDir(QString::fromLocal8Bit(g_get_user_config_dir()) + "/fsearch/database/" + checksum).removeRecursively();
+        }
+
+        void createFile(const QString &name)
+        {
+            QFile file(tempDir.filePath(name));
+            file.open(QIODevice::WriteOnly);
+            file.close();
+        }
+
+        // 修改时间以秒为单位保存，把目录的修改时间改到过去，保证与快照中的不同
+        void touchDirectory(const QString &name)
+        {
+            struct utimbuf times;
+            times.actime = times.modtime = time(nullptr) - 100;
+            utime(tempDir.filePath(name).toLocal8Bit().constData(), &times);
+        }
+
+        Database *build()
+        {
+            Database *db = db_new();
+            bool state = true;
+
+            if (db_location_add(db, path.constData(), config, &state, nullptr))
+                db_build_initial_entries_list(db);
+
+            return db;
+        }
+
+        static QSet<QString> names(Database *db)
+        {
+            QSet<QString> result;
+            DynamicArray *entries = db_get_entries(db);
+
+            for (uint32_t i = 0; entries && i < db_get_num_entries(db); ++i) {
+                BTreeNode *node = static_cast<BTreeNode *>(darray_get_item(entries, i));
+
+                if (node)
+                    result << QString::fromLocal8Bit(node->name);
+            }
+
+            return result;
+        }
+
+        static void release(Database *db)
+        {
+            db_clear(db);
+            db_free(db);
+        }
+
+        QTemporaryDir tempDir;
+        QByteArray path;
+        FsearchConfig *config = nullptr;
+    };
+}
+
+TEST_F(TestFSearchSnapshot, save_and_load_snapshot)
+{
+    Database *db = build();
+    const QSet<QString> &builtNames = names(db);
+
+    EXPECT_TRUE(builtNames.contains("a.txt"));
+    EXPECT_TRUE(builtNames.contains("c.txt"));
+    EXPECT_TRUE(db_save_location(db, path.constData()));
+
+    Database *loaded = db_new();
+    ASSERT_TRUE(db_location_load(loaded, path.constData()));
+    db_update_entries_list(loaded);
+
+    EXPECT_EQ(db_get_num_entries(db), db_get_num_entries(loaded));
+    EXPECT_EQ(builtNames, names(loaded));
+
+    release(loaded);
+    release(db);
+}
+
+TEST_F(TestFSearchSnapshot, refresh_snapshot)
+{
+    Database *db = build();
+    ASSERT_TRUE(db_save_location(db, path.constData()));
+    release(db);
+
+    QFile::remove(tempDir.filePath("a.txt"));
+    createFile("sub/d.txt");
+    touchDirectory(".");
+    touchDirectory("sub");
+
+    // 加载快照时先刷新，搜索到的是最新的结果
+    FsearchApplication app;
+    memset(&app, 0, sizeof(app));
+    app.config = config;
+    bool state = true;
+    ASSERT_TRUE(load_database_from_snapshot(&app, path.constData(), &state));
+
+    const QSet<QString> &refreshedNames = names(app.db);
+    EXPECT_FALSE(refreshedNames.contains("a.txt"));
+    EXPECT_TRUE(refreshedNames.contains("b.txt"));
+    EXPECT_TRUE(refreshedNames.contains("d.txt"));
+    release(app.db);
+
+    // 刷新后的快照也会保存下来
+    Database *loaded = db_new();
+    ASSERT_TRUE(db_location_load(loaded, path.constData()));
+    db_update_entries_list(loaded);
+
+    const QSet<QString> &loadedNames = names(loaded);
+    EXPECT_FALSE(loadedNames.contains("a.txt"));
+    EXPECT_TRUE(loadedNames.contains("d.txt"));
+
+    release(loaded);
+}
+
+TEST_F(TestFSearchSnapshot, build_databases_in_parallel)
+{
+    Database *db = build();
+    const uint32_t count = db_get_num_entries(db);
+    release(db);
+
+    // 多个数据库同时建立时，各自的条目索引互不影响
+    QList<QFuture<QSet<QString>>> futures;
+
+    for (int i = 0; i < 4; ++i) {
+        futures << QtConcurrent::run([this] {
+            Database *db = build();
+            const QSet<QString> &result = names(db);
+            release(db);
+            return result;
+        });
+    }
+
+    for (QFuture<QSet<QString>> &future : futures) {
+        const QSet<QString> &result = future.result();
+        EXPECT_EQ(static_cast<int>(count), result.size());
+        EXPECT_TRUE(result.contains("sub"));
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "shutil/dfmtrashinfoindex.h"
+#include "interfaces/dfmstandardpaths.h"
+
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QFile>
+
+namespace  {
+    class TestDFMTrashInfoIndex : public testing::Test {
+    public:
+        QString infoFilePath = DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath) + "/ut_trash_info_index_file.trashinfo";
+        void SetUp() override
+        {
+            QDir().mkpath(DFMStandardPaths::location(DFMStandardPaths::TrashInfosPath));
+        }
+        void TearDown() override
+        {
+            QFile::remove(infoFilePath);
+            DFMTrashInfoIndex::instance()->update(infoFilePath);
+        }
+    };
+}
+
+TEST_F(TestDFMTrashInfoIndex, parse_trash_info)
+{
+    DFMTrashInfoIndex::Entry entry;
+    QByteArray data("[Trash Info]\n"
+                    "Path=/tmp/a%20b/%E6%96%87%E4%BB%B6.txt\n"
+                    "DeletionDate=2021-03-04T05:06:07\n"
+                    "TagNameList=Red,Blue\n");
+
+    EXPECT_TRUE(DFMTrashInfoIndex::parseTrashInfo(data, &entry));
+    EXPECT_EQ(QString("/tmp/a b/文件.txt"), entry.originalFilePath);
+    EXPECT_EQ(QString("2021-03-04T05:06:07"), entry.deletionDateString);
+    EXPECT_EQ(QDateTime(QDate(2021, 3, 4), QTime(5, 6, 7)), entry.deletionDate);
+    EXPECT_EQ(QStringList({"Red", "Blue"}), entry.tagNameList);
+
+    DFMTrashInfoIndex::Entry invalidEntry;
+    EXPECT_FALSE(DFMTrashInfoIndex::parseTrashInfo("Path=/tmp/a\n", &invalidEntry));
+}
+
+TEST_F(TestDFMTrashInfoIndex, update_from_watcher)
+{
+    QFile file(infoFilePath);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("[Trash Info]\nPath=/tmp/ut_trash_info_index_file\nDeletionDate=2021-03-04T05:06:07\n");
+    file.close();
+
+    DFMTrashInfoIndex::Entry entry;
+    EXPECT_TRUE(DFMTrashInfoIndex::instance()->entry("ut_trash_info_index_file", &entry));
+    EXPECT_EQ(QString("/tmp/ut_trash_info_index_file"), entry.originalFilePath);
+    EXPECT_TRUE(DFMTrashInfoIndex::instance()->names().contains("ut_trash_info_index_file"));
+
+    QFile::remove(infoFilePath);
+    DFMTrashInfoIndex::instance()->update(infoFilePath);
+    EXPECT_FALSE(DFMTrashInfoIndex::instance()->entry("ut_trash_info_index_file", &entry));
+}
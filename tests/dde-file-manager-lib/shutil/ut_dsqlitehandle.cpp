@@ -88,6 +88,8 @@ TEST_F(TestDSqliteHandle, can_dispose_clientDatas)
 
     StubExt st;
     st.set_lamda((bool(QSqlQuery::*)(const QString&))ADDR(QSqlQuery, exec), []{return true;});
+    st.set_lamda((bool(QSqlQuery::*)())ADDR(QSqlQuery, exec), []{return true;});
+    st.set_lamda(&QSqlQuery::prepare, []{return true;});
     st.set_lamda(&QSqlQuery::next, []{return ++nextCount > 3 ? false : true;});
     st.set_lamda((QVariant(QSqlQuery::*)(const QString&) const)ADDR(QSqlQuery, value), []{return QVariant("ut_qurey_value" + nextCount);});
     st.set_lamda((QVariant(QSqlQuery::*)(int) const)ADDR(QSqlQuery, value), []{return QVariant("ut_qurey_value" + nextCount);});
@@ -171,6 +173,8 @@ TEST_F(TestDSqliteHandle, can_get_sda_partions)
     StubExt st;
     nextCount = 0;
     st.set_lamda((bool(QSqlQuery::*)(const QString&))ADDR(QSqlQuery, exec), []{return true;});
+    st.set_lamda((bool(QSqlQuery::*)())ADDR(QSqlQuery, exec), []{return true;});
+    st.set_lamda(&QSqlQuery::prepare, []{return true;});
     st.set_lamda(&QSqlQuery::next, []{return ++nextCount > 3 ? false : true;});
 
     std::map<QString, std::multimap<QString, QString>> partionResult = m_pHandle->queryPartionsInfoOfDevices();
@@ -192,6 +196,8 @@ TEST_F(TestDSqliteHandle, can_monitor_the_mounted_points)
     StubExt st;
     nextCount = 0;
     st.set_lamda((bool(QSqlQuery::*)(const QString&))ADDR(QSqlQuery, exec), []{return true;});
+    st.set_lamda((bool(QSqlQuery::*)())ADDR(QSqlQuery, exec), []{return true;});
+    st.set_lamda(&QSqlQuery::prepare, []{return true;});
     st.set_lamda(&QSqlQuery::next, []{return ++nextCount > 3 ? false : true;});
     st.set_lamda((QVariant(QSqlQuery::*)(const QString&) const)ADDR(QSqlQuery, value), []{return QVariant("ut_qurey_value" + nextCount);});
     st.set_lamda((QVariant(QSqlQuery::*)(int) const)ADDR(QSqlQuery, value), []{return QVariant("ut_qurey_value" + nextCount);});
@@ -257,6 +263,79 @@ TEST_F(TestDSqliteHandle, test_before_tag_files)
 
     StubExt st;
     st.set_lamda((bool(QSqlQuery::*)(const QString&))ADDR(QSqlQuery, exec), []{return true;});
+    st.set_lamda((bool(QSqlQuery::*)())ADDR(QSqlQuery, exec), []{return true;});
+    st.set_lamda(&QSqlQuery::prepare, []{return true;});
     st.set_lamda(&QSqlQuery::next, []{return true;});
     EXPECT_TRUE(m_pHandle->disposeClientData(filesAndTags, 11).toBool());
 }
+
+TEST_F(TestDSqliteHandle, test_batch_tag_untag_and_rename_files)
+{
+    ASSERT_NE(m_pHandle, nullptr);
+
+    m_pHandle->m_sqlDatabasePtr.reset(new QSqlDatabase{ QSqlDatabase::addDatabase("QSQLITE", "ut_sqlite_batch") });
+    m_pHandle->m_sqlDatabasePtr->setDatabaseName(":memory:");
+    ASSERT_TRUE(m_pHandle->openSqlDatabase());
+
+    QSqlQuery sqlQuery{ *m_pHandle->m_sqlDatabasePtr };
+    EXPECT_TRUE(sqlQuery.exec("CREATE TABLE file_property (file_name TEXT NOT NULL UNIQUE, tag_1 TEXT NOT NULL, tag_2 TEXT, tag_3 TEXT)"));
+    EXPECT_TRUE(sqlQuery.exec("CREATE TABLE tag_with_file (tag_name TEXT NOT NULL, file_name TEXT NOT NULL)"));
+
+    QMap<QString, QList<QString>> filesAndTags;
+    filesAndTags["/ut_a.txt"] = QList<QString>{ m_tagNameAlpha, m_tagNameBeta };
+    filesAndTags["/ut_b.txt"] = QList<QString>{ m_tagNameAlpha };
+
+    // 重复标记不会产生重复的记录
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString, QList<QString>>, bool>(filesAndTags, "/")));
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString, QList<QString>>, bool>(filesAndTags, "/")));
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::TagFiles3, QList<QString>, bool>(filesAndTags.keys(), "/")));
+
+    ASSERT_TRUE(sqlQuery.exec("SELECT COUNT(*) FROM tag_with_file") && sqlQuery.next());
+    EXPECT_EQ(3, sqlQuery.value(0).toInt());
+    ASSERT_TRUE(sqlQuery.exec("SELECT tag_1, tag_2 FROM file_property WHERE file_name = '/ut_a.txt'") && sqlQuery.next());
+    EXPECT_EQ(m_tagNameAlpha, sqlQuery.value(0).toString());
+    EXPECT_EQ(m_tagNameBeta, sqlQuery.value(1).toString());
+
+    QMap<QString, QList<QString>> untagFiles;
+    untagFiles["/ut_b.txt"] = QList<QString>{ m_tagNameAlpha };
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles, QMap<QString, QList<QString>>, bool>(untagFiles, "/")));
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::UntagSamePartionFiles2, QMap<QString, QList<QString>>, bool>(untagFiles, "/")));
+
+    ASSERT_TRUE(sqlQuery.exec("SELECT COUNT(*) FROM file_property WHERE file_name = '/ut_b.txt'") && sqlQuery.next());
+    EXPECT_EQ(0, sqlQuery.value(0).toInt());
+
+    std::map<QString, QString> oldAndNewNames{ {"/ut_a.txt", "/ut_c.txt"} };
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName, std::map<QString, QString>, bool>(oldAndNewNames, "/")));
+
+    std::map<QString, QString> newNames{ {"/ut_c.txt", "/ut_a.txt"} };
+    QMap<QString, QList<QString>> renamedFileAndTags{ m_pHandle->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName2, std::map<QString, QString>,
+                                                      QMap<QString, QList<QString>>>(newNames, "/") };
+    EXPECT_EQ(renamedFileAndTags.value("/ut_c.txt"), (QList<QString>{ m_tagNameAlpha, m_tagNameBeta }));
+
+    // 互换和链式的重命名不会触发唯一约束，与批次外的文件冲突时只跳过冲突的那一个
+    QMap<QString, QList<QString>> swapFilesAndTags;
+    swapFilesAndTags["/ut_x.txt"] = QList<QString>{ m_tagNameAlpha };
+    swapFilesAndTags["/ut_y.txt"] = QList<QString>{ m_tagNameBeta };
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::TagFiles2, QMap<QString, QList<QString>>, bool>(swapFilesAndTags, "/")));
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::TagFiles3, QList<QString>, bool>(swapFilesAndTags.keys(), "/")));
+
+    std::map<QString, QString> swapNames{ {"/ut_x.txt", "/ut_y.txt"}, {"/ut_y.txt", "/ut_x.txt"} };
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName, std::map<QString, QString>, bool>(swapNames, "/")));
+    ASSERT_TRUE(sqlQuery.exec("SELECT tag_1 FROM file_property WHERE file_name = '/ut_x.txt'") && sqlQuery.next());
+    EXPECT_EQ(m_tagNameBeta, sqlQuery.value(0).toString());
+
+    std::map<QString, QString> chainNames{ {"/ut_x.txt", "/ut_c.txt"}, {"/ut_y.txt", "/ut_x.txt"} };
+    EXPECT_TRUE((m_pHandle->helpExecSql<DSqliteHandle::SqlType::ChangeFilesName, std::map<QString, QString>, bool>(chainNames, "/")));
+    ASSERT_TRUE(sqlQuery.exec("SELECT file_name, tag_1 FROM file_property ORDER BY file_name"));
+    QMap<QString, QString> fileAndFirstTag;
+    while (sqlQuery.next())
+        fileAndFirstTag[sqlQuery.value(0).toString()] = sqlQuery.value(1).toString();
+    // ut_x.txt 与已有的 ut_c.txt 冲突被跳过，它原来的名称已经被 ut_y.txt 占用
+    EXPECT_EQ(2, fileAndFirstTag.size());
+    EXPECT_EQ(m_tagNameAlpha, fileAndFirstTag.value("/ut_c.txt"));
+    EXPECT_EQ(m_tagNameAlpha, fileAndFirstTag.value("/ut_x.txt"));
+
+    m_pHandle->closeSqlDatabase();
+    m_pHandle->m_sqlDatabasePtr.reset(nullptr);
+    QSqlDatabase::removeDatabase("ut_sqlite_batch");
+}
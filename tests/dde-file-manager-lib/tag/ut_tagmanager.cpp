@@ -140,6 +140,28 @@ TEST_F(TestTagManager, can_getTagsThroughFiles)
     EXPECT_TRUE(!m_pManager->getTagsThroughFiles(files).isEmpty());
 }
 
+TEST_F(TestTagManager, can_getTagsOfFilesInDirectory_through_cache)
+{
+    ASSERT_NE(m_pManager, nullptr);
+
+    QString dirPath = QStandardPaths::standardLocations(QStandardPaths::TempLocation).first();
+    int count = 0;
+    StubExt stExt;
+    stExt.set_lamda(&TagManagerDaemonController::disposeClientData, [&]{
+        ++count;
+        return QVariant(QMap<QString, QVariant>({{tempDirPath_A, QVariant(QStringList({TAG_NAME_A}))}}));
+    });
+
+    EXPECT_EQ(m_pManager->getTagsOfFilesInDirectory(DUrl::fromLocalFile(dirPath)).value(tempDirPath_A), QStringList({TAG_NAME_A}));
+    EXPECT_EQ(m_pManager->getTagsThroughFiles({DUrl::fromLocalFile(tempDirPath_A)}), QStringList({TAG_NAME_A}));
+    EXPECT_TRUE(m_pManager->getTagsThroughFiles({DUrl::fromLocalFile(tempDirPath_B)}).isEmpty());
+    EXPECT_EQ(count, 1);
+
+    m_pManager->removeTagsCacheOfFiles({tempDirPath_A});
+    EXPECT_EQ(m_pManager->getTagsThroughFiles({DUrl::fromLocalFile(tempDirPath_A)}), QStringList({TAG_NAME_A}));
+    EXPECT_EQ(count, 2);
+}
+
 TEST_F(TestTagManager, can_getTagColor)
 {
     ASSERT_NE(m_pManager, nullptr);
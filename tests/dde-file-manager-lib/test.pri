@@ -17,6 +17,11 @@ isEqual(ARCH, x86_64) {
 SOURCES += $$PWD/shutil/ut_danythingmonitor.cpp
 }
 
+# 与 dfsearch.pri 的编译条件一致
+isEqual(ARCH, sw_64) | isEqual(ARCH, mips64) | isEqual(ARCH, mips32) | isEqual(ARCH, aarch64) | isEqual(ARCH, loongarch64) {
+SOURCES += $$PWD/search/ut_fsearchsnapshot.cpp
+}
+
 SOURCES += \
     $$PWD/main.cpp \
     # vault
@@ -24,6 +29,9 @@ SOURCES += \
     $$PWD/vault/ut_interfaceactivevault.cpp \
     $$PWD/shutil/ut_checknetwork.cpp \
     $$PWD/io/ut_dfilecopymovejob.cpp \
+    $$PWD/io/ut_dfilecopypipeline.cpp \
+    $$PWD/io/ut_dfilewritebackcontroller.cpp \
+    $$PWD/io/ut_dfilecopybufferpool.cpp \
     $$PWD/vault/ut_operatorcenter.cpp \
     $$PWD/vault/ut_vaulthelper.cpp \
     $$PWD/vault/ut_vaultlockmanager.cpp \
@@ -31,6 +39,7 @@ SOURCES += \
     $$PWD/shutil/ut_danythingmonitorfilter.cpp \
     $$PWD/shutil/ut_desktopfile.cpp \
     $$PWD/shutil/ut_dfmfilelistfile.cpp \
+    $$PWD/shutil/ut_dfmtrashinfoindex.cpp \
     $$PWD/shutil/ut_dfmregularexpression.cpp \
     $$PWD/controllers/ut_appcontroller.cpp \
     $$PWD/io/ut_dlocalfilehandler.cpp \
@@ -22,11 +22,15 @@
 
 #include <gtest/gtest.h>
 
+#define private public
 #include "imageview.h"
+#undef private
 #include "durl.h"
 
 #include <QImageReader>
 #include <QFile>
+#include <QThread>
+#include <QApplication>
 
 class TestImageView : public testing::Test {
 public:
@@ -74,3 +78,73 @@ TEST_F(TestImageView, get_source_size){
     m_imageView->setFile(m_url.toLocalFile(), format);
     EXPECT_TRUE(m_imageView->sourceSize().isValid());
 }
+
+TEST_F(TestImageView, read_scaled_and_clipped_image){
+    QByteArray format = QImageReader::imageFormat(m_url.toLocalFile());
+
+    QImage image = ImageView::readImage(m_url.toLocalFile(), format, QRect(), QSize(300, 400));
+    EXPECT_EQ(QSize(300, 400), image.size());
+
+    image = ImageView::readImage(m_url.toLocalFile(), format, QRect(100, 200, 200, 100), QSize(100, 50));
+    EXPECT_EQ(QSize(100, 50), image.size());
+
+    image = ImageView::readImage(QString("test"), format, QRect(), QSize());
+    EXPECT_TRUE(image.isNull());
+}
+
+TEST_F(TestImageView, size_hint_before_decoded){
+    QByteArray format = QImageReader::imageFormat(m_url.toLocalFile());
+    m_imageView->setFile(m_url.toLocalFile(), format);
+
+    // 解码在线程中进行，解码完成前就可以得到显示的大小
+    EXPECT_EQ(QSize(600, 800), m_imageView->sourceSize());
+    EXPECT_TRUE(m_imageView->sizeHint().isValid());
+    EXPECT_GE(m_imageView->sizeHint().width(), 400);
+}
+
+TEST_F(TestImageView, drop_tile_of_previous_file){
+    QByteArray format = QImageReader::imageFormat(m_url.toLocalFile());
+    m_imageView->setFile(m_url.toLocalFile(), format);
+    m_imageView->resize(400, 300);
+
+    // png 不支持裁剪解码，放大时解码一次整张图片作为图块
+    EXPECT_FALSE(m_imageView->m_supportsClipRect);
+    m_imageView->m_image = QImage(300, 400, QImage::Format_ARGB32);
+    m_imageView->m_scale = 2;
+    m_imageView->requestTile();
+    EXPECT_EQ(QRect(0, 0, 600, 800), m_imageView->m_pendingTileSourceRect);
+
+    // 图块解码完成前切换了文件，之前文件的图块不能被使用
+    m_imageView->setFile(m_url.toLocalFile(), QByteArray("png"));
+    for (int i = 0; i < 100; ++i) {
+        QThread::msleep(10);
+        qApp->processEvents();
+    }
+    EXPECT_TRUE(m_imageView->m_tile.isNull());
+}
+
+TEST_F(TestImageView, limit_pixels_of_full_decode){
+    QByteArray format = QImageReader::imageFormat(m_url.toLocalFile());
+    m_imageView->setFile(m_url.toLocalFile(), format);
+    m_imageView->resize(400, 300);
+
+    // 不支持裁剪解码的大图按上限缩小解码，而不是解码原图或者不使用图块
+    m_imageView->m_sourceSize = QSize(8192, 8192);
+    m_imageView->m_image = QImage(300, 300, QImage::Format_ARGB32);
+    m_imageView->m_scale = 1000;
+    m_imageView->requestTile();
+    EXPECT_EQ(QRect(0, 0, 8192, 8192), m_imageView->m_pendingTileSourceRect);
+    EXPECT_DOUBLE_EQ(0.5, m_imageView->m_pendingTileScale);
+
+    m_imageView->setFile(m_url.toLocalFile(), format);
+}
+
+TEST_F(TestImageView, jpeg_supports_clip_rect){
+    QImage image(600, 800, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    ASSERT_TRUE(image.save(QString("./123.jpg"), "JPG"));
+
+    m_imageView->setFile(QString("./123.jpg"), QByteArray("jpeg"));
+    EXPECT_TRUE(m_imageView->m_supportsClipRect);
+    QFile::remove(QString("./123.jpg"));
+}
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui widgets quick
+QT       += core gui widgets quick concurrent
 
 TARGET = test-dde-text-preview-plugin
 TEMPLATE = app
@@ -25,10 +25,14 @@ QMAKE_LFLAGS += -g -Wall -fprofile-arcs -ftest-coverage  -O0
 
 SOURCES += \
     $$PWD/../../../../src/dde-file-manager-plugins/pluginPreview/dde-text-preview-plugin/textpreview.cpp \
+    $$PWD/../../../../src/dde-file-manager-plugins/pluginPreview/dde-text-preview-plugin/textfileindex.cpp \
+    $$PWD/../../../../src/dde-file-manager-plugins/pluginPreview/dde-text-preview-plugin/largetextview.cpp \
     $$PWD/../../../../src/dde-file-manager-plugins/pluginPreview/dde-text-preview-plugin/textpreviewplugin.cpp
 
 HEADERS += \
     $$PWD/../../../../src/dde-file-manager-plugins/pluginPreview/dde-text-preview-plugin/textpreview.h \
+    $$PWD/../../../../src/dde-file-manager-plugins/pluginPreview/dde-text-preview-plugin/textfileindex.h \
+    $$PWD/../../../../src/dde-file-manager-plugins/pluginPreview/dde-text-preview-plugin/largetextview.h \
     $$PWD/../../../../src/dde-file-manager-plugins/pluginPreview/dde-text-preview-plugin/textpreviewplugin.h
 
 #include(../../../../3rdparty/googletest/gtest_dependency.pri)
@@ -15,6 +15,7 @@ HEADERS += \
 SOURCES += \
     $$PWD/test-main.cpp \
     $$PWD/ut_textpreview.cpp \
+    $$PWD/ut_textfileindex.cpp \
     $$PWD/ut_textpreviewplugin.cpp
 
 !CONFIG(DISABLE_TSAN_TOOL) {
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2020 ~ 2021 Uniontech Software Technology Co., Ltd.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <gtest/gtest.h>
+
+#include <QFile>
+#include <QThread>
+
+#include "textfileindex.h"
+
+namespace  {
+    class TestTextFileIndex : public testing::Test {
+    public:
+        QString filePath = "./ut_text_file_index.txt";
+
+        void SetUp() override
+        {
+            QFile file(filePath);
+            file.open(QIODevice::WriteOnly);
+
+            file.write("first\r\n");
+            for (int i = 1; i < 1000; ++i)
+                file.write(QString("line %1\n").arg(i).toUtf8());
+
+            file.close();
+        }
+
+        void TearDown() override
+        {
+            m_index.close();
+            QFile::remove(filePath);
+        }
+
+        void waitForFinished()
+        {
+            for (int i = 0; i < 5000 && !m_index.isFinished(); ++i)
+                QThread::msleep(1);
+        }
+
+        TextFileIndex m_index;
+    };
+}
+
+TEST_F(TestTextFileIndex, build_line_index)
+{
+    ASSERT_TRUE(m_index.open(filePath));
+    waitForFinished();
+
+    EXPECT_TRUE(m_index.isFinished());
+    EXPECT_EQ(1000, m_index.lineCount());
+    EXPECT_EQ(QStringList({"first", "line 1"}), m_index.lines(0, 2));
+    EXPECT_EQ(QStringList({"line 500", "line 501"}), m_index.lines(500, 2));
+    EXPECT_EQ(QStringList({"line 999"}), m_index.lines(999, 5));
+    EXPECT_TRUE(m_index.lines(1000, 1).isEmpty());
+}
+
+TEST_F(TestTextFileIndex, open_empty_file)
+{
+    QFile file(filePath);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.close();
+
+    EXPECT_FALSE(m_index.open(filePath));
+    EXPECT_FALSE(m_index.isOpen());
+}
+
+TEST_F(TestTextFileIndex, split_long_line_at_char_boundary)
+{
+    // 前两个字节之后全部是 3 字节的 UTF-8 字符，kMaxLineLength 处正好落在字符中间
+    QByteArray data("ab");
+    while (data.size() < TextFileIndex::kMaxLineLength * 2)
+        data.append("中");
+
+    qint64 lineEnd = 0;
+    qint64 next = TextFileIndex::nextLineStart(data.constData(), data.size(), 0, &lineEnd);
+
+    EXPECT_EQ(next, lineEnd);
+    EXPECT_LE(next, TextFileIndex::kMaxLineLength);
+    EXPECT_EQ(2, next % 3);
+    EXPECT_NE(0x80, data.at(static_cast<int>(next)) & 0xC0);
+}
+
+TEST_F(TestTextFileIndex, truncate_file_after_open)
+{
+    ASSERT_TRUE(m_index.open(filePath));
+
+    // 文件被其它程序截断后，建立索引和读取文本只能读到剩余的内容，不会访问无效的内存
+    ASSERT_TRUE(QFile::resize(filePath, 0));
+    waitForFinished();
+
+    EXPECT_TRUE(m_index.isFinished());
+    EXPECT_LE(m_index.lineCount(), 1000);
+    EXPECT_TRUE(m_index.lines(0, 10).isEmpty());
+    EXPECT_TRUE(m_index.lines(999, 1).isEmpty());
+}
+
+TEST_F(TestTextFileIndex, truncate_file_after_index_built)
+{
+    ASSERT_TRUE(m_index.open(filePath));
+    waitForFinished();
+    ASSERT_EQ(1000, m_index.lineCount());
+
+    // 只保留第一行
+    ASSERT_TRUE(QFile::resize(filePath, 7));
+
+    EXPECT_EQ(QStringList({"first"}), m_index.lines(0, 10));
+    EXPECT_TRUE(m_index.lines(500, 2).isEmpty());
+}
@@ -24,8 +24,10 @@
 #include <gtest/gtest.h>
 
 #include <QIODevice>
+#include <QPointer>
 
 #include "textpreview.h"
+#include "largetextview.h"
 #include "durl.h"
 
 #include "stub.h"
@@ -86,3 +88,45 @@ TEST_F(TestTextPreview, get_show_statusbar_separator)
     EXPECT_TRUE(m_testPreview->setFileUrl(m_url));
     EXPECT_TRUE(m_testPreview->showStatusBarSeparator());
 }
+
+TEST_F(TestTextPreview, set_large_file_url)
+{
+    QFile fp("./2.txt");
+    fp.open(QIODevice::WriteOnly);
+    const QByteArray line(1023, 'a');
+    for (int i = 0; i < 5 * 1024; ++i)
+        fp.write(line + "\n");
+    fp.close();
+
+    EXPECT_TRUE(m_testPreview->setFileUrl(DUrl("./2.txt")));
+    EXPECT_TRUE(m_testPreview->contentWidget() != nullptr);
+    EXPECT_TRUE(m_testPreview->setFileUrl(m_url));
+
+    fp.remove();
+}
+
+TEST_F(TestTextPreview, release_index_before_content_widget)
+{
+    QFile fp("./2.txt");
+    fp.open(QIODevice::WriteOnly);
+    const QByteArray line(1023, 'a');
+    for (int i = 0; i < 5 * 1024; ++i)
+        fp.write(line + "\n");
+    fp.close();
+
+    EXPECT_TRUE(m_testPreview->setFileUrl(DUrl("./2.txt")));
+    QPointer<QWidget> widget = m_testPreview->contentWidget();
+    ASSERT_TRUE(widget);
+    LargeTextView *view = widget->findChild<LargeTextView *>();
+    ASSERT_TRUE(view);
+    EXPECT_TRUE(view->index() != nullptr);
+
+    // 内容控件延迟删除，预览析构后视图不再持有索引
+    delete m_testPreview;
+    m_testPreview = nullptr;
+    ASSERT_TRUE(widget);
+    EXPECT_TRUE(view->index() == nullptr);
+
+    delete widget;
+    fp.remove();
+}